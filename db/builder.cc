@@ -0,0 +1,121 @@
+#include "db/builder.h"
+
+#include "db/dbformat.h"
+#include "db/filename.h"
+#include "db/version.h"
+#include "leveldb/env.h"
+#include "leveldb/iterator.h"
+#include "leveldb/table.h"
+#include "leveldb/table_builder.h"
+#include "util/rate_limiter.h"
+
+namespace leveldb {
+
+Status BuildTable(const std::string& dbname, Env* env, const Options& options,
+                  Iterator* iter, const Slice* limit,
+                  const std::vector<RangeTombstone>& range_dels,
+                  FileMetaData* meta) {
+  Status s;
+  meta->file_size = 0;
+  const bool has_entries =
+      iter->Valid() &&
+      (limit == nullptr || options.comparator->Compare(iter->key(), *limit) < 0);
+  const bool has_range_dels = !range_dels.empty();
+  if (!has_entries && !has_range_dels) {
+    return iter->status();
+  }
+
+  std::string fname = TableFileName(dbname, meta->number);
+  WritableFile* file;
+  EnvOptions env_options;
+  env_options.use_direct_writes =
+      options.use_direct_io_for_flush_and_compaction;
+  env_options.writable_file_max_buffer_size =
+      options.writable_file_max_buffer_size;
+  s = env->NewWritableFile(fname, env_options, &file);
+  if (!s.ok()) {
+    return s;
+  }
+  if (options.rate_limiter != nullptr) {
+    file = NewRateLimitedWritableFile(file, options.rate_limiter,
+                                      RateLimiter::IO_HIGH);
+  }
+
+  TableBuilder* builder = new TableBuilder(options, file);
+  meta->smallest.Clear();
+  meta->largest.Clear();
+  if (has_entries) {
+    meta->smallest.DecodeFrom(iter->key());
+    for (; iter->Valid(); iter->Next()) {
+      const Slice key = iter->key();
+      if (limit != nullptr && options.comparator->Compare(key, *limit) >= 0) {
+        break;
+      }
+      builder->Add(key, iter->value());
+      meta->largest.DecodeFrom(key);
+    }
+  }
+  if (has_range_dels) {
+    // 区间删除也算进文件的 key 范围，end 是开区间，用作上界只会偏大
+    for (const RangeTombstone& t : range_dels) {
+      InternalKey start(t.start_key, t.seq, kTypeRangeDeletion);
+      builder->AddRangeTombstone(start.Encode(), t.end_key);
+      InternalKey end(t.end_key, kMaxSequenceNumber, kValueTypeForSeek);
+      if (meta->smallest.empty() ||
+          options.comparator->Compare(start.Encode(),
+                                      meta->smallest.Encode()) < 0) {
+        meta->smallest = start;
+      }
+      if (meta->largest.empty() ||
+          options.comparator->Compare(end.Encode(), meta->largest.Encode()) >
+              0) {
+        meta->largest = end;
+      }
+    }
+  }
+
+  // 写完文件
+  s = builder->Finish();
+  if (s.ok()) {
+    meta->file_size = builder->FileSize();
+    assert(meta->file_size > 0);
+  }
+  delete builder;
+
+  if (s.ok()) {
+    s = file->Sync();
+  }
+  if (s.ok()) {
+    s = file->Close();
+  }
+  delete file;
+  file = nullptr;
+
+  if (s.ok()) {
+    // 打开文件，确认生成的 sstable 可以读
+    RandomAccessFile* rfile;
+    s = env->NewRandomAccessFile(fname, &rfile);
+    if (s.ok()) {
+      meta->file.reset(rfile);
+      Table* table;
+      s = Table::Open(options, rfile, meta->file_size, &table);
+      if (s.ok()) {
+        meta->table.reset(table);
+      }
+    }
+  }
+
+  // 检查 iter 的错误
+  if (s.ok() && !iter->status().ok()) {
+    s = iter->status();
+  }
+
+  if (!s.ok() || meta->file_size == 0) {
+    meta->table.reset();
+    meta->file.reset();
+    env->RemoveFile(fname);
+  }
+  return s;
+}
+
+}  // namespace leveldb
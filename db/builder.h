@@ -0,0 +1,30 @@
+#ifndef STORAGE_LEVELDB_DB_BUILDER_H_
+#define STORAGE_LEVELDB_DB_BUILDER_H_
+
+#include <string>
+#include <vector>
+
+#include "db/range_tombstone.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+struct FileMetaData;
+class Env;
+class Iterator;
+struct Options;
+
+// 从 iter 的当前位置开始，把 internal key 小于 *limit（为 nullptr 时不限）的
+// entry 写入编号为 meta->number 的 sstable；range_dels 中的区间删除也写入
+// 这个文件，它们按 start_key 升序、start_key 相同时按 seq 降序排列
+// 成功时填充 *meta 的其余字段并打开文件；没有任何数据时不生成文件，
+// meta->file_size 为 0
+// options.comparator 必须是 InternalKeyComparator
+Status BuildTable(const std::string& dbname, Env* env, const Options& options,
+                  Iterator* iter, const Slice* limit,
+                  const std::vector<RangeTombstone>& range_dels,
+                  FileMetaData* meta);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_BUILDER_H_
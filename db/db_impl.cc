@@ -0,0 +1,999 @@
+#include "db/db_impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <utility>
+
+#include "db/builder.h"
+#include "db/db_iter.h"
+#include "db/filename.h"
+#include "db/memtable.h"
+#include "db/version.h"
+#include "db/write_batch_internal.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "leveldb/table.h"
+#include "leveldb/write_batch.h"
+#include "table/merger.h"
+#include "util/compression.h"
+
+namespace leveldb {
+
+// memtable 每有这么多数据才多切出一个 flush 分段，
+// 数据太少时多线程的开销比写文件本身还大
+static const size_t kFlushPartitionBytes = 1 << 20;
+
+DBImpl::SuperVersion::SuperVersion(MemTable* m, std::vector<MemTable*> i,
+                                   Version* v)
+    : mem(m), imm(std::move(i)), version(v), refs(1) {
+  mem->Ref();
+  for (MemTable* table : imm) {
+    table->Ref();
+  }
+  version->Ref();
+}
+
+DBImpl::SuperVersion::~SuperVersion() {
+  mem->Unref();
+  for (MemTable* table : imm) {
+    table->Unref();
+  }
+  version->Unref();
+}
+
+// 内部统一使用 internal key，comparator 和 filter_policy 都换成 internal 版本
+static Options SanitizeOptions(const InternalKeyComparator* icmp,
+                               const InternalFilterPolicy* ipolicy,
+                               const Options& src) {
+  Options result = src;
+  result.comparator = icmp;
+  result.filter_policy = (src.filter_policy != nullptr) ? ipolicy : nullptr;
+  result.max_write_buffer_number = std::max(result.max_write_buffer_number, 2);
+  result.flush_parallelism = std::max(result.flush_parallelism, 1);
+  return result;
+}
+
+DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
+    : env_(raw_options.env != nullptr ? raw_options.env : Env::Default()),
+      internal_comparator_(raw_options.comparator),
+      internal_filter_policy_(raw_options.filter_policy,
+                              raw_options.prefix_extractor),
+      options_(SanitizeOptions(&internal_comparator_, &internal_filter_policy_,
+                               raw_options)),
+      dbname_(dbname),
+      current_(new SuperVersion(new MemTable(internal_comparator_, options_),
+                                {}, new Version(&internal_comparator_, {}))),
+      last_sequence_(0),
+      shutting_down_(false),
+      background_flush_scheduled_(false),
+      next_file_number_(1) {}
+
+DBImpl::~DBImpl() {
+  // 等待正在进行的 flush 和冻结结束
+  std::unique_lock<std::mutex> l(mutex_);
+  shutting_down_.store(true, std::memory_order_release);
+  while (background_flush_scheduled_ || !freezing_.empty()) {
+    background_work_finished_signal_.wait(l);
+  }
+  assert(snapshots_.empty());
+  current_.load(std::memory_order_relaxed)->Unref();
+  // 还没回收的 SuperVersion 由 epochs_ 的析构函数释放
+}
+
+void DBImpl::InstallSuperVersion(SuperVersion* next) {
+  // 替换只是一次原子的指针写入，读者不需要加锁；
+  // 旧的 SuperVersion 可能还有读者在用，交给 epochs_ 延迟释放
+  SuperVersion* current = current_.load(std::memory_order_relaxed);
+  current_.store(next, std::memory_order_release);
+  epochs_.Retire(
+      [](void* arg) { reinterpret_cast<SuperVersion*>(arg)->Unref(); },
+      current);
+}
+
+Status DBImpl::MakeRoomForWrite(std::unique_lock<std::mutex>* lock) {
+  while (true) {
+    SuperVersion* current = current_.load(std::memory_order_relaxed);
+    if (!bg_error_.ok()) {
+      return bg_error_;
+    } else if (current->mem->ApproximateMemoryUsage() -
+                   current->mem->InitialMemoryUsage() <
+               options_.write_buffer_size) {
+      // 只计算写入的数据，固定开销再大也不会切换空的 memtable
+      return Status::OK();
+    } else if (current->imm.size() + 1 >=
+               static_cast<size_t>(options_.max_write_buffer_number)) {
+      // 只读的 memtable 太多，等待 flush 腾出位置
+      background_work_finished_signal_.wait(*lock);
+    } else {
+      SwitchMemTable();
+    }
+  }
+}
+
+void DBImpl::SwitchMemTable() {
+  SuperVersion* current = current_.load(std::memory_order_relaxed);
+  std::vector<MemTable*> imm;
+  imm.reserve(current->imm.size() + 1);
+  imm.push_back(current->mem);
+  imm.insert(imm.end(), current->imm.begin(), current->imm.end());
+  InstallSuperVersion(
+      new SuperVersion(new MemTable(internal_comparator_, options_),
+                       std::move(imm), current->version));
+
+  // 切换下来之后立即冻结，读者在等待 flush 期间就能用上只读形式
+  MemTable* mem = current->mem;
+  mem->Ref();
+  freezing_.insert(mem);
+  env_->StartThread(&DBImpl::BGFreeze,
+                    new std::pair<DBImpl*, MemTable*>(this, mem));
+  MaybeScheduleFlush();
+}
+
+void DBImpl::BGFreeze(void* arg) {
+  auto* p = reinterpret_cast<std::pair<DBImpl*, MemTable*>*>(arg);
+  DBImpl* db = p->first;
+  MemTable* mem = p->second;
+  delete p;
+
+  mem->MarkImmutable();
+  std::lock_guard<std::mutex> l(db->mutex_);
+  db->freezing_.erase(mem);
+  mem->Unref();
+  db->background_work_finished_signal_.notify_all();
+}
+
+int DBImpl::TEST_NumFrozenMemTables() {
+  std::lock_guard<std::mutex> l(mutex_);
+  int n = 0;
+  for (MemTable* imm : current_.load(std::memory_order_relaxed)->imm) {
+    if (imm->IsImmutable()) {
+      n++;
+    }
+  }
+  return n;
+}
+
+Status DBImpl::TEST_FlushMemTable() {
+  std::unique_lock<std::mutex> l(mutex_);
+  // 只写入了少量数据时 arena 可能还没有分配新的 block，不能用内存用量判断
+  MemTable* mem = current_.load(std::memory_order_relaxed)->mem;
+  bool empty;
+  {
+    std::unique_ptr<Iterator> iter(mem->NewIterator());
+    iter->SeekToFirst();
+    empty = !iter->Valid() && mem->GetRangeTombstones() == nullptr;
+  }
+  if (!empty) {
+    while (bg_error_.ok() &&
+           current_.load(std::memory_order_relaxed)->imm.size() + 1 >=
+               static_cast<size_t>(options_.max_write_buffer_number)) {
+      background_work_finished_signal_.wait(l);
+    }
+    if (bg_error_.ok()) {
+      SwitchMemTable();
+    }
+  }
+  while (bg_error_.ok() &&
+         !current_.load(std::memory_order_relaxed)->imm.empty()) {
+    background_work_finished_signal_.wait(l);
+  }
+  return bg_error_;
+}
+
+std::vector<std::shared_ptr<FileMetaData>> DBImpl::TEST_Files() {
+  std::lock_guard<std::mutex> l(mutex_);
+  return current_.load(std::memory_order_relaxed)->version->files();
+}
+
+void DBImpl::MaybeScheduleFlush() {
+  if (background_flush_scheduled_) {
+    // 已经安排过了
+  } else if (shutting_down_.load(std::memory_order_acquire)) {
+    // 正在关闭，不再开始新的 flush
+  } else if (!bg_error_.ok()) {
+    // 出错之后不再写文件
+  } else if (current_.load(std::memory_order_relaxed)->imm.empty() &&
+             !epochs_.HasPending()) {
+    // 没有需要 flush 的 memtable，也没有等待回收的 SuperVersion
+  } else {
+    background_flush_scheduled_ = true;
+    env_->Schedule(&DBImpl::BGWork, this);
+  }
+}
+
+void DBImpl::BGWork(void* db) {
+  reinterpret_cast<DBImpl*>(db)->BackgroundCall();
+}
+
+void DBImpl::BackgroundCall() {
+  std::unique_lock<std::mutex> l(mutex_);
+  assert(background_flush_scheduled_);
+  if (!shutting_down_.load(std::memory_order_acquire) && bg_error_.ok() &&
+      !current_.load(std::memory_order_relaxed)->imm.empty()) {
+    Status s = FlushOldestMemTable(&l);
+    if (!s.ok()) {
+      bg_error_ = s;
+    }
+  }
+  ReclaimSuperVersions(&l);
+  background_flush_scheduled_ = false;
+
+  // 一次只 flush 一个 memtable，还有剩下的就再安排一次
+  MaybeScheduleFlush();
+  background_work_finished_signal_.notify_all();
+}
+
+void DBImpl::ReclaimSuperVersions(std::unique_lock<std::mutex>* lock) {
+  // 读者在 epoch 中最多读几个 block，很快就会退出；
+  // 还有 memtable 等待 flush 时先去 flush，之后会再回到这里
+  epochs_.TryReclaim();
+  while (epochs_.HasPending() &&
+         !shutting_down_.load(std::memory_order_acquire) &&
+         current_.load(std::memory_order_relaxed)->imm.empty()) {
+    background_work_finished_signal_.wait_for(*lock,
+                                              std::chrono::milliseconds(1));
+    epochs_.TryReclaim();
+  }
+}
+
+Status DBImpl::FlushOldestMemTable(std::unique_lock<std::mutex>* lock) {
+  MemTable* mem = current_.load(std::memory_order_relaxed)->imm.back();
+  // 从只读形式生成 sstable 更快，等它冻结完
+  while (freezing_.count(mem) != 0) {
+    background_work_finished_signal_.wait(*lock);
+  }
+  mem->Ref();
+  // 预留足够的文件编号，生成文件的过程中不需要再加锁
+  const uint64_t first_number = next_file_number_;
+  next_file_number_ += options_.flush_parallelism;
+
+  std::vector<std::shared_ptr<FileMetaData>> files;
+  lock->unlock();
+  Status s = WriteLevel0Tables(mem, first_number, &files);
+  lock->lock();
+
+  if (s.ok()) {
+    // flush 期间可能又有 memtable 被切换下来，它们都排在 mem 前面
+    SuperVersion* current = current_.load(std::memory_order_relaxed);
+    assert(current->imm.back() == mem);
+    std::vector<MemTable*> imm(current->imm.begin(), current->imm.end() - 1);
+    // 新文件比已有的文件新，排在前面
+    files.insert(files.end(), current->version->files().begin(),
+                 current->version->files().end());
+    InstallSuperVersion(new SuperVersion(
+        current->mem, std::move(imm),
+        new Version(&internal_comparator_, std::move(files))));
+  }
+  mem->Unref();
+  return s;
+}
+
+// 把 tombstones 与 [*lo, *hi) 相交的部分按 BuildTable 要求的顺序存入 *result，
+// lo/hi 为 nullptr 时对应的一侧不限
+static void ClipRangeTombstones(const std::vector<RangeTombstone>& tombstones,
+                                const Comparator* ucmp, const std::string* lo,
+                                const std::string* hi,
+                                std::vector<RangeTombstone>* result) {
+  result->clear();
+  for (const RangeTombstone& t : tombstones) {
+    if (hi != nullptr && ucmp->Compare(t.start_key, *hi) >= 0) {
+      break;  // tombstones 按 start_key 排序，之后的都在 hi 之后
+    }
+    if (lo != nullptr && ucmp->Compare(t.end_key, *lo) <= 0) {
+      continue;
+    }
+    RangeTombstone clipped = t;
+    if (lo != nullptr && ucmp->Compare(clipped.start_key, *lo) < 0) {
+      clipped.start_key = *lo;
+    }
+    if (hi != nullptr && ucmp->Compare(clipped.end_key, *hi) > 0) {
+      clipped.end_key = *hi;
+    }
+    result->push_back(std::move(clipped));
+  }
+  // 截断到 lo 的 tombstone 有了相同的 start_key，重新按 seq 降序排列
+  std::sort(result->begin(), result->end(),
+            [ucmp](const RangeTombstone& a, const RangeTombstone& b) {
+              int r = ucmp->Compare(a.start_key, b.start_key);
+              return r < 0 || (r == 0 && a.seq > b.seq);
+            });
+}
+
+Status DBImpl::WriteLevel0Tables(
+    MemTable* mem, uint64_t first_number,
+    std::vector<std::shared_ptr<FileMetaData>>* files) {
+  // 用 skiplist 高层的节点把 key 空间切成大致均匀的几段，
+  // 每段各生成一个 sstable；同一个 user key 的所有版本落在同一段
+  const size_t max_partitions = std::min<size_t>(
+      options_.flush_parallelism,
+      1 + mem->ApproximateMemoryUsage() / kFlushPartitionBytes);
+  std::vector<std::string> split_keys;
+  if (max_partitions > 1) {
+    mem->SampleSplitKeys(max_partitions - 1, &split_keys);
+  }
+  const size_t n = split_keys.size() + 1;
+
+  // 区间删除按同样的分段截断，每段只写入落在本段中的部分
+  std::vector<RangeTombstone> tombstones;
+  std::shared_ptr<const FragmentedRangeTombstoneList> range_dels =
+      mem->GetRangeTombstones();
+  if (range_dels != nullptr) {
+    tombstones = range_dels->tombstones();
+  }
+
+  // 第 i 段为 [bounds[i-1], bounds[i])，排在 split key 的所有版本之前
+  std::vector<InternalKey> bounds;
+  bounds.reserve(split_keys.size());
+  for (const std::string& key : split_keys) {
+    bounds.emplace_back(key, kMaxSequenceNumber, kValueTypeForSeek);
+  }
+
+  // flush 生成的文件属于第 0 层
+  Options table_options = options_;
+  table_options.compression = CompressionTypeForLevel(options_, 0);
+
+  std::vector<std::shared_ptr<FileMetaData>> metas(n);
+  std::vector<Status> statuses(n);
+  auto build = [&](size_t i) {
+    metas[i] = std::make_shared<FileMetaData>();
+    metas[i]->number = first_number + i;
+    ReadOptions ro;
+    Iterator* iter = mem->NewIterator(ro);
+    if (i == 0) {
+      iter->SeekToFirst();
+    } else {
+      iter->Seek(bounds[i - 1].Encode());
+    }
+    Slice limit;
+    if (i + 1 < n) {
+      limit = bounds[i].Encode();
+    }
+    std::vector<RangeTombstone> partition_dels;
+    ClipRangeTombstones(tombstones, internal_comparator_.user_comparator(),
+                        (i > 0) ? &split_keys[i - 1] : nullptr,
+                        (i + 1 < n) ? &split_keys[i] : nullptr,
+                        &partition_dels);
+    statuses[i] =
+        BuildTable(dbname_, env_, table_options, iter,
+                   (i + 1 < n) ? &limit : nullptr, partition_dels,
+                   metas[i].get());
+    delete iter;
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(n - 1);
+  for (size_t i = 1; i < n; i++) {
+    threads.emplace_back(build, i);
+  }
+  build(0);
+  for (std::thread& t : threads) {
+    t.join();
+  }
+
+  Status s;
+  for (const Status& status : statuses) {
+    if (!status.ok()) {
+      s = status;
+      break;
+    }
+  }
+  for (std::shared_ptr<FileMetaData>& meta : metas) {
+    if (meta->file_size == 0) {
+      continue;  // 这一段没有数据
+    }
+    if (s.ok()) {
+      files->push_back(std::move(meta));
+    } else {
+      // 有一段失败，整个 flush 作废，删除其他段已经生成的文件
+      meta->table.reset();
+      meta->file.reset();
+      env_->RemoveFile(TableFileName(dbname_, meta->number));
+    }
+  }
+  return s;
+}
+
+Status DBImpl::WriteEntry(ValueType type, const Slice& key,
+                          const Slice& value) {
+  std::unique_lock<std::mutex> l(mutex_);
+  Status s = MakeRoomForWrite(&l);
+  if (!s.ok()) {
+    return s;
+  }
+  const SequenceNumber sequence =
+      last_sequence_.load(std::memory_order_relaxed) + 1;
+  current_.load(std::memory_order_relaxed)->mem->Add(sequence, type, key,
+                                                      value);
+  // 写完 memtable 之后再发布 sequence，新的快照一定能看到完整的 entry
+  last_sequence_.store(sequence, std::memory_order_release);
+  if (epochs_.HasPending()) {
+    epochs_.TryReclaim();
+  }
+  return Status::OK();
+}
+
+Status DBImpl::Put(const WriteOptions& options, const Slice& key,
+                   const Slice& value) {
+  return WriteEntry(kTypeValue, key, value);
+}
+
+Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
+  return WriteEntry(kTypeDeletion, key, Slice());
+}
+
+Status DBImpl::DeleteRange(const WriteOptions& options, const Slice& begin_key,
+                           const Slice& end_key) {
+  if (internal_comparator_.user_comparator()->Compare(begin_key, end_key) > 0) {
+    return Status::InvalidArgument("begin key is after end key");
+  }
+  return WriteEntry(kTypeRangeDeletion, begin_key, end_key);
+}
+
+namespace {
+
+// 只检查 batch 的格式和区间删除的范围，不做任何修改
+class WriteBatchChecker : public WriteBatch::Handler {
+ public:
+  explicit WriteBatchChecker(const Comparator* ucmp)
+      : ucmp_(ucmp), bad_range_(false) {}
+
+  void Put(const Slice& key, const Slice& value) override {}
+  void Delete(const Slice& key) override {}
+  void DeleteRange(const Slice& begin_key, const Slice& end_key) override {
+    if (ucmp_->Compare(begin_key, end_key) > 0) {
+      bad_range_ = true;
+    }
+  }
+
+  bool bad_range() const { return bad_range_; }
+
+ private:
+  const Comparator* const ucmp_;
+  bool bad_range_;
+};
+
+}  // namespace
+
+Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
+  // 加锁之前先检查一遍，写 memtable 的途中不会出错，不会只写入一部分
+  WriteBatchChecker checker(internal_comparator_.user_comparator());
+  Status s = updates->Iterate(&checker);
+  if (!s.ok()) {
+    return s;
+  }
+  if (checker.bad_range()) {
+    return Status::InvalidArgument("begin key is after end key");
+  }
+  const int count = WriteBatchInternal::Count(updates);
+  if (count == 0) {
+    return Status::OK();
+  }
+
+  std::unique_lock<std::mutex> l(mutex_);
+  s = MakeRoomForWrite(&l);
+  if (!s.ok()) {
+    return s;
+  }
+  const SequenceNumber first =
+      last_sequence_.load(std::memory_order_relaxed) + 1;
+  WriteBatchInternal::SetSequence(updates, first);
+  MemTable* mem = current_.load(std::memory_order_relaxed)->mem;
+  s = WriteBatchInternal::InsertInto(updates, mem);
+  // 与 WriteEntry 相同，整个 batch 写完之后才发布 sequence
+  last_sequence_.store(first + count - 1, std::memory_order_release);
+  if (epochs_.HasPending()) {
+    epochs_.TryReclaim();
+  }
+  return s;
+}
+
+// 把 src 的内容复制到新文件 target，失败时删除 target
+static Status CopyFile(Env* env, const std::string& src,
+                       const std::string& target) {
+  static const size_t kBufferSize = 1 << 20;
+  uint64_t size;
+  Status s = env->GetFileSize(src, &size);
+  if (!s.ok()) {
+    return s;
+  }
+  RandomAccessFile* in;
+  s = env->NewRandomAccessFile(src, &in);
+  if (!s.ok()) {
+    return s;
+  }
+  WritableFile* out;
+  s = env->NewWritableFile(target, &out);
+  if (!s.ok()) {
+    delete in;
+    return s;
+  }
+
+  std::string scratch(kBufferSize, '\0');
+  uint64_t offset = 0;
+  while (s.ok() && offset < size) {
+    Slice chunk;
+    s = in->Read(offset, std::min<uint64_t>(kBufferSize, size - offset), &chunk,
+                 &scratch[0]);
+    if (s.ok() && chunk.empty()) {
+      s = Status::IOError(src, "file shrank while copying");
+    }
+    if (s.ok()) {
+      s = out->Append(chunk);
+      offset += chunk.size();
+    }
+  }
+  if (s.ok()) {
+    s = out->Sync();
+  }
+  if (s.ok()) {
+    s = out->Close();
+  }
+  delete out;
+  delete in;
+  if (!s.ok()) {
+    env->RemoveFile(target);
+  }
+  return s;
+}
+
+// memtable 中是否有 user key 落在 [smallest, largest] 中的 entry 或区间删除
+static bool MemTableOverlaps(MemTable* mem, const Comparator* ucmp,
+                             const Slice& smallest, const Slice& largest) {
+  InternalKey start(smallest, kMaxSequenceNumber, kValueTypeForSeek);
+  Iterator* iter = mem->NewIterator();
+  iter->Seek(start.Encode());
+  bool overlap =
+      iter->Valid() && ucmp->Compare(ExtractUserKey(iter->key()), largest) <= 0;
+  delete iter;
+
+  iter = mem->NewRangeTombstoneIterator();
+  for (iter->SeekToFirst(); iter->Valid() && !overlap; iter->Next()) {
+    // [begin, end) 与 [smallest, largest] 相交
+    overlap = ucmp->Compare(ExtractUserKey(iter->key()), largest) <= 0 &&
+              ucmp->Compare(iter->value(), smallest) > 0;
+  }
+  delete iter;
+  return overlap;
+}
+
+Status DBImpl::PrepareIngestedFile(const std::string& src,
+                                   const Options& table_options,
+                                   FileMetaData* meta) {
+  const std::string fname = TableFileName(dbname_, meta->number);
+  Status s = env_->LinkFile(src, fname);
+  if (!s.ok()) {
+    // 不在同一个文件系统中，只能复制
+    s = CopyFile(env_, src, fname);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  s = env_->GetFileSize(fname, &meta->file_size);
+  if (s.ok()) {
+    RandomAccessFile* file;
+    s = env_->NewRandomAccessFile(fname, &file);
+    if (s.ok()) {
+      meta->file.reset(file);
+      Table* table;
+      s = Table::Open(table_options, file, meta->file_size, &table);
+      if (s.ok()) {
+        meta->table.reset(table);
+      }
+    }
+  }
+  if (s.ok()) {
+    Iterator* range_del_iter = meta->table->NewRangeTombstoneIterator();
+    if (range_del_iter != nullptr) {
+      delete range_del_iter;
+      s = Status::InvalidArgument(src, "range deletions cannot be ingested");
+    }
+  }
+  if (s.ok()) {
+    // sequence 还没有确定，先记录 user key
+    Iterator* iter = meta->table->NewIterator(ReadOptions());
+    iter->SeekToFirst();
+    if (iter->Valid()) {
+      meta->smallest = InternalKey(iter->key(), 0, kTypeValue);
+      iter->SeekToLast();
+      meta->largest = InternalKey(iter->key(), 0, kTypeValue);
+    }
+    s = iter->status();
+    if (s.ok() && meta->smallest.empty()) {
+      s = Status::InvalidArgument(src, "file is empty");
+    }
+    delete iter;
+  }
+
+  if (!s.ok()) {
+    meta->table.reset();
+    meta->file.reset();
+    env_->RemoveFile(fname);
+  }
+  return s;
+}
+
+Status DBImpl::InstallIngestedFiles(
+    std::unique_lock<std::mutex>* lock,
+    std::vector<std::shared_ptr<FileMetaData>>* files) {
+  const Comparator* ucmp = internal_comparator_.user_comparator();
+  const std::string smallest = files->front()->smallest.user_key().ToString();
+  const std::string largest = files->back()->largest.user_key().ToString();
+
+  // memtable 中的数据比导入的文件新，重叠时先把它们 flush 成文件；
+  // 等待期间还有新的写入，每次醒来都要重新检查
+  SuperVersion* current;
+  while (true) {
+    if (!bg_error_.ok()) {
+      return bg_error_;
+    }
+    current = current_.load(std::memory_order_relaxed);
+    const bool mem_overlap =
+        MemTableOverlaps(current->mem, ucmp, smallest, largest);
+    bool imm_overlap = false;
+    for (MemTable* imm : current->imm) {
+      imm_overlap =
+          imm_overlap || MemTableOverlaps(imm, ucmp, smallest, largest);
+    }
+    if (!mem_overlap && !imm_overlap) {
+      break;
+    } else if (mem_overlap &&
+               current->imm.size() + 1 <
+                   static_cast<size_t>(options_.max_write_buffer_number)) {
+      SwitchMemTable();
+    } else {
+      background_work_finished_signal_.wait(*lock);
+    }
+  }
+
+  const std::vector<std::shared_ptr<FileMetaData>>& old_files =
+      current->version->files();
+  bool overlap = false;
+  for (const auto& f : old_files) {
+    if (ucmp->Compare(largest, f->smallest.user_key()) >= 0 &&
+        ucmp->Compare(smallest, f->largest.user_key()) <= 0) {
+      overlap = true;
+      break;
+    }
+  }
+
+  // 与已有的数据都不重叠、也没有快照时，放在最老的位置，sequence 为 0；
+  // 否则分配一个新的 sequence，放在最新的位置，已有的快照看不到这些 key
+  SequenceNumber seqno = 0;
+  if (overlap || !snapshots_.empty()) {
+    seqno = last_sequence_.load(std::memory_order_relaxed) + 1;
+    last_sequence_.store(seqno, std::memory_order_release);
+  }
+  for (const auto& f : *files) {
+    f->global_seqno = seqno;
+    f->smallest = InternalKey(f->smallest.user_key(), seqno, kTypeValue);
+    f->largest = InternalKey(f->largest.user_key(), seqno, kTypeValue);
+  }
+
+  std::vector<std::shared_ptr<FileMetaData>> new_files;
+  new_files.reserve(old_files.size() + files->size());
+  if (seqno == 0) {
+    new_files.insert(new_files.end(), old_files.begin(), old_files.end());
+    new_files.insert(new_files.end(), files->begin(), files->end());
+  } else {
+    new_files.insert(new_files.end(), files->begin(), files->end());
+    new_files.insert(new_files.end(), old_files.begin(), old_files.end());
+  }
+  InstallSuperVersion(new SuperVersion(
+      current->mem, current->imm,
+      new Version(&internal_comparator_, std::move(new_files))));
+  return Status::OK();
+}
+
+Status DBImpl::IngestExternalFile(
+    const std::vector<std::string>& external_files,
+    const IngestExternalFileOptions& ingest_options) {
+  if (external_files.empty()) {
+    return Status::InvalidArgument("no files to ingest");
+  }
+  uint64_t first_number;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    first_number = next_file_number_;
+    next_file_number_ += external_files.size();
+  }
+
+  // 导入的文件保存的是 user key，按 user comparator 打开
+  Options table_options = options_;
+  table_options.comparator = internal_comparator_.user_comparator();
+  table_options.filter_policy = (options_.filter_policy != nullptr)
+                                    ? internal_filter_policy_.user_policy()
+                                    : nullptr;
+
+  // 链接和打开文件都不需要加锁
+  std::vector<std::shared_ptr<FileMetaData>> files;
+  Status s;
+  for (size_t i = 0; s.ok() && i < external_files.size(); i++) {
+    auto meta = std::make_shared<FileMetaData>();
+    meta->number = first_number + i;
+    s = PrepareIngestedFile(external_files[i], table_options, meta.get());
+    if (s.ok()) {
+      files.push_back(std::move(meta));
+    }
+  }
+
+  if (s.ok()) {
+    const Comparator* ucmp = internal_comparator_.user_comparator();
+    std::sort(files.begin(), files.end(),
+              [ucmp](const std::shared_ptr<FileMetaData>& a,
+                     const std::shared_ptr<FileMetaData>& b) {
+                return ucmp->Compare(a->smallest.user_key(),
+                                     b->smallest.user_key()) < 0;
+              });
+    for (size_t i = 1; i < files.size(); i++) {
+      if (ucmp->Compare(files[i - 1]->largest.user_key(),
+                        files[i]->smallest.user_key()) >= 0) {
+        s = Status::InvalidArgument("ingested files overlap");
+        break;
+      }
+    }
+  }
+
+  if (s.ok()) {
+    std::unique_lock<std::mutex> l(mutex_);
+    s = InstallIngestedFiles(&l, &files);
+    if (s.ok()) {
+      // 之后可能一直没有写入，由后台线程回收替换下来的 SuperVersion
+      epochs_.TryReclaim();
+      MaybeScheduleFlush();
+    }
+  }
+
+  if (!s.ok()) {
+    for (const auto& f : files) {
+      f->table.reset();
+      f->file.reset();
+      env_->RemoveFile(TableFileName(dbname_, f->number));
+    }
+  } else if (ingest_options.move_files) {
+    // 数据库已经持有文件的链接或副本，删除原文件失败不影响导入
+    for (const std::string& fname : external_files) {
+      env_->RemoveFile(fname);
+    }
+  }
+  return s;
+}
+
+Status DBImpl::Get(const ReadOptions& options, const Slice& key,
+                   std::string* value) {
+  // 拷贝到 *value，不需要 pin
+  PinnableSlice result(value);
+  return GetImpl(options, key, &result, false);
+}
+
+Status DBImpl::Get(const ReadOptions& options, const Slice& key,
+                   PinnableSlice* value) {
+  return GetImpl(options, key, value, true);
+}
+
+Status DBImpl::GetImpl(const ReadOptions& options, const Slice& key,
+                       PinnableSlice* value, bool pin) {
+  // 先取 sequence 再取 memtable: 取到的 memtable 中一定包含所有
+  // sequence 不超过快照的 entry
+  SequenceNumber snapshot;
+  if (options.snapshot != nullptr) {
+    snapshot =
+        static_cast<const SnapshotImpl*>(options.snapshot)->sequence_number();
+  } else {
+    snapshot = last_sequence_.load(std::memory_order_acquire);
+  }
+
+  // 整个读操作都不加锁，除了 pin 住 memtable 中的值以外，
+  // 也不修改 memtable 和 version 的引用计数
+  EpochGuard guard(&epochs_);
+  SuperVersion* current = current_.load(std::memory_order_acquire);
+  LookupKey lkey(key, snapshot);
+  Status s;
+  Slice v;
+  bool done = current->mem->Get(lkey, &v, &s);
+  for (size_t i = 0; !done && i < current->imm.size(); i++) {
+    done = current->imm[i]->Get(lkey, &v, &s);
+  }
+  if (done) {
+    if (!s.ok()) {
+      value->Reset();
+    } else if (pin) {
+      // v 指向 memtable 的 arena，离开 epoch 之后由引用计数保证它有效
+      current->Ref();
+      value->PinSlice(
+          v,
+          [](void* arg1, void* arg2) {
+            reinterpret_cast<SuperVersion*>(arg1)->Unref();
+          },
+          current, nullptr);
+    } else {
+      value->PinSelf(v);
+    }
+    return s;
+  }
+
+  s = current->version->Get(options, lkey, value, pin);
+  if (!s.ok()) {
+    value->Reset();
+  }
+  return s;
+}
+
+std::vector<Status> DBImpl::MultiGet(const ReadOptions& options,
+                                     const std::vector<Slice>& keys,
+                                     std::vector<std::string>* values) {
+  SequenceNumber snapshot;
+  if (options.snapshot != nullptr) {
+    snapshot =
+        static_cast<const SnapshotImpl*>(options.snapshot)->sequence_number();
+  } else {
+    snapshot = last_sequence_.load(std::memory_order_acquire);
+  }
+
+  const size_t n = keys.size();
+  std::vector<Status> statuses(n);
+  values->resize(n);
+
+  EpochGuard guard(&epochs_);
+  const SuperVersion* current = current_.load(std::memory_order_acquire);
+
+  // memtable 中找不到的 key 留给 sstable 批量查找
+  std::deque<LookupKey> lkeys;  // LookupKey 不能移动
+  std::vector<const LookupKey*> pending_keys;
+  std::vector<std::string*> pending_values;
+  std::vector<size_t> pending;
+  for (size_t i = 0; i < n; i++) {
+    lkeys.emplace_back(keys[i], snapshot);
+    const LookupKey& lkey = lkeys.back();
+    std::string* value = &(*values)[i];
+    if (current->mem->Get(lkey, value, &statuses[i])) {
+      continue;
+    }
+    bool found = false;
+    for (MemTable* imm : current->imm) {
+      if (imm->Get(lkey, value, &statuses[i])) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      pending_keys.push_back(&lkey);
+      pending_values.push_back(value);
+      pending.push_back(i);
+    }
+  }
+
+  if (!pending.empty()) {
+    std::vector<Status> pending_statuses(pending.size());
+    current->version->MultiGet(options, pending_keys.data(),
+                               pending_values.data(), pending_statuses.data(),
+                               pending.size());
+    for (size_t j = 0; j < pending.size(); j++) {
+      statuses[pending[j]] = std::move(pending_statuses[j]);
+    }
+  }
+  return statuses;
+}
+
+Iterator* DBImpl::NewInternalIterator(
+    const ReadOptions& options, SequenceNumber* latest_snapshot,
+    std::shared_ptr<const FragmentedRangeTombstoneList>* range_dels) {
+  *latest_snapshot = last_sequence_.load(std::memory_order_acquire);
+
+  SuperVersion* current;
+  {
+    // 迭代器的生命周期不确定，不能一直处于 epoch 中，改为持有引用
+    EpochGuard guard(&epochs_);
+    current = current_.load(std::memory_order_acquire);
+    current->Ref();
+  }
+
+  std::vector<MemTable*> mems;
+  mems.reserve(current->imm.size() + 1);
+  mems.push_back(current->mem);
+  mems.insert(mems.end(), current->imm.begin(), current->imm.end());
+
+  std::vector<Iterator*> list;
+  std::vector<std::shared_ptr<const FragmentedRangeTombstoneList>> del_lists;
+  for (MemTable* m : mems) {
+    list.push_back(m->NewIterator(options));
+    std::shared_ptr<const FragmentedRangeTombstoneList> dels =
+        m->GetRangeTombstones();
+    if (dels != nullptr) {
+      del_lists.push_back(std::move(dels));
+    }
+  }
+  current->version->AddIterators(options, options_.prefix_extractor, &list);
+  if (current->version->range_dels() != nullptr) {
+    del_lists.push_back(current->version->range_dels());
+  }
+
+  range_dels->reset();
+  if (del_lists.size() == 1) {
+    *range_dels = std::move(del_lists[0]);
+  } else if (del_lists.size() > 1) {
+    // 多处都有区间删除，合在一起重新切分
+    *range_dels = std::make_shared<const FragmentedRangeTombstoneList>(
+        del_lists, internal_comparator_.user_comparator());
+  }
+
+  Iterator* internal_iter = NewMergingIterator(
+      &internal_comparator_, &list[0], static_cast<int>(list.size()));
+  internal_iter->RegisterCleanup(
+      [](void* arg1, void* arg2) {
+        reinterpret_cast<SuperVersion*>(arg1)->Unref();
+      },
+      current, nullptr);
+  return internal_iter;
+}
+
+Iterator* DBImpl::NewIterator(const ReadOptions& options) {
+  SequenceNumber latest_snapshot;
+  std::shared_ptr<const FragmentedRangeTombstoneList> range_dels;
+  Iterator* iter = NewInternalIterator(options, &latest_snapshot, &range_dels);
+  // 没有指定快照时，使用创建迭代器时的最新 sequence 作为隐式快照
+  return NewDBIterator(
+      internal_comparator_.user_comparator(), iter,
+      (options.snapshot != nullptr
+           ? static_cast<const SnapshotImpl*>(options.snapshot)
+                 ->sequence_number()
+           : latest_snapshot),
+      std::move(range_dels), options, options_.prefix_extractor);
+}
+
+const Snapshot* DBImpl::GetSnapshot() {
+  std::lock_guard<std::mutex> l(mutex_);
+  return snapshots_.New(last_sequence_.load(std::memory_order_relaxed));
+}
+
+void DBImpl::ReleaseSnapshot(const Snapshot* snapshot) {
+  std::lock_guard<std::mutex> l(mutex_);
+  snapshots_.Delete(static_cast<const SnapshotImpl*>(snapshot));
+}
+
+Snapshot::~Snapshot() = default;
+
+DB::~DB() = default;
+
+Status DB::Open(const Options& options, const std::string& dbname,
+                DB** dbptr) {
+  *dbptr = nullptr;
+  if (options.comparator == nullptr) {
+    return Status::InvalidArgument(dbname, "comparator is required");
+  }
+  Env* env = (options.env != nullptr) ? options.env : Env::Default();
+  Status s = env->CreateDir(dbname);
+  if (!s.ok()) {
+    return s;
+  }
+  // 不会加载已有的 sstable，与其让里面的数据悄悄消失，不如直接拒绝
+  std::vector<std::string> children;
+  s = env->GetChildren(dbname, &children);
+  if (!s.ok()) {
+    return s;
+  }
+  for (const std::string& child : children) {
+    uint64_t number;
+    if (ParseTableFileName(child, &number)) {
+      return Status::InvalidArgument(
+          dbname, "contains table files, reopening is not supported");
+    }
+  }
+  DBImpl* impl = new DBImpl(options, dbname);
+  // 固定开销比写入的数据还多，说明前缀 bloom 或者哈希桶的配置与
+  // write_buffer_size 不匹配
+  const size_t overhead =
+      impl->current_.load(std::memory_order_relaxed)->mem->InitialMemoryUsage();
+  if (overhead >= impl->options_.write_buffer_size) {
+    delete impl;
+    return Status::InvalidArgument(
+        dbname, "memtable overhead (" + std::to_string(overhead) +
+                    " bytes) is not below write_buffer_size");
+  }
+  *dbptr = impl;
+  return s;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,170 @@
+#ifndef STORAGE_LEVELDB_DB_DB_IMPL_H_
+#define STORAGE_LEVELDB_DB_DB_IMPL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/range_tombstone.h"
+#include "db/snapshot.h"
+#include "leveldb/db.h"
+#include "util/epoch.h"
+
+namespace leveldb {
+
+struct FileMetaData;
+class MemTable;
+class Version;
+
+class DBImpl : public DB {
+ public:
+  DBImpl(const Options& options, const std::string& dbname);
+
+  DBImpl(const DBImpl&) = delete;
+  DBImpl& operator=(const DBImpl&) = delete;
+
+  ~DBImpl() override;
+
+  // DB 接口的实现
+  Status Put(const WriteOptions&, const Slice& key,
+             const Slice& value) override;
+  Status Delete(const WriteOptions&, const Slice& key) override;
+  Status DeleteRange(const WriteOptions&, const Slice& begin_key,
+                     const Slice& end_key) override;
+  Status Write(const WriteOptions& options, WriteBatch* updates) override;
+  Status Get(const ReadOptions& options, const Slice& key,
+             std::string* value) override;
+  Status Get(const ReadOptions& options, const Slice& key,
+             PinnableSlice* value) override;
+  std::vector<Status> MultiGet(const ReadOptions& options,
+                               const std::vector<Slice>& keys,
+                               std::vector<std::string>* values) override;
+  Status IngestExternalFile(const std::vector<std::string>& files,
+                            const IngestExternalFileOptions& options) override;
+  Iterator* NewIterator(const ReadOptions&) override;
+  const Snapshot* GetSnapshot() override;
+  void ReleaseSnapshot(const Snapshot* snapshot) override;
+
+  // 测试用: 只读的 memtable 中已经冻结成只读形式的个数
+  int TEST_NumFrozenMemTables();
+
+  // 测试用: 切换当前的 memtable（为空时不切换），等待所有只读的 memtable
+  // flush 完成
+  Status TEST_FlushMemTable();
+
+  // 测试用: 当前所有的 sstable，从新到旧排列
+  std::vector<std::shared_ptr<FileMetaData>> TEST_Files();
+
+ private:
+  friend class DB;
+
+  // 某一时刻可读的全部数据: 正在写入的 mem、已经只读的 imm（较新的在前）
+  // 和 sstable 的集合 version
+  // 创建后不再修改，切换 memtable 或者 flush 完成时整体替换；
+  // 持有对所有 memtable 和 version 的引用
+  struct SuperVersion {
+    SuperVersion(MemTable* mem, std::vector<MemTable*> imm, Version* version);
+    ~SuperVersion();
+
+    void Ref() { refs.fetch_add(1, std::memory_order_relaxed); }
+    void Unref() {
+      if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+      }
+    }
+
+    MemTable* const mem;
+    const std::vector<MemTable*> imm;
+    Version* const version;
+    std::atomic<int> refs;
+  };
+
+  // 分配下一个 sequence 并写入 memtable
+  Status WriteEntry(ValueType type, const Slice& key, const Slice& value);
+
+  // 当前 memtable 写满时换成新的 memtable，只读的 memtable 太多时等待 flush
+  // 要求: lock 持有 mutex_
+  Status MakeRoomForWrite(std::unique_lock<std::mutex>* lock);
+
+  // 把当前的 memtable 转为只读并安排 flush
+  // 要求: 持有 mutex_，只读的 memtable 个数还没有达到上限
+  void SwitchMemTable();
+
+  // 发布新的 SuperVersion，旧的交给 epochs_ 延迟释放，要求: 持有 mutex_
+  void InstallSuperVersion(SuperVersion* next);
+
+  // 有只读的 memtable 或者等待回收的 SuperVersion 时安排后台任务，
+  // 要求: 持有 mutex_
+  void MaybeScheduleFlush();
+  static void BGWork(void* db);
+  void BackgroundCall();
+
+  // 在单独的线程中把刚切换下来的 memtable 整理成只读形式，
+  // 不必排在 flush 队列后面，也不占用写者持有 mutex_ 的时间
+  static void BGFreeze(void* arg);
+
+  // 回收替换下来的 SuperVersion，等待还在使用它们的读者退出；
+  // 有 memtable 需要 flush 或者正在关闭时提前返回，要求: lock 持有 mutex_
+  void ReclaimSuperVersions(std::unique_lock<std::mutex>* lock);
+
+  // 把最老的只读 memtable 写成 level-0 的 sstable，要求: lock 持有 mutex_
+  Status FlushOldestMemTable(std::unique_lock<std::mutex>* lock);
+
+  // 把 mem 切分成多段，在多个线程中分别生成 sstable，文件编号从
+  // first_number 开始，生成的文件追加到 *files
+  Status WriteLevel0Tables(MemTable* mem, uint64_t first_number,
+                           std::vector<std::shared_ptr<FileMetaData>>* files);
+
+  // 把外部文件 src 链接（或复制）成编号为 meta->number 的文件并打开，
+  // 填充 meta 中除 sequence 以外的字段；失败时不留下文件
+  Status PrepareIngestedFile(const std::string& src,
+                             const Options& table_options, FileMetaData* meta);
+
+  // 为 files（按 key 排序，互不重叠）分配 sequence 并加入新的 Version
+  // 与 memtable 重叠时先等待 flush，要求: lock 持有 mutex_
+  Status InstallIngestedFiles(std::unique_lock<std::mutex>* lock,
+                              std::vector<std::shared_ptr<FileMetaData>>* files);
+
+  // Get 的实现，pin 为 false 时总是把值拷贝到 value 的缓冲区
+  Status GetImpl(const ReadOptions& options, const Slice& key,
+                 PinnableSlice* value, bool pin);
+
+  // 返回遍历 internal key 的迭代器，*latest_snapshot 为创建时的最新 sequence，
+  // *range_dels 为所有 memtable 中的区间删除
+  Iterator* NewInternalIterator(
+      const ReadOptions&, SequenceNumber* latest_snapshot,
+      std::shared_ptr<const FragmentedRangeTombstoneList>* range_dels);
+
+  // 构造后不可更改
+  Env* const env_;
+  const InternalKeyComparator internal_comparator_;
+  const InternalFilterPolicy internal_filter_policy_;
+  const Options options_;  // comparator 和 filter_policy 换成了 internal 版本
+  const std::string dbname_;
+
+  // 读者在 epochs_ 的保护下直接读取 current_，不需要加锁；
+  // 替换下来的 SuperVersion 等到读者全部退出后才释放
+  EpochManager epochs_;
+  std::atomic<SuperVersion*> current_;  // 只在持有 mutex_ 时替换
+
+  // 写入 memtable 之后才发布，读者看到的 sequence 对应的 entry 一定已经写完
+  std::atomic<SequenceNumber> last_sequence_;
+
+  std::mutex mutex_;  // 串行化写操作，保护下面的成员
+  std::condition_variable background_work_finished_signal_;
+  std::atomic<bool> shutting_down_;
+  bool background_flush_scheduled_;
+  std::set<MemTable*> freezing_;  // 正在冻结的 memtable，flush 前要等它们完成
+  uint64_t next_file_number_;
+  Status bg_error_;  // flush 失败后的写操作都返回这个错误
+  SnapshotList snapshots_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_DB_IMPL_H_
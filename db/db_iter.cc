@@ -0,0 +1,345 @@
+#include "db/db_iter.h"
+
+#include <string>
+
+#include "leveldb/slice_transform.h"
+
+namespace leveldb {
+
+namespace {
+
+// memtable 中同一个 user key 的多个版本按 sequence 降序相邻存放:
+//    (user_key, seq, type) => value
+// DBIter 把它们合并成一个 user key，并根据 sequence 和 type 决定是否可见
+//
+// 正向遍历时，内部迭代器就停在当前 entry 上；
+// 反向遍历时，内部迭代器停在当前 user key 的所有 entry 之前，
+// 当前的 key/value 保存在 saved_key_/saved_value_ 中
+class DBIter : public Iterator {
+ public:
+  enum Direction { kForward, kReverse };
+
+  DBIter(const Comparator* cmp, Iterator* iter, SequenceNumber s,
+         std::shared_ptr<const FragmentedRangeTombstoneList> range_dels,
+         const Slice* upper_bound, const SliceTransform* prefix_extractor)
+      : user_comparator_(cmp),
+        iter_(iter),
+        sequence_(s),
+        range_dels_(std::move(range_dels)),
+        upper_bound_(upper_bound),
+        prefix_extractor_(prefix_extractor),
+        direction_(kForward),
+        valid_(false),
+        prefix_bounded_(false) {}
+
+  DBIter(const DBIter&) = delete;
+  DBIter& operator=(const DBIter&) = delete;
+
+  ~DBIter() override { delete iter_; }
+
+  bool Valid() const override { return valid_; }
+  Slice key() const override {
+    assert(valid_);
+    return (direction_ == kForward) ? ExtractUserKey(iter_->key()) : saved_key_;
+  }
+  Slice value() const override {
+    assert(valid_);
+    return (direction_ == kForward) ? iter_->value() : saved_value_;
+  }
+  Status status() const override {
+    if (status_.ok()) {
+      return iter_->status();
+    } else {
+      return status_;
+    }
+  }
+
+  void Next() override;
+  void Prev() override;
+  void Seek(const Slice& target) override;
+  void SeekToFirst() override;
+  void SeekToLast() override;
+
+ private:
+  void FindNextUserEntry(bool skipping, std::string* skip);
+  void FindPrevUserEntry();
+  bool ParseKey(ParsedInternalKey* key);
+
+  // 返回 ikey 在当前快照下实际的类型，被区间删除覆盖的值视为 kTypeDeletion
+  ValueType EffectiveType(const ParsedInternalKey& ikey) const {
+    if (ikey.type == kTypeValue && range_dels_ != nullptr &&
+        range_dels_->MaxCoveringTombstoneSeqnum(ikey.user_key, sequence_) >
+            ikey.sequence) {
+      return kTypeDeletion;
+    }
+    return ikey.type;
+  }
+
+  // 正向遍历时 user_key 已经超出 iterate_upper_bound 或者离开了 Seek 的前缀
+  bool PastUpperBound(const Slice& user_key) const {
+    return (upper_bound_ != nullptr &&
+            user_comparator_->Compare(user_key, *upper_bound_) >= 0) ||
+           OutOfPrefix(user_key);
+  }
+
+  // 离开了 Seek 的前缀，前缀单调，所以两个方向都可以据此停止
+  bool OutOfPrefix(const Slice& user_key) const {
+    return prefix_bounded_ && (!prefix_extractor_->InDomain(user_key) ||
+                               prefix_extractor_->Transform(user_key) !=
+                                   Slice(prefix_));
+  }
+
+  inline void SaveKey(const Slice& k, std::string* dst) {
+    dst->assign(k.data(), k.size());
+  }
+
+  inline void ClearSavedValue() {
+    if (saved_value_.capacity() > 1048576) {
+      std::string empty;
+      std::swap(empty, saved_value_);
+    } else {
+      saved_value_.clear();
+    }
+  }
+
+  const Comparator* const user_comparator_;
+  Iterator* const iter_;
+  SequenceNumber const sequence_;
+  const std::shared_ptr<const FragmentedRangeTombstoneList> range_dels_;
+  const Slice* const upper_bound_;
+  const SliceTransform* const prefix_extractor_;
+  Status status_;
+  std::string saved_key_;    // 反向遍历时的当前 key，正向遍历时用作临时存储
+  std::string saved_value_;  // 反向遍历时的当前 value
+  std::string prefix_;       // 最近一次 Seek 的 target 的前缀
+  Direction direction_;
+  bool valid_;
+  bool prefix_bounded_;      // prefix_ 是否有效
+};
+
+inline bool DBIter::ParseKey(ParsedInternalKey* ikey) {
+  if (!ParseInternalKey(iter_->key(), ikey)) {
+    status_ = Status::Corruption("corrupted internal key in DBIter");
+    return false;
+  } else {
+    return true;
+  }
+}
+
+void DBIter::Next() {
+  assert(valid_);
+
+  if (direction_ == kReverse) {  // 切换方向
+    direction_ = kForward;
+    // iter_ 停在当前 key 的所有 entry 之前，
+    // 或者已经越过开头（当前 key 是最小的 key）
+    if (!iter_->Valid()) {
+      iter_->SeekToFirst();
+    } else {
+      iter_->Next();
+    }
+    if (!iter_->Valid()) {
+      valid_ = false;
+      saved_key_.clear();
+      return;
+    }
+    // saved_key_ 中已经是需要跳过的 key
+  } else {
+    // 把当前 key 存到 saved_key_ 中，跳过它的其他版本
+    SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
+    iter_->Next();
+    if (!iter_->Valid()) {
+      valid_ = false;
+      saved_key_.clear();
+      return;
+    }
+  }
+
+  FindNextUserEntry(true, &saved_key_);
+}
+
+void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
+  // 循环直到找到一个合适的 entry
+  assert(iter_->Valid());
+  assert(direction_ == kForward);
+  do {
+    ParsedInternalKey ikey;
+    if (ParseKey(&ikey)) {
+      if (PastUpperBound(ikey.user_key)) {
+        // 后面的 key 都在范围之外，不用再往下扫描
+        break;
+      }
+      if (ikey.sequence > sequence_) {
+        iter_->Next();
+        continue;
+      }
+      switch (EffectiveType(ikey)) {
+        case kTypeDeletion:
+          // 这个 user key 剩下的 entry 都被删除了
+          SaveKey(ikey.user_key, skip);
+          skipping = true;
+          break;
+        case kTypeValue:
+          if (skipping &&
+              user_comparator_->Compare(ikey.user_key, *skip) <= 0) {
+            // 被隐藏
+          } else {
+            valid_ = true;
+            saved_key_.clear();
+            return;
+          }
+          break;
+        default:
+          break;
+      }
+    }
+    iter_->Next();
+  } while (iter_->Valid());
+  saved_key_.clear();
+  valid_ = false;
+}
+
+void DBIter::Prev() {
+  assert(valid_);
+
+  if (direction_ == kForward) {  // 切换方向
+    // iter_ 停在当前 entry 上，往前退到当前 key 的所有 entry 之前
+    assert(iter_->Valid());
+    SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
+    while (true) {
+      iter_->Prev();
+      if (!iter_->Valid()) {
+        valid_ = false;
+        saved_key_.clear();
+        ClearSavedValue();
+        return;
+      }
+      if (user_comparator_->Compare(ExtractUserKey(iter_->key()),
+                                    saved_key_) < 0) {
+        break;
+      }
+    }
+    direction_ = kReverse;
+  }
+
+  FindPrevUserEntry();
+}
+
+void DBIter::FindPrevUserEntry() {
+  assert(direction_ == kReverse);
+
+  ValueType value_type = kTypeDeletion;
+  if (iter_->Valid()) {
+    do {
+      ParsedInternalKey ikey;
+      if (ParseKey(&ikey)) {
+        if (OutOfPrefix(ikey.user_key)) {
+          // 更小的 key 都不在 Seek 的前缀里
+          break;
+        }
+        if (ikey.sequence > sequence_) {
+          iter_->Prev();
+          continue;
+        }
+        if ((value_type != kTypeDeletion) &&
+            user_comparator_->Compare(ikey.user_key, saved_key_) < 0) {
+          // 已经找到了一个没有被删除的 key，遇到了更小的 key，停止
+          break;
+        }
+        value_type = EffectiveType(ikey);
+        if (value_type == kTypeDeletion) {
+          saved_key_.clear();
+          ClearSavedValue();
+        } else {
+          Slice raw_value = iter_->value();
+          if (saved_value_.capacity() > raw_value.size() + 1048576) {
+            std::string empty;
+            std::swap(empty, saved_value_);
+          }
+          SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
+          saved_value_.assign(raw_value.data(), raw_value.size());
+        }
+      }
+      iter_->Prev();
+    } while (iter_->Valid());
+  }
+
+  if (value_type == kTypeDeletion) {
+    // 到头了
+    valid_ = false;
+    saved_key_.clear();
+    ClearSavedValue();
+    direction_ = kForward;
+  } else {
+    valid_ = true;
+  }
+}
+
+void DBIter::Seek(const Slice& target) {
+  direction_ = kForward;
+  prefix_bounded_ =
+      prefix_extractor_ != nullptr && prefix_extractor_->InDomain(target);
+  if (prefix_bounded_) {
+    Slice prefix = prefix_extractor_->Transform(target);
+    prefix_.assign(prefix.data(), prefix.size());
+  }
+  ClearSavedValue();
+  saved_key_.clear();
+  AppendInternalKey(&saved_key_,
+                    ParsedInternalKey(target, sequence_, kValueTypeForSeek));
+  iter_->Seek(saved_key_);
+  if (iter_->Valid()) {
+    FindNextUserEntry(false, &saved_key_ /* 临时存储 */);
+  } else {
+    valid_ = false;
+  }
+}
+
+void DBIter::SeekToFirst() {
+  direction_ = kForward;
+  prefix_bounded_ = false;
+  ClearSavedValue();
+  iter_->SeekToFirst();
+  if (iter_->Valid()) {
+    FindNextUserEntry(false, &saved_key_ /* 临时存储 */);
+  } else {
+    valid_ = false;
+  }
+}
+
+void DBIter::SeekToLast() {
+  direction_ = kReverse;
+  prefix_bounded_ = false;
+  ClearSavedValue();
+  if (upper_bound_ != nullptr) {
+    // 从上界之前开始往前找
+    saved_key_.clear();
+    AppendInternalKey(&saved_key_, ParsedInternalKey(*upper_bound_,
+                                                     kMaxSequenceNumber,
+                                                     kValueTypeForSeek));
+    iter_->Seek(saved_key_);
+    if (iter_->Valid()) {
+      iter_->Prev();
+    } else {
+      iter_->SeekToLast();
+    }
+  } else {
+    iter_->SeekToLast();
+  }
+  FindPrevUserEntry();
+}
+
+}  // namespace
+
+Iterator* NewDBIterator(
+    const Comparator* user_key_comparator, Iterator* internal_iter,
+    SequenceNumber sequence,
+    std::shared_ptr<const FragmentedRangeTombstoneList> range_dels,
+    const ReadOptions& read_options, const SliceTransform* prefix_extractor) {
+  return new DBIter(
+      user_key_comparator, internal_iter, sequence, std::move(range_dels),
+      read_options.iterate_upper_bound,
+      read_options.prefix_same_as_start ? prefix_extractor : nullptr);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,30 @@
+#ifndef STORAGE_LEVELDB_DB_DB_ITER_H_
+#define STORAGE_LEVELDB_DB_DB_ITER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "db/dbformat.h"
+#include "db/range_tombstone.h"
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+
+namespace leveldb {
+
+// 把遍历 internal key 的迭代器转换成遍历 user key 的迭代器:
+// 同一个 user key 只返回 sequence <= sequence 的最新版本，
+// 跳过点删除以及被区间删除 range_dels 覆盖的 entry
+// 遍历范围受 read_options.iterate_upper_bound 限制；
+// read_options.prefix_same_as_start 为 true 且 prefix_extractor 不为 nullptr 时，
+// Seek 之后离开 target 的前缀就停止
+// 返回的迭代器拥有 internal_iter 的所有权，range_dels 可以为 nullptr
+Iterator* NewDBIterator(
+    const Comparator* user_key_comparator, Iterator* internal_iter,
+    SequenceNumber sequence,
+    std::shared_ptr<const FragmentedRangeTombstoneList> range_dels,
+    const ReadOptions& read_options = ReadOptions(),
+    const SliceTransform* prefix_extractor = nullptr);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_DB_ITER_H_
@@ -0,0 +1,1083 @@
+#include "leveldb/db.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db/db_impl.h"
+#include "db/memtablerep.h"
+#include "db/version.h"
+#include "db/write_batch_internal.h"
+#include "gtest/gtest.h"
+#include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/iterator.h"
+#include "leveldb/memtablerep.h"
+#include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
+#include "leveldb/table.h"
+#include "leveldb/table_builder.h"
+#include "leveldb/write_batch.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+namespace {
+
+std::string Key(int i) {
+  char buf[16];
+  std::snprintf(buf, sizeof(buf), "key%06d", i);
+  return buf;
+}
+
+// 记录还没有销毁的 rep 的个数，每个 memtable 有一个点写入的 rep
+class CountingRepFactory : public MemTableRepFactory {
+ public:
+  CountingRepFactory()
+      : base_(NewSkipListRepFactory()), live_(0) {}
+
+  MemTableRep* CreateMemTableRep(const MemTableKeyComparator& cmp,
+                                 Arena* arena,
+                                 const SliceTransform* prefix_extractor)
+      const override {
+    return new CountingRep(base_->CreateMemTableRep(cmp, arena,
+                                                    prefix_extractor),
+                           &live_);
+  }
+
+  const char* Name() const override { return "CountingRepFactory"; }
+
+  int live() const { return live_.load(); }
+
+ private:
+  class CountingRep : public MemTableRep {
+   public:
+    CountingRep(MemTableRep* rep, std::atomic<int>* live)
+        : rep_(rep), live_(live) {
+      live_->fetch_add(1);
+    }
+    ~CountingRep() override { live_->fetch_sub(1); }
+
+    void Insert(const char* entry) override { rep_->Insert(entry); }
+    bool Contains(const char* entry) const override {
+      return rep_->Contains(entry);
+    }
+    const char* FindGreaterOrEqual(const LookupKey& k) const override {
+      return rep_->FindGreaterOrEqual(k);
+    }
+    void MarkReadOnly() override { rep_->MarkReadOnly(); }
+    void SampleSplitKeys(size_t n,
+                         std::vector<const char*>* entries) const override {
+      rep_->SampleSplitKeys(n, entries);
+    }
+    Iterator* GetIterator() override { return rep_->GetIterator(); }
+
+   private:
+    std::unique_ptr<MemTableRep> rep_;
+    std::atomic<int>* const live_;
+  };
+
+  std::unique_ptr<MemTableRepFactory> base_;
+  mutable std::atomic<int> live_;
+};
+
+}  // namespace
+
+class DBTest : public testing::Test {
+ public:
+  DBTest()
+      : dbname_(test::TmpDir("db_test")),
+        external_dir_(test::TmpDir("db_test_external")),
+        db_(nullptr) {}
+
+  ~DBTest() override { delete db_; }
+
+  Status TryOpen() {
+    Close();
+    return DB::Open(options_, dbname_, &db_);
+  }
+
+  // 等待后台 flush 结束并关闭数据库
+  void Close() {
+    delete db_;
+    db_ = nullptr;
+  }
+
+  void Open() { ASSERT_TRUE(TryOpen().ok()); }
+
+  Status Put(const std::string& k, const std::string& v) {
+    return db_->Put(WriteOptions(), k, v);
+  }
+
+  Status Delete(const std::string& k) { return db_->Delete(WriteOptions(), k); }
+
+  std::string Get(const std::string& k, const Snapshot* snapshot = nullptr) {
+    ReadOptions options;
+    options.snapshot = snapshot;
+    std::string result;
+    Status s = db_->Get(options, k, &result);
+    if (s.IsNotFound()) {
+      result = "NOT_FOUND";
+    } else if (!s.ok()) {
+      result = s.ToString();
+    }
+    return result;
+  }
+
+  // 以 "k1->v1 k2->v2" 的形式返回迭代器能看到的所有数据
+  std::string Contents(const ReadOptions& options = ReadOptions()) {
+    std::unique_ptr<Iterator> iter(db_->NewIterator(options));
+    std::string result;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      if (!result.empty()) result += " ";
+      result += iter->key().ToString() + "->" + iter->value().ToString();
+    }
+    EXPECT_TRUE(iter->status().ok());
+    return result;
+  }
+
+  // 写入足够的数据，让当前的 memtable 写满并被 flush
+  void FillMemTable(int base) {
+    for (int i = 0; i < 64; i++) {
+      ASSERT_TRUE(Put(Key(base + i), std::string(1024, 'x')).ok());
+    }
+  }
+
+  // 在 external_dir_ 中生成一个包含 Key(begin) ~ Key(end - 1) 的 sstable，
+  // value 为 value_prefix 加上编号，返回文件名
+  std::string BuildExternalFile(const std::string& name, int begin, int end,
+                                const std::string& value_prefix) {
+    const std::string fname = external_dir_ + "/" + name;
+    WritableFile* file;
+    EXPECT_TRUE(Env::Default()->NewWritableFile(fname, &file).ok());
+    TableBuilder builder(Options(), file);
+    for (int i = begin; i < end; i++) {
+      builder.Add(Key(i), value_prefix + std::to_string(i));
+    }
+    EXPECT_TRUE(builder.Finish().ok());
+    EXPECT_TRUE(file->Close().ok());
+    delete file;
+    return fname;
+  }
+
+  // 数据库目录中 sstable 的个数
+  int CountTableFiles() {
+    std::vector<std::string> children;
+    EXPECT_TRUE(Env::Default()->GetChildren(dbname_, &children).ok());
+    int tables = 0;
+    for (const std::string& child : children) {
+      if (child.size() > 4 &&
+          child.compare(child.size() - 4, 4, ".ldb") == 0) {
+        tables++;
+      }
+    }
+    return tables;
+  }
+
+  // 对 keys 调用一次 MultiGet，结果与逐个调用 Get 相同
+  void CheckMultiGet(const ReadOptions& options,
+                     const std::vector<std::string>& keys) {
+    std::vector<Slice> key_slices(keys.begin(), keys.end());
+    std::vector<std::string> values;
+    std::vector<Status> statuses = db_->MultiGet(options, key_slices, &values);
+    ASSERT_EQ(keys.size(), statuses.size());
+    ASSERT_EQ(keys.size(), values.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      std::string expected;
+      Status s = db_->Get(options, keys[i], &expected);
+      ASSERT_EQ(s.ToString(), statuses[i].ToString()) << keys[i];
+      if (s.ok()) {
+        ASSERT_EQ(expected, values[i]) << keys[i];
+      }
+    }
+  }
+
+  const std::string dbname_;
+  const std::string external_dir_;  // 导入用的外部文件
+  Options options_;
+  // options_ 引用的对象，db_ 删除（后台 flush 结束）之后才释放
+  std::unique_ptr<const SliceTransform> prefix_extractor_;
+  std::unique_ptr<const FilterPolicy> filter_policy_;
+  std::unique_ptr<MemTableRepFactory> memtable_factory_;
+  DB* db_;
+};
+
+TEST_F(DBTest, Empty) {
+  Open();
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+  ASSERT_EQ("", Contents());
+}
+
+TEST_F(DBTest, PutDeleteGet) {
+  Open();
+  ASSERT_TRUE(Put("foo", "v1").ok());
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_TRUE(Put("foo", "v2").ok());
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_TRUE(Delete("foo").ok());
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+}
+
+TEST_F(DBTest, GetFromSnapshot) {
+  options_.write_buffer_size = 16 * 1024;
+  Open();
+  ASSERT_TRUE(Put("foo", "v1").ok());
+  const Snapshot* s1 = db_->GetSnapshot();
+  ASSERT_TRUE(Put("foo", "v2").ok());
+  const Snapshot* s2 = db_->GetSnapshot();
+  ASSERT_TRUE(Delete("foo").ok());
+  ASSERT_EQ("v1", Get("foo", s1));
+  ASSERT_EQ("v2", Get("foo", s2));
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+
+  // flush 到 sstable 之后，快照看到的仍然是当时的值
+  FillMemTable(0);
+  FillMemTable(100);
+  ASSERT_EQ("v1", Get("foo", s1));
+  ASSERT_EQ("v2", Get("foo", s2));
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+  db_->ReleaseSnapshot(s1);
+  db_->ReleaseSnapshot(s2);
+}
+
+TEST_F(DBTest, IterateSnapshot) {
+  Open();
+  ASSERT_TRUE(Put("a", "1").ok());
+  ASSERT_TRUE(Put("b", "2").ok());
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_TRUE(Put("a", "3").ok());
+  ASSERT_TRUE(Delete("b").ok());
+  ASSERT_TRUE(Put("c", "4").ok());
+  ReadOptions options;
+  options.snapshot = snapshot;
+  ASSERT_EQ("a->1 b->2", Contents(options));
+  ASSERT_EQ("a->3 c->4", Contents());
+  db_->ReleaseSnapshot(snapshot);
+}
+
+TEST_F(DBTest, DeleteRangeRespectsSnapshot) {
+  options_.write_buffer_size = 16 * 1024;
+  Open();
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(Put(Key(i), "v").ok());
+  }
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_TRUE(db_->DeleteRange(WriteOptions(), Key(2), Key(5)).ok());
+  ASSERT_TRUE(Put(Key(3), "new").ok());
+  ASSERT_EQ("v", Get(Key(2), snapshot));
+  ASSERT_EQ("NOT_FOUND", Get(Key(2)));
+  ASSERT_EQ("new", Get(Key(3)));
+  ASSERT_EQ("NOT_FOUND", Get(Key(4)));
+  ASSERT_EQ("v", Get(Key(5)));
+
+  // 区间删除随 memtable 一起 flush 之后仍然生效
+  FillMemTable(100);
+  FillMemTable(200);
+  ASSERT_EQ("v", Get(Key(2), snapshot));
+  ASSERT_EQ("NOT_FOUND", Get(Key(2)));
+  ASSERT_EQ("new", Get(Key(3)));
+  ASSERT_EQ("NOT_FOUND", Get(Key(4)));
+  ASSERT_EQ("v", Get(Key(5)));
+
+  ASSERT_TRUE(
+      db_->DeleteRange(WriteOptions(), Key(5), Key(2)).IsInvalidArgument());
+  db_->ReleaseSnapshot(snapshot);
+}
+
+// batch 中有一个非法的区间删除时整个 batch 都不写入
+TEST_F(DBTest, WriteBatchInvalidRangeRejected) {
+  Open();
+  ASSERT_TRUE(Put("a", "old").ok());
+  WriteBatch batch;
+  batch.Put("a", "new");
+  batch.Put("b", "v");
+  batch.DeleteRange("a", "z");
+  batch.DeleteRange("y", "c");
+  batch.Delete("a");
+  ASSERT_TRUE(db_->Write(WriteOptions(), &batch).IsInvalidArgument());
+  ASSERT_EQ("a->old", Contents());
+
+  // 格式错误的 batch 同样不写入
+  WriteBatch corrupt;
+  corrupt.Put("b", "v");
+  corrupt.Put("c", "v");
+  WriteBatchInternal::SetCount(&corrupt, 3);
+  ASSERT_TRUE(db_->Write(WriteOptions(), &corrupt).IsCorruption());
+  ASSERT_EQ("a->old", Contents());
+
+  // 被拒绝的 batch 不占用 sequence，之后的写入和快照正常
+  const Snapshot* snapshot = db_->GetSnapshot();
+  batch.Clear();
+  batch.Put("b", "v");
+  batch.DeleteRange("a", "b");
+  ASSERT_TRUE(db_->Write(WriteOptions(), &batch).ok());
+  ASSERT_EQ("b->v", Contents());
+  ReadOptions options;
+  options.snapshot = snapshot;
+  ASSERT_EQ("a->old", Contents(options));
+  db_->ReleaseSnapshot(snapshot);
+}
+
+// 写者不断写入覆盖所有 key 的 batch，读者在写入过程中获取快照
+// 快照看到的要么是整个 batch，要么完全看不到它: 所有 key 都来自同一个 batch
+// GetSnapshot 与写者互斥；不指定快照的迭代器不加锁地读取最新的 sequence，
+// 最容易在 batch 写入的途中创建
+TEST_F(DBTest, WriteBatchAtomicForSnapshots) {
+  options_.write_buffer_size = 32 * 1024;
+  Open();
+  const int kKeys = 100;
+  const int kBatches = 1000;
+  // 第 b 个 batch 先删除所有 key，b 为奇数时写入所有 key，否则只写入偶数的 key
+  auto expected = [&](int b) {
+    std::string result;
+    for (int k = 0; k < kKeys; k++) {
+      if (b % 2 == 1 || k % 2 == 0) {
+        if (!result.empty()) result += " ";
+        result += Key(k) + "->batch" + std::to_string(b);
+      }
+    }
+    return result;
+  };
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; t++) {
+    readers.emplace_back([&, t] {
+      while (!done.load(std::memory_order_acquire)) {
+        ReadOptions options;
+        if (t != 2) {
+          options.snapshot = db_->GetSnapshot();
+        }
+        std::string state;
+        if (t == 0) {
+          for (int k = 0; k < kKeys; k++) {
+            std::string value;
+            if (db_->Get(options, Key(k), &value).ok()) {
+              if (!state.empty()) state += " ";
+              state += Key(k) + "->" + value;
+            }
+          }
+        } else {
+          state = Contents(options);
+        }
+        if (options.snapshot != nullptr) {
+          db_->ReleaseSnapshot(options.snapshot);
+        }
+        if (state.empty()) {
+          continue;
+        }
+        const size_t begin = state.find("->batch") + 7;
+        const int b = std::stoi(state.substr(begin, state.find(' ') - begin));
+        ASSERT_EQ(expected(b), state);
+      }
+    });
+  }
+  for (int b = 0; b < kBatches; b++) {
+    WriteBatch batch;
+    const std::string value = "batch" + std::to_string(b);
+    batch.DeleteRange(Key(0), Key(kKeys));
+    for (int k = 0; k < kKeys; k++) {
+      if (b % 2 == 1 || k % 2 == 0) {
+        batch.Put(Key(k), value);
+      }
+    }
+    ASSERT_TRUE(db_->Write(WriteOptions(), &batch).ok());
+  }
+  done.store(true, std::memory_order_release);
+  for (std::thread& t : readers) {
+    t.join();
+  }
+  ASSERT_EQ(expected(kBatches - 1), Contents());
+}
+
+TEST_F(DBTest, IterateUpperBound) {
+  options_.write_buffer_size = 16 * 1024;
+  Open();
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(Put(Key(i), "v" + std::to_string(i)).ok());
+  }
+  FillMemTable(100);
+  FillMemTable(200);
+
+  const std::string bound = Key(5);
+  const Slice bound_slice(bound);
+  ReadOptions options;
+  options.iterate_upper_bound = &bound_slice;
+  std::unique_ptr<Iterator> iter(db_->NewIterator(options));
+  int count = 0;
+  for (iter->Seek(Key(2)); iter->Valid(); iter->Next()) {
+    ASSERT_LT(iter->key().ToString(), bound);
+    count++;
+  }
+  ASSERT_EQ(3, count);
+  iter->Seek(Key(7));
+  ASSERT_FALSE(iter->Valid());
+}
+
+TEST_F(DBTest, PrefixSeek) {
+  prefix_extractor_.reset(NewFixedPrefixTransform(3));
+  options_.prefix_extractor = prefix_extractor_.get();
+  options_.write_buffer_size = 256 * 1024;
+  Open();
+  // 前缀 "aaa"、"aab"、"aac" 分别落在 sstable、只读的 memtable 和当前的
+  // memtable 中
+  const char* prefixes[] = {"aaa", "aab", "aac"};
+  for (const char* p : prefixes) {
+    for (int i = 0; i < 3; i++) {
+      ASSERT_TRUE(Put(std::string(p) + std::to_string(i), p).ok());
+    }
+    FillMemTable(std::string(p) == "aaa" ? 0 : 1000);
+  }
+
+  ReadOptions options;
+  options.prefix_same_as_start = true;
+  std::unique_ptr<Iterator> iter(db_->NewIterator(options));
+  for (const char* p : prefixes) {
+    int count = 0;
+    for (iter->Seek(p); iter->Valid(); iter->Next()) {
+      ASSERT_EQ(p, iter->key().ToString().substr(0, 3));
+      ASSERT_EQ(p, iter->value().ToString());
+      count++;
+    }
+    ASSERT_EQ(3, count) << p;
+  }
+  // 没有写入过的前缀
+  iter->Seek("aad");
+  ASSERT_FALSE(iter->Valid());
+  iter->Seek("aa");  // 不在 prefix_extractor 的 domain 中，不受前缀限制
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("aaa0", iter->key().ToString());
+}
+
+// 前缀分散在多个 sstable 中，按 filter 跳过不含前缀的 sstable 后结果不变
+TEST_F(DBTest, PrefixSeekAcrossTables) {
+  prefix_extractor_.reset(NewFixedPrefixTransform(4));
+  filter_policy_.reset(NewBloomFilterPolicy(10));
+  options_.prefix_extractor = prefix_extractor_.get();
+  options_.filter_policy = filter_policy_.get();
+  options_.memtable_prefix_bloom_bits = 0;
+  options_.write_buffer_size = 16 * 1024;
+  Open();
+
+  // 前缀 p000 ~ p039，每个 sstable 只包含其中一部分
+  std::map<std::string, std::string> model;
+  Random rnd(301);
+  for (int i = 0; i < 2000; i++) {
+    char key[32];
+    std::snprintf(key, sizeof(key), "p%03d%06d", 2 * rnd.Uniform(20),
+                  static_cast<int>(rnd.Uniform(100)));
+    const std::string value(100, 'a' + i % 26);
+    ASSERT_TRUE(Put(key, value).ok());
+    model[key] = value;
+  }
+
+  ReadOptions options;
+  options.prefix_same_as_start = true;
+  std::unique_ptr<Iterator> iter(db_->NewIterator(options));
+  for (int p = 0; p < 40; p++) {
+    char prefix[8];
+    std::snprintf(prefix, sizeof(prefix), "p%03d", p);
+    auto m = model.lower_bound(prefix);
+    for (iter->Seek(prefix); iter->Valid(); iter->Next(), ++m) {
+      ASSERT_TRUE(m != model.end());
+      ASSERT_EQ(m->first, iter->key().ToString());
+      ASSERT_EQ(m->second, iter->value().ToString());
+    }
+    ASSERT_TRUE(iter->status().ok());
+    ASSERT_TRUE(m == model.end() || m->first.compare(0, 4, prefix) != 0)
+        << prefix;
+  }
+}
+
+// 大的 memtable 切分成多段并行 flush，每段一个 sstable，结果与模型一致
+TEST_F(DBTest, ParallelFlush) {
+  options_.write_buffer_size = 3 << 20;
+  options_.flush_parallelism = 4;
+  Open();
+
+  // 写满四个 memtable: 第三次切换要等第一次 flush 完成，至少 flush 了两次
+  std::map<std::string, std::string> model;
+  Random rnd(301);
+  for (int i = 0; i < 13000; i++) {
+    const std::string key = Key(rnd.Uniform(20000));
+    if (rnd.OneIn(10)) {
+      ASSERT_TRUE(Delete(key).ok());
+      model.erase(key);
+    } else {
+      const std::string value(1000, 'a' + i % 26);
+      ASSERT_TRUE(Put(key, value).ok());
+      model[key] = value;
+    }
+    if (i % 3000 == 1500) {
+      const int start = rnd.Uniform(20000);
+      ASSERT_TRUE(
+          db_->DeleteRange(WriteOptions(), Key(start), Key(start + 50)).ok());
+      model.erase(model.lower_bound(Key(start)),
+                  model.lower_bound(Key(start + 50)));
+    }
+  }
+
+  for (int i = 0; i < 20000; i += 13) {
+    auto it = model.find(Key(i));
+    ASSERT_EQ(it == model.end() ? "NOT_FOUND" : it->second, Get(Key(i)));
+  }
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  auto m = model.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++m) {
+    ASSERT_TRUE(m != model.end());
+    ASSERT_EQ(m->first, iter->key().ToString());
+    ASSERT_EQ(m->second, iter->value().ToString());
+  }
+  ASSERT_TRUE(m == model.end());
+  iter.reset();
+
+  // 每次 flush 生成 flush_parallelism 个文件
+  ASSERT_GE(CountTableFiles(), 2 * options_.flush_parallelism);
+}
+
+// 每个分段文件的 smallest/largest 恰好是文件中第一个和最后一个 key，
+// 相邻分段的 key 范围互不重叠
+TEST_F(DBTest, ParallelFlushFileKeyRanges) {
+  options_.write_buffer_size = 64 << 20;
+  options_.flush_parallelism = 4;
+  Open();
+  Random rnd(301);
+  for (int i = 0; i < 5000; i++) {
+    ASSERT_TRUE(Put(Key(rnd.Uniform(20000)), std::string(1000, 'v')).ok());
+  }
+  DBImpl* impl = reinterpret_cast<DBImpl*>(db_);
+  ASSERT_TRUE(impl->TEST_FlushMemTable().ok());
+
+  std::vector<std::shared_ptr<FileMetaData>> files = impl->TEST_Files();
+  ASSERT_EQ(4u, files.size());
+  for (size_t i = 0; i < files.size(); i++) {
+    std::unique_ptr<Iterator> iter(files[i]->table->NewIterator(ReadOptions()));
+    iter->SeekToFirst();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(files[i]->smallest.Encode().ToString(), iter->key().ToString());
+    iter->SeekToLast();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(files[i]->largest.Encode().ToString(), iter->key().ToString());
+    if (i > 0) {
+      ASSERT_LT(files[i - 1]->largest.user_key().ToString(),
+                files[i]->smallest.user_key().ToString());
+    }
+  }
+}
+
+// 跨越分段边界的区间删除被截断到各个分段，每个文件只包含本段的部分，
+// 文件的 key 范围不会因为区间删除互相重叠
+TEST_F(DBTest, ParallelFlushClipsRangeTombstones) {
+  options_.write_buffer_size = 64 << 20;
+  options_.flush_parallelism = 4;
+  Open();
+  std::map<std::string, std::string> model;
+  Random rnd(301);
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < 2500; i++) {
+      const std::string key = Key(rnd.Uniform(20000));
+      ASSERT_TRUE(Put(key, std::string(1000, 'a' + round)).ok());
+      model[key] = std::string(1000, 'a' + round);
+    }
+    for (int i = 0; i < 5; i++) {
+      const int start = rnd.Uniform(20000);
+      const int end = start + rnd.Uniform(8000);
+      ASSERT_TRUE(db_->DeleteRange(WriteOptions(), Key(start), Key(end)).ok());
+      model.erase(model.lower_bound(Key(start)), model.lower_bound(Key(end)));
+    }
+  }
+  DBImpl* impl = reinterpret_cast<DBImpl*>(db_);
+  ASSERT_TRUE(impl->TEST_FlushMemTable().ok());
+
+  std::vector<std::shared_ptr<FileMetaData>> files = impl->TEST_Files();
+  ASSERT_EQ(4u, files.size());
+  int tombstones = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    const std::string smallest = files[i]->smallest.user_key().ToString();
+    const std::string largest = files[i]->largest.user_key().ToString();
+    std::unique_ptr<Iterator> iter(
+        files[i]->table->NewRangeTombstoneIterator());
+    if (iter != nullptr) {
+      for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        ASSERT_LE(smallest, ExtractUserKey(iter->key()).ToString());
+        ASSERT_GE(largest, iter->value().ToString());
+        tombstones++;
+      }
+    }
+    if (i > 0) {
+      ASSERT_LE(files[i - 1]->largest.user_key().ToString(), smallest);
+    }
+  }
+  // 至少有一条区间删除被切到了多个文件中
+  ASSERT_GT(tombstones, 10);
+
+  for (int i = 0; i < 20000; i += 7) {
+    auto it = model.find(Key(i));
+    ASSERT_EQ(it == model.end() ? "NOT_FOUND" : it->second, Get(Key(i)));
+  }
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  auto m = model.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++m) {
+    ASSERT_TRUE(m != model.end());
+    ASSERT_EQ(m->first, iter->key().ToString());
+  }
+  ASSERT_TRUE(m == model.end());
+}
+
+// flush 之后即使不再有写入，flush 完的 memtable 也会被释放，
+// 读者在 flush 期间一直在读时由后台线程等它们退出后回收
+TEST_F(DBTest, FlushedMemTableReclaimedWithoutWrites) {
+  CountingRepFactory* factory = new CountingRepFactory;
+  memtable_factory_.reset(factory);
+  options_.memtable_factory = factory;
+  Open();
+  for (int i = 0; i < 100; i++) {
+    ASSERT_TRUE(Put(Key(i), "v").ok());
+  }
+  ASSERT_EQ(1, factory->live());
+
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 2; t++) {
+    readers.emplace_back([&] {
+      std::string value;
+      while (!done.load(std::memory_order_acquire)) {
+        ASSERT_TRUE(db_->Get(ReadOptions(), Key(7), &value).ok());
+      }
+    });
+  }
+  DBImpl* impl = reinterpret_cast<DBImpl*>(db_);
+  ASSERT_TRUE(impl->TEST_FlushMemTable().ok());
+  done.store(true, std::memory_order_release);
+  for (std::thread& t : readers) {
+    t.join();
+  }
+  for (int i = 0; i < 1000 && factory->live() > 1; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(1, factory->live());
+
+  // 导入与 memtable 重叠，先 flush 再导入，之后同样不再有写入
+  const std::string fname = BuildExternalFile("a.sst", 200, 210, "a");
+  ASSERT_TRUE(Put(Key(205), "old").ok());
+  ASSERT_TRUE(Put(Key(300), "v").ok());
+  ASSERT_TRUE(db_->IngestExternalFile({fname}, IngestExternalFileOptions()).ok());
+  for (int i = 0; i < 1000 && factory->live() > 1; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(1, factory->live());
+  ASSERT_EQ("a205", Get(Key(205)));
+  ASSERT_EQ("v", Get(Key(300)));
+}
+
+// 写者不断写满 memtable，触发切换和 flush，读者同时不加锁地读
+// 已经写入的 key 一定能读到，迭代器看到的是一个一致的快照
+TEST_F(DBTest, ConcurrentReadsDuringSwitch) {
+  options_.write_buffer_size = 32 * 1024;
+  Open();
+  const int kNum = 20000;
+  std::atomic<int> written(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; t++) {
+    readers.emplace_back([&, t] {
+      Random rnd(t + 1);
+      std::string value;
+      int n;
+      while ((n = written.load(std::memory_order_acquire)) < kNum) {
+        if (t == 0) {
+          // 迭代器创建之后的写入不可见，两次遍历的结果相同
+          std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+          int c1 = 0, c2 = 0;
+          for (iter->SeekToFirst(); iter->Valid(); iter->Next()) c1++;
+          for (iter->SeekToFirst(); iter->Valid(); iter->Next()) c2++;
+          ASSERT_EQ(c1, c2);
+          ASSERT_GE(c1, n);
+        } else if (n > 0) {
+          const int i = rnd.Uniform(n);
+          ASSERT_TRUE(db_->Get(ReadOptions(), Key(i), &value).ok()) << Key(i);
+          ASSERT_EQ(Key(i), value);
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kNum; i++) {
+    ASSERT_TRUE(Put(Key(i), Key(i)).ok());
+    written.store(i + 1, std::memory_order_release);
+  }
+  for (std::thread& t : readers) {
+    t.join();
+  }
+  for (int i = 0; i < kNum; i += 101) {
+    ASSERT_EQ(Key(i), Get(Key(i)));
+  }
+}
+
+// memtable 的固定开销不小于 write_buffer_size 时，每个新的 memtable
+// 一写入就是满的；这种配置在 Open 时直接拒绝
+TEST_F(DBTest, MemTableOverheadExceedsWriteBuffer) {
+  prefix_extractor_.reset(NewFixedPrefixTransform(3));
+  options_.prefix_extractor = prefix_extractor_.get();
+  options_.memtable_prefix_bloom_bits = 1 << 20;  // 128KB
+  options_.write_buffer_size = 64 * 1024;
+  ASSERT_TRUE(TryOpen().IsInvalidArgument());
+
+  memtable_factory_.reset(
+      NewHashSkipListRepFactory(1000000));  // 8MB 的桶数组
+  options_.memtable_prefix_bloom_bits = 0;
+  options_.memtable_factory = memtable_factory_.get();
+  options_.write_buffer_size = 4 * 1024 * 1024;
+  ASSERT_TRUE(TryOpen().IsInvalidArgument());
+
+  // 固定开销比 write_buffer_size 小时，只按写入的数据判断是否写满，
+  // 每个 memtable 都能写入 write_buffer_size 的数据
+  options_.write_buffer_size = 16 * 1024 * 1024;
+  Open();
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_TRUE(Put(Key(i), std::string(100, 'v')).ok());
+  }
+  ASSERT_EQ(std::string(100, 'v'), Get(Key(999)));
+
+  // 先关闭数据库，它还在使用旧的 factory
+  Close();
+  memtable_factory_.reset(NewHashSkipListRepFactory(1000));
+  options_.memtable_factory = memtable_factory_.get();
+  options_.memtable_prefix_bloom_bits = 1 << 16;
+  options_.write_buffer_size = 64 * 1024;
+  Open();
+  for (int i = 0; i < 5000; i++) {
+    ASSERT_TRUE(Put(Key(i), std::string(100, 'v')).ok());
+  }
+  for (int i = 0; i < 5000; i += 37) {
+    ASSERT_EQ(std::string(100, 'v'), Get(Key(i)));
+  }
+}
+
+// 还不能加载已有的 sstable，目录中有 sstable 时拒绝打开，而不是忽略它们
+TEST_F(DBTest, ReopenWithTablesRejected) {
+  options_.write_buffer_size = 16 * 1024;
+  Open();
+  ASSERT_TRUE(Put("foo", "v1").ok());
+  // 没有 sstable 时可以重新打开（memtable 中的数据不会保留）
+  Open();
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+
+  FillMemTable(0);
+  FillMemTable(100);
+  Close();
+  ASSERT_TRUE(TryOpen().IsInvalidArgument());
+}
+
+// 切换下来的 memtable 立即冻结，不需要等到轮到它 flush
+TEST_F(DBTest, FreezeOnSwitch) {
+  options_.write_buffer_size = 16 * 1024;
+  Open();
+
+  // 占住后台线程，flush 在此期间无法开始
+  struct Blocker {
+    std::mutex mu;
+    std::condition_variable cv;
+    bool released = false;
+  } blocker;
+  Env::Default()->Schedule(
+      [](void* arg) {
+        Blocker* b = reinterpret_cast<Blocker*>(arg);
+        std::unique_lock<std::mutex> l(b->mu);
+        b->cv.wait(l, [b] { return b->released; });
+      },
+      &blocker);
+
+  // 只切换一次，第二次切换要等 flush
+  for (int i = 0; i < 20; i++) {
+    ASSERT_TRUE(Put(Key(i), std::string(1024, 'x')).ok());
+  }
+  DBImpl* impl = reinterpret_cast<DBImpl*>(db_);
+  for (int i = 0; i < 1000 && impl->TEST_NumFrozenMemTables() == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ(1, impl->TEST_NumFrozenMemTables());
+  ASSERT_EQ(std::string(1024, 'x'), Get(Key(10)));
+
+  {
+    std::lock_guard<std::mutex> l(blocker.mu);
+    blocker.released = true;
+  }
+  blocker.cv.notify_all();
+  FillMemTable(100);
+  for (int i = 0; i < 164; i += 9) {
+    ASSERT_EQ(i < 20 || i >= 100 ? std::string(1024, 'x') : "NOT_FOUND",
+              Get(Key(i)));
+  }
+}
+
+TEST_F(DBTest, IngestExternalFile) {
+  Open();
+  ASSERT_TRUE(Put(Key(5), "old").ok());
+  ASSERT_TRUE(Put(Key(50), "unrelated").ok());
+  const Snapshot* snapshot = db_->GetSnapshot();
+
+  // 与 memtable 中的 Key(5) 重叠，导入的数据比它新
+  std::vector<std::string> files = {BuildExternalFile("b.sst", 20, 30, "b"),
+                                    BuildExternalFile("a.sst", 0, 10, "a")};
+  Status s = db_->IngestExternalFile(files, IngestExternalFileOptions());
+  ASSERT_TRUE(s.ok()) << s.ToString();
+  ASSERT_EQ("a5", Get(Key(5)));
+  ASSERT_EQ("b25", Get(Key(25)));
+  ASSERT_EQ("NOT_FOUND", Get(Key(15)));
+  ASSERT_EQ("unrelated", Get(Key(50)));
+  // 导入之前的快照看不到导入的数据
+  ASSERT_EQ("old", Get(Key(5), snapshot));
+  ASSERT_EQ("NOT_FOUND", Get(Key(25), snapshot));
+  db_->ReleaseSnapshot(snapshot);
+
+  // 之后的写入比导入的数据新
+  ASSERT_TRUE(Put(Key(6), "new").ok());
+  ASSERT_TRUE(Delete(Key(7)).ok());
+  ASSERT_EQ("new", Get(Key(6)));
+  ASSERT_EQ("NOT_FOUND", Get(Key(7)));
+
+  int count = 0;
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    count++;
+  }
+  ASSERT_EQ(20, count);  // 10 + 10 - Key(7) + Key(50)
+
+  // 没有 move_files 时保留原文件
+  for (const std::string& f : files) {
+    ASSERT_TRUE(Env::Default()->FileExists(f));
+  }
+}
+
+TEST_F(DBTest, IngestMoveFiles) {
+  Open();
+  IngestExternalFileOptions ingest_options;
+  ingest_options.move_files = true;
+  const std::string fname = BuildExternalFile("a.sst", 0, 10, "a");
+  ASSERT_TRUE(db_->IngestExternalFile({fname}, ingest_options).ok());
+  ASSERT_FALSE(Env::Default()->FileExists(fname));
+  ASSERT_EQ("a3", Get(Key(3)));
+}
+
+// 导入失败时不留下文件，也不改变数据库的内容
+TEST_F(DBTest, IngestOverlappingFilesRejected) {
+  Open();
+  ASSERT_TRUE(Put(Key(1), "v").ok());
+  std::vector<std::string> files = {BuildExternalFile("a.sst", 0, 10, "a"),
+                                    BuildExternalFile("b.sst", 9, 20, "b")};
+  Status s = db_->IngestExternalFile(files, IngestExternalFileOptions());
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_EQ(0, CountTableFiles());
+  ASSERT_EQ("v", Get(Key(1)));
+  ASSERT_EQ("NOT_FOUND", Get(Key(15)));
+
+  s = db_->IngestExternalFile({}, IngestExternalFileOptions());
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = db_->IngestExternalFile({files[0] + ".missing"},
+                              IngestExternalFileOptions());
+  ASSERT_FALSE(s.ok());
+  ASSERT_EQ(0, CountTableFiles());
+}
+
+// pin 住的值在 memtable 切换、flush 和导入之后仍然有效；
+// Reset() 或析构释放引用之后，flush 完的 memtable 才被释放
+TEST_F(DBTest, PinnedValuesSurviveSwitchFlushAndIngest) {
+  CountingRepFactory* factory = new CountingRepFactory;
+  memtable_factory_.reset(factory);
+  options_.memtable_factory = factory;
+  Open();
+  DBImpl* impl = reinterpret_cast<DBImpl*>(db_);
+  const std::string v1(3000, '1');
+  const std::string v2(3000, '2');
+  ASSERT_TRUE(Put(Key(5), v1).ok());
+
+  PinnableSlice from_mem;
+  ASSERT_TRUE(db_->Get(ReadOptions(), Key(5), &from_mem).ok());
+  ASSERT_TRUE(from_mem.IsPinned());
+  ASSERT_EQ(v1, from_mem.ToString());
+
+  // 覆盖写入并 flush，旧的 memtable 被 from_mem 持有
+  ASSERT_TRUE(Put(Key(5), v2).ok());
+  ASSERT_TRUE(impl->TEST_FlushMemTable().ok());
+  ASSERT_EQ(1, CountTableFiles());
+  ASSERT_EQ(v1, from_mem.ToString());
+  ASSERT_EQ(2, factory->live());
+
+  // 从 sstable 中读到的值 pin 住 data block
+  std::unique_ptr<PinnableSlice> from_table(new PinnableSlice);
+  ASSERT_TRUE(db_->Get(ReadOptions(), Key(5), from_table.get()).ok());
+  ASSERT_TRUE(from_table->IsPinned());
+  ASSERT_EQ(v2, from_table->ToString());
+
+  // 导入覆盖这个 key 的文件，之后再写入并 flush 一次
+  const std::string fname = BuildExternalFile("a.sst", 0, 10, "a");
+  ASSERT_TRUE(db_->IngestExternalFile({fname}, IngestExternalFileOptions())
+                  .ok());
+  FillMemTable(100);
+  ASSERT_TRUE(impl->TEST_FlushMemTable().ok());
+  ASSERT_EQ("a5", Get(Key(5)));
+  ASSERT_EQ(v1, from_mem.ToString());
+  ASSERT_EQ(v2, from_table->ToString());
+
+  PinnableSlice from_ingested;
+  ASSERT_TRUE(db_->Get(ReadOptions(), Key(5), &from_ingested).ok());
+  ASSERT_TRUE(from_ingested.IsPinned());
+  ASSERT_EQ("a5", from_ingested.ToString());
+
+  // 释放之后不再 pin 住，旧的 memtable 被回收
+  from_mem.Reset();
+  ASSERT_FALSE(from_mem.IsPinned());
+  ASSERT_TRUE(from_mem.empty());
+  from_table.reset();
+  ASSERT_TRUE(Put(Key(6), "v").ok());
+  for (int i = 0; i < 1000 && factory->live() > 1; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(1, factory->live());
+  ASSERT_EQ("a5", from_ingested.ToString());
+
+  // 析构同样释放引用
+  {
+    PinnableSlice value;
+    ASSERT_TRUE(db_->Get(ReadOptions(), Key(6), &value).ok());
+    ASSERT_TRUE(value.IsPinned());
+    ASSERT_TRUE(impl->TEST_FlushMemTable().ok());
+    ASSERT_EQ(2, factory->live());
+  }
+  ASSERT_TRUE(Put(Key(7), "v").ok());
+  for (int i = 0; i < 1000 && factory->live() > 1; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(1, factory->live());
+}
+
+// MultiGet 的结果与 Get 相同: key 分布在 memtable、多个 sstable 和导入的文件中，
+// 被点删除和区间删除覆盖，在不同的快照上读
+TEST_F(DBTest, MultiGetMatchesGet) {
+  filter_policy_.reset(NewBloomFilterPolicy(10));
+  options_.filter_policy = filter_policy_.get();
+  Open();
+  DBImpl* impl = reinterpret_cast<DBImpl*>(db_);
+  for (int i = 0; i < 300; i++) {
+    ASSERT_TRUE(Put(Key(i), "v1-" + std::to_string(i)).ok());
+  }
+  ASSERT_TRUE(impl->TEST_FlushMemTable().ok());
+  for (int i = 0; i < 300; i += 3) {
+    ASSERT_TRUE(Put(Key(i), "v2-" + std::to_string(i)).ok());
+  }
+  for (int i = 0; i < 300; i += 7) {
+    ASSERT_TRUE(Delete(Key(i)).ok());
+  }
+  ASSERT_TRUE(db_->DeleteRange(WriteOptions(), Key(100), Key(150)).ok());
+  ASSERT_TRUE(impl->TEST_FlushMemTable().ok());
+  const Snapshot* s1 = db_->GetSnapshot();
+
+  // 一个导入的文件与已有的 sstable 重叠，另一个在它们之后
+  const std::vector<std::string> files = {
+      BuildExternalFile("a.sst", 250, 270, "a"),
+      BuildExternalFile("b.sst", 400, 450, "b")};
+  ASSERT_TRUE(db_->IngestExternalFile(files, IngestExternalFileOptions()).ok());
+
+  for (int i = 0; i < 460; i += 5) {
+    ASSERT_TRUE(Put(Key(i), "m-" + std::to_string(i)).ok());
+  }
+  ASSERT_TRUE(db_->DeleteRange(WriteOptions(), Key(200), Key(220)).ok());
+  ASSERT_TRUE(db_->DeleteRange(WriteOptions(), Key(420), Key(430)).ok());
+  ASSERT_TRUE(Put(Key(210), "after-range").ok());
+  const Snapshot* s2 = db_->GetSnapshot();
+  ASSERT_TRUE(Put(Key(1), "latest").ok());
+  ASSERT_TRUE(Delete(Key(2)).ok());
+  ASSERT_EQ(4, CountTableFiles());
+
+  // 所有 key 打乱顺序，加上不存在的 key 和重复的 key
+  std::vector<std::string> keys;
+  for (int i = 0; i < 470; i++) {
+    keys.push_back(Key(i));
+  }
+  keys.push_back("a");
+  keys.push_back("zzz");
+  keys.push_back(Key(5));
+  keys.push_back(Key(260));
+  Random rnd(301);
+  for (size_t i = keys.size() - 1; i > 0; i--) {
+    std::swap(keys[i], keys[rnd.Uniform(static_cast<int>(i + 1))]);
+  }
+
+  for (const Snapshot* snapshot : {static_cast<const Snapshot*>(nullptr), s1,
+                                   s2}) {
+    ReadOptions options;
+    options.snapshot = snapshot;
+    CheckMultiGet(options, keys);
+    CheckMultiGet(options, {});
+    CheckMultiGet(options, {Key(210)});
+    // 有序的 key，同一个 data block 中的 key 只读一次
+    std::vector<std::string> sorted = keys;
+    std::sort(sorted.begin(), sorted.end());
+    CheckMultiGet(options, sorted);
+  }
+  ReadOptions options;
+  options.verify_checksums = true;
+  CheckMultiGet(options, keys);
+
+  // 抽查几个结果，确认覆盖到了各种情况
+  ReadOptions at_s2;
+  at_s2.snapshot = s2;
+  std::vector<std::string> values;
+  std::vector<Status> statuses = db_->MultiGet(
+      at_s2, {Key(1), Key(3), Key(7), Key(121), Key(210), Key(215), Key(260),
+              Key(425), Key(445), Key(455)},
+      &values);
+  ASSERT_EQ("v1-1", values[0]);
+  ASSERT_EQ("v2-3", values[1]);
+  ASSERT_TRUE(statuses[2].IsNotFound());
+  ASSERT_TRUE(statuses[3].IsNotFound());
+  ASSERT_EQ("after-range", values[4]);
+  ASSERT_TRUE(statuses[5].IsNotFound());
+  ASSERT_EQ("m-260", values[6]);
+  ASSERT_TRUE(statuses[7].IsNotFound());
+  ASSERT_EQ("m-445", values[8]);
+  ASSERT_EQ("m-455", values[9]);
+  db_->ReleaseSnapshot(s1);
+  db_->ReleaseSnapshot(s2);
+}
+
+// memtable 不断切换和 flush 时，同一个快照上 MultiGet 与 Get 的结果相同，
+// 包括还在只读 memtable 中等待 flush 的数据
+TEST_F(DBTest, MultiGetDuringFlush) {
+  options_.write_buffer_size = 32 * 1024;
+  Open();
+  const int kNum = 5000;
+  std::atomic<int> written(0);
+  std::thread reader([&] {
+    Random rnd(301);
+    int n;
+    while ((n = written.load(std::memory_order_acquire)) < kNum) {
+      std::vector<std::string> keys;
+      for (int i = 0; i < 50; i++) {
+        keys.push_back(Key(rnd.Uniform(n + 10)));
+      }
+      ReadOptions options;
+      options.snapshot = db_->GetSnapshot();
+      CheckMultiGet(options, keys);
+      db_->ReleaseSnapshot(options.snapshot);
+    }
+  });
+  for (int i = 0; i < kNum; i++) {
+    if (i % 10 == 9) {
+      ASSERT_TRUE(db_->DeleteRange(WriteOptions(), Key(i - 5), Key(i - 3)).ok());
+    }
+    ASSERT_TRUE(Put(Key(i), std::string(100, 'a' + i % 26)).ok());
+    written.store(i + 1, std::memory_order_release);
+  }
+  reader.join();
+  ASSERT_GT(CountTableFiles(), 3);
+}
+
+}  // namespace leveldb
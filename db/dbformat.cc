@@ -0,0 +1,118 @@
+#include "db/dbformat.h"
+
+#include <cstdio>
+#include <sstream>
+
+#include "leveldb/slice_transform.h"
+
+namespace leveldb {
+
+void AppendInternalKey(std::string* result, const ParsedInternalKey& key) {
+  result->append(key.user_key.data(), key.user_key.size());
+  char buf[8];
+  EncodeFixed64(buf, PackSequenceAndType(key.sequence, key.type));
+  result->append(buf, sizeof(buf));
+}
+
+bool ParseInternalKey(const Slice& internal_key, ParsedInternalKey* result) {
+  const size_t n = internal_key.size();
+  if (n < 8) return false;
+  uint64_t num = DecodeFixed64(internal_key.data() + n - 8);
+  uint8_t c = num & 0xff;
+  result->sequence = num >> 8;
+  result->type = static_cast<ValueType>(c);
+  result->user_key = Slice(internal_key.data(), n - 8);
+  return (c <= static_cast<uint8_t>(kTypeRangeDeletion));
+}
+
+std::string ParsedInternalKey::DebugString() const {
+  std::ostringstream ss;
+  ss << '\'' << user_key.ToString() << "' @ " << sequence << " : "
+     << static_cast<int>(type);
+  return ss.str();
+}
+
+const char* InternalKeyComparator::Name() const {
+  return "leveldb.InternalKeyComparator";
+}
+
+void InternalKeyComparator::FindShortestSeparator(std::string* start,
+                                                  const Slice& limit) const {
+  // 先缩短 user key 部分
+  Slice user_start = ExtractUserKey(*start);
+  Slice user_limit = ExtractUserKey(limit);
+  std::string tmp(user_start.data(), user_start.size());
+  user_comparator_->FindShortestSeparator(&tmp, user_limit);
+  if (tmp.size() < user_start.size() &&
+      user_comparator_->Compare(user_start, tmp) < 0) {
+    // user key 在物理上变短了，但逻辑上变大了
+    // 补上最大的 sequence，保证它排在同一个 user key 的所有 entry 之前
+    char buf[8];
+    EncodeFixed64(buf, PackSequenceAndType(kMaxSequenceNumber,
+                                           kValueTypeForSeek));
+    tmp.append(buf, sizeof(buf));
+    assert(this->Compare(*start, tmp) < 0);
+    assert(this->Compare(tmp, limit) < 0);
+    start->swap(tmp);
+  }
+}
+
+void InternalKeyComparator::FindShortSuccessor(std::string* key) const {
+  Slice user_key = ExtractUserKey(*key);
+  std::string tmp(user_key.data(), user_key.size());
+  user_comparator_->FindShortSuccessor(&tmp);
+  if (tmp.size() < user_key.size() &&
+      user_comparator_->Compare(user_key, tmp) < 0) {
+    char buf[8];
+    EncodeFixed64(buf, PackSequenceAndType(kMaxSequenceNumber,
+                                           kValueTypeForSeek));
+    tmp.append(buf, sizeof(buf));
+    assert(this->Compare(*key, tmp) < 0);
+    key->swap(tmp);
+  }
+}
+
+const char* InternalFilterPolicy::Name() const { return user_policy_->Name(); }
+
+Slice InternalFilterPolicy::FilterKey(const Slice& internal_key) const {
+  Slice user_key = ExtractUserKey(internal_key);
+  if (prefix_extractor_ != nullptr && prefix_extractor_->InDomain(user_key)) {
+    return prefix_extractor_->Transform(user_key);
+  }
+  return user_key;
+}
+
+void InternalFilterPolicy::CreateFilter(const Slice* keys, int n,
+                                        std::string* dst) const {
+  // 直接修改 keys 数组，把 internal key 换成 filter 使用的 key
+  Slice* mkey = const_cast<Slice*>(keys);
+  for (int i = 0; i < n; i++) {
+    mkey[i] = FilterKey(keys[i]);
+  }
+  user_policy_->CreateFilter(keys, n, dst);
+}
+
+bool InternalFilterPolicy::KeyMayMatch(const Slice& key, const Slice& f) const {
+  return user_policy_->KeyMayMatch(FilterKey(key), f);
+}
+
+LookupKey::LookupKey(const Slice& user_key, SequenceNumber s) {
+  size_t usize = user_key.size();
+  size_t needed = usize + 13;  // 保守估计
+  char* dst;
+  if (needed <= sizeof(space_)) {
+    dst = space_;
+  } else {
+    dst = new char[needed];
+  }
+  start_ = dst;
+  dst = EncodeVarint32(dst, usize + 8);
+  kstart_ = dst;
+  std::memcpy(dst, user_key.data(), usize);
+  dst += usize;
+  EncodeFixed64(dst, PackSequenceAndType(s, kValueTypeForSeek));
+  dst += 8;
+  end_ = dst;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,217 @@
+#ifndef STORAGE_LEVELDB_DB_DBFORMAT_H_
+#define STORAGE_LEVELDB_DB_DBFORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "leveldb/comparator.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice.h"
+#include "util/bytewise_compare.h"
+#include "util/coding.h"
+
+namespace leveldb {
+
+class SliceTransform;
+
+// ValueType 编码在 internal key 的最后一个字节里
+// 注意: 数值会被持久化，不能修改
+enum ValueType {
+  kTypeDeletion = 0x0,
+  kTypeValue = 0x1,
+  // [user_key, value) 区间删除，value 里存放区间的结束 key
+  kTypeRangeDeletion = 0x2
+};
+
+// 构造 seek 用的 ParsedInternalKey 时使用的 type
+// 同一个 sequence 下 type 越大排得越靠前，所以这里取最大的 type
+static const ValueType kValueTypeForSeek = kTypeRangeDeletion;
+
+typedef uint64_t SequenceNumber;
+
+// 低 8 位留给 type，sequence 只用高 56 位
+static const SequenceNumber kMaxSequenceNumber = ((0x1ull << 56) - 1);
+
+struct ParsedInternalKey {
+  Slice user_key;
+  SequenceNumber sequence;
+  ValueType type;
+
+  ParsedInternalKey() {}  // 不初始化，提高效率
+  ParsedInternalKey(const Slice& u, const SequenceNumber& seq, ValueType t)
+      : user_key(u), sequence(seq), type(t) {}
+  std::string DebugString() const;
+};
+
+// internal key 的编码长度
+inline size_t InternalKeyEncodingLength(const ParsedInternalKey& key) {
+  return key.user_key.size() + 8;
+}
+
+inline uint64_t PackSequenceAndType(uint64_t seq, ValueType t) {
+  assert(seq <= kMaxSequenceNumber);
+  assert(t <= kValueTypeForSeek);
+  return (seq << 8) | t;
+}
+
+// internal key 的格式: user_key + fixed64(sequence << 8 | type)
+void AppendInternalKey(std::string* result, const ParsedInternalKey& key);
+
+// 解析 internal key，格式不对时返回 false
+bool ParseInternalKey(const Slice& internal_key, ParsedInternalKey* result);
+
+// 返回 internal key 里的 user key 部分
+inline Slice ExtractUserKey(const Slice& internal_key) {
+  assert(internal_key.size() >= 8);
+  return Slice(internal_key.data(), internal_key.size() - 8);
+}
+
+inline SequenceNumber ExtractSequence(const Slice& internal_key) {
+  assert(internal_key.size() >= 8);
+  return DecodeFixed64(internal_key.data() + internal_key.size() - 8) >> 8;
+}
+
+inline ValueType ExtractValueType(const Slice& internal_key) {
+  assert(internal_key.size() >= 8);
+  const uint64_t num =
+      DecodeFixed64(internal_key.data() + internal_key.size() - 8);
+  return static_cast<ValueType>(num & 0xff);
+}
+
+// internal key 的比较器: user key 升序，sequence 降序，type 降序
+// 同一个 user key 最新的版本排在最前面
+class InternalKeyComparator : public Comparator {
+ private:
+  const Comparator* user_comparator_;
+  // 内置的字节序比较器直接调用 BytewiseCompare，省掉一次虚函数调用
+  bool user_is_bytewise_;
+
+ public:
+  explicit InternalKeyComparator(const Comparator* c)
+      : user_comparator_(c), user_is_bytewise_(c == BytewiseComparator()) {}
+  const char* Name() const override;
+  int Compare(const Slice& a, const Slice& b) const override;
+  void FindShortestSeparator(std::string* start,
+                             const Slice& limit) const override;
+  void FindShortSuccessor(std::string* key) const override;
+  // user key 按字节序比较时，去掉 8 字节的 sequence 和 type 就是 user key
+  bool HasNormalizedKeyPrefix(size_t* trailer) const override {
+    *trailer = 8;
+    return user_is_bytewise_;
+  }
+
+  const Comparator* user_comparator() const { return user_comparator_; }
+};
+
+inline int InternalKeyComparator::Compare(const Slice& akey,
+                                          const Slice& bkey) const {
+  int r = user_is_bytewise_
+              ? BytewiseCompare(ExtractUserKey(akey), ExtractUserKey(bkey))
+              : user_comparator_->Compare(ExtractUserKey(akey),
+                                          ExtractUserKey(bkey));
+  if (r == 0) {
+    const uint64_t anum = DecodeFixed64(akey.data() + akey.size() - 8);
+    const uint64_t bnum = DecodeFixed64(bkey.data() + bkey.size() - 8);
+    if (anum > bnum) {
+      r = -1;
+    } else if (anum < bnum) {
+      r = +1;
+    }
+  }
+  return r;
+}
+
+// 把 sstable 中的 internal key 转换成 user key（或者它的前缀）再交给用户的
+// filter 策略，与 memtable 的前缀 bloom 使用同样的规则:
+// 设置了 prefix_extractor 且 user key 在其定义域内时用前缀，否则用整个 user key
+class InternalFilterPolicy : public FilterPolicy {
+ private:
+  const FilterPolicy* const user_policy_;
+  const SliceTransform* const prefix_extractor_;
+
+  Slice FilterKey(const Slice& internal_key) const;
+
+ public:
+  InternalFilterPolicy(const FilterPolicy* p, const SliceTransform* prefix)
+      : user_policy_(p), prefix_extractor_(prefix) {}
+  const FilterPolicy* user_policy() const { return user_policy_; }
+
+  const char* Name() const override;
+  void CreateFilter(const Slice* keys, int n, std::string* dst) const override;
+  bool KeyMayMatch(const Slice& key, const Slice& filter) const override;
+};
+
+// 用 std::string 保存的 internal key，FileMetaData 等需要持有 key 的地方使用
+class InternalKey {
+ private:
+  std::string rep_;
+
+ public:
+  InternalKey() {}  // 为空，表示无效
+  InternalKey(const Slice& user_key, SequenceNumber s, ValueType t) {
+    AppendInternalKey(&rep_, ParsedInternalKey(user_key, s, t));
+  }
+
+  bool DecodeFrom(const Slice& s) {
+    rep_.assign(s.data(), s.size());
+    return !rep_.empty();
+  }
+
+  Slice Encode() const {
+    assert(!rep_.empty());
+    return rep_;
+  }
+
+  Slice user_key() const { return ExtractUserKey(rep_); }
+
+  void SetFrom(const ParsedInternalKey& p) {
+    rep_.clear();
+    AppendInternalKey(&rep_, p);
+  }
+
+  void Clear() { rep_.clear(); }
+
+  bool empty() const { return rep_.empty(); }
+};
+
+// MemTable::Get() 使用的查找 key
+class LookupKey {
+ public:
+  // 构造一个在 sequence 这个快照上查找 user_key 的 key
+  LookupKey(const Slice& user_key, SequenceNumber sequence);
+
+  LookupKey(const LookupKey&) = delete;
+  LookupKey& operator=(const LookupKey&) = delete;
+
+  ~LookupKey();
+
+  // 返回适合在 MemTable 中查找的 key（带长度前缀）
+  Slice memtable_key() const { return Slice(start_, end_ - start_); }
+
+  // 返回 internal key
+  Slice internal_key() const { return Slice(kstart_, end_ - kstart_); }
+
+  Slice user_key() const { return Slice(kstart_, end_ - kstart_ - 8); }
+
+  SequenceNumber sequence() const { return ExtractSequence(internal_key()); }
+
+ private:
+  // 布局:
+  //    klength  varint32               <-- start_
+  //    userkey  char[klength]          <-- kstart_
+  //    tag      uint64
+  //                                    <-- end_
+  const char* start_;
+  const char* kstart_;
+  const char* end_;
+  char space_[200];  // 短 key 不需要额外分配内存
+};
+
+inline LookupKey::~LookupKey() {
+  if (start_ != space_) delete[] start_;
+}
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_DBFORMAT_H_
@@ -0,0 +1,40 @@
+#include "db/filename.h"
+
+#include <cassert>
+#include <cstdio>
+
+namespace leveldb {
+
+static std::string MakeFileName(const std::string& dbname, uint64_t number,
+                                const char* suffix) {
+  char buf[100];
+  std::snprintf(buf, sizeof(buf), "/%06llu.%s",
+                static_cast<unsigned long long>(number), suffix);
+  return dbname + buf;
+}
+
+std::string TableFileName(const std::string& dbname, uint64_t number) {
+  assert(number > 0);
+  return MakeFileName(dbname, number, "ldb");
+}
+
+bool ParseTableFileName(const std::string& fname, uint64_t* number) {
+  static const char kSuffix[] = ".ldb";
+  const size_t suffix_len = sizeof(kSuffix) - 1;
+  if (fname.size() <= suffix_len ||
+      fname.compare(fname.size() - suffix_len, suffix_len, kSuffix) != 0) {
+    return false;
+  }
+  uint64_t v = 0;
+  for (size_t i = 0; i < fname.size() - suffix_len; i++) {
+    const char c = fname[i];
+    if (c < '0' || c > '9' || v > (~static_cast<uint64_t>(0) - 9) / 10) {
+      return false;
+    }
+    v = v * 10 + (c - '0');
+  }
+  *number = v;
+  return true;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,17 @@
+#ifndef STORAGE_LEVELDB_DB_FILENAME_H_
+#define STORAGE_LEVELDB_DB_FILENAME_H_
+
+#include <cstdint>
+#include <string>
+
+namespace leveldb {
+
+// 返回编号为 number 的 sstable 的文件名，以 dbname 开头
+std::string TableFileName(const std::string& dbname, uint64_t number);
+
+// fname（不含目录）是 sstable 的文件名时返回 true，并把编号存入 *number
+bool ParseTableFileName(const std::string& fname, uint64_t* number);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_FILENAME_H_
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "db/memtablerep.h"
+#include "db/skiplist.h"
+#include "leveldb/slice_transform.h"
+#include "util/arena.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+namespace {
+
+// 按 user key 前缀分桶，每个桶是一个只包含该前缀 entry 的跳表
+// 同一个 user key 的所有版本一定落在同一个桶里，所以点查只需要查一个桶
+class HashSkipListRep : public MemTableRep {
+ public:
+  HashSkipListRep(const MemTableKeyComparator& cmp, Arena* arena,
+                  const SliceTransform* transform, size_t bucket_count);
+
+  void Insert(const char* entry) override;
+
+  bool Contains(const char* entry) const override;
+
+  const char* FindGreaterOrEqual(const LookupKey& k) const override;
+
+  MemTableRep::Iterator* GetIterator() override;
+
+  MemTableRep::Iterator* GetDynamicPrefixIterator() override;
+
+ private:
+  typedef SkipList<const char*, const MemTableKeyComparator&> Bucket;
+
+  class BucketIterator;
+  class FullListIterator;
+  class DynamicIterator;
+
+  // 不在 transform 的 domain 中的 key 统一放进前缀为空的桶
+  Slice GetPrefix(const Slice& user_key) const {
+    if (transform_ == nullptr || !transform_->InDomain(user_key)) {
+      return Slice();
+    }
+    return transform_->Transform(user_key);
+  }
+
+  size_t GetHash(const Slice& prefix) const {
+    return Hash(prefix.data(), prefix.size(), 0) % bucket_count_;
+  }
+
+  Bucket* GetBucket(const Slice& prefix) const {
+    return buckets_[GetHash(prefix)].load(std::memory_order_acquire);
+  }
+
+  // 返回前缀对应的桶，不存在时创建，只能由写者调用
+  Bucket* GetInitializedBucket(const Slice& prefix);
+
+  const MemTableKeyComparator compare_;
+  Arena* const arena_;
+  const SliceTransform* const transform_;
+  const size_t bucket_count_;
+
+  // 从 arena 分配的桶数组，桶在第一次插入时创建
+  // 用 release store 发布，读者用 acquire load 看到完整初始化的跳表
+  std::atomic<Bucket*>* buckets_;
+};
+
+HashSkipListRep::HashSkipListRep(const MemTableKeyComparator& cmp,
+                                 Arena* arena, const SliceTransform* transform,
+                                 size_t bucket_count)
+    : compare_(cmp),
+      arena_(arena),
+      transform_(transform),
+      bucket_count_(bucket_count > 0 ? bucket_count : 1) {
+  char* mem =
+      arena_->AllocateAligned(sizeof(std::atomic<Bucket*>) * bucket_count_);
+  buckets_ = reinterpret_cast<std::atomic<Bucket*>*>(mem);
+  for (size_t i = 0; i < bucket_count_; i++) {
+    new (&buckets_[i]) std::atomic<Bucket*>(nullptr);
+  }
+}
+
+HashSkipListRep::Bucket* HashSkipListRep::GetInitializedBucket(
+    const Slice& prefix) {
+  std::atomic<Bucket*>& slot = buckets_[GetHash(prefix)];
+  Bucket* bucket = slot.load(std::memory_order_relaxed);
+  if (bucket == nullptr) {
+    char* mem = arena_->AllocateAligned(sizeof(Bucket));
+    bucket = new (mem) Bucket(compare_, arena_);
+    slot.store(bucket, std::memory_order_release);
+  }
+  return bucket;
+}
+
+void HashSkipListRep::Insert(const char* entry) {
+  Slice user_key = ExtractUserKey(GetLengthPrefixedSlice(entry));
+  GetInitializedBucket(GetPrefix(user_key))->Insert(entry);
+}
+
+bool HashSkipListRep::Contains(const char* entry) const {
+  Slice user_key = ExtractUserKey(GetLengthPrefixedSlice(entry));
+  Bucket* bucket = GetBucket(GetPrefix(user_key));
+  return bucket != nullptr && bucket->Contains(entry);
+}
+
+const char* HashSkipListRep::FindGreaterOrEqual(const LookupKey& k) const {
+  Bucket* bucket = GetBucket(GetPrefix(k.user_key()));
+  if (bucket == nullptr) {
+    return nullptr;
+  }
+  Bucket::Iterator iter(bucket);
+  iter.Seek(k.memtable_key().data());
+  return iter.Valid() ? iter.key() : nullptr;
+}
+
+// 遍历单个桶
+class HashSkipListRep::BucketIterator : public MemTableRep::Iterator {
+ public:
+  explicit BucketIterator(Bucket* bucket) : iter_(bucket) {}
+
+  bool Valid() const override { return iter_.Valid(); }
+  const char* key() const override { return iter_.key(); }
+  void Next() override { iter_.Next(); }
+  void Prev() override { iter_.Prev(); }
+  void Seek(const Slice& internal_key, const char* memtable_key) override {
+    iter_.Seek(memtable_key);
+  }
+  void SeekToFirst() override { iter_.SeekToFirst(); }
+  void SeekToLast() override { iter_.SeekToLast(); }
+
+ private:
+  Bucket::Iterator iter_;
+};
+
+// 全序遍历: 创建时把所有桶中的 entry 收集起来排序
+// 之后插入的 entry 不可见，调用者读的是更早的快照，不受影响
+class HashSkipListRep::FullListIterator : public MemTableRep::Iterator {
+ public:
+  FullListIterator(const HashSkipListRep* rep) : compare_(rep->compare_) {
+    for (size_t i = 0; i < rep->bucket_count_; i++) {
+      Bucket* bucket = rep->buckets_[i].load(std::memory_order_acquire);
+      if (bucket == nullptr) continue;
+      Bucket::Iterator iter(bucket);
+      for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+        entries_.push_back(iter.key());
+      }
+    }
+    const MemTableKeyComparator& cmp = compare_;
+    std::sort(entries_.begin(), entries_.end(),
+              [&cmp](const char* a, const char* b) { return cmp(a, b) < 0; });
+    pos_ = entries_.size();
+  }
+
+  bool Valid() const override { return pos_ < entries_.size(); }
+  const char* key() const override {
+    assert(Valid());
+    return entries_[pos_];
+  }
+  void Next() override {
+    assert(Valid());
+    pos_++;
+  }
+  void Prev() override {
+    assert(Valid());
+    pos_ = (pos_ == 0) ? entries_.size() : pos_ - 1;
+  }
+  void Seek(const Slice& internal_key, const char* memtable_key) override {
+    const MemTableKeyComparator& cmp = compare_;
+    pos_ = std::lower_bound(entries_.begin(), entries_.end(), memtable_key,
+                            [&cmp](const char* a, const char* b) {
+                              return cmp(a, b) < 0;
+                            }) -
+           entries_.begin();
+  }
+  void SeekToFirst() override { pos_ = 0; }
+  void SeekToLast() override {
+    pos_ = entries_.empty() ? 0 : entries_.size() - 1;
+  }
+
+ private:
+  const MemTableKeyComparator& compare_;
+  std::vector<const char*> entries_;
+  size_t pos_;  // == entries_.size() 表示无效
+};
+
+// 前缀遍历: Seek 时只定位到 target 前缀所在的桶
+// target 不在 domain 中，或者调用 SeekToFirst/SeekToLast 时退化为全序遍历
+class HashSkipListRep::DynamicIterator : public MemTableRep::Iterator {
+ public:
+  explicit DynamicIterator(HashSkipListRep* rep) : rep_(rep) {}
+
+  bool Valid() const override { return current_ != nullptr && current_->Valid(); }
+  const char* key() const override { return current_->key(); }
+  void Next() override { current_->Next(); }
+  void Prev() override { current_->Prev(); }
+
+  void Seek(const Slice& internal_key, const char* memtable_key) override {
+    Slice user_key = ExtractUserKey(internal_key);
+    if (rep_->transform_ == nullptr || !rep_->transform_->InDomain(user_key)) {
+      UseFullList();
+    } else {
+      Bucket* bucket = rep_->GetBucket(rep_->transform_->Transform(user_key));
+      if (bucket == nullptr) {
+        current_ = nullptr;
+        return;
+      }
+      bucket_iter_.reset(new BucketIterator(bucket));
+      current_ = bucket_iter_.get();
+    }
+    current_->Seek(internal_key, memtable_key);
+  }
+
+  void SeekToFirst() override {
+    UseFullList();
+    current_->SeekToFirst();
+  }
+
+  void SeekToLast() override {
+    UseFullList();
+    current_->SeekToLast();
+  }
+
+ private:
+  void UseFullList() {
+    if (full_iter_ == nullptr) {
+      full_iter_.reset(new FullListIterator(rep_));
+    }
+    current_ = full_iter_.get();
+  }
+
+  HashSkipListRep* const rep_;
+  std::unique_ptr<MemTableRep::Iterator> bucket_iter_;
+  std::unique_ptr<MemTableRep::Iterator> full_iter_;
+  MemTableRep::Iterator* current_ = nullptr;
+};
+
+MemTableRep::Iterator* HashSkipListRep::GetIterator() {
+  return new FullListIterator(this);
+}
+
+MemTableRep::Iterator* HashSkipListRep::GetDynamicPrefixIterator() {
+  return new DynamicIterator(this);
+}
+
+class HashSkipListRepFactory : public MemTableRepFactory {
+ public:
+  explicit HashSkipListRepFactory(size_t bucket_count)
+      : bucket_count_(bucket_count) {}
+
+  MemTableRep* CreateMemTableRep(const MemTableKeyComparator& cmp,
+                                 Arena* arena,
+                                 const SliceTransform* prefix_extractor)
+      const override {
+    return new HashSkipListRep(cmp, arena, prefix_extractor, bucket_count_);
+  }
+
+  const char* Name() const override { return "HashSkipListRepFactory"; }
+
+ private:
+  const size_t bucket_count_;
+};
+
+}  // namespace
+
+MemTableRepFactory* NewHashSkipListRepFactory(size_t bucket_count) {
+  return new HashSkipListRepFactory(bucket_count);
+}
+
+}  // namespace leveldb
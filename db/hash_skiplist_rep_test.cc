@@ -0,0 +1,122 @@
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "leveldb/db.h"
+#include "leveldb/iterator.h"
+#include "leveldb/memtablerep.h"
+#include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+class HashSkipListRepTest : public testing::Test {
+ public:
+  HashSkipListRepTest()
+      : factory_(NewHashSkipListRepFactory()),
+        prefix_(NewFixedPrefixTransform(4)),
+        dbname_(test::TmpDir("hash_skiplist_rep_test")),
+        db_(nullptr) {
+    options_.memtable_factory = factory_.get();
+    options_.prefix_extractor = prefix_.get();
+  }
+
+  ~HashSkipListRepTest() override { delete db_; }
+
+  void Open() { ASSERT_TRUE(DB::Open(options_, dbname_, &db_).ok()); }
+
+  std::string Get(const std::string& key) {
+    std::string value;
+    Status s = db_->Get(ReadOptions(), key, &value);
+    if (s.IsNotFound()) {
+      return "NOT_FOUND";
+    }
+    EXPECT_TRUE(s.ok()) << s.ToString();
+    return value;
+  }
+
+  static std::string Key(int prefix, int i) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "p%03d-%06d", prefix, i);
+    return buf;
+  }
+
+  std::unique_ptr<MemTableRepFactory> factory_;
+  std::unique_ptr<const SliceTransform> prefix_;
+  Options options_;
+  const std::string dbname_;
+  DB* db_;
+};
+
+// 默认的桶个数和默认的 write_buffer_size 可以一起使用
+TEST_F(HashSkipListRepTest, DefaultOptions) {
+  Open();
+  WriteOptions wo;
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(db_->Put(wo, Key(i, i), "v" + std::to_string(i)).ok());
+  }
+  for (int i = 0; i < 5; i++) {
+    ASSERT_EQ("v" + std::to_string(i), Get(Key(i, i)));
+  }
+  ASSERT_EQ("NOT_FOUND", Get(Key(7, 7)));
+}
+
+// 写入足够多的数据，经过多次 memtable 切换和 flush 后结果仍然正确
+TEST_F(HashSkipListRepTest, WriteAcrossFlushes) {
+  options_.write_buffer_size = 256 * 1024;
+  Open();
+  WriteOptions wo;
+  std::map<std::string, std::string> model;
+  Random rnd(301);
+  for (int i = 0; i < 20000; i++) {
+    const std::string key = Key(rnd.Uniform(50), rnd.Uniform(500));
+    if (rnd.OneIn(5)) {
+      ASSERT_TRUE(db_->Delete(wo, key).ok());
+      model.erase(key);
+    } else {
+      const std::string value = std::string(20, 'a' + i % 26);
+      ASSERT_TRUE(db_->Put(wo, key, value).ok());
+      model[key] = value;
+    }
+  }
+
+  for (int p = 0; p < 50; p++) {
+    for (int i = 0; i < 500; i += 7) {
+      auto it = model.find(Key(p, i));
+      ASSERT_EQ(it == model.end() ? "NOT_FOUND" : it->second, Get(Key(p, i)));
+    }
+  }
+
+  // 全序遍历
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  auto m = model.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++m) {
+    ASSERT_TRUE(m != model.end());
+    ASSERT_EQ(m->first, iter->key().ToString());
+    ASSERT_EQ(m->second, iter->value().ToString());
+  }
+  ASSERT_TRUE(m == model.end());
+
+  // 前缀遍历只返回同一前缀的 key
+  ReadOptions ro;
+  ro.prefix_same_as_start = true;
+  iter.reset(db_->NewIterator(ro));
+  const std::string prefix = Key(17, 0).substr(0, 4);
+  int count = 0;
+  for (iter->Seek(prefix); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(prefix, iter->key().ToString().substr(0, 4));
+    count++;
+  }
+  int expected = 0;
+  for (auto it = model.lower_bound(prefix);
+       it != model.end() && it->first.compare(0, 4, prefix) == 0; ++it) {
+    expected++;
+  }
+  ASSERT_EQ(expected, count);
+}
+
+}  // namespace leveldb
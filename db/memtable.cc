@@ -0,0 +1,296 @@
+#include "db/memtable.h"
+
+#include "leveldb/comparator.h"
+#include "leveldb/slice_transform.h"
+#include "util/coding.h"
+
+namespace leveldb {
+
+static const MemTableRepFactory* DefaultRepFactory() {
+  static const MemTableRepFactory* factory = NewSkipListRepFactory();
+  return factory;
+}
+
+MemTable::MemTable(const InternalKeyComparator& comparator,
+                   const Options& options)
+    : comparator_(comparator),
+      prefix_extractor_(options.prefix_extractor),
+      refs_(0),
+      immutable_(false),
+      table_((options.memtable_factory != nullptr ? options.memtable_factory
+                                                  : DefaultRepFactory())
+                 ->CreateMemTableRep(comparator_, &arena_, prefix_extractor_)),
+      range_del_table_(DefaultRepFactory()->CreateMemTableRep(
+          comparator_, &arena_, nullptr)),
+      num_range_deletes_(0),
+      fragmented_range_dels_(nullptr) {
+  if (prefix_extractor_ != nullptr && options.memtable_prefix_bloom_bits > 0) {
+    prefix_bloom_.reset(new DynamicBloom(
+        &arena_, static_cast<uint32_t>(options.memtable_prefix_bloom_bits)));
+  }
+  initial_memory_usage_ = arena_.MemoryUsage();
+}
+
+MemTable::~MemTable() {
+  assert(refs_ == 0);
+  delete fragmented_range_dels_.load(std::memory_order_relaxed);
+  // 替换下来的切分结果由 range_del_epochs_ 的析构函数释放
+}
+
+void MemTable::SampleSplitKeys(size_t n,
+                               std::vector<std::string>* user_keys) const {
+  std::vector<const char*> entries;
+  table_->SampleSplitKeys(n, &entries);
+  user_keys->clear();
+  const Comparator* ucmp = comparator_.comparator.user_comparator();
+  for (const char* entry : entries) {
+    Slice user_key = ExtractUserKey(GetLengthPrefixedSlice(entry));
+    // 同一个 user key 的多个版本只保留一个
+    if (user_keys->empty() || ucmp->Compare(user_keys->back(), user_key) < 0) {
+      user_keys->push_back(user_key.ToString());
+    }
+  }
+}
+
+size_t MemTable::ApproximateMemoryUsage() { return arena_.MemoryUsage(); }
+
+// 把 target 编码成带长度前缀的 key，scratch 作为临时存储
+static const char* EncodeKey(std::string* scratch, const Slice& target) {
+  scratch->clear();
+  PutVarint32(scratch, target.size());
+  scratch->append(target.data(), target.size());
+  return scratch->data();
+}
+
+uint64_t MemTable::ApproximateNumEntries(const Slice& start_ikey,
+                                         const Slice& end_ikey) const {
+  std::string start, end;
+  return table_->ApproximateNumEntries(EncodeKey(&start, start_ikey),
+                                       EncodeKey(&end, end_ikey));
+}
+
+class MemTableIterator : public Iterator {
+ public:
+  // 拥有 iter 的所有权，mem 不为 nullptr 时按前缀 bloom 过滤 Seek
+  MemTableIterator(MemTableRep::Iterator* iter, const MemTable* mem)
+      : iter_(iter), prefix_filter_(mem), filtered_(false) {}
+
+  MemTableIterator(const MemTableIterator&) = delete;
+  MemTableIterator& operator=(const MemTableIterator&) = delete;
+
+  ~MemTableIterator() override = default;
+
+  bool Valid() const override { return !filtered_ && iter_->Valid(); }
+  void Seek(const Slice& k) override {
+    filtered_ = prefix_filter_ != nullptr &&
+                !prefix_filter_->PrefixMayMatch(ExtractUserKey(k));
+    if (filtered_) {
+      // memtable 中没有这个前缀，不用再查 rep
+      return;
+    }
+    iter_->Seek(k, EncodeKey(&tmp_, k));
+  }
+  void SeekToFirst() override {
+    filtered_ = false;
+    iter_->SeekToFirst();
+  }
+  void SeekToLast() override {
+    filtered_ = false;
+    iter_->SeekToLast();
+  }
+  void Next() override { iter_->Next(); }
+  void Prev() override { iter_->Prev(); }
+  Slice key() const override { return GetLengthPrefixedSlice(iter_->key()); }
+  Slice value() const override {
+    Slice key_slice = GetLengthPrefixedSlice(iter_->key());
+    return GetLengthPrefixedSlice(key_slice.data() + key_slice.size());
+  }
+
+  Status status() const override { return Status::OK(); }
+
+ private:
+  std::unique_ptr<MemTableRep::Iterator> iter_;
+  const MemTable* const prefix_filter_;
+  bool filtered_;  // 最近一次 Seek 被前缀 bloom 过滤掉了
+  std::string tmp_;  // 给 EncodeKey 用
+};
+
+Iterator* MemTable::NewIterator(const ReadOptions& read_options) {
+  if (read_options.prefix_same_as_start && prefix_extractor_ != nullptr) {
+    return new MemTableIterator(table_->GetDynamicPrefixIterator(),
+                                prefix_bloom_ != nullptr ? this : nullptr);
+  }
+  return new MemTableIterator(table_->GetIterator(), nullptr);
+}
+
+Iterator* MemTable::NewRangeTombstoneIterator() {
+  return new MemTableIterator(range_del_table_->GetIterator(), nullptr);
+}
+
+bool MemTable::PrefixMayMatch(const Slice& user_key) const {
+  if (prefix_bloom_ == nullptr || !prefix_extractor_->InDomain(user_key)) {
+    return true;
+  }
+  return prefix_bloom_->MayContain(prefix_extractor_->Transform(user_key));
+}
+
+void MemTable::Add(SequenceNumber s, ValueType type, const Slice& key,
+                   const Slice& value) {
+  // entry 的格式:
+  //  key_size     : varint32 of internal_key.size()
+  //  key bytes    : char[internal_key.size()]
+  //  tag          : uint64((sequence << 8) | type)
+  //  value_size   : varint32 of value.size()
+  //  value bytes  : char[value.size()]
+  size_t key_size = key.size();
+  size_t val_size = value.size();
+  size_t internal_key_size = key_size + 8;
+  const size_t encoded_len = VarintLength(internal_key_size) +
+                             internal_key_size + VarintLength(val_size) +
+                             val_size;
+  char* buf = arena_.Allocate(encoded_len);
+  char* p = EncodeVarint32(buf, internal_key_size);
+  std::memcpy(p, key.data(), key_size);
+  p += key_size;
+  EncodeFixed64(p, PackSequenceAndType(s, type));
+  p += 8;
+  p = EncodeVarint32(p, val_size);
+  std::memcpy(p, value.data(), val_size);
+  assert(p + val_size == buf + encoded_len);
+  if (type != kTypeRangeDeletion && prefix_bloom_ != nullptr &&
+      prefix_extractor_->InDomain(key)) {
+    // 先加入 bloom 再插入跳表，读者看到 entry 时 bloom 中一定已经有它的前缀
+    prefix_bloom_->Add(prefix_extractor_->Transform(key));
+  }
+  if (type == kTypeRangeDeletion) {
+    range_del_table_->Insert(buf);
+    // 先插入再增加计数，读者看到计数时一定能在跳表里看到这条 entry
+    // 写入时不切分，由之后的读者发现已发布的结果过期时再重新切分
+    num_range_deletes_.fetch_add(1, std::memory_order_release);
+  } else {
+    table_->Insert(buf);
+  }
+}
+
+const MemTable::RangeDelList* MemTable::CurrentRangeTombstones() {
+  const size_t n = num_range_deletes_.load(std::memory_order_acquire);
+  RangeDelList* current =
+      fragmented_range_dels_.load(std::memory_order_acquire);
+  if (current != nullptr && (*current)->num_unfragmented_tombstones() >= n) {
+    return current;
+  }
+
+  // 已发布的结果过期，重新切分后发布；多个读者可能同时重建，
+  // 只保留读到的 tombstone 最多的那个
+  Iterator* iter = NewRangeTombstoneIterator();
+  RangeDelList* list = new RangeDelList(
+      std::make_shared<const FragmentedRangeTombstoneList>(
+          iter, comparator_.comparator.user_comparator()));
+  delete iter;
+  while (true) {
+    if (current != nullptr && (*current)->num_unfragmented_tombstones() >=
+                                  (*list)->num_unfragmented_tombstones()) {
+      delete list;
+      return current;
+    }
+    if (fragmented_range_dels_.compare_exchange_weak(
+            current, list, std::memory_order_acq_rel,
+            std::memory_order_acquire)) {
+      break;
+    }
+  }
+  if (current != nullptr) {
+    range_del_epochs_.Retire(
+        [](void* arg) { delete reinterpret_cast<RangeDelList*>(arg); },
+        current);
+  }
+  return list;
+}
+
+std::shared_ptr<const FragmentedRangeTombstoneList>
+MemTable::GetRangeTombstones() {
+  if (num_range_deletes_.load(std::memory_order_acquire) == 0) {
+    return nullptr;
+  }
+  std::shared_ptr<const FragmentedRangeTombstoneList> result;
+  {
+    EpochGuard guard(&range_del_epochs_);
+    result = *CurrentRangeTombstones();
+  }
+  if (range_del_epochs_.HasPending()) {
+    range_del_epochs_.TryReclaim();
+  }
+  return result;
+}
+
+bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
+  Slice v;
+  if (!Get(key, &v, s)) {
+    return false;
+  }
+  if (s->ok()) {
+    value->assign(v.data(), v.size());
+  }
+  return true;
+}
+
+bool MemTable::Get(const LookupKey& key, Slice* value, Status* s) {
+  // 覆盖这个 key 且对当前快照可见的区间删除
+  // 只在 epoch 中使用切分结果，不修改 shared_ptr 的引用计数
+  SequenceNumber tombstone_seq = 0;
+  if (num_range_deletes_.load(std::memory_order_relaxed) != 0) {
+    {
+      EpochGuard guard(&range_del_epochs_);
+      tombstone_seq = (*CurrentRangeTombstones())
+                          ->MaxCoveringTombstoneSeqnum(key.user_key(),
+                                                       key.sequence());
+    }
+    if (range_del_epochs_.HasPending()) {
+      range_del_epochs_.TryReclaim();
+    }
+  }
+
+  const char* entry = nullptr;
+  if (PrefixMayMatch(key.user_key())) {
+    entry = table_->FindGreaterOrEqual(key);
+  }
+  if (entry != nullptr) {
+    // entry 的格式:
+    //    klength  varint32
+    //    userkey  char[klength - 8]
+    //    tag      uint64
+    //    vlength  varint32
+    //    value    char[vlength]
+    // 查找时已经跳过了 sequence 大于快照的 entry，这里只需要检查 user key 是否相同
+    uint32_t key_length;
+    const char* key_ptr = GetVarint32Ptr(entry, entry + 5, &key_length);
+    if (comparator_.comparator.user_comparator()->Compare(
+            Slice(key_ptr, key_length - 8), key.user_key()) == 0) {
+      const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
+      if ((tag >> 8) < tombstone_seq) {
+        // 被更新的区间删除覆盖
+        *s = Status::NotFound(Slice());
+        return true;
+      }
+      switch (static_cast<ValueType>(tag & 0xff)) {
+        case kTypeValue: {
+          *value = GetLengthPrefixedSlice(key_ptr + key_length);
+          return true;
+        }
+        case kTypeDeletion:
+          *s = Status::NotFound(Slice());
+          return true;
+        default:
+          break;
+      }
+    }
+  }
+  if (tombstone_seq > 0) {
+    // memtable 中没有这个 key，但区间删除已经覆盖了更老的数据
+    *s = Status::NotFound(Slice());
+    return true;
+  }
+  return false;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,144 @@
+#ifndef STORAGE_LEVELDB_DB_MEMTABLE_H_
+#define STORAGE_LEVELDB_DB_MEMTABLE_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/memtablerep.h"
+#include "db/range_tombstone.h"
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "util/arena.h"
+#include "util/dynamic_bloom.h"
+#include "util/epoch.h"
+
+namespace leveldb {
+
+class MemTable {
+ public:
+  // MemTable 使用引用计数，初始为 0，调用者至少要 Ref() 一次
+  // 设置了 options.prefix_extractor 时维护 user key 前缀的 bloom
+  // 点写入的存储结构由 options.memtable_factory 创建，默认为跳表
+  MemTable(const InternalKeyComparator& comparator, const Options& options);
+
+  MemTable(const MemTable&) = delete;
+  MemTable& operator=(const MemTable&) = delete;
+
+  // 引用计数是原子的，Ref/Unref 可以在不同线程中调用，不需要加锁
+  void Ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+  // 引用计数为 0 时删除自己
+  void Unref() {
+    const int refs = refs_.fetch_sub(1, std::memory_order_acq_rel);
+    assert(refs >= 1);
+    if (refs == 1) {
+      delete this;
+    }
+  }
+
+  // memtable 写满、不再接受写入时调用，rep 可以借此整理成只读的形式
+  // （默认的跳表会冻结成紧凑的数组），期间读操作可以照常并发执行
+  // 要求: 之后不再调用 Add，不能在多个线程中同时调用
+  void MarkImmutable() {
+    table_->MarkReadOnly();
+    immutable_.store(true, std::memory_order_release);
+  }
+
+  // MarkImmutable 已经完成时返回 true
+  bool IsImmutable() const {
+    return immutable_.load(std::memory_order_acquire);
+  }
+
+  // 按顺序返回最多 n 个互不相同、大致均匀分布的 user key，
+  // flush 时用它们把 key 空间切分成多段
+  void SampleSplitKeys(size_t n, std::vector<std::string>* user_keys) const;
+
+  // 估算 internal key 在 [start_ikey, end_ikey) 范围内的 entry 个数，
+  // 用于在索引和扫描之间做选择、切分并行扫描，可以在修改 memtable 的同时调用
+  uint64_t ApproximateNumEntries(const Slice& start_ikey,
+                                 const Slice& end_ikey) const;
+
+  // 返回已使用内存的估计值，可以在修改 memtable 的同时调用
+  size_t ApproximateMemoryUsage();
+
+  // 空的 memtable 已经占用的内存（rep 的头部、哈希桶、前缀 bloom 等）
+  size_t InitialMemoryUsage() const { return initial_memory_usage_; }
+
+  // 返回遍历点写入 entry 的迭代器（不包含区间删除）
+  // 迭代器的 key() 是 internal key
+  // 迭代器存活期间 memtable 必须存活
+  // read_options.prefix_same_as_start 为 true 时，如果前缀 bloom 表明
+  // memtable 中没有 Seek 的 target 的前缀，Seek 直接返回 !Valid()
+  Iterator* NewIterator(const ReadOptions& read_options = ReadOptions());
+
+  // 返回遍历区间删除的迭代器，key() 为 internal key(start)，value() 为 end
+  Iterator* NewRangeTombstoneIterator();
+
+  // 插入一条 entry: type 为 kTypeValue 时存放 key->value，
+  // kTypeDeletion 时 value 通常为空，
+  // kTypeRangeDeletion 时表示删除 [key, value)
+  // 要求: 写操作由外部同步
+  void Add(SequenceNumber seq, ValueType type, const Slice& key,
+           const Slice& value);
+
+  // 删除 [begin_key, end_key) 中 sequence < seq 的所有 key
+  // 只写入一条 entry，与区间内 key 的个数无关
+  void DeleteRange(SequenceNumber seq, const Slice& begin_key,
+                   const Slice& end_key) {
+    Add(seq, kTypeRangeDeletion, begin_key, end_key);
+  }
+
+  // 如果 memtable 中有 key 的值，把值存入 *value 并返回 true
+  // 如果 key 已被删除（点删除或区间删除），*s 置为 NotFound 并返回 true
+  // 否则返回 false
+  bool Get(const LookupKey& key, std::string* value, Status* s);
+
+  // 同上，但 *value 直接指向 arena 中的数据，memtable 释放之前一直有效
+  bool Get(const LookupKey& key, Slice* value, Status* s);
+
+  // 返回当前区间删除的切分结果，没有区间删除时返回 nullptr
+  // 结果被缓存，只有新的区间删除写入后的第一次读取才会重新切分，读者不加锁
+  std::shared_ptr<const FragmentedRangeTombstoneList> GetRangeTombstones();
+
+ private:
+  friend class MemTableIterator;
+
+  ~MemTable();  // 只能通过 Unref() 删除
+
+  typedef std::shared_ptr<const FragmentedRangeTombstoneList> RangeDelList;
+
+  // 返回包含所有已写入的区间删除的切分结果，过期时重新切分并发布
+  // 要求: 在 range_del_epochs_ 的读临界区中调用，且已经写入过区间删除，
+  // 返回值在离开临界区之前有效
+  const RangeDelList* CurrentRangeTombstones();
+
+  // user_key 的前缀一定不在 memtable 中时返回 false
+  bool PrefixMayMatch(const Slice& user_key) const;
+
+  MemTableKeyComparator comparator_;
+  const SliceTransform* const prefix_extractor_;
+  std::atomic<int> refs_;
+  std::atomic<bool> immutable_;
+  Arena arena_;
+  std::unique_ptr<MemTableRep> table_;
+  // 区间删除单独存放在跳表中，点查和迭代时再去查询，不会干扰点写入的查找路径
+  std::unique_ptr<MemTableRep> range_del_table_;
+  std::atomic<size_t> num_range_deletes_;
+
+  // 最近发布的切分结果，还没有切分过时为 nullptr；由发现它过期的读者替换，
+  // 读者在 range_del_epochs_ 中读取，替换下来的等读者退出后才释放
+  EpochManager range_del_epochs_;
+  std::atomic<RangeDelList*> fragmented_range_dels_;
+
+  // 点写入的 user key 前缀的 bloom，没有设置 prefix_extractor 时为 nullptr
+  std::unique_ptr<DynamicBloom> prefix_bloom_;
+
+  size_t initial_memory_usage_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_MEMTABLE_H_
@@ -0,0 +1,374 @@
+#include "db/memtable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/comparator.h"
+#include "leveldb/memtablerep.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+namespace {
+
+struct Op {
+  SequenceNumber seq;
+  ValueType type;
+  std::string key;
+  std::string value;  // kTypeRangeDeletion 时为 end key
+};
+
+std::string Key(int i) {
+  char buf[16];
+  std::snprintf(buf, sizeof(buf), "k%04d", i);
+  return buf;
+}
+
+// 按定义逐条检查 ops，得出 MemTable::Get 应有的结果
+// 返回 false 表示 memtable 中没有 key 的任何信息
+bool ModelGet(const std::vector<Op>& ops, const std::string& key,
+              SequenceNumber snapshot, std::string* value, bool* deleted) {
+  const Op* point = nullptr;
+  SequenceNumber tombstone_seq = 0;
+  for (const Op& op : ops) {
+    if (op.seq > snapshot) {
+      continue;
+    }
+    if (op.type == kTypeRangeDeletion) {
+      if (op.key <= key && key < op.value) {
+        tombstone_seq = std::max(tombstone_seq, op.seq);
+      }
+    } else if (op.key == key && (point == nullptr || op.seq > point->seq)) {
+      point = &op;
+    }
+  }
+  if (tombstone_seq > 0 && (point == nullptr || point->seq < tombstone_seq)) {
+    *deleted = true;
+    return true;
+  }
+  if (point == nullptr) {
+    return false;
+  }
+  *deleted = (point->type == kTypeDeletion);
+  *value = point->value;
+  return true;
+}
+
+}  // namespace
+
+class MemTableTest : public testing::Test {
+ public:
+  MemTableTest() : cmp_(BytewiseComparator()) {}
+
+  MemTable* NewMemTable() {
+    MemTable* mem = new MemTable(cmp_, options_);
+    mem->Ref();
+    return mem;
+  }
+
+  // 写入 n 个随机操作，每写入 500 个（check_while_writing 为 true 时）
+  // 和全部写完之后与模型比较一次
+  void AddRandomOps(MemTable* mem, std::vector<Op>* ops, Random* rnd, int n,
+                    bool check_while_writing) {
+    for (int i = 0; i < n; i++) {
+      Op op;
+      op.seq = ops->size() + 1;
+      const int r = rnd->Uniform(20);
+      op.key = Key(rnd->Uniform(kKeys));
+      if (r < 14) {
+        op.type = kTypeValue;
+        op.value = "v" + std::to_string(op.seq);
+      } else if (r < 18) {
+        op.type = kTypeDeletion;
+      } else {
+        op.type = kTypeRangeDeletion;
+        op.value = Key(rnd->Uniform(kKeys));
+      }
+      mem->Add(op.seq, op.type, op.key, op.value);
+      ops->push_back(op);
+      if (check_while_writing && op.seq % 500 == 0) {
+        CheckAgainstModel(mem, *ops, rnd);
+      }
+    }
+    CheckAgainstModel(mem, *ops, rnd);
+  }
+
+  // 在随机快照下点查随机的 key，并检查迭代器按 internal key 有序、
+  // 包含所有点写入的 entry
+  void CheckAgainstModel(MemTable* mem, const std::vector<Op>& ops,
+                         Random* rnd) {
+    const SequenceNumber last = ops.size();
+    for (int i = 0; i < 300; i++) {
+      const std::string key = Key(rnd->Uniform(kKeys + 10));
+      const SequenceNumber snapshot = 1 + rnd->Uniform(last);
+      std::string expected, value;
+      bool deleted = false;
+      const bool found = ModelGet(ops, key, snapshot, &expected, &deleted);
+      Status s;
+      ASSERT_EQ(found, mem->Get(LookupKey(key, snapshot), &value, &s))
+          << key << " @" << snapshot;
+      if (found) {
+        ASSERT_EQ(deleted, s.IsNotFound()) << key << " @" << snapshot;
+        if (!deleted) {
+          ASSERT_EQ(expected, value);
+        }
+      }
+    }
+
+    size_t point_ops = 0;
+    for (const Op& op : ops) {
+      point_ops += (op.type != kTypeRangeDeletion);
+    }
+    std::unique_ptr<Iterator> iter(mem->NewIterator());
+    std::string prev;
+    size_t count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      if (count > 0) {
+        ASSERT_LT(cmp_.Compare(prev, iter->key()), 0);
+      }
+      prev = iter->key().ToString();
+      count++;
+    }
+    ASSERT_EQ(point_ops, count);
+
+    // Seek 到任意 key 都落在第一个 >= 它的 entry 上
+    for (int i = 0; i < 50; i++) {
+      const Op& op = ops[rnd->Uniform(ops.size())];
+      if (op.type == kTypeRangeDeletion) {
+        continue;
+      }
+      InternalKey target(op.key, op.seq, op.type);
+      iter->Seek(target.Encode());
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(0, cmp_.Compare(target.Encode(), iter->key()));
+    }
+  }
+
+  static const int kKeys = 200;
+
+  InternalKeyComparator cmp_;
+  Options options_;
+};
+
+TEST_F(MemTableTest, Empty) {
+  MemTable* mem = NewMemTable();
+  std::string value;
+  Status s;
+  ASSERT_FALSE(mem->Get(LookupKey("a", kMaxSequenceNumber), &value, &s));
+  ASSERT_EQ(nullptr, mem->GetRangeTombstones());
+  mem->Unref();
+}
+
+TEST_F(MemTableTest, RangeDeletionHidesOlderEntries) {
+  MemTable* mem = NewMemTable();
+  mem->Add(1, kTypeValue, "b", "v1");
+  mem->Add(2, kTypeValue, "d", "v2");
+  mem->DeleteRange(3, "a", "c");
+  mem->Add(4, kTypeValue, "b", "v4");
+
+  std::string value;
+  Status s;
+  ASSERT_TRUE(mem->Get(LookupKey("b", 2), &value, &s));
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ("v1", value);
+
+  s = Status::OK();
+  ASSERT_TRUE(mem->Get(LookupKey("b", 3), &value, &s));
+  ASSERT_TRUE(s.IsNotFound());
+
+  s = Status::OK();
+  ASSERT_TRUE(mem->Get(LookupKey("b", 4), &value, &s));
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ("v4", value);
+
+  // 区间删除不包含 end key
+  s = Status::OK();
+  ASSERT_FALSE(mem->Get(LookupKey("c", 4), &value, &s));
+  ASSERT_TRUE(mem->Get(LookupKey("d", 4), &value, &s));
+  ASSERT_EQ("v2", value);
+
+  // 没有写入过的 key 被区间删除覆盖时也要返回 NotFound，屏蔽更老的数据
+  s = Status::OK();
+  ASSERT_TRUE(mem->Get(LookupKey("a", 4), &value, &s));
+  ASSERT_TRUE(s.IsNotFound());
+  mem->Unref();
+}
+
+// 写入区间删除时不切分，读取时只在有新的区间删除之后才重新切分
+TEST_F(MemTableTest, RangeTombstonesFragmentedOnRead) {
+  MemTable* mem = NewMemTable();
+  const int kNum = 1000;
+  for (int i = 0; i < kNum; i++) {
+    mem->DeleteRange(i + 1, Key(i), Key(i + 2));
+  }
+  std::shared_ptr<const FragmentedRangeTombstoneList> list =
+      mem->GetRangeTombstones();
+  ASSERT_EQ(static_cast<size_t>(kNum), list->num_unfragmented_tombstones());
+  ASSERT_EQ(list, mem->GetRangeTombstones());
+
+  std::string value;
+  Status s;
+  ASSERT_TRUE(mem->Get(LookupKey(Key(kNum), kMaxSequenceNumber), &value, &s));
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_EQ(list, mem->GetRangeTombstones());
+
+  mem->DeleteRange(kNum + 1, Key(kNum + 5), Key(kNum + 6));
+  s = Status::OK();
+  ASSERT_TRUE(
+      mem->Get(LookupKey(Key(kNum + 5), kMaxSequenceNumber), &value, &s));
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_EQ(static_cast<size_t>(kNum + 1),
+            mem->GetRangeTombstones()->num_unfragmented_tombstones());
+  mem->Unref();
+}
+
+TEST_F(MemTableTest, RandomizedAgainstModel) {
+  MemTable* mem = NewMemTable();
+  std::vector<Op> ops;
+  Random rnd(301);
+  AddRandomOps(mem, &ops, &rnd, 3000, true);
+  mem->Unref();
+}
+
+// 只读之前逐个扫描，只读之后排序并二分查找，两种状态下结果都正确
+TEST_F(MemTableTest, VectorRep) {
+  std::unique_ptr<MemTableRepFactory> factory(NewVectorRepFactory(1000));
+  options_.memtable_factory = factory.get();
+  MemTable* mem = NewMemTable();
+  std::vector<Op> ops;
+  Random rnd(302);
+  AddRandomOps(mem, &ops, &rnd, 2000, true);
+  mem->MarkImmutable();
+  CheckAgainstModel(mem, ops, &rnd);
+
+  std::vector<std::string> split_keys;
+  mem->SampleSplitKeys(7, &split_keys);
+  ASSERT_FALSE(split_keys.empty());
+  ASSERT_LE(split_keys.size(), 7u);
+  for (size_t i = 1; i < split_keys.size(); i++) {
+    ASSERT_LT(split_keys[i - 1], split_keys[i]);
+  }
+  mem->Unref();
+}
+
+// 按预计的 entry 个数选择高度的跳表，entry 远多于预计时仍然正确
+TEST_F(MemTableTest, AdaptiveSkipList) {
+  for (size_t expected : {size_t{10}, size_t{100000000}}) {
+    std::unique_ptr<MemTableRepFactory> factory(
+        NewAdaptiveSkipListRepFactory(expected));
+    options_.memtable_factory = factory.get();
+    MemTable* mem = NewMemTable();
+    std::vector<Op> ops;
+    Random rnd(303);
+    AddRandomOps(mem, &ops, &rnd, 2000, false);
+    CheckAgainstModel(mem, ops, &rnd);
+    mem->Unref();
+  }
+}
+
+// 冻结成 Eytzinger 数组前后结果相同，覆盖各种大小的完全二叉树
+TEST_F(MemTableTest, FrozenSkipList) {
+  for (int n : {1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 100, 1000, 4097}) {
+    MemTable* mem = NewMemTable();
+    std::vector<Op> ops;
+    Random rnd(n);
+    AddRandomOps(mem, &ops, &rnd, n, false);
+    std::vector<std::string> before;
+    std::unique_ptr<Iterator> iter(mem->NewIterator());
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      before.push_back(iter->key().ToString());
+    }
+
+    mem->MarkImmutable();
+    CheckAgainstModel(mem, ops, &rnd);
+    // 反向遍历
+    std::vector<std::string> after;
+    iter.reset(mem->NewIterator());
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      after.push_back(iter->key().ToString());
+    }
+    ASSERT_EQ(before, after) << n;
+    mem->Unref();
+  }
+}
+
+// 冻结的同时读者照常查找，任何时刻都能查到所有已写入的 key
+TEST_F(MemTableTest, ConcurrentReadsDuringFreeze) {
+  MemTable* mem = NewMemTable();
+  const int kNum = 20000;
+  for (int i = 0; i < kNum; i++) {
+    mem->Add(i + 1, kTypeValue, Key(i), "v" + std::to_string(i));
+  }
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&, t] {
+      Random rnd(t + 1);
+      std::string value;
+      while (!done.load(std::memory_order_acquire)) {
+        const int i = rnd.Uniform(kNum);
+        Status s;
+        ASSERT_TRUE(
+            mem->Get(LookupKey(Key(i), kMaxSequenceNumber), &value, &s));
+        ASSERT_EQ("v" + std::to_string(i), value);
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  mem->MarkImmutable();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  done.store(true, std::memory_order_release);
+  for (std::thread& t : readers) {
+    t.join();
+  }
+  mem->Unref();
+}
+
+// 区间删除一边写入，读者一边发现结果过期、重新切分并发布，读者不加锁，
+// 已经写入的区间删除对之后的读一定可见
+TEST_F(MemTableTest, ConcurrentReadsDuringRangeDeletion) {
+  MemTable* mem = NewMemTable();
+  const int kNum = 500;
+  for (int i = 0; i < kNum; i++) {
+    mem->Add(i + 1, kTypeValue, Key(i), "v");
+  }
+  std::atomic<int> deleted_upto(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 2; t++) {
+    readers.emplace_back([&, t] {
+      Random rnd(t + 1);
+      std::string value;
+      int upto;
+      while ((upto = deleted_upto.load(std::memory_order_acquire)) < kNum) {
+        if (upto == 0) {
+          continue;
+        }
+        const int i = rnd.Uniform(upto);
+        Status s;
+        ASSERT_TRUE(
+            mem->Get(LookupKey(Key(i), kMaxSequenceNumber), &value, &s));
+        ASSERT_TRUE(s.IsNotFound()) << Key(i);
+        ASSERT_NE(nullptr, mem->GetRangeTombstones());
+      }
+    });
+  }
+  for (int i = 0; i < kNum; i++) {
+    mem->DeleteRange(kNum + i + 1, Key(i), Key(i + 1));
+    deleted_upto.store(i + 1, std::memory_order_release);
+  }
+  for (std::thread& t : readers) {
+    t.join();
+  }
+  ASSERT_EQ(static_cast<size_t>(kNum),
+            mem->GetRangeTombstones()->num_unfragmented_tombstones());
+  mem->Unref();
+}
+
+}  // namespace leveldb
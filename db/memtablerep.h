@@ -0,0 +1,106 @@
+#ifndef STORAGE_LEVELDB_DB_MEMTABLEREP_H_
+#define STORAGE_LEVELDB_DB_MEMTABLEREP_H_
+
+#include <vector>
+
+#include "db/dbformat.h"
+#include "leveldb/memtablerep.h"
+#include "util/coding.h"
+
+namespace leveldb {
+
+// 解析 arena 中带 varint32 长度前缀的 Slice
+inline Slice GetLengthPrefixedSlice(const char* data) {
+  uint32_t len;
+  const char* p = data;
+  p = GetVarint32Ptr(p, p + 5, &len);  // +5: 这里不检查越界
+  return Slice(p, len);
+}
+
+// 比较 memtable 中的 entry，entry 以带长度前缀的 internal key 开头
+struct MemTableKeyComparator {
+  const InternalKeyComparator comparator;
+  explicit MemTableKeyComparator(const InternalKeyComparator& c)
+      : comparator(c) {}
+  int operator()(const char* a, const char* b) const {
+    return comparator.Compare(GetLengthPrefixedSlice(a),
+                              GetLengthPrefixedSlice(b));
+  }
+};
+
+// memtable 的底层有序存储，保存的是 MemTable::Add 编码好的 entry 指针
+//
+// 线程安全: Insert 需要外部同步（同一时刻只有一个写者），
+// 读操作可以和 Insert 并发执行，不需要加锁
+// entry 插入后不会被删除，直到整个 rep 被销毁
+class MemTableRep {
+ public:
+  class Iterator {
+   public:
+    virtual ~Iterator() = default;
+
+    virtual bool Valid() const = 0;
+
+    // 返回当前 entry，要求: Valid()
+    virtual const char* key() const = 0;
+
+    virtual void Next() = 0;
+
+    virtual void Prev() = 0;
+
+    // 定位到第一个 >= target 的 entry
+    // internal_key 是 target 的 internal key，memtable_key 是它带长度前缀的编码
+    virtual void Seek(const Slice& internal_key, const char* memtable_key) = 0;
+
+    virtual void SeekToFirst() = 0;
+
+    virtual void SeekToLast() = 0;
+  };
+
+  MemTableRep() = default;
+
+  MemTableRep(const MemTableRep&) = delete;
+  MemTableRep& operator=(const MemTableRep&) = delete;
+
+  virtual ~MemTableRep() = default;
+
+  // 插入 entry，要求: rep 中没有与之相等的 entry
+  virtual void Insert(const char* entry) = 0;
+
+  // rep 中有与 entry 相等的 entry 时返回 true
+  virtual bool Contains(const char* entry) const = 0;
+
+  // 返回第一个 >= k 的 entry，没有时返回 nullptr
+  // 返回的 entry 可能属于别的 user key，由调用者检查
+  // 只保证 k.user_key() 的 entry 存在时一定能找到，不保证跨 user key 的全序
+  virtual const char* FindGreaterOrEqual(const LookupKey& k) const = 0;
+
+  // memtable 不再接受写入时调用，之后只有读操作
+  // rep 可以借此把数据整理成更适合读的形式
+  virtual void MarkReadOnly() {}
+
+  // 按顺序取出最多 n 个大致均匀分布的 entry，flush 时用来切分 key 空间
+  // 不支持取样的 rep 返回空，此时不切分
+  virtual void SampleSplitKeys(size_t n,
+                               std::vector<const char*>* entries) const {
+    entries->clear();
+  }
+
+  // 估算 [start, end) 范围内的 entry 个数，start 和 end 是带长度前缀的
+  // internal key；不需要精确，可以和 Insert 并发调用，不支持估算的 rep 返回 0
+  virtual uint64_t ApproximateNumEntries(const char* start,
+                                         const char* end) const {
+    return 0;
+  }
+
+  // 返回全序遍历的迭代器，调用者负责删除
+  virtual Iterator* GetIterator() = 0;
+
+  // 返回只需要遍历 Seek 的 target 所在前缀的迭代器，调用者负责删除
+  // 没有前缀索引的 rep 直接返回全序迭代器
+  virtual Iterator* GetDynamicPrefixIterator() { return GetIterator(); }
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_MEMTABLEREP_H_
@@ -0,0 +1,129 @@
+#include "db/range_tombstone.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace leveldb {
+
+FragmentedRangeTombstoneList::FragmentedRangeTombstoneList(
+    Iterator* iter, const Comparator* ucmp)
+    : ucmp_(ucmp), num_unfragmented_(0) {
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    if (!ParseInternalKey(iter->key(), &ikey) ||
+        ikey.type != kTypeRangeDeletion) {
+      continue;
+    }
+    num_unfragmented_++;
+    // 空区间不删除任何东西
+    if (ucmp_->Compare(ikey.user_key, iter->value()) >= 0) {
+      continue;
+    }
+    tombstones_.emplace_back(ikey.user_key, iter->value(), ikey.sequence);
+  }
+  BuildFragments();
+}
+
+FragmentedRangeTombstoneList::FragmentedRangeTombstoneList(
+    const std::vector<std::shared_ptr<const FragmentedRangeTombstoneList>>&
+        lists,
+    const Comparator* ucmp)
+    : ucmp_(ucmp), num_unfragmented_(0) {
+  for (const auto& list : lists) {
+    num_unfragmented_ += list->num_unfragmented_;
+    tombstones_.insert(tombstones_.end(), list->tombstones_.begin(),
+                       list->tombstones_.end());
+  }
+  BuildFragments();
+}
+
+void FragmentedRangeTombstoneList::BuildFragments() {
+  if (tombstones_.empty()) {
+    return;
+  }
+  const Comparator* ucmp = ucmp_;
+  std::stable_sort(tombstones_.begin(), tombstones_.end(),
+                   [ucmp](const RangeTombstone& a, const RangeTombstone& b) {
+                     int r = ucmp->Compare(a.start_key, b.start_key);
+                     return r < 0 || (r == 0 && a.seq > b.seq);
+                   });
+
+  // 所有区间的端点，排序去重后相邻的两个端点构成一个候选片段
+  std::vector<Slice> bounds;
+  bounds.reserve(tombstones_.size() * 2);
+  for (const RangeTombstone& t : tombstones_) {
+    bounds.push_back(t.start_key);
+    bounds.push_back(t.end_key);
+  }
+  std::sort(bounds.begin(), bounds.end(), [ucmp](const Slice& a, const Slice& b) {
+    return ucmp->Compare(a, b) < 0;
+  });
+  bounds.erase(std::unique(bounds.begin(), bounds.end(),
+                           [ucmp](const Slice& a, const Slice& b) {
+                             return ucmp->Compare(a, b) == 0;
+                           }),
+               bounds.end());
+
+  // 扫描线: active 中是覆盖当前片段的 tombstone
+  std::vector<const RangeTombstone*> active;
+  std::vector<SequenceNumber> fragment_seqs;
+  size_t next = 0;
+  for (size_t i = 0; i + 1 < bounds.size(); i++) {
+    const Slice& lo = bounds[i];
+    const Slice& hi = bounds[i + 1];
+    while (next < tombstones_.size() &&
+           ucmp_->Compare(tombstones_[next].start_key, lo) <= 0) {
+      active.push_back(&tombstones_[next]);
+      next++;
+    }
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [ucmp, &lo](const RangeTombstone* t) {
+                                  return ucmp->Compare(t->end_key, lo) <= 0;
+                                }),
+                 active.end());
+    if (active.empty()) {
+      continue;
+    }
+
+    fragment_seqs.clear();
+    for (const RangeTombstone* t : active) {
+      fragment_seqs.push_back(t->seq);
+    }
+    std::sort(fragment_seqs.begin(), fragment_seqs.end(),
+              std::greater<SequenceNumber>());
+    fragment_seqs.erase(std::unique(fragment_seqs.begin(), fragment_seqs.end()),
+                        fragment_seqs.end());
+
+    Fragment f;
+    f.start_key = lo.ToString();
+    f.end_key = hi.ToString();
+    f.seq_start = seqs_.size();
+    seqs_.insert(seqs_.end(), fragment_seqs.begin(), fragment_seqs.end());
+    f.seq_end = seqs_.size();
+    fragments_.push_back(std::move(f));
+  }
+}
+
+SequenceNumber FragmentedRangeTombstoneList::MaxCoveringTombstoneSeqnum(
+    const Slice& user_key, SequenceNumber read_seq) const {
+  // 找到最后一个 start_key <= user_key 的片段
+  auto it = std::upper_bound(fragments_.begin(), fragments_.end(), user_key,
+                             [this](const Slice& k, const Fragment& f) {
+                               return ucmp_->Compare(k, f.start_key) < 0;
+                             });
+  if (it == fragments_.begin()) {
+    return 0;
+  }
+  --it;
+  if (ucmp_->Compare(user_key, it->end_key) >= 0) {
+    return 0;
+  }
+  // seqs 降序，找到第一个 <= read_seq 的
+  auto seq_begin = seqs_.begin() + it->seq_start;
+  auto seq_end = seqs_.begin() + it->seq_end;
+  auto seq_it = std::lower_bound(seq_begin, seq_end, read_seq,
+                                 std::greater<SequenceNumber>());
+  return seq_it == seq_end ? 0 : *seq_it;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,80 @@
+#ifndef STORAGE_LEVELDB_DB_RANGE_TOMBSTONE_H_
+#define STORAGE_LEVELDB_DB_RANGE_TOMBSTONE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "leveldb/iterator.h"
+
+namespace leveldb {
+
+// 一条区间删除: 删除 [start_key, end_key) 中 sequence < seq 的所有 entry
+struct RangeTombstone {
+  RangeTombstone() : seq(0) {}
+  RangeTombstone(const Slice& s, const Slice& e, SequenceNumber sq)
+      : start_key(s.ToString()), end_key(e.ToString()), seq(sq) {}
+
+  std::string start_key;
+  std::string end_key;
+  SequenceNumber seq;
+};
+
+// 把互相重叠的区间删除切成互不重叠的片段(fragment)
+// 每个片段记录所有覆盖它的 tombstone 的 sequence（降序），
+// 点查时二分找到片段，再在片段内二分找到快照可见的最大 sequence
+//
+// 构造完成后不可修改，可以被多个线程同时读
+class FragmentedRangeTombstoneList {
+ public:
+  // iter 遍历的是 kTypeRangeDeletion 类型的 entry:
+  //   key() 为 internal key(start_key)，value() 为 end_key
+  // 调用者保留 iter 的所有权
+  FragmentedRangeTombstoneList(Iterator* iter, const Comparator* ucmp);
+
+  // 把多个来源（memtable、sstable）的区间删除合在一起重新切分
+  FragmentedRangeTombstoneList(
+      const std::vector<std::shared_ptr<const FragmentedRangeTombstoneList>>&
+          lists,
+      const Comparator* ucmp);
+
+  FragmentedRangeTombstoneList(const FragmentedRangeTombstoneList&) = delete;
+  FragmentedRangeTombstoneList& operator=(const FragmentedRangeTombstoneList&) =
+      delete;
+
+  bool empty() const { return fragments_.empty(); }
+
+  // 构造时读到的未切分的 tombstone 个数
+  size_t num_unfragmented_tombstones() const { return num_unfragmented_; }
+
+  // 返回覆盖 user_key 且 sequence <= read_seq 的 tombstone 中最大的 sequence
+  // 没有则返回 0
+  // sequence 为 s 的 entry 在 read_seq 快照下被删除 当且仅当 返回值 > s
+  SequenceNumber MaxCoveringTombstoneSeqnum(const Slice& user_key,
+                                            SequenceNumber read_seq) const;
+
+  // 按 start_key 顺序返回所有未切分的 tombstone，flush 时使用
+  const std::vector<RangeTombstone>& tombstones() const { return tombstones_; }
+
+ private:
+  struct Fragment {
+    std::string start_key;
+    std::string end_key;
+    // [seq_start, seq_end) 是 seqs_ 中的下标
+    size_t seq_start;
+    size_t seq_end;
+  };
+
+  void BuildFragments();
+
+  const Comparator* const ucmp_;
+  size_t num_unfragmented_;
+  std::vector<RangeTombstone> tombstones_;
+  std::vector<Fragment> fragments_;  // 按 start_key 升序且互不重叠
+  std::vector<SequenceNumber> seqs_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_RANGE_TOMBSTONE_H_
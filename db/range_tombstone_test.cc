@@ -0,0 +1,118 @@
+#include "db/range_tombstone.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/memtable.h"
+#include "gtest/gtest.h"
+#include "leveldb/comparator.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+namespace {
+
+std::string Key(int i) {
+  char buf[16];
+  std::snprintf(buf, sizeof(buf), "k%03d", i);
+  return buf;
+}
+
+// 逐条检查 tombstones，得出 MaxCoveringTombstoneSeqnum 应有的结果
+SequenceNumber ModelMaxCovering(const std::vector<RangeTombstone>& tombstones,
+                                const std::string& key,
+                                SequenceNumber read_seq) {
+  SequenceNumber result = 0;
+  for (const RangeTombstone& t : tombstones) {
+    if (t.seq <= read_seq && t.start_key <= key && key < t.end_key) {
+      result = std::max(result, t.seq);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+class RangeTombstoneTest : public testing::Test {
+ public:
+  RangeTombstoneTest() : icmp_(BytewiseComparator()) {}
+
+  // 把 tombstones 写入一个 memtable，再从它构造切分结果
+  std::shared_ptr<const FragmentedRangeTombstoneList> Build(
+      const std::vector<RangeTombstone>& tombstones) {
+    MemTable* mem = new MemTable(icmp_, Options());
+    mem->Ref();
+    for (const RangeTombstone& t : tombstones) {
+      mem->DeleteRange(t.seq, t.start_key, t.end_key);
+    }
+    std::shared_ptr<const FragmentedRangeTombstoneList> list =
+        mem->GetRangeTombstones();
+    mem->Unref();
+    return list;
+  }
+
+  void Check(const FragmentedRangeTombstoneList& list,
+             const std::vector<RangeTombstone>& tombstones, int num_keys,
+             SequenceNumber max_seq) {
+    for (int k = 0; k <= num_keys; k++) {
+      for (SequenceNumber seq = 0; seq <= max_seq + 1; seq++) {
+        ASSERT_EQ(ModelMaxCovering(tombstones, Key(k), seq),
+                  list.MaxCoveringTombstoneSeqnum(Key(k), seq))
+            << Key(k) << " @" << seq;
+      }
+    }
+  }
+
+  InternalKeyComparator icmp_;
+};
+
+TEST_F(RangeTombstoneTest, OverlappingRanges) {
+  std::vector<RangeTombstone> tombstones = {
+      {Key(10), Key(20), 5}, {Key(15), Key(30), 3}, {Key(12), Key(18), 7},
+      {Key(25), Key(26), 9}, {Key(40), Key(40), 11},  // 空区间
+  };
+  auto list = Build(tombstones);
+  ASSERT_EQ(5u, list->num_unfragmented_tombstones());
+  ASSERT_EQ(4u, list->tombstones().size());
+  Check(*list, tombstones, 50, 12);
+}
+
+TEST_F(RangeTombstoneTest, Randomized) {
+  Random rnd(301);
+  for (int round = 0; round < 50; round++) {
+    std::vector<RangeTombstone> tombstones;
+    const int n = 1 + rnd.Uniform(30);
+    for (int i = 0; i < n; i++) {
+      int a = rnd.Uniform(60), b = rnd.Uniform(60);
+      if (a > b) std::swap(a, b);
+      tombstones.emplace_back(Key(a), Key(b), 1 + rnd.Uniform(40));
+    }
+    auto list = Build(tombstones);
+    Check(*list, tombstones, 60, 41);
+  }
+}
+
+// 多个来源的切分结果合并后与一次性切分的结果相同
+TEST_F(RangeTombstoneTest, MergeLists) {
+  Random rnd(17);
+  std::vector<RangeTombstone> all;
+  std::vector<std::shared_ptr<const FragmentedRangeTombstoneList>> lists;
+  for (int l = 0; l < 4; l++) {
+    std::vector<RangeTombstone> part;
+    for (int i = 0; i < 8; i++) {
+      int a = rnd.Uniform(60), b = rnd.Uniform(60);
+      if (a > b) std::swap(a, b);
+      part.emplace_back(Key(a), Key(b), 1 + l * 10 + i);
+    }
+    all.insert(all.end(), part.begin(), part.end());
+    lists.push_back(Build(part));
+  }
+  FragmentedRangeTombstoneList merged(lists, BytewiseComparator());
+  ASSERT_EQ(all.size(), merged.num_unfragmented_tombstones());
+  Check(merged, all, 60, 41);
+}
+
+}  // namespace leveldb
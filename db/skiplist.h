@@ -1,19 +1,73 @@
 #ifndef STORAGE_LEVELDB_DB_SKIPLIST_H_
 #define STORAGE_LEVELDB_DB_SKIPLIST_H_
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
+#include <new>
+#include <vector>
 
 #include "util/arena.h"
 #include "util/random.h"
 
+// 查找时经过 level > 0 的指针，只需要保证看到的节点已经初始化；之后对节点的
+// 访问都经由这个指针（地址依赖），x86、ARM、POWER 的硬件本身就保证了这种顺序，
+// 不需要 acquire 的屏障（ARM 上 ldar 比普通的 ldr 慢）
+// memory_order_consume 表达的正是这种语义，但编译器都把它当作 acquire，
+// 只能用 relaxed 读取加地址依赖来实现。这超出了 C++ 内存模型的保证，依赖编译器
+// 不破坏地址依赖（不对指针做值推测），所以默认不开启，
+// 定义 LEVELDB_SKIPLIST_DEPENDENT_LOADS 时开启
+// TSan 只认 C++ 内存模型，会把 relaxed 读取之后的访问报告为数据竞争，
+// 在 TSan 下总是使用 acquire
+#if defined(__SANITIZE_THREAD__)
+#define LEVELDB_SKIPLIST_TSAN 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define LEVELDB_SKIPLIST_TSAN 1
+#endif
+#endif
+
+#if defined(LEVELDB_SKIPLIST_DEPENDENT_LOADS) && !defined(LEVELDB_SKIPLIST_TSAN)
+#define LEVELDB_SKIPLIST_RELAXED_SEARCH 1
+#endif
+
 
 
 
 
 namespace leveldb {
 
+// 根据预计的 key 个数选择跳表的最大高度，使最高一层平均只有几个节点
+// 高度不够时上面几层的节点过多，查找退化成长距离的线性扫描；
+// 太高则浪费 head 的指针和每次查找都要经过的空层
+inline int SkipListHeightFor(uint64_t expected_count, int branching) {
+  int height = 1;
+  uint64_t capacity = branching;
+  while (capacity < expected_count && height < 32) {
+    capacity *= branching;
+    height++;
+  }
+  return std::min(std::max(height + 1, 4), 32);
+}
+
+// 线程安全:
+// 写操作（Insert）需要外部同步，同一时刻只能有一个写者
+// 读操作只要求跳表在读的过程中不被销毁，不需要加锁，可以和 Insert 并发执行
+//
+// 与 Insert 并发时读者能得到的保证:
+// (1) 迭代器 Next() 得到的 key 严格递增，Prev() 得到的 key 严格递减
+// (2) Insert 返回之后才开始的查找和 Seek 一定能看到这个 key
+// (3) 从某个节点出发沿 level 0 遍历，看到的是遍历开始时已经发布的所有
+//     后续节点，再加上遍历期间插入的部分节点，不会漏掉已经发布的节点
+// 这些保证依赖于 Node::SetNext 的 release 和 Node::Next 的 acquire:
+// 新节点的 key 和 next_ 都在 prev->SetNext() 之前写好，读者经由 Next()
+// 拿到新节点时一定能看到完整的内容；其余的 relaxed 读写都不会发布新节点
+// 开启 LEVELDB_SKIPLIST_DEPENDENT_LOADS 时，查找经过的 level > 0 的指针改由
+// 地址依赖保证顺序（Node::SearchNext），level 0 仍然使用 acquire
+// debug 模式下读操作会检查 (1)，修改内存序之后可以在 TSan 下验证
+// skiplist_dependent_loads_test.cc 在开启这个宏时运行同样的测试
 template <typename Key, class Comparator>
 class SkipList {
  private:
@@ -21,7 +75,16 @@ class SkipList {
 
  public:
     
-  explicit SkipList(Comparator cmp, Arena* arena);
+  // 节点高度每增加一层的概率为 1/branching，最高 max_height 层，
+  // 大约可以容纳 branching^max_height 个 key 而不退化
+  // 要求: 1 <= max_height <= kMaxHeightLimit，branching >= 2
+  enum { kMaxHeightLimit = 32 };
+  static const int kDefaultMaxHeight = 12;
+  static const int kDefaultBranching = 4;
+
+  explicit SkipList(Comparator cmp, Arena* arena,
+                    int max_height = kDefaultMaxHeight,
+                    int branching = kDefaultBranching);
   
   SkipList(const SkipList&) = delete;
   SkipList& operator=(const SkipList&) = delete;
@@ -33,6 +96,19 @@ class SkipList {
   // 如果list包含key返回true
   bool Contains(const Key& key) const;
 
+  // 按顺序取出最多 n 个大致均匀分布的 key，用作切分跳表的分界点
+  // 高层的节点是随机选出的，直接在节点数不少于 n 的最高一层上取样，
+  // 不需要遍历整个跳表
+  void SampleKeys(size_t n, std::vector<Key>* keys) const;
+
+  // 返回跳表中 key 的个数，不需要加锁，可以和 Insert 并发调用
+  uint64_t ApproximateCount() const;
+
+  // 估算 [begin, end) 范围内 key 的个数
+  // 只沿着高层的节点查找两次，每下降一层按相邻两层的节点数之比放大计数，
+  // 代价和一次查找相当，不需要加锁，可以和 Insert 并发调用
+  uint64_t ApproximateRangeCount(const Key& begin, const Key& end) const;
+
   // 遍历调表的迭代器
   class Iterator {
    public:
@@ -60,7 +136,7 @@ class SkipList {
     // Intentionally copyable
   };
  private:
-  enum { kMaxHeight = 12 };
+  static const uint64_t kMinEstimateNodes = 64;
 
   inline int GetMaxHight() const {
     return max_height_.load(std::memory_order_relaxed);
@@ -79,15 +155,29 @@ class SkipList {
 
   Node* FindLast() const;
 
+  // 估算小于 key 的 key 的个数
+  double EstimateCountLessThan(const Key& key) const;
+
   // 构造后不可更改
   Comparator const compare_;
   Arena* const arena_;  // 用于node内存的分配
+  const int height_limit_;
+  const int branching_;
+  // Random::Next() 小于这个值的概率为 1/branching_，省掉 RandomHeight 中的取模
+  const uint32_t branching_threshold_;
   
   Node* const head_;
 
   // 只能被insert()改变
   std::atomic<int> max_height_;  // 调表的高度
 
+  // level_counts_[i] 为高度大于 i 的节点个数，只能被 Insert() 改变
+  // 理论上相邻两层之比为 branching_，但最高的几层节点很少，实际比例偏差很大，
+  // 估算时使用实际的比例
+  // 长度为 height_limit_，从 arena 中分配，哈希 rep 中每个桶都是一个跳表，
+  // 不能按 kMaxHeightLimit 占用空间
+  std::atomic<uint64_t>* const level_counts_;
+
   Random rnd_;
 };
 
@@ -109,6 +199,17 @@ struct SkipList<Key, Comparator>::Node {
     next_[n].store(x, std::memory_order_release); // 用来修饰一个写操作，表示在本线程中，所有之前的针对该变量的内存操作完成后才能执行本条原子操作。
   }
 
+  // 查找时读取 level > 0 的指针，见文件开头的说明
+  // 返回的节点只能经由这个指针访问，不能用来同步其他数据
+  Node* SearchNext(int n) {
+    assert(n > 0);
+#if defined(LEVELDB_SKIPLIST_RELAXED_SEARCH)
+    return next_[n].load(std::memory_order_relaxed);
+#else
+    return next_[n].load(std::memory_order_acquire);
+#endif
+  }
+
   // No-barrier variants that can be safely used in a few locations.
   Node* NoBarrier_Next(int n) {
     assert(n >= 0);
@@ -127,7 +228,7 @@ struct SkipList<Key, Comparator>::Node {
 template<typename Key, class Comparator>
 typename SkipList<Key,Comparator>::Node* SkipList<Key, Comparator>::NewNode(
     const Key& key, int height) {
-  char* const node_memory = arena_.AllocateAligned(
+  char* const node_memory = arena_->AllocateAligned(
       sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1));
   return new (node_memory) Node(key);
 
@@ -151,23 +252,25 @@ inline const Key& SkipList<Key, Comparator>::Iterator::key() const {
 }
 
 template <typename Key, class Comparator>
-inline void  SkipList<Key, Comparator>::Iterator::Next() {
+inline void SkipList<Key, Comparator>::Iterator::Next() {
   assert(Valid());
-  return node_->Next(0);
+  Node* next = node_->Next(0);
+  assert(next == nullptr || list_->compare_(node_->key, next->key) < 0);
+  node_ = next;
 }
 
 template <typename Key, class Comparator>
 inline void SkipList<Key, Comparator>::Iterator::Prev() {
   assert(Valid());
-  node_ = FindLessThan(node_->key);
-  if(node_ == list_->head_) {
-    node_ = nullptr;
-  }
+  Node* prev = list_->FindLessThan(node_->key);
+  assert(prev == list_->head_ || list_->compare_(prev->key, node_->key) < 0);
+  node_ = (prev == list_->head_) ? nullptr : prev;
 }
 
 template <typename Key, class Comparator>
 inline void SkipList<Key, Comparator>::Iterator::Seek(const Key& target) {
-  node_ = FindGreaterOrEqual(key, nullptr);
+  node_ = list_->FindGreaterOrEqual(target, nullptr);
+  assert(node_ == nullptr || list_->compare_(node_->key, target) >= 0);
 }
 
 template <typename Key, class Comparator>
@@ -177,7 +280,7 @@ inline void SkipList<Key, Comparator>::Iterator::SeekToFirst() {
 
 template <typename Key, class Comparator>
 inline void SkipList<Key, Comparator>::Iterator::SeekToLast() {
-  node_ = FindLast();
+  node_ = list_->FindLast();
   if(node_ == list_->head_) {
     node_ = nullptr;
   }
@@ -185,13 +288,12 @@ inline void SkipList<Key, Comparator>::Iterator::SeekToLast() {
 
 template <typename Key, class Comparator>
 int SkipList<Key, Comparator>::RandomHeight() {
-  static const unsigned int kBranching = 4;
   int height = 1;
-  while(height < kMaxHeight && rnd_.OneIn(kBranching)) {
+  while(height < height_limit_ && rnd_.Next() < branching_threshold_) {
     height++;
   }
   assert(height > 0);
-  assert(height <= kMaxHeight);
+  assert(height <= height_limit_);
   return height;
 }
 
@@ -207,7 +309,7 @@ SkipList<Key, Comparator>::FindGreaterOrEqual(const Key& key,
   Node* x = head_;
   int level = GetMaxHight() - 1;
   while(true) {
-    Node* next = x->Next(level);
+    Node* next = (level > 0) ? x->SearchNext(level) : x->Next(0);
     if(KeyIsAfterNode(key, next)) {
       x = next;
     } else {
@@ -228,7 +330,7 @@ SkipList<Key, Comparator>::FindLessThan(const Key& key) const {
   int level = GetMaxHight()-1;
   while(true) {
     assert(x == head_ || compare_(x->key, key) < 0);
-    Node* next = x->Next(level);
+    Node* next = (level > 0) ? x->SearchNext(level) : x->Next(0);
     if(next == nullptr || compare_(next->key, key) >= 0) {
       if(level == 0) {
         return x;
@@ -247,7 +349,7 @@ typename SkipList<Key, Comparator>::Node* SkipList<Key, Comparator>::FindLast()
   Node* x = head_;
   int level = GetMaxHight() - 1;
   while(true) {
-    Node* next = x->Next(level);
+    Node* next = (level > 0) ? x->SearchNext(level) : x->Next(0);
     if(next == nullptr) {
       if(level == 0) {
         return x;
@@ -262,20 +364,79 @@ typename SkipList<Key, Comparator>::Node* SkipList<Key, Comparator>::FindLast()
 }
 
 template <typename Key, class Comparator>
-SkipList<Key, Comparator>::SkipList(Comparator cmp, Arena* arena)
+double SkipList<Key, Comparator>::EstimateCountLessThan(const Key& key) const {
+  // 最高的几层节点太少，从这些层开始放大误差很大（只有一两个节点时
+  // 估计值可能差好几倍），所以从节点数不少于 kMinEstimateNodes 的最高一层
+  // 开始数，这一层最多走 kMinEstimateNodes * branching_ 个节点左右
+  int level = GetMaxHight() - 1;
+  while (level > 0 && level_counts_[level].load(std::memory_order_relaxed) <
+                          kMinEstimateNodes) {
+    level--;
+  }
+
+  // count 为第 level 层上小于 key 的节点个数的估计值，
+  // 下降一层时按两层的节点数之比放大，再加上这一层多走的节点
+  double count = 0;
+  Node* x = head_;
+  while (true) {
+    Node* next = (level > 0) ? x->SearchNext(level) : x->Next(0);
+    if (next == nullptr || compare_(next->key, key) >= 0) {
+      if (level == 0) {
+        return count;
+      }
+      const uint64_t upper = level_counts_[level].load(std::memory_order_relaxed);
+      const uint64_t lower =
+          level_counts_[level - 1].load(std::memory_order_relaxed);
+      // 与 Insert 并发时计数可能还没更新
+      count *= (upper != 0 && lower >= upper)
+                   ? static_cast<double>(lower) / upper
+                   : branching_;
+      level--;
+    } else {
+      x = next;
+      count++;
+    }
+  }
+}
+
+template <typename Key, class Comparator>
+uint64_t SkipList<Key, Comparator>::ApproximateCount() const {
+  return level_counts_[0].load(std::memory_order_relaxed);
+}
+
+template <typename Key, class Comparator>
+uint64_t SkipList<Key, Comparator>::ApproximateRangeCount(
+    const Key& begin, const Key& end) const {
+  // 两次估算各自有误差，相减可能为负
+  const double count = EstimateCountLessThan(end) - EstimateCountLessThan(begin);
+  return count > 0 ? static_cast<uint64_t>(count + 0.5) : 0;
+}
+
+template <typename Key, class Comparator>
+SkipList<Key, Comparator>::SkipList(Comparator cmp, Arena* arena,
+                                    int max_height, int branching)
     : compare_(cmp),
       arena_(arena),
-      head_(NewNode(0 /* any key will do */, kMaxHeight)),
+      height_limit_(max_height),
+      branching_(branching),
+      branching_threshold_(static_cast<uint32_t>((uint64_t{1} << 31) /
+                                                 branching)),
+      head_(NewNode(0 /* any key will do */, max_height)),
       max_height_(1),
+      level_counts_(reinterpret_cast<std::atomic<uint64_t>*>(
+          arena->AllocateAligned(sizeof(std::atomic<uint64_t>) * max_height))),
       rnd_(0xdeadbeef) /* 已分配但还未初始化的内存中用该数字来填充 */ {
-        for(int i = 0; i < kMaxHeight; i++) {
+        assert(max_height >= 1 && max_height <= kMaxHeightLimit);
+        assert(branching >= 2);
+        for(int i = 0; i < height_limit_; i++) {
           head_->SetNext(i, nullptr);
+          new (&level_counts_[i]) std::atomic<uint64_t>(0);
         }
 }
 
 template <typename Key, class Comparator>
 void SkipList<Key, Comparator>::Insert(const Key& key) {
-  Node* prev[kMaxHeight];
+  Node* prev[kMaxHeightLimit];
   Node* x = FindGreaterOrEqual(key, prev);
 
   assert(x == nullptr || !Equal(key, x->key)); // 在插入的时候要么找不到节点， 要么找到的节点key与插入的不同
@@ -295,6 +456,9 @@ void SkipList<Key, Comparator>::Insert(const Key& key) {
   for(int i = 0; i < height; i++) {
     x->NoBarrier_SetNext(i, prev[i]->NoBarrier_Next(i)); // 插入x时我们不会访问x-》next所以不需要屏障
     prev[i]->SetNext(i, x); // 设置 x的pre的next时，在多线程情况下可能存在使用x的pre的next 所以我们设置时使用SetNext，保证设置时，前面针对pre指针的操作都执行完毕
+    // 只有一个写者，不需要 fetch_add
+    level_counts_[i].store(level_counts_[i].load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
   }
 }
 template <typename Key, class Comparator>
@@ -303,7 +467,32 @@ bool SkipList<Key, Comparator>::Contains(const Key& key) const {
   if (x != nullptr && Equal(key, x->key)) {
     return true;
   } else {
-    return flase;
+    return false;
+  }
+}
+
+template <typename Key, class Comparator>
+void SkipList<Key, Comparator>::SampleKeys(size_t n,
+                                           std::vector<Key>* keys) const {
+  keys->clear();
+  if (n == 0) {
+    return;
+  }
+  std::vector<Node*> nodes;
+  for (int level = GetMaxHight() - 1; level >= 0; level--) {
+    nodes.clear();
+    for (Node* x = head_->Next(level); x != nullptr; x = x->Next(level)) {
+      nodes.push_back(x);
+    }
+    if (nodes.size() >= n) {
+      break;
+    }
+  }
+  // 节点不够 n 个时全部返回，否则等间隔地取 n 个
+  const size_t count = nodes.size();
+  for (size_t i = 0; i < std::min(n, count); i++) {
+    const size_t index = (count <= n) ? i : (i + 1) * count / (n + 1);
+    keys->push_back(nodes[index]->key);
   }
 }
 
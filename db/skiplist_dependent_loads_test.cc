@@ -0,0 +1,11 @@
+// 开启 LEVELDB_SKIPLIST_DEPENDENT_LOADS（查找时 level > 0 用 relaxed 读取），
+// 再运行一遍 skiplist_test.cc 中的所有测试，包括并发测试
+// TSan 下这个宏不起作用（总是使用 acquire），这里只能在普通编译下验证
+#define LEVELDB_SKIPLIST_DEPENDENT_LOADS 1
+
+#include "db/skiplist_test.cc"
+
+#if !defined(LEVELDB_SKIPLIST_RELAXED_SEARCH) && \
+    !defined(LEVELDB_SKIPLIST_TSAN)
+#error "LEVELDB_SKIPLIST_DEPENDENT_LOADS did not enable the relaxed search"
+#endif
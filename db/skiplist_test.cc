@@ -0,0 +1,416 @@
+#include "db/skiplist.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/arena.h"
+#include "util/hash.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+typedef uint64_t Key;
+
+struct Comparator {
+  int operator()(const Key& a, const Key& b) const {
+    if (a < b) {
+      return -1;
+    } else if (a > b) {
+      return +1;
+    } else {
+      return 0;
+    }
+  }
+};
+
+typedef SkipList<Key, Comparator> IntSkipList;
+
+// 在 list 和 *keys 中插入 n 个 [0, range) 内随机的不同 key
+static void InsertRandomKeys(IntSkipList* list, std::set<Key>* keys, int n,
+                             uint32_t range, Random* rnd) {
+  while (n > 0) {
+    const Key key = rnd->Uniform(range);
+    if (keys->insert(key).second) {
+      list->Insert(key);
+      n--;
+    }
+  }
+}
+
+TEST(SkipTest, Empty) {
+  Arena arena;
+  Comparator cmp;
+  IntSkipList list(cmp, &arena);
+  ASSERT_TRUE(!list.Contains(10));
+  ASSERT_EQ(0, list.ApproximateCount());
+  ASSERT_EQ(0, list.ApproximateRangeCount(0, 100));
+
+  IntSkipList::Iterator iter(&list);
+  ASSERT_TRUE(!iter.Valid());
+  iter.SeekToFirst();
+  ASSERT_TRUE(!iter.Valid());
+  iter.Seek(100);
+  ASSERT_TRUE(!iter.Valid());
+  iter.SeekToLast();
+  ASSERT_TRUE(!iter.Valid());
+}
+
+TEST(SkipTest, InsertAndLookup) {
+  const int N = 2000;
+  const int R = 5000;
+  Random rnd(1000);
+  std::set<Key> keys;
+  Arena arena;
+  Comparator cmp;
+  IntSkipList list(cmp, &arena);
+  InsertRandomKeys(&list, &keys, N, R, &rnd);
+
+  for (int i = 0; i < R; i++) {
+    ASSERT_EQ(keys.count(i) == 1, list.Contains(i)) << i;
+  }
+
+  // Seek 之后向前、向后遍历
+  for (int i = 0; i < R; i += 7) {
+    IntSkipList::Iterator iter(&list);
+    iter.Seek(i);
+    std::set<Key>::iterator model = keys.lower_bound(i);
+    for (int j = 0; j < 3; j++) {
+      if (model == keys.end()) {
+        ASSERT_TRUE(!iter.Valid());
+        break;
+      }
+      ASSERT_TRUE(iter.Valid());
+      ASSERT_EQ(*model, iter.key());
+      ++model;
+      iter.Next();
+    }
+  }
+
+  IntSkipList::Iterator iter(&list);
+  iter.SeekToLast();
+  for (std::set<Key>::reverse_iterator model = keys.rbegin();
+       model != keys.rend(); ++model) {
+    ASSERT_TRUE(iter.Valid());
+    ASSERT_EQ(*model, iter.key());
+    iter.Prev();
+  }
+  ASSERT_TRUE(!iter.Valid());
+}
+
+// 总数是精确的，区间计数的误差与 key 总数成比例，与区间大小无关
+TEST(SkipTest, ApproximateCount) {
+  const int N = 100000;
+  const uint32_t R = 10000000;
+  Random rnd(301);
+  std::set<Key> keys;
+  Arena arena;
+  Comparator cmp;
+  IntSkipList list(cmp, &arena);
+  for (int i = 0; i < 10; i++) {
+    InsertRandomKeys(&list, &keys, N / 10, R, &rnd);
+    ASSERT_EQ(keys.size(), list.ApproximateCount());
+  }
+
+  const double total = list.ApproximateRangeCount(0, R);
+  ASSERT_NEAR(N, total, N * 0.05);
+
+  for (int i = 0; i < 200; i++) {
+    Key begin = rnd.Uniform(R);
+    Key end = rnd.Uniform(R);
+    if (begin > end) {
+      std::swap(begin, end);
+    }
+    const double exact = std::distance(keys.lower_bound(begin),
+                                       keys.lower_bound(end));
+    const double estimate = list.ApproximateRangeCount(begin, end);
+    // 误差来自起始层上相邻节点之间的 key 个数，与区间大小无关，
+    // 总是在 key 总数的一成左右以内
+    ASSERT_NEAR(exact, estimate, 0.12 * N)
+        << "[" << begin << ", " << end << ")";
+  }
+
+  // 空区间和颠倒的区间
+  ASSERT_EQ(0, list.ApproximateRangeCount(100, 100));
+  ASSERT_EQ(0, list.ApproximateRangeCount(R, 0));
+}
+
+// 各种高度和分支因子下结果都正确，包括高度为 1（退化成链表）的情况
+TEST(SkipTest, HeightAndBranching) {
+  const int kShapes[][2] = {{1, 2}, {2, 2}, {4, 16}, {12, 4}, {32, 2}, {32, 8}};
+  for (const auto& shape : kShapes) {
+    Random rnd(301);
+    std::set<Key> keys;
+    Arena arena;
+    Comparator cmp;
+    IntSkipList list(cmp, &arena, shape[0], shape[1]);
+    InsertRandomKeys(&list, &keys, 3000, 100000, &rnd);
+    ASSERT_EQ(keys.size(), list.ApproximateCount());
+
+    IntSkipList::Iterator iter(&list);
+    iter.SeekToFirst();
+    for (Key key : keys) {
+      ASSERT_TRUE(iter.Valid());
+      ASSERT_EQ(key, iter.key());
+      iter.Next();
+    }
+    ASSERT_TRUE(!iter.Valid());
+    for (int i = 0; i < 1000; i++) {
+      const Key key = rnd.Uniform(100000);
+      ASSERT_EQ(keys.count(key) == 1, list.Contains(key))
+          << "height " << shape[0] << " branching " << shape[1];
+    }
+  }
+}
+
+TEST(SkipTest, HeightFor) {
+  // 小的跳表也保留几层
+  ASSERT_EQ(4, SkipListHeightFor(0, 4));
+  ASSERT_EQ(4, SkipListHeightFor(10, 4));
+  // 最高一层平均只有几个节点: 没有达到上限时 branching^(height-1) >= n
+  for (int branching : {2, 4, 8}) {
+    int last = 0;
+    for (uint64_t n = 1; n < (uint64_t{1} << 40); n *= 3) {
+      const int height = SkipListHeightFor(n, branching);
+      ASSERT_GE(height, last);
+      last = height;
+      double capacity = 1;
+      for (int i = 1; i < height; i++) {
+        capacity *= branching;
+      }
+      if (height < IntSkipList::kMaxHeightLimit) {
+        ASSERT_GE(capacity, n) << n << " " << branching;
+      }
+    }
+  }
+  // 5000 万个 entry 超过了默认的 12 层，但不超过上限
+  const int default_height = IntSkipList::kDefaultMaxHeight;
+  ASSERT_GT(SkipListHeightFor(50000000, 4), default_height);
+  ASSERT_EQ(IntSkipList::kMaxHeightLimit,
+            SkipListHeightFor(~uint64_t{0}, 2));
+}
+
+// 并发测试: 一个写者、多个读者，读者不加锁，检查 skiplist.h 开头列出的保证
+//
+// key 的格式为 <k, gen, hash>，k 取 [0, K) 中的一个，gen 为它被写入的次数，
+// hash 由前两者计算，用来发现读到未初始化的节点
+// 写者每次选一个 k，插入 <k, gen + 1> 之后再把 current_ 中的 gen 加一（release）
+// 读者开始前先记下每个 k 的 gen（acquire），之后遍历时:
+// (1) 看到的 key 严格递增
+// (2) 开始时已经发布的 <k, g>（g <= 记下的 gen）一定能看到，
+//     Contains 也一定能找到
+//
+// soak 时设置环境变量 LEVELDB_SKIPLIST_STRESS_SECONDS 延长运行时间，
+// 并且用 -fsanitize=thread 编译，见 README
+namespace {
+
+static const uint32_t K = 4;
+
+class ConcurrentTest {
+ public:
+  ConcurrentTest() : list_(Comparator(), &arena_) {}
+
+  static uint64_t key(Key key) { return (key >> 40); }
+  static uint64_t gen(Key key) { return (key >> 8) & 0xffffffffu; }
+  static uint64_t hash(Key key) { return key & 0xff; }
+
+  static uint64_t HashNumbers(uint64_t k, uint64_t g) {
+    uint64_t data[2] = {k, g};
+    return Hash(reinterpret_cast<char*>(data), sizeof(data), 0);
+  }
+
+  static Key MakeKey(uint64_t k, uint64_t g) {
+    assert(k <= K);  // 允许 K，用作末尾的哨兵
+    assert(g <= 0xffffffffu);
+    return ((k << 40) | (g << 8) | (HashNumbers(k, g) & 0xff));
+  }
+
+  static bool IsValidKey(Key k) {
+    return hash(k) == (HashNumbers(key(k), gen(k)) & 0xff);
+  }
+
+  static Key RandomTarget(Random* rnd) {
+    switch (rnd->Next() % 10) {
+      case 0:
+        return MakeKey(0, 0);
+      case 1:
+        return MakeKey(K, 0);
+      default:
+        return MakeKey(rnd->Next() % K, 0);
+    }
+  }
+
+  // 每个 k 已经发布的 gen
+  struct State {
+    std::atomic<int> generation[K];
+    void Set(int k, int v) {
+      generation[k].store(v, std::memory_order_release);
+    }
+    int Get(int k) { return generation[k].load(std::memory_order_acquire); }
+
+    State() {
+      for (unsigned int k = 0; k < K; k++) {
+        Set(k, 0);
+      }
+    }
+  };
+
+  // 只能在写者线程中调用
+  void WriteStep(Random* rnd) {
+    const uint32_t k = rnd->Next() % K;
+    const int g = current_.Get(k) + 1;
+    list_.Insert(MakeKey(k, g));
+    current_.Set(k, g);
+  }
+
+  void ReadStep(Random* rnd) {
+    State initial_state;
+    for (unsigned int k = 0; k < K; k++) {
+      initial_state.Set(k, current_.Get(k));
+    }
+
+    // 已经发布的 key 一定能找到
+    const uint32_t probe = rnd->Next() % K;
+    const int probe_gen = initial_state.Get(probe);
+    if (probe_gen > 0) {
+      ASSERT_TRUE(list_.Contains(MakeKey(probe, probe_gen)));
+    }
+
+    Key pos = RandomTarget(rnd);
+    IntSkipList::Iterator iter(&list_);
+    iter.Seek(pos);
+    while (true) {
+      Key current;
+      if (!iter.Valid()) {
+        current = MakeKey(K, 0);
+      } else {
+        current = iter.key();
+        ASSERT_TRUE(IsValidKey(current)) << current;
+      }
+      ASSERT_LE(pos, current) << "should not go backwards";
+
+      // [pos, current) 中的 key 在开始时都还没有发布
+      while (pos < current) {
+        ASSERT_LT(key(pos), K) << pos;
+        // gen 0 从来不会插入
+        ASSERT_TRUE((gen(pos) == 0) ||
+                    (gen(pos) > static_cast<Key>(initial_state.Get(key(pos)))))
+            << "key: " << key(pos) << "; gen: " << gen(pos)
+            << "; initgen: " << initial_state.Get(key(pos));
+
+        // 在合法的 key 空间中前进
+        if (key(pos) < key(current)) {
+          pos = MakeKey(key(pos) + 1, 0);
+        } else {
+          pos = MakeKey(key(pos), gen(pos) + 1);
+        }
+      }
+
+      if (!iter.Valid()) {
+        break;
+      }
+
+      if (rnd->Next() % 2) {
+        iter.Next();
+        pos = MakeKey(key(pos), gen(pos) + 1);
+      } else {
+        Key new_target = RandomTarget(rnd);
+        if (new_target > pos) {
+          pos = new_target;
+          iter.Seek(new_target);
+        }
+      }
+    }
+
+    // 估算只读取计数器和高层的指针，与 Insert 并发时不能出错
+    ASSERT_LE(list_.ApproximateRangeCount(MakeKey(0, 0), MakeKey(K, 0)),
+              list_.ApproximateCount() * 2 + 1000);
+    std::vector<Key> samples;
+    list_.SampleKeys(3, &samples);
+    for (size_t i = 1; i < samples.size(); i++) {
+      ASSERT_LT(samples[i - 1], samples[i]);
+    }
+  }
+
+ private:
+  Arena arena_;
+  State current_;
+  IntSkipList list_;
+};
+
+// 运行时间（毫秒）
+int StressMillis() {
+  const char* env = std::getenv("LEVELDB_SKIPLIST_STRESS_SECONDS");
+  if (env != nullptr && std::atoi(env) > 0) {
+    return std::atoi(env) * 1000;
+  }
+  return 300;
+}
+
+}  // namespace
+
+// 没有并发时同样的检查也要成立
+TEST(SkipTest, ConcurrentWithoutThreads) {
+  ConcurrentTest test;
+  Random rnd(301);
+  for (int i = 0; i < 10000; i++) {
+    test.ReadStep(&rnd);
+    test.WriteStep(&rnd);
+  }
+}
+
+static void RunConcurrent(int num_readers) {
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(StressMillis());
+  for (int run = 0; std::chrono::steady_clock::now() < deadline; run++) {
+    ConcurrentTest test;
+    std::atomic<bool> quit(false);
+    std::atomic<int> reads(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < num_readers; i++) {
+      readers.emplace_back([&test, &quit, &reads, run, i] {
+        Random rnd(301 + run * 100 + i);
+        while (!quit.load(std::memory_order_acquire)) {
+          test.ReadStep(&rnd);
+          reads.fetch_add(1, std::memory_order_relaxed);
+          if (testing::Test::HasFatalFailure()) {
+            return;
+          }
+        }
+      });
+    }
+
+    // 写者在当前线程中，每个跳表写入的个数有限，保证读者的遍历不会太长
+    Random rnd(301 + run);
+    for (int i = 0; i < 10000; i++) {
+      test.WriteStep(&rnd);
+      if (i % 100 == 0) {
+        std::this_thread::yield();
+      }
+    }
+    // 至少让每个读者在写完之后再读一次
+    const int target = reads.load(std::memory_order_relaxed) + num_readers;
+    while (reads.load(std::memory_order_relaxed) < target &&
+           !testing::Test::HasFatalFailure()) {
+      std::this_thread::yield();
+    }
+    quit.store(true, std::memory_order_release);
+    for (auto& t : readers) {
+      t.join();
+    }
+    ASSERT_FALSE(testing::Test::HasFailure());
+  }
+}
+
+TEST(SkipTest, Concurrent1) { RunConcurrent(1); }
+TEST(SkipTest, Concurrent4) { RunConcurrent(4); }
+
+}  // namespace leveldb
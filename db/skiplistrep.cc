@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include "db/memtablerep.h"
+#include "db/skiplist.h"
+#include "util/arena.h"
+#include "util/ordered_coding.h"
+
+namespace leveldb {
+
+MemTableRepFactory::~MemTableRepFactory() = default;
+
+namespace {
+
+// 跳表节点中除了 entry 指针，还缓存 user key 的前 8 个字节（大端整数）
+// user key 按字节序比较时（比如保序编码的复合 key），大多数比较只需要比较
+// 节点里的前缀，不用去访问 entry，也省掉了一次 cache miss
+// 其他比较器的前缀都为 0，总是比较完整的 key
+struct PrefixedEntry {
+  PrefixedEntry(const char* e = nullptr, uint64_t p = 0) : entry(e), prefix(p) {}
+
+  const char* entry;
+  uint64_t prefix;
+};
+
+struct PrefixedEntryComparator {
+  const MemTableKeyComparator cmp;
+
+  explicit PrefixedEntryComparator(const MemTableKeyComparator& c) : cmp(c) {}
+
+  int operator()(const PrefixedEntry& a, const PrefixedEntry& b) const {
+    if (a.prefix != b.prefix) {
+      return a.prefix < b.prefix ? -1 : +1;
+    }
+    return cmp(a.entry, b.entry);
+  }
+};
+
+// memtable 变成只读后由跳表冻结得到的紧凑数组，只读
+//
+// entry 按 Eytzinger（BFS 顺序的完全二叉树）布局存放，下标从 1 开始，
+// 节点 k 的孩子是 2k 和 2k+1，0 表示不存在。
+// 查找路径上的前几层集中在数组开头、常驻 cache，后面几层可以提前预取，
+// 比跳表逐个节点跳转的访存少得多；顺序遍历沿中序后继移动，均摊 O(1)
+class FrozenEntryArray {
+ public:
+  // 数组从 arena 分配，n 为 entry 的个数
+  FrozenEntryArray(Arena* arena, size_t n) : n_(n) {
+    // 按 cache line 对齐，使下标为 4 的倍数的节点位于 cache line 开头
+    char* mem = arena->AllocateAligned(sizeof(PrefixedEntry) * (n + 1) +
+                                       kCacheLineSize);
+    uintptr_t addr = reinterpret_cast<uintptr_t>(mem);
+    addr = (addr + kCacheLineSize - 1) & ~(uintptr_t{kCacheLineSize} - 1);
+    nodes_ = reinterpret_cast<PrefixedEntry*>(addr);
+  }
+
+  // sorted 为按顺序排列的全部 entry，按中序遍历填入 nodes_
+  void Build(const std::vector<PrefixedEntry>& sorted) {
+    assert(sorted.size() == n_);
+    size_t rank = 0;
+    Fill(1, sorted, &rank);
+    assert(rank == n_);
+  }
+
+  const char* entry(size_t k) const { return nodes_[k].entry; }
+
+  // 返回第一个 >= target 的节点，没有时返回 0
+  size_t LowerBound(const PrefixedEntry& target,
+                    const PrefixedEntryComparator& cmp) const {
+    size_t k = 1;
+    while (k <= n_) {
+      // 一个 cache line 放 4 个节点，提前预取 3 层之后的 8 个后代
+      if (8 * k + 7 <= n_) {
+        __builtin_prefetch(nodes_ + 8 * k);
+        __builtin_prefetch(nodes_ + 8 * k + 4);
+      }
+      k = 2 * k + (cmp(nodes_[k], target) < 0 ? 1 : 0);
+    }
+    // 最后一次向左走的位置就是答案：去掉末尾连续的 1 和它前面的 0
+    return k >> __builtin_ffsll(static_cast<long long>(~k));
+  }
+
+  size_t First() const { return n_ == 0 ? 0 : Leftmost(1); }
+
+  size_t Last() const { return n_ == 0 ? 0 : Rightmost(1); }
+
+  // 中序后继，k 为最后一个节点时返回 0
+  size_t Next(size_t k) const {
+    if (2 * k + 1 <= n_) {
+      return Leftmost(2 * k + 1);
+    }
+    // 向上走到第一个作为左孩子的祖先，它的父节点就是后继
+    while (k & 1) {
+      k >>= 1;
+    }
+    return k >> 1;
+  }
+
+  // 中序前驱，k 为第一个节点时返回 0
+  size_t Prev(size_t k) const {
+    if (2 * k <= n_) {
+      return Rightmost(2 * k);
+    }
+    while (k != 1 && (k & 1) == 0) {
+      k >>= 1;
+    }
+    return k >> 1;
+  }
+
+ private:
+  enum { kCacheLineSize = 64 };
+
+  size_t Leftmost(size_t k) const {
+    while (2 * k <= n_) {
+      k = 2 * k;
+    }
+    return k;
+  }
+
+  size_t Rightmost(size_t k) const {
+    while (2 * k + 1 <= n_) {
+      k = 2 * k + 1;
+    }
+    return k;
+  }
+
+  void Fill(size_t k, const std::vector<PrefixedEntry>& sorted, size_t* rank) {
+    if (k > n_) {
+      return;
+    }
+    Fill(2 * k, sorted, rank);
+    nodes_[k] = sorted[(*rank)++];
+    Fill(2 * k + 1, sorted, rank);
+  }
+
+  const size_t n_;
+  PrefixedEntry* nodes_;
+};
+
+class SkipListRep : public MemTableRep {
+ public:
+  SkipListRep(const MemTableKeyComparator& cmp, Arena* arena, int max_height,
+              int branching)
+      : use_prefix_(cmp.comparator.user_comparator() == BytewiseComparator()),
+        entry_cmp_(cmp),
+        arena_(arena),
+        skip_list_(PrefixedEntryComparator(cmp), arena, max_height, branching),
+        frozen_(nullptr) {}
+
+  void Insert(const char* entry) override {
+    skip_list_.Insert(MakeKey(entry));
+  }
+
+  bool Contains(const char* entry) const override {
+    return skip_list_.Contains(MakeKey(entry));
+  }
+
+  const char* FindGreaterOrEqual(const LookupKey& k) const override {
+    const FrozenEntryArray* frozen = frozen_.load(std::memory_order_acquire);
+    if (frozen != nullptr) {
+      size_t pos =
+          frozen->LowerBound(MakeKey(k.memtable_key().data()), entry_cmp_);
+      return pos != 0 ? frozen->entry(pos) : nullptr;
+    }
+    Table::Iterator iter(&skip_list_);
+    iter.Seek(MakeKey(k.memtable_key().data()));
+    return iter.Valid() ? iter.key().entry : nullptr;
+  }
+
+  void SampleSplitKeys(size_t n,
+                       std::vector<const char*>* entries) const override {
+    std::vector<PrefixedEntry> keys;
+    skip_list_.SampleKeys(n, &keys);
+    entries->clear();
+    for (const PrefixedEntry& key : keys) {
+      entries->push_back(key.entry);
+    }
+  }
+
+  uint64_t ApproximateNumEntries(const char* start,
+                                 const char* end) const override {
+    return skip_list_.ApproximateRangeCount(MakeKey(start), MakeKey(end));
+  }
+
+  // 把跳表冻结成 FrozenEntryArray，之后的点查和新建的迭代器都使用数组
+  // 冻结期间读操作照常访问跳表，数组构造完之后才发布；
+  // 跳表节点一直保留在 arena 中，已有的迭代器不受影响
+  void MarkReadOnly() override;
+
+  MemTableRep::Iterator* GetIterator() override {
+    const FrozenEntryArray* frozen = frozen_.load(std::memory_order_acquire);
+    if (frozen != nullptr) {
+      return new FrozenIterator(this, frozen);
+    }
+    return new Iterator(this);
+  }
+
+ private:
+  typedef SkipList<PrefixedEntry, PrefixedEntryComparator> Table;
+
+  PrefixedEntry MakeKey(const char* entry) const {
+    if (!use_prefix_) {
+      return PrefixedEntry(entry, 0);
+    }
+    Slice user_key = ExtractUserKey(GetLengthPrefixedSlice(entry));
+    return PrefixedEntry(entry,
+                         NormalizedKeyPrefix(user_key.data(), user_key.size()));
+  }
+
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    explicit Iterator(const SkipListRep* rep)
+        : rep_(rep), iter_(&rep->skip_list_) {}
+
+    bool Valid() const override { return iter_.Valid(); }
+    const char* key() const override { return iter_.key().entry; }
+    void Next() override { iter_.Next(); }
+    void Prev() override { iter_.Prev(); }
+    void Seek(const Slice& internal_key, const char* memtable_key) override {
+      iter_.Seek(rep_->MakeKey(memtable_key));
+    }
+    void SeekToFirst() override { iter_.SeekToFirst(); }
+    void SeekToLast() override { iter_.SeekToLast(); }
+
+   private:
+    const SkipListRep* const rep_;
+    Table::Iterator iter_;
+  };
+
+  // 遍历冻结后的数组，pos_ 为 0 表示 !Valid()
+  class FrozenIterator : public MemTableRep::Iterator {
+   public:
+    FrozenIterator(const SkipListRep* rep, const FrozenEntryArray* frozen)
+        : rep_(rep), frozen_(frozen), pos_(0) {}
+
+    bool Valid() const override { return pos_ != 0; }
+    const char* key() const override { return frozen_->entry(pos_); }
+    void Next() override {
+      assert(Valid());
+      pos_ = frozen_->Next(pos_);
+    }
+    void Prev() override {
+      assert(Valid());
+      pos_ = frozen_->Prev(pos_);
+    }
+    void Seek(const Slice& internal_key, const char* memtable_key) override {
+      pos_ = frozen_->LowerBound(rep_->MakeKey(memtable_key), rep_->entry_cmp_);
+    }
+    void SeekToFirst() override { pos_ = frozen_->First(); }
+    void SeekToLast() override { pos_ = frozen_->Last(); }
+
+   private:
+    const SkipListRep* const rep_;
+    const FrozenEntryArray* const frozen_;
+    size_t pos_;
+  };
+
+  const bool use_prefix_;
+  const PrefixedEntryComparator entry_cmp_;
+  Arena* const arena_;
+  Table skip_list_;
+  // MarkReadOnly 之前为 nullptr，对象本身也在 arena 中
+  std::atomic<const FrozenEntryArray*> frozen_;
+};
+
+void SkipListRep::MarkReadOnly() {
+  if (frozen_.load(std::memory_order_relaxed) != nullptr) {
+    return;
+  }
+  std::vector<PrefixedEntry> sorted;
+  Table::Iterator iter(&skip_list_);
+  for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+    sorted.push_back(iter.key());
+  }
+  // 之后不会再有写入，已经没有别人使用 arena
+  FrozenEntryArray* frozen = new (arena_->AllocateAligned(
+      sizeof(FrozenEntryArray))) FrozenEntryArray(arena_, sorted.size());
+  frozen->Build(sorted);
+  frozen_.store(frozen, std::memory_order_release);
+}
+
+class SkipListFactory : public MemTableRepFactory {
+ public:
+  SkipListFactory(int max_height, int branching)
+      : max_height_(max_height), branching_(branching) {}
+
+  MemTableRep* CreateMemTableRep(const MemTableKeyComparator& cmp,
+                                 Arena* arena,
+                                 const SliceTransform* prefix_extractor)
+      const override {
+    return new SkipListRep(cmp, arena, max_height_, branching_);
+  }
+
+  const char* Name() const override { return "SkipListFactory"; }
+
+ private:
+  const int max_height_;
+  const int branching_;
+};
+
+typedef SkipList<PrefixedEntry, PrefixedEntryComparator> EntrySkipList;
+
+}  // namespace
+
+MemTableRepFactory* NewSkipListRepFactory(int max_height, int branching) {
+  max_height = std::max(1, std::min<int>(max_height,
+                                         EntrySkipList::kMaxHeightLimit));
+  branching = std::max(branching, 2);
+  return new SkipListFactory(max_height, branching);
+}
+
+MemTableRepFactory* NewAdaptiveSkipListRepFactory(size_t expected_entries) {
+  // 分支因子为 4 时平均每个节点 4/3 个指针，查找的比较次数也接近最少，
+  // 所以固定分支因子，只按 entry 个数调整高度
+  const int branching = EntrySkipList::kDefaultBranching;
+  return new SkipListFactory(SkipListHeightFor(expected_entries, branching),
+                             branching);
+}
+
+}  // namespace leveldb
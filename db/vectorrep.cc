@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "db/memtablerep.h"
+
+namespace leveldb {
+
+namespace {
+
+// 批量导入用的 rep: Insert 只是把 entry 指针追加到数组末尾，不做任何查找，
+// memtable 变成只读（MarkReadOnly）时并行排序一次，之后用二分查找
+//
+// 只读之前的读操作需要扫描或者复制排序整个数组，代价很高，
+// 只适合导入期间几乎没有读的场景
+class VectorRep : public MemTableRep {
+ public:
+  VectorRep(const MemTableKeyComparator& cmp, size_t reserved_count)
+      : compare_(cmp), immutable_(false) {
+    entries_.reserve(reserved_count);
+  }
+
+  void Insert(const char* entry) override {
+    std::lock_guard<std::mutex> l(mutex_);
+    assert(!immutable_.load(std::memory_order_relaxed));
+    entries_.push_back(entry);
+  }
+
+  bool Contains(const char* entry) const override;
+
+  const char* FindGreaterOrEqual(const LookupKey& k) const override;
+
+  void MarkReadOnly() override;
+
+  // 只有排好序之后才能取样
+  void SampleSplitKeys(size_t n,
+                       std::vector<const char*>* entries) const override;
+
+  MemTableRep::Iterator* GetIterator() override;
+
+ private:
+  class Iterator;
+
+  bool Less(const char* a, const char* b) const { return compare_(a, b) < 0; }
+
+  // 返回 entries 中第一个 >= key 的 entry，entries 必须有序
+  const char* LowerBound(const std::vector<const char*>& entries,
+                         const char* key) const {
+    auto it = std::lower_bound(
+        entries.begin(), entries.end(), key,
+        [this](const char* a, const char* b) { return Less(a, b); });
+    return it == entries.end() ? nullptr : *it;
+  }
+
+  // 并行排序 entries_
+  void ParallelSort();
+
+  const MemTableKeyComparator compare_;
+
+  // 只读之前保护 entries_，只读之后 entries_ 不再修改，读者不需要加锁
+  mutable std::mutex mutex_;
+  std::vector<const char*> entries_;
+  std::atomic<bool> immutable_;  // 为 true 时 entries_ 已经排好序
+};
+
+bool VectorRep::Contains(const char* entry) const {
+  const char* found;
+  if (immutable_.load(std::memory_order_acquire)) {
+    found = LowerBound(entries_, entry);
+  } else {
+    std::lock_guard<std::mutex> l(mutex_);
+    found = nullptr;
+    for (const char* e : entries_) {
+      if (compare_(e, entry) == 0) {
+        found = e;
+        break;
+      }
+    }
+  }
+  return found != nullptr && compare_(found, entry) == 0;
+}
+
+const char* VectorRep::FindGreaterOrEqual(const LookupKey& k) const {
+  const char* key = k.memtable_key().data();
+  if (immutable_.load(std::memory_order_acquire)) {
+    return LowerBound(entries_, key);
+  }
+  // 还没有排序，线性扫描找到 >= key 的最小 entry
+  std::lock_guard<std::mutex> l(mutex_);
+  const char* result = nullptr;
+  for (const char* e : entries_) {
+    if (!Less(e, key) && (result == nullptr || Less(e, result))) {
+      result = e;
+    }
+  }
+  return result;
+}
+
+void VectorRep::ParallelSort() {
+  auto less = [this](const char* a, const char* b) { return Less(a, b); };
+  const size_t n = entries_.size();
+  static const size_t kMinEntriesPerThread = 1 << 16;
+  size_t threads = std::thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+  threads = std::min(threads, n / kMinEntriesPerThread);
+  if (threads <= 1) {
+    std::sort(entries_.begin(), entries_.end(), less);
+    return;
+  }
+
+  // 切成 threads 段分别排序，再两两归并
+  std::vector<size_t> bounds;
+  for (size_t i = 0; i <= threads; i++) {
+    bounds.push_back(n * i / threads);
+  }
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; i++) {
+    workers.emplace_back([this, &bounds, &less, i]() {
+      std::sort(entries_.begin() + bounds[i], entries_.begin() + bounds[i + 1],
+                less);
+    });
+  }
+  for (std::thread& t : workers) t.join();
+
+  while (bounds.size() > 2) {
+    std::vector<size_t> merged;
+    workers.clear();
+    for (size_t i = 0; i + 2 < bounds.size(); i += 2) {
+      const size_t lo = bounds[i], mid = bounds[i + 1], hi = bounds[i + 2];
+      workers.emplace_back([this, &less, lo, mid, hi]() {
+        std::inplace_merge(entries_.begin() + lo, entries_.begin() + mid,
+                           entries_.begin() + hi, less);
+      });
+      merged.push_back(lo);
+    }
+    if (bounds.size() % 2 == 0) {
+      // 段数为奇数，最后一段留到下一轮
+      merged.push_back(bounds[bounds.size() - 2]);
+    }
+    merged.push_back(n);
+    for (std::thread& t : workers) t.join();
+    bounds.swap(merged);
+  }
+}
+
+void VectorRep::SampleSplitKeys(size_t n,
+                                std::vector<const char*>* entries) const {
+  entries->clear();
+  if (!immutable_.load(std::memory_order_acquire)) {
+    return;
+  }
+  const size_t count = entries_.size();
+  for (size_t i = 0; i < std::min(n, count); i++) {
+    entries->push_back(entries_[(i + 1) * count / (n + 1)]);
+  }
+}
+
+void VectorRep::MarkReadOnly() {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (immutable_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  ParallelSort();
+  entries_.shrink_to_fit();
+  immutable_.store(true, std::memory_order_release);
+}
+
+class VectorRep::Iterator : public MemTableRep::Iterator {
+ public:
+  // entries 必须有序，owned 不为空时由迭代器持有
+  Iterator(const VectorRep* rep, const std::vector<const char*>* entries,
+           std::unique_ptr<std::vector<const char*>> owned)
+      : rep_(rep),
+        owned_(std::move(owned)),
+        entries_(entries),
+        pos_(entries->size()) {}
+
+  bool Valid() const override { return pos_ < entries_->size(); }
+  const char* key() const override {
+    assert(Valid());
+    return (*entries_)[pos_];
+  }
+  void Next() override {
+    assert(Valid());
+    pos_++;
+  }
+  void Prev() override {
+    assert(Valid());
+    pos_ = (pos_ == 0) ? entries_->size() : pos_ - 1;
+  }
+  void Seek(const Slice& internal_key, const char* memtable_key) override {
+    const VectorRep* rep = rep_;
+    pos_ = std::lower_bound(entries_->begin(), entries_->end(), memtable_key,
+                            [rep](const char* a, const char* b) {
+                              return rep->Less(a, b);
+                            }) -
+           entries_->begin();
+  }
+  void SeekToFirst() override { pos_ = 0; }
+  void SeekToLast() override {
+    pos_ = entries_->empty() ? 0 : entries_->size() - 1;
+  }
+
+ private:
+  const VectorRep* const rep_;
+  const std::unique_ptr<std::vector<const char*>> owned_;
+  const std::vector<const char*>* const entries_;
+  size_t pos_;  // == entries_->size() 表示无效
+};
+
+MemTableRep::Iterator* VectorRep::GetIterator() {
+  if (immutable_.load(std::memory_order_acquire)) {
+    return new Iterator(this, &entries_, nullptr);
+  }
+  // 还可能有写入，复制一份再排序
+  std::unique_ptr<std::vector<const char*>> copy;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    copy.reset(new std::vector<const char*>(entries_));
+  }
+  std::sort(copy->begin(), copy->end(),
+            [this](const char* a, const char* b) { return Less(a, b); });
+  const std::vector<const char*>* entries = copy.get();
+  return new Iterator(this, entries, std::move(copy));
+}
+
+class VectorRepFactory : public MemTableRepFactory {
+ public:
+  explicit VectorRepFactory(size_t reserved_count)
+      : reserved_count_(reserved_count) {}
+
+  MemTableRep* CreateMemTableRep(const MemTableKeyComparator& cmp,
+                                 Arena* arena,
+                                 const SliceTransform* prefix_extractor)
+      const override {
+    return new VectorRep(cmp, reserved_count_);
+  }
+
+  const char* Name() const override { return "VectorRepFactory"; }
+
+ private:
+  const size_t reserved_count_;
+};
+
+}  // namespace
+
+MemTableRepFactory* NewVectorRepFactory(size_t reserved_count) {
+  return new VectorRepFactory(reserved_count);
+}
+
+}  // namespace leveldb
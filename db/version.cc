@@ -0,0 +1,371 @@
+#include "db/version.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "leveldb/env.h"
+#include "leveldb/pinnable_slice.h"
+#include "leveldb/slice_transform.h"
+#include "leveldb/table.h"
+#include "table/merger.h"
+
+namespace leveldb {
+
+FileMetaData::FileMetaData()
+    : number(0), file_size(0), global_seqno(kDisableGlobalSeqno) {}
+
+FileMetaData::~FileMetaData() = default;
+
+Version::Version(const InternalKeyComparator* icmp,
+                 std::vector<std::shared_ptr<FileMetaData>> files)
+    : icmp_(icmp), files_(std::move(files)), refs_(0) {
+  // 区间删除的 sequence 与所在文件无关，合在一起切分一次，读的时候只查一处
+  std::vector<Iterator*> list;
+  for (const auto& f : files_) {
+    Iterator* iter = f->table->NewRangeTombstoneIterator();
+    if (iter != nullptr) {
+      list.push_back(iter);
+    }
+  }
+  if (!list.empty()) {
+    Iterator* iter =
+        NewMergingIterator(icmp_, &list[0], static_cast<int>(list.size()));
+    auto dels = std::make_shared<const FragmentedRangeTombstoneList>(
+        iter, icmp_->user_comparator());
+    delete iter;
+    if (!dels->empty()) {
+      range_dels_ = std::move(dels);
+    }
+  }
+}
+
+namespace {
+
+enum SaverState {
+  kNotFound,
+  kFound,
+  kDeleted,
+  kCorrupt,
+};
+
+struct Saver {
+  SaverState state;
+  const Comparator* ucmp;
+  Slice user_key;
+  SequenceNumber sequence;
+  PinnableSlice* value;
+  bool pin;  // 是否可以让 value 直接指向 block
+};
+
+static void DeleteBlockIterator(void* arg1, void* arg2) {
+  delete reinterpret_cast<Iterator*>(arg1);
+}
+
+// 找到的值存入 s->value，可以时接管 block 迭代器，避免拷贝
+static void SaveFoundValue(Saver* s, const Slice& v, Iterator** block_iter) {
+  if (s->pin && *block_iter != nullptr) {
+    s->value->PinSlice(v, &DeleteBlockIterator, *block_iter, nullptr);
+    *block_iter = nullptr;
+  } else {
+    s->value->PinSelf(v);
+  }
+}
+
+// 把保存 user key 的导入文件的迭代器转换成 internal key 的迭代器，
+// 每个 key 的 sequence 都是 global_seqno，类型为 kTypeValue
+class GlobalSeqnoIterator : public Iterator {
+ public:
+  GlobalSeqnoIterator(Iterator* iter, const Comparator* ucmp,
+                      SequenceNumber global_seqno)
+      : iter_(iter), ucmp_(ucmp), global_seqno_(global_seqno) {}
+  ~GlobalSeqnoIterator() override { delete iter_; }
+
+  bool Valid() const override { return iter_->Valid(); }
+  Slice key() const override {
+    assert(Valid());
+    return key_;
+  }
+  Slice value() const override { return iter_->value(); }
+  Status status() const override { return iter_->status(); }
+
+  void Seek(const Slice& target) override {
+    const Slice user_key = ExtractUserKey(target);
+    iter_->Seek(user_key);
+    // 同一个 user key 只有一个版本，它比 target 的 sequence 新时排在 target 之前
+    if (iter_->Valid() && ExtractSequence(target) < global_seqno_ &&
+        ucmp_->Compare(iter_->key(), user_key) == 0) {
+      iter_->Next();
+    }
+    UpdateKey();
+  }
+  void SeekToFirst() override {
+    iter_->SeekToFirst();
+    UpdateKey();
+  }
+  void SeekToLast() override {
+    iter_->SeekToLast();
+    UpdateKey();
+  }
+  void Next() override {
+    iter_->Next();
+    UpdateKey();
+  }
+  void Prev() override {
+    iter_->Prev();
+    UpdateKey();
+  }
+
+ private:
+  void UpdateKey() {
+    key_.clear();
+    if (iter_->Valid()) {
+      AppendInternalKey(
+          &key_, ParsedInternalKey(iter_->key(), global_seqno_, kTypeValue));
+    }
+  }
+
+  Iterator* const iter_;
+  const Comparator* const ucmp_;
+  const SequenceNumber global_seqno_;
+  std::string key_;
+};
+
+// 前缀遍历时先用 filter 检查 Seek 的 target 所在的 data block:
+// 同一前缀的 key 是连续的，这个 block 中没有 target 的前缀时，
+// 文件中也没有 >= target 的同前缀 key，不用再读 data block
+// 前缀遍历只保证 Seek 之后向后（Next）的结果
+class PrefixFilterIterator : public Iterator {
+ public:
+  PrefixFilterIterator(Iterator* iter, const Table* table,
+                       const SliceTransform* prefix_extractor)
+      : iter_(iter),
+        table_(table),
+        prefix_extractor_(prefix_extractor),
+        filtered_(false) {}
+  ~PrefixFilterIterator() override { delete iter_; }
+
+  bool Valid() const override { return !filtered_ && iter_->Valid(); }
+  Slice key() const override { return iter_->key(); }
+  Slice value() const override { return iter_->value(); }
+  Status status() const override {
+    return filtered_ ? Status::OK() : iter_->status();
+  }
+
+  void Seek(const Slice& target) override {
+    filtered_ = prefix_extractor_->InDomain(ExtractUserKey(target)) &&
+                !table_->BlockMayMatch(target);
+    if (filtered_) {
+      return;
+    }
+    iter_->Seek(target);
+  }
+  void SeekToFirst() override {
+    filtered_ = false;
+    iter_->SeekToFirst();
+  }
+  void SeekToLast() override {
+    filtered_ = false;
+    iter_->SeekToLast();
+  }
+  void Next() override { iter_->Next(); }
+  void Prev() override { iter_->Prev(); }
+
+ private:
+  Iterator* const iter_;
+  const Table* const table_;
+  const SliceTransform* const prefix_extractor_;
+  bool filtered_;  // 最近一次 Seek 被 filter 过滤掉了
+};
+
+}  // namespace
+
+// 导入文件中的 key 是 user key，sequence 由调用者填写
+static void SaveIngestedValue(void* arg, const Slice& key, const Slice& v,
+                              Iterator** block_iter) {
+  Saver* s = reinterpret_cast<Saver*>(arg);
+  if (s->ucmp->Compare(key, s->user_key) == 0) {
+    s->state = kFound;
+    SaveFoundValue(s, v, block_iter);
+  }
+}
+
+static void SaveValue(void* arg, const Slice& ikey, const Slice& v,
+                      Iterator** block_iter) {
+  Saver* s = reinterpret_cast<Saver*>(arg);
+  ParsedInternalKey parsed_key;
+  if (!ParseInternalKey(ikey, &parsed_key)) {
+    s->state = kCorrupt;
+  } else if (s->ucmp->Compare(parsed_key.user_key, s->user_key) == 0) {
+    s->sequence = parsed_key.sequence;
+    s->state = (parsed_key.type == kTypeValue) ? kFound : kDeleted;
+    if (s->state == kFound) {
+      SaveFoundValue(s, v, block_iter);
+    }
+  }
+}
+
+// 查找结束之后根据 saver 和区间删除得到结果
+static Status SaverStatus(const Saver& saver,
+                          const FragmentedRangeTombstoneList* range_dels,
+                          const LookupKey& k) {
+  if (saver.state != kFound) {
+    return Status::NotFound(Slice());
+  }
+  if (range_dels != nullptr &&
+      range_dels->MaxCoveringTombstoneSeqnum(k.user_key(), k.sequence()) >
+          saver.sequence) {
+    // 被区间删除覆盖
+    return Status::NotFound(Slice());
+  }
+  return Status::OK();
+}
+
+Status Version::Get(const ReadOptions& options, const LookupKey& k,
+                    PinnableSlice* value, bool pin) const {
+  const Slice user_key = k.user_key();
+  const Comparator* ucmp = icmp_->user_comparator();
+
+  Saver saver;
+  saver.state = kNotFound;
+  saver.ucmp = ucmp;
+  saver.user_key = user_key;
+  saver.value = value;
+  saver.pin = pin;
+
+  // 从新到旧查找，第一个找到的就是快照可见的最新版本
+  for (const auto& f : files_) {
+    if (ucmp->Compare(user_key, f->smallest.user_key()) < 0 ||
+        ucmp->Compare(user_key, f->largest.user_key()) > 0) {
+      continue;
+    }
+    Status s;
+    if (f->global_seqno != kDisableGlobalSeqno) {
+      if (f->global_seqno > k.sequence()) {
+        continue;  // 快照之后导入的文件
+      }
+      saver.sequence = f->global_seqno;
+      s = f->table->InternalGet(options, user_key, &saver, SaveIngestedValue);
+    } else {
+      s = f->table->InternalGet(options, k.internal_key(), &saver, SaveValue);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    if (saver.state == kCorrupt) {
+      return Status::Corruption("corrupted key for ", user_key);
+    }
+    if (saver.state != kNotFound) {
+      break;
+    }
+  }
+
+  return SaverStatus(saver, range_dels_.get(), k);
+}
+
+void Version::MultiGet(const ReadOptions& options, const LookupKey* const* keys,
+                       std::string* const* values, Status* statuses,
+                       size_t n) const {
+  const Comparator* ucmp = icmp_->user_comparator();
+  std::vector<Saver> savers(n);
+  std::vector<bool> failed(n, false);  // 读文件出错，statuses[i] 已经设置
+  std::deque<PinnableSlice> results;   // 拷贝到 *values[i]
+  for (size_t i = 0; i < n; i++) {
+    results.emplace_back(values[i]);
+    savers[i].state = kNotFound;
+    savers[i].ucmp = ucmp;
+    savers[i].user_key = keys[i]->user_key();
+    savers[i].value = &results.back();
+    savers[i].pin = false;
+  }
+
+  // 按 key 排序，落在同一个 data block 的 key 只读一次
+  std::vector<size_t> pending(n);
+  for (size_t i = 0; i < n; i++) {
+    pending[i] = i;
+  }
+  std::sort(pending.begin(), pending.end(), [&](size_t a, size_t b) {
+    return icmp_->Compare(keys[a]->internal_key(), keys[b]->internal_key()) <
+           0;
+  });
+
+  // 与 Get 相同，从新到旧查找，每个文件只处理还没有结果的 key
+  std::vector<Slice> batch_keys;
+  std::vector<void*> batch_args;
+  std::vector<size_t> batch;
+  for (const auto& f : files_) {
+    if (pending.empty()) {
+      break;
+    }
+    const bool ingested = f->global_seqno != kDisableGlobalSeqno;
+    batch_keys.clear();
+    batch_args.clear();
+    batch.clear();
+    for (size_t i : pending) {
+      const Slice user_key = keys[i]->user_key();
+      if (ucmp->Compare(user_key, f->smallest.user_key()) < 0 ||
+          ucmp->Compare(user_key, f->largest.user_key()) > 0) {
+        continue;
+      }
+      if (ingested) {
+        if (f->global_seqno > keys[i]->sequence()) {
+          continue;  // 快照之后导入的文件
+        }
+        savers[i].sequence = f->global_seqno;
+        batch_keys.push_back(user_key);
+      } else {
+        batch_keys.push_back(keys[i]->internal_key());
+      }
+      batch_args.push_back(&savers[i]);
+      batch.push_back(i);
+    }
+    if (batch.empty()) {
+      continue;
+    }
+
+    Status s = f->table->InternalMultiGet(
+        options, batch_keys.data(), batch_args.data(), batch.size(),
+        ingested ? SaveIngestedValue : SaveValue);
+    if (!s.ok()) {
+      for (size_t i : batch) {
+        failed[i] = true;
+        statuses[i] = s;
+      }
+    }
+    pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                 [&](size_t i) {
+                                   return failed[i] ||
+                                          savers[i].state != kNotFound;
+                                 }),
+                  pending.end());
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    if (failed[i]) {
+      continue;
+    }
+    if (savers[i].state == kCorrupt) {
+      statuses[i] =
+          Status::Corruption("corrupted key for ", keys[i]->user_key());
+    } else {
+      statuses[i] = SaverStatus(savers[i], range_dels_.get(), *keys[i]);
+    }
+  }
+}
+
+void Version::AddIterators(const ReadOptions& options,
+                           const SliceTransform* prefix_extractor,
+                           std::vector<Iterator*>* iters) const {
+  for (const auto& f : files_) {
+    Iterator* iter = f->table->NewIterator(options);
+    if (f->global_seqno != kDisableGlobalSeqno) {
+      // 导入文件的 filter 按整个 user key 建立，不能用来过滤前缀
+      iter = new GlobalSeqnoIterator(iter, icmp_->user_comparator(),
+                                     f->global_seqno);
+    } else if (options.prefix_same_as_start && prefix_extractor != nullptr) {
+      iter = new PrefixFilterIterator(iter, f->table.get(), prefix_extractor);
+    }
+    iters->push_back(iter);
+  }
+}
+
+}  // namespace leveldb
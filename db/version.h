@@ -0,0 +1,98 @@
+#ifndef STORAGE_LEVELDB_DB_VERSION_H_
+#define STORAGE_LEVELDB_DB_VERSION_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/range_tombstone.h"
+#include "leveldb/options.h"
+
+namespace leveldb {
+
+class Iterator;
+class PinnableSlice;
+class RandomAccessFile;
+class Table;
+
+// flush 生成的文件中保存的是 internal key，global_seqno 为这个值
+static const SequenceNumber kDisableGlobalSeqno = kMaxSequenceNumber;
+
+// 一个 sstable 文件，打开之后一直保持打开，直到没有 Version 引用它
+struct FileMetaData {
+  FileMetaData();
+  ~FileMetaData();
+
+  uint64_t number;
+  uint64_t file_size;    // 文件大小（字节）
+  InternalKey smallest;  // 文件中最小的 internal key
+  InternalKey largest;   // 文件中最大的 internal key
+
+  // 外部导入的文件中保存的是 user key，table 按 user comparator 打开，
+  // 读取时每个 key 都视为 sequence 为 global_seqno 的 kTypeValue
+  SequenceNumber global_seqno;
+
+  std::unique_ptr<RandomAccessFile> file;
+  std::unique_ptr<Table> table;
+};
+
+// 某一时刻所有 sstable 的集合，创建后不可修改
+// 目前所有文件都在 level-0，文件之间的 key 范围可以重叠
+class Version {
+ public:
+  // files 按从新到旧的顺序排列（同一次 flush 生成的文件 key 范围互不重叠）
+  Version(const InternalKeyComparator* icmp,
+          std::vector<std::shared_ptr<FileMetaData>> files);
+
+  Version(const Version&) = delete;
+  Version& operator=(const Version&) = delete;
+
+  void Ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
+  void Unref() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+  // 在 sstable 中查找 key，找到时把值存入 *value 并返回 OK
+  // 不存在或者已被删除时返回 NotFound
+  // pin 为 true 时 *value 直接指向 sstable 的 block，不拷贝
+  Status Get(const ReadOptions& options, const LookupKey& key,
+             PinnableSlice* value, bool pin) const;
+
+  // 对每个 keys[i] 做 Get，结果存入 *values[i] 和 statuses[i]
+  // 同一个 sstable 中需要读的 data block 一次同时读取
+  void MultiGet(const ReadOptions& options, const LookupKey* const* keys,
+                std::string* const* values, Status* statuses, size_t n) const;
+
+  // 把遍历每个 sstable 的迭代器追加到 *iters，迭代器的 key() 都是 internal key
+  // options.prefix_same_as_start 为 true 时，filter 表明不含 Seek 的 target
+  // 的前缀的 sstable 不读 data block；filter 要按 prefix_extractor 建立
+  void AddIterators(const ReadOptions& options,
+                    const SliceTransform* prefix_extractor,
+                    std::vector<Iterator*>* iters) const;
+
+  // 所有 sstable 中的区间删除，没有时返回 nullptr
+  const std::shared_ptr<const FragmentedRangeTombstoneList>& range_dels()
+      const {
+    return range_dels_;
+  }
+
+  const std::vector<std::shared_ptr<FileMetaData>>& files() const {
+    return files_;
+  }
+
+ private:
+  ~Version() = default;  // 只能通过 Unref() 删除
+
+  const InternalKeyComparator* const icmp_;
+  const std::vector<std::shared_ptr<FileMetaData>> files_;
+  std::shared_ptr<const FragmentedRangeTombstoneList> range_dels_;
+  std::atomic<int> refs_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_VERSION_H_
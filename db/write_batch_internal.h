@@ -0,0 +1,39 @@
+#ifndef STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
+#define STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
+
+#include "db/dbformat.h"
+#include "leveldb/write_batch.h"
+
+namespace leveldb {
+
+class MemTable;
+
+// 数据库内部使用的 WriteBatch 方法，不对外公开
+class WriteBatchInternal {
+ public:
+  // batch 中操作的个数
+  static int Count(const WriteBatch* batch);
+
+  static void SetCount(WriteBatch* batch, int n);
+
+  // 第一个操作的 sequence，之后的操作依次加一
+  static SequenceNumber Sequence(const WriteBatch* batch);
+
+  static void SetSequence(WriteBatch* batch, SequenceNumber seq);
+
+  static Slice Contents(const WriteBatch* batch) { return Slice(batch->rep_); }
+
+  static size_t ByteSize(const WriteBatch* batch) { return batch->rep_.size(); }
+
+  static void SetContents(WriteBatch* batch, const Slice& contents);
+
+  // 遍历一次 batch，从 Sequence(batch) 开始依次分配 sequence 写入 memtable
+  // 要求: 写操作由外部同步，batch 已经用 Iterate 检查过格式
+  static Status InsertInto(const WriteBatch* batch, MemTable* memtable);
+
+  static void Append(WriteBatch* dst, const WriteBatch* src);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
@@ -0,0 +1,258 @@
+#include "leveldb/write_batch.h"
+
+#include <string>
+
+#include "db/memtable.h"
+#include "db/write_batch_internal.h"
+#include "gtest/gtest.h"
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "util/coding.h"
+
+namespace leveldb {
+
+// 把 b 写入一个新的 memtable，按 internal key 的顺序输出所有 entry，
+// 区间删除排在最后；InsertInto 失败时末尾加上 "ParseError()"
+static std::string PrintContents(WriteBatch* b) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  Options options;
+  MemTable* mem = new MemTable(cmp, options);
+  mem->Ref();
+  std::string state;
+  Status s = WriteBatchInternal::InsertInto(b, mem);
+  int count = 0;
+  Iterator* iter = mem->NewIterator();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    EXPECT_TRUE(ParseInternalKey(iter->key(), &ikey));
+    switch (ikey.type) {
+      case kTypeValue:
+        state.append("Put(");
+        state.append(ikey.user_key.ToString());
+        state.append(", ");
+        state.append(iter->value().ToString());
+        state.append(")");
+        break;
+      case kTypeDeletion:
+        state.append("Delete(");
+        state.append(ikey.user_key.ToString());
+        state.append(")");
+        break;
+      default:
+        ADD_FAILURE() << "unexpected type " << ikey.type;
+        break;
+    }
+    state.append("@");
+    state.append(std::to_string(ikey.sequence));
+    count++;
+  }
+  delete iter;
+  iter = mem->NewRangeTombstoneIterator();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    EXPECT_TRUE(ParseInternalKey(iter->key(), &ikey));
+    EXPECT_EQ(kTypeRangeDeletion, ikey.type);
+    state.append("DeleteRange(");
+    state.append(ikey.user_key.ToString());
+    state.append(", ");
+    state.append(iter->value().ToString());
+    state.append(")@");
+    state.append(std::to_string(ikey.sequence));
+    count++;
+  }
+  delete iter;
+  if (!s.ok()) {
+    state.append("ParseError()");
+  } else if (count != WriteBatchInternal::Count(b)) {
+    state.append("CountMismatch()");
+  }
+  mem->Unref();
+  return state;
+}
+
+TEST(WriteBatchTest, Empty) {
+  WriteBatch batch;
+  ASSERT_EQ("", PrintContents(&batch));
+  ASSERT_EQ(0, batch.Count());
+  ASSERT_EQ(0, WriteBatchInternal::Count(&batch));
+  // 只有 12 字节的头部: sequence 和个数
+  ASSERT_EQ(12, WriteBatchInternal::ByteSize(&batch));
+}
+
+// 每个操作依次使用连续的 sequence
+TEST(WriteBatchTest, Multiple) {
+  WriteBatch batch;
+  batch.Put(Slice("foo"), Slice("bar"));
+  batch.Delete(Slice("box"));
+  batch.Put(Slice("baz"), Slice("boo"));
+  batch.DeleteRange(Slice("c"), Slice("e"));
+  WriteBatchInternal::SetSequence(&batch, 100);
+  ASSERT_EQ(100, WriteBatchInternal::Sequence(&batch));
+  ASSERT_EQ(4, WriteBatchInternal::Count(&batch));
+  ASSERT_EQ(4, batch.Count());
+  ASSERT_EQ(
+      "Put(baz, boo)@102"
+      "Delete(box)@101"
+      "Put(foo, bar)@100"
+      "DeleteRange(c, e)@103",
+      PrintContents(&batch));
+}
+
+// 同一个 key 的多个操作按写入顺序得到递增的 sequence
+TEST(WriteBatchTest, SameKeyConsecutiveSequences) {
+  WriteBatch batch;
+  batch.Put(Slice("k"), Slice("v1"));
+  batch.Delete(Slice("k"));
+  batch.Put(Slice("k"), Slice("v2"));
+  WriteBatchInternal::SetSequence(&batch, 7);
+  ASSERT_EQ("Put(k, v2)@9Delete(k)@8Put(k, v1)@7", PrintContents(&batch));
+}
+
+// rep 的格式: fixed64 sequence, fixed32 个数, 然后是每条记录
+TEST(WriteBatchTest, RepFormat) {
+  WriteBatch batch;
+  batch.Put(Slice("a"), Slice("bc"));
+  batch.Delete(Slice("d"));
+  batch.DeleteRange(Slice("e"), Slice("fg"));
+  WriteBatchInternal::SetSequence(&batch, 0x0011223344556677ull);
+
+  std::string expected;
+  PutFixed64(&expected, 0x0011223344556677ull);
+  PutFixed32(&expected, 3);
+  expected.push_back(static_cast<char>(kTypeValue));
+  expected.append("\x01"
+                  "a"
+                  "\x02"
+                  "bc");
+  expected.push_back(static_cast<char>(kTypeDeletion));
+  expected.append("\x01"
+                  "d");
+  expected.push_back(static_cast<char>(kTypeRangeDeletion));
+  expected.append("\x01"
+                  "e"
+                  "\x02"
+                  "fg");
+  ASSERT_EQ(expected, WriteBatchInternal::Contents(&batch).ToString());
+  ASSERT_EQ(expected.size(), batch.ApproximateSize());
+
+  // SetContents 之后内容和顺序不变
+  WriteBatch copy;
+  WriteBatchInternal::SetContents(&copy, Slice(expected));
+  ASSERT_EQ(3, copy.Count());
+  ASSERT_EQ(0x0011223344556677ull, WriteBatchInternal::Sequence(&copy));
+  ASSERT_EQ(PrintContents(&batch), PrintContents(&copy));
+}
+
+TEST(WriteBatchTest, Corruption) {
+  WriteBatch batch;
+  batch.Put(Slice("foo"), Slice("bar"));
+  batch.Delete(Slice("box"));
+  WriteBatchInternal::SetSequence(&batch, 200);
+  Slice contents = WriteBatchInternal::Contents(&batch);
+  WriteBatchInternal::SetContents(&batch,
+                                  Slice(contents.data(), contents.size() - 1));
+  ASSERT_EQ("Put(foo, bar)@200ParseError()", PrintContents(&batch));
+}
+
+// 各种格式错误都由 Iterate 返回 Corruption
+TEST(WriteBatchTest, MalformedRep) {
+  struct NullHandler : public WriteBatch::Handler {
+    void Put(const Slice&, const Slice&) override {}
+    void Delete(const Slice&) override {}
+    void DeleteRange(const Slice&, const Slice&) override {}
+  } handler;
+
+  WriteBatch good;
+  good.Put(Slice("foo"), Slice("bar"));
+  good.DeleteRange(Slice("a"), Slice("b"));
+  ASSERT_TRUE(good.Iterate(&handler).ok());
+  const std::string rep = WriteBatchInternal::Contents(&good).ToString();
+
+  // 每一种截断
+  for (size_t len = 12; len < rep.size(); len++) {
+    WriteBatch b;
+    WriteBatchInternal::SetContents(&b, Slice(rep.data(), len));
+    ASSERT_TRUE(b.Iterate(&handler).IsCorruption()) << len;
+  }
+
+  // 个数与记录不符
+  {
+    WriteBatch b = good;
+    WriteBatchInternal::SetCount(&b, 3);
+    ASSERT_TRUE(b.Iterate(&handler).IsCorruption());
+    WriteBatchInternal::SetCount(&b, 1);
+    ASSERT_TRUE(b.Iterate(&handler).IsCorruption());
+  }
+
+  // 未知的类型
+  {
+    std::string bad = rep;
+    bad[12] = static_cast<char>(0x7f);
+    WriteBatch b;
+    WriteBatchInternal::SetContents(&b, Slice(bad));
+    ASSERT_TRUE(b.Iterate(&handler).IsCorruption());
+  }
+
+  // 长度超过剩余的数据
+  {
+    std::string bad = rep;
+    bad[13] = static_cast<char>(100);
+    WriteBatch b;
+    WriteBatchInternal::SetContents(&b, Slice(bad));
+    ASSERT_TRUE(b.Iterate(&handler).IsCorruption());
+  }
+}
+
+TEST(WriteBatchTest, Append) {
+  WriteBatch b1, b2;
+  WriteBatchInternal::SetSequence(&b1, 200);
+  WriteBatchInternal::SetSequence(&b2, 300);
+  b1.Append(b2);
+  ASSERT_EQ("", PrintContents(&b1));
+  b2.Put("a", "va");
+  b1.Append(b2);
+  ASSERT_EQ("Put(a, va)@200", PrintContents(&b1));
+  b2.Clear();
+  b2.Put("b", "vb");
+  b1.Append(b2);
+  ASSERT_EQ(
+      "Put(a, va)@200"
+      "Put(b, vb)@201",
+      PrintContents(&b1));
+  b2.Delete("foo");
+  b2.DeleteRange("x", "z");
+  b1.Append(b2);
+  ASSERT_EQ(
+      "Put(a, va)@200"
+      "Put(b, vb)@202"
+      "Put(b, vb)@201"
+      "Delete(foo)@203"
+      "DeleteRange(x, z)@204",
+      PrintContents(&b1));
+  ASSERT_EQ(5, b1.Count());
+  // 追加之后 sequence 仍然是 b1 自己的
+  ASSERT_EQ(200, WriteBatchInternal::Sequence(&b1));
+}
+
+TEST(WriteBatchTest, ApproximateSize) {
+  WriteBatch batch;
+  size_t empty_size = batch.ApproximateSize();
+
+  batch.Put(Slice("foo"), Slice("bar"));
+  size_t one_key_size = batch.ApproximateSize();
+  ASSERT_LT(empty_size, one_key_size);
+
+  batch.Put(Slice("baz"), Slice("boo"));
+  size_t two_keys_size = batch.ApproximateSize();
+  ASSERT_LT(one_key_size, two_keys_size);
+
+  batch.Delete(Slice("box"));
+  size_t post_delete_size = batch.ApproximateSize();
+  ASSERT_LT(two_keys_size, post_delete_size);
+
+  batch.DeleteRange(Slice("c"), Slice("d"));
+  ASSERT_LT(post_delete_size, batch.ApproximateSize());
+}
+
+}  // namespace leveldb
@@ -0,0 +1,43 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_COMPARATOR_H_
+#define STORAGE_LEVELDB_INCLUDE_COMPARATOR_H_
+
+#include <cstddef>
+#include <string>
+
+namespace leveldb {
+
+class Slice;
+
+// Comparator 为 sstable / memtable 中的 key 提供全序关系
+// 实现必须是线程安全的
+class Comparator {
+ public:
+  virtual ~Comparator();
+
+  // 三路比较: <0 表示 a < b, ==0 表示 a == b, >0 表示 a > b
+  virtual int Compare(const Slice& a, const Slice& b) const = 0;
+
+  // 比较器的名字，用来检查比较器是否匹配
+  virtual const char* Name() const = 0;
+
+  // 如果 *start < limit, 把 *start 改成一个位于 [start,limit) 中的更短的串
+  // 用来缩小 index block 的大小
+  virtual void FindShortestSeparator(std::string* start,
+                                     const Slice& limit) const = 0;
+
+  // 把 *key 改成一个 >= *key 的更短的串
+  virtual void FindShortSuccessor(std::string* key) const = 0;
+
+  // 返回 true 表示 key 去掉末尾 *trailer 个字节后按字节序决定了顺序:
+  // 这部分的前 8 个字节（大端，不足时补 0）较小的 key 一定较小
+  // block 查找时先比较这 8 个字节，相等时才调用 Compare
+  // 默认返回 false
+  virtual bool HasNormalizedKeyPrefix(size_t* trailer) const { return false; }
+};
+
+// 返回按字节序比较的内置比较器，返回结果是单例，不能删除
+const Comparator* BytewiseComparator();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_COMPARATOR_H_
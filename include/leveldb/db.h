@@ -0,0 +1,98 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_DB_H_
+#define STORAGE_LEVELDB_INCLUDE_DB_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "leveldb/pinnable_slice.h"
+
+namespace leveldb {
+
+class WriteBatch;
+
+// 快照是数据库在某一时刻的只读视图，不会复制任何数据
+// 不再使用时必须调用 DB::ReleaseSnapshot 释放
+class Snapshot {
+ protected:
+  virtual ~Snapshot();
+};
+
+// DB 是从 key 到 value 的持久化有序映射
+// 多个线程可以同时访问同一个 DB，不需要外部同步
+class DB {
+ public:
+  // 打开名为 name 的数据库，成功时把堆上分配的 DB 存入 *dbptr，
+  // 不再使用时由调用者 delete
+  // 还不能重新打开已有的数据库: 目录中已经有 sstable 时返回 InvalidArgument
+  static Status Open(const Options& options, const std::string& name,
+                     DB** dbptr);
+
+  DB() = default;
+
+  DB(const DB&) = delete;
+  DB& operator=(const DB&) = delete;
+
+  virtual ~DB();
+
+  // 设置 key 的值为 value
+  virtual Status Put(const WriteOptions& options, const Slice& key,
+                     const Slice& value) = 0;
+
+  // 删除 key，key 不存在不算错误
+  virtual Status Delete(const WriteOptions& options, const Slice& key) = 0;
+
+  // 删除 [begin_key, end_key) 中的所有 key，只写入一条记录
+  virtual Status DeleteRange(const WriteOptions& options,
+                             const Slice& begin_key,
+                             const Slice& end_key) = 0;
+
+  // 原子地执行 updates 中的所有操作，只加一次锁，
+  // 操作使用连续的 sequence，读者要么全部看到，要么全部看不到
+  // 会修改 updates 中记录的 sequence
+  virtual Status Write(const WriteOptions& options, WriteBatch* updates) = 0;
+
+  // 找到 key 时把值存入 *value 并返回 OK
+  // 找不到时返回 IsNotFound() 为 true 的 Status
+  virtual Status Get(const ReadOptions& options, const Slice& key,
+                     std::string* value) = 0;
+
+  // 与上面的 Get 相同，但尽量不拷贝: *value 直接指向 memtable 或 data block
+  // 中的数据，并持有它们直到 value->Reset() 或 value 析构
+  virtual Status Get(const ReadOptions& options, const Slice& key,
+                     PinnableSlice* value) = 0;
+
+  // 在同一个快照上查找所有 keys，返回的第 i 个 Status 和 (*values)[i]
+  // 与对 keys[i] 调用 Get 的结果相同
+  // 需要读 sstable 时，同一个文件中的 data block 一起发出读请求
+  virtual std::vector<Status> MultiGet(const ReadOptions& options,
+                                       const std::vector<Slice>& keys,
+                                       std::vector<std::string>* values) = 0;
+
+  // 把离线生成的 sstable 直接加入数据库，不经过 memtable
+  // 文件用 TableBuilder 生成: options.comparator 与数据库相同，key 是 user key，
+  // 不能包含区间删除；使用 filter 时 filter_policy 也要与数据库相同
+  // 多个文件的 key 范围不能重叠；文件中的所有 key 使用同一个 sequence，
+  // 与已有数据重叠时这些 key 比已有的数据新
+  // 与 memtable 重叠时会先等待 memtable flush
+  virtual Status IngestExternalFile(
+      const std::vector<std::string>& files,
+      const IngestExternalFileOptions& options) = 0;
+
+  // 返回遍历数据库内容的迭代器（在堆上分配）
+  // 迭代器看到的是创建时（或者 options.snapshot）的快照，之后的写入不可见
+  // 迭代器必须在 DB 之前删除
+  virtual Iterator* NewIterator(const ReadOptions& options) = 0;
+
+  // 返回当前状态的快照，在 ReadOptions::snapshot 中使用
+  virtual const Snapshot* GetSnapshot() = 0;
+
+  // 释放快照，之后不能再使用它
+  virtual void ReleaseSnapshot(const Snapshot* snapshot) = 0;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_DB_H_
@@ -0,0 +1,135 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_ENV_H_
+#define STORAGE_LEVELDB_INCLUDE_ENV_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "leveldb/slice.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class RandomAccessFile;
+class WritableFile;
+
+// 创建文件时的选项
+struct EnvOptions {
+  EnvOptions() = default;
+
+  // 为 true 时用 direct I/O（O_DIRECT）写文件，不经过 page cache
+  // 文件系统不支持时退回普通的写
+  bool use_direct_writes = false;
+
+  // direct I/O 写文件时缓冲区的大小，缓冲区满了才写一次
+  size_t writable_file_max_buffer_size = 1024 * 1024;
+};
+
+// 数据库访问操作系统功能（文件、后台线程等）的接口
+// 用户可以提供自己的实现，比如把文件放在内存里做测试
+// 所有实现都必须是线程安全的
+class Env {
+ public:
+  Env();
+
+  Env(const Env&) = delete;
+  Env& operator=(const Env&) = delete;
+
+  virtual ~Env();
+
+  // 返回适合当前操作系统的默认 Env，属于 leveldb，不能删除
+  static Env* Default();
+
+  // 打开一个支持随机读的文件，成功时把新对象存入 *result，由调用者删除
+  // 文件不存在时返回非 OK 的 Status
+  virtual Status NewRandomAccessFile(const std::string& fname,
+                                     RandomAccessFile** result) = 0;
+
+  // 创建一个新的可写文件，已存在的同名文件会被清空
+  // 成功时把新对象存入 *result，由调用者删除
+  virtual Status NewWritableFile(const std::string& fname,
+                                 WritableFile** result) = 0;
+
+  // 同上，按 options 创建；默认实现忽略 options
+  virtual Status NewWritableFile(const std::string& fname,
+                                 const EnvOptions& options,
+                                 WritableFile** result);
+
+  virtual bool FileExists(const std::string& fname) = 0;
+
+  // 把 dir 下的文件名（不含路径）存入 *result
+  virtual Status GetChildren(const std::string& dir,
+                             std::vector<std::string>* result) = 0;
+
+  virtual Status RemoveFile(const std::string& fname) = 0;
+
+  // 为 src 创建硬链接 target，两者必须在同一个文件系统中
+  virtual Status LinkFile(const std::string& src, const std::string& target) = 0;
+
+  // 目录已存在不算错误
+  virtual Status CreateDir(const std::string& dirname) = 0;
+
+  virtual Status GetFileSize(const std::string& fname, uint64_t* file_size) = 0;
+
+  // 在后台线程中执行一次 (*function)(arg)
+  // 任务按提交顺序在同一个后台线程中串行执行
+  virtual void Schedule(void (*function)(void* arg), void* arg) = 0;
+
+  // 启动一个新线程执行 (*function)(arg)，函数返回时线程结束
+  virtual void StartThread(void (*function)(void* arg), void* arg) = 0;
+};
+
+// RandomAccessFile::MultiRead 中的一个读请求
+struct ReadRequest {
+  // 由调用者填写
+  uint64_t offset = 0;
+  size_t len = 0;
+  char* scratch = nullptr;  // 至少 len 字节
+
+  // 由 MultiRead 填写，含义与 Read 的 *result 和返回值相同
+  Slice result;
+  Status status;
+};
+
+// 支持随机读的文件
+class RandomAccessFile {
+ public:
+  RandomAccessFile() = default;
+
+  RandomAccessFile(const RandomAccessFile&) = delete;
+  RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+  virtual ~RandomAccessFile();
+
+  // 从 offset 开始读最多 n 个字节，*result 指向读到的数据，
+  // 数据可能放在 scratch[0..n-1] 中，scratch 在 *result 使用期间必须有效
+  // 可以被多个线程同时调用
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const = 0;
+
+  // 同时发出 reqs[0..n-1] 的读请求，全部完成后返回
+  // 每个请求的结果放在各自的 result 和 status 中；返回值只表示请求是否发出
+  // 默认实现依次调用 Read
+  virtual Status MultiRead(ReadRequest* reqs, size_t n) const;
+};
+
+// 顺序写的文件，实现应当自己做缓冲，调用者会写很多小块的数据
+// 不要求线程安全
+class WritableFile {
+ public:
+  WritableFile() = default;
+
+  WritableFile(const WritableFile&) = delete;
+  WritableFile& operator=(const WritableFile&) = delete;
+
+  virtual ~WritableFile();
+
+  virtual Status Append(const Slice& data) = 0;
+  virtual Status Close() = 0;
+  virtual Status Flush() = 0;
+  virtual Status Sync() = 0;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_ENV_H_
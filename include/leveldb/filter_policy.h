@@ -0,0 +1,34 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_FILTER_POLICY_H_
+#define STORAGE_LEVELDB_INCLUDE_FILTER_POLICY_H_
+
+#include <string>
+
+namespace leveldb {
+
+class Slice;
+
+// sstable 中 filter block 的生成与查询策略
+// 设置了 prefix_extractor 时，传进来的 key 是 key 的前缀
+class FilterPolicy {
+ public:
+  virtual ~FilterPolicy();
+
+  // 名字会被写入 sstable，filter 的编码方式变化时必须换名字
+  virtual const char* Name() const = 0;
+
+  // keys[0,n-1] 是一组 key（可能有重复），生成对应的 filter 追加到 *dst
+  virtual void CreateFilter(const Slice* keys, int n,
+                            std::string* dst) const = 0;
+
+  // filter 是 CreateFilter 生成的内容
+  // 如果 key 在生成 filter 的 key 中，必须返回 true，否则应尽量返回 false
+  virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const = 0;
+};
+
+// 返回每个 key 大约使用 bits_per_key 位的 bloom filter 策略
+// bits_per_key 取 10 时误判率约为 1%
+const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_FILTER_POLICY_H_
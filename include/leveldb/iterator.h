@@ -0,0 +1,74 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_ITERATOR_H_
+#define STORAGE_LEVELDB_INCLUDE_ITERATOR_H_
+
+#include "leveldb/slice.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+// 对一组有序 key/value 的遍历接口
+// 多个线程可以同时调用 const 方法，非 const 方法需要外部同步
+class Iterator {
+ public:
+  Iterator();
+
+  Iterator(const Iterator&) = delete;
+  Iterator& operator=(const Iterator&) = delete;
+
+  virtual ~Iterator();
+
+  // 迭代器位于某个 key/value 上时返回 true
+  virtual bool Valid() const = 0;
+
+  virtual void SeekToFirst() = 0;
+
+  virtual void SeekToLast() = 0;
+
+  // 定位到第一个 >= target 的 key
+  virtual void Seek(const Slice& target) = 0;
+
+  // 要求: Valid()
+  virtual void Next() = 0;
+
+  // 要求: Valid()
+  virtual void Prev() = 0;
+
+  // 返回的 Slice 只在下一次修改迭代器之前有效
+  // 要求: Valid()
+  virtual Slice key() const = 0;
+
+  // 要求: Valid()
+  virtual Slice value() const = 0;
+
+  virtual Status status() const = 0;
+
+  // 迭代器析构时会调用 function(arg1, arg2)
+  using CleanupFunction = void (*)(void* arg1, void* arg2);
+  void RegisterCleanup(CleanupFunction function, void* arg1, void* arg2);
+
+ private:
+  // cleanup 函数组成的单链表，头结点直接放在迭代器里
+  struct CleanupNode {
+    bool IsEmpty() const { return function == nullptr; }
+    void Run() {
+      assert(function != nullptr);
+      (*function)(arg1, arg2);
+    }
+
+    CleanupFunction function;
+    void* arg1;
+    void* arg2;
+    CleanupNode* next;
+  };
+  CleanupNode cleanup_head_;
+};
+
+// 返回一个空的迭代器
+Iterator* NewEmptyIterator();
+
+// 返回一个带有错误状态的空迭代器
+Iterator* NewErrorIterator(const Status& status);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_ITERATOR_H_
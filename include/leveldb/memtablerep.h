@@ -0,0 +1,54 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_MEMTABLEREP_H_
+#define STORAGE_LEVELDB_INCLUDE_MEMTABLEREP_H_
+
+#include <cstddef>
+
+namespace leveldb {
+
+class Arena;
+class MemTableRep;
+class SliceTransform;
+struct MemTableKeyComparator;
+
+// 创建 memtable 底层存储结构（MemTableRep）的工厂
+// 每个新的 memtable 都会调用一次 CreateMemTableRep
+class MemTableRepFactory {
+ public:
+  virtual ~MemTableRepFactory();
+
+  // rep 的节点内存从 arena 分配；prefix_extractor 为 Options::prefix_extractor
+  virtual MemTableRep* CreateMemTableRep(const MemTableKeyComparator& cmp,
+                                         Arena* arena,
+                                         const SliceTransform* prefix_extractor)
+      const = 0;
+
+  virtual const char* Name() const = 0;
+};
+
+// 默认的跳表实现，所有操作 O(log n)，支持全序遍历
+// memtable 变成只读后冻结成按 Eytzinger 顺序排列的数组，点查和 Seek 更快
+// 节点高度每增加一层的概率为 1/branching，最高 max_height 层（不超过 32），
+// 大约可以容纳 branching^max_height 个 entry，超过之后查找逐渐退化
+MemTableRepFactory* NewSkipListRepFactory(int max_height = 12,
+                                          int branching = 4);
+
+// 根据 memtable 预计的 entry 个数选择跳表的高度:
+// 大的 memtable（上千万个小 entry）保持 O(log n) 的查找，小的不浪费空层
+MemTableRepFactory* NewAdaptiveSkipListRepFactory(size_t expected_entries);
+
+// 按 key 前缀分桶的哈希表，每个桶是一个跳表
+// 点查只需要在前缀对应的桶内查找，适合点查为主的负载
+// 要求设置 Options::prefix_extractor，否则所有 key 都落在同一个桶里
+// 带 prefix_same_as_start 的遍历只访问一个桶；全序遍历需要先把所有桶排序，代价较高
+// 每个 memtable 的桶数组（每个桶 8 字节）从 memtable 的内存中分配，
+// 计入 memtable 的固定开销，不能接近 Options::write_buffer_size
+MemTableRepFactory* NewHashSkipListRepFactory(size_t bucket_count = 1000);
+
+// 批量导入用的 rep: 写入只是追加到数组末尾，memtable 变成只读时并行排序一次
+// 变成只读之前的读操作需要扫描整个数组，只适合导入期间没有读的场景
+// reserved_count 为预留的 entry 个数
+MemTableRepFactory* NewVectorRepFactory(size_t reserved_count = 0);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_MEMTABLEREP_H_
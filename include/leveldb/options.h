@@ -0,0 +1,150 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
+#define STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace leveldb {
+
+class Comparator;
+class Env;
+class FilterPolicy;
+class MemTableRepFactory;
+class RateLimiter;
+class Slice;
+class SliceTransform;
+class Snapshot;
+
+// block 的压缩方式，数值会写入 sstable，不能修改
+// 当前编译的版本不支持的压缩方式按 kNoCompression 处理
+enum CompressionType {
+  kNoCompression = 0x0,
+  kSnappyCompression = 0x1,
+  kZstdCompression = 0x2,
+  kLZ4Compression = 0x3
+};
+
+// 控制数据库行为的选项，传给 DB::Open
+struct Options {
+  // 默认值见各字段
+  Options();
+
+  // 决定 key 顺序的比较器，默认按字节序比较
+  // 打开同一个数据库时必须使用同名的比较器
+  const Comparator* comparator;
+
+  // 访问文件和启动后台线程使用的 Env，默认为 Env::Default()
+  Env* env;
+
+  // 不为 nullptr 时，用它从 user key 中提取前缀:
+  // memtable 维护前缀 bloom，sstable 的 filter 也按前缀生成，
+  // 配合 ReadOptions::prefix_same_as_start 可以跳过不含该前缀的数据
+  const SliceTransform* prefix_extractor = nullptr;
+
+  // 不为 nullptr 时，sstable 使用这个策略生成 filter block
+  const FilterPolicy* filter_policy = nullptr;
+
+  // memtable 中写入的数据超过这个值（字节）之后转为只读，新的写入进入新的
+  // memtable；不包括 memtable 的固定开销（前缀 bloom、哈希桶等），
+  // 固定开销不小于这个值时 DB::Open 返回 InvalidArgument
+  size_t write_buffer_size = 4 * 1024 * 1024;
+
+  // 内存中最多保留的 memtable 个数（包括正在写入的），
+  // 只读的 memtable 来不及 flush 时写操作会等待
+  int max_write_buffer_number = 2;
+
+  // flush 一个 memtable 时最多切分成几段，每段在单独的线程中生成一个 sstable
+  // memtable 小于 1MB 时不切分
+  int flush_parallelism = 4;
+
+  // 为 true 时 flush（以及以后的 compaction）用 direct I/O 写 sstable，
+  // 数据不经过 page cache，避免后台写入把读操作需要的热数据挤出去
+  bool use_direct_io_for_flush_and_compaction = false;
+
+  // 使用 direct I/O 时每个文件的写缓冲区大小，缓冲区满了才写一次
+  size_t writable_file_max_buffer_size = 1024 * 1024;
+
+  // 不为 nullptr 时，后台写文件（flush 以及以后的 compaction）都要先向它申请配额，
+  // 限制后台写入占用的磁盘带宽；flush 使用 IO_HIGH 优先级
+  // 可以被多个数据库共享，由调用者释放
+  RateLimiter* rate_limiter = nullptr;
+
+  // 每个 data block 中用户数据（未压缩）的大概大小
+  size_t block_size = 4 * 1024;
+
+  // block 中每隔多少个 key 记录一个重启点，大多数情况下不需要修改
+  int block_restart_interval = 16;
+
+  // block 的压缩方式，压缩后缩小不到 1/8 的 block 不压缩
+  CompressionType compression = kLZ4Compression;
+
+  // 非空时第 i 层的 sstable 使用 compression_per_level[i]，超出的层使用
+  // 最后一项，compression 不再生效；比如 {kNoCompression, kLZ4Compression,
+  // kZstdCompression} 让上层写得快、最底层省空间
+  // flush 生成的 sstable 属于第 0 层
+  std::vector<CompressionType> compression_per_level;
+
+  // 使用 kZstdCompression 时，每个 sstable 先缓存前 zstd_max_train_bytes 字节的
+  // data block，用它们训练一个不超过 zstd_max_dict_bytes 的字典，保存在文件中，
+  // 压缩和解压这个文件的 data block 时都使用它
+  // 大量小而相似的 value（比如 JSON）单个 block 压缩效果很差，字典可以明显改善
+  // zstd_max_dict_bytes 为 0 表示不使用字典
+  uint32_t zstd_max_dict_bytes = 16 * 1024;
+  uint32_t zstd_max_train_bytes = 1024 * 1024;
+
+  // 创建 memtable 存储结构的工厂，nullptr 表示使用默认的跳表
+  // 点查为主的负载可以使用 NewHashSkipListRepFactory()
+  MemTableRepFactory* memtable_factory = nullptr;
+
+  // memtable 前缀 bloom 的大小（位），0 表示不使用
+  // 只有设置了 prefix_extractor 时才生效
+  size_t memtable_prefix_bloom_bits = 1 << 20;
+};
+
+// 控制读操作的选项
+struct ReadOptions {
+  ReadOptions() = default;
+
+  // 为 true 时检查从 sstable 读到的每个 block 的 crc
+  bool verify_checksums = false;
+
+  // 不为 nullptr 时，在这个快照（必须属于正在读的数据库）上读；
+  // 为 nullptr 时，在读操作开始时隐式取一个快照
+  const Snapshot* snapshot = nullptr;
+
+  // 不为 nullptr 时，迭代器遇到 >= *iterate_upper_bound 的 key 就停止
+  // Slice 指向的内容在迭代器存活期间必须保持有效
+  const Slice* iterate_upper_bound = nullptr;
+
+  // 为 true 且设置了 Options::prefix_extractor 时，Seek 之后迭代器只返回与
+  // target 前缀相同的 key，离开这个前缀就变为 !Valid()
+  // 此时不含该前缀的 memtable 会被前缀 bloom 直接跳过
+  bool prefix_same_as_start = false;
+
+  // 迭代器顺序读取 sstable 时每次预读的字节数，预读的范围切成多个请求
+  // 通过一次 RandomAccessFile::MultiRead 同时发出
+  // 为 0 时在连续读到相邻的 data block 后自动预读，大小逐步增加到 256KB
+  size_t readahead_size = 0;
+};
+
+// 控制写操作的选项
+struct WriteOptions {
+  WriteOptions() = default;
+
+  // 是否在写完成前把数据刷到磁盘
+  bool sync = false;
+};
+
+// 控制 DB::IngestExternalFile 的选项
+struct IngestExternalFileOptions {
+  IngestExternalFileOptions() = default;
+
+  // 为 true 时导入成功后删除原来的文件
+  // 无论是否为 true，文件都会先硬链接（跨文件系统时复制）到数据库目录中
+  bool move_files = false;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
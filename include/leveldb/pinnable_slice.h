@@ -0,0 +1,73 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_PINNABLE_SLICE_H_
+#define STORAGE_LEVELDB_INCLUDE_PINNABLE_SLICE_H_
+
+#include <cassert>
+#include <string>
+
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+// 可以直接指向数据库内部内存（memtable 的 entry 或者 sstable 的 block）的 Slice，
+// 读比较大的 value 时不用拷贝
+// pin 住内部内存时持有它的引用，Reset() 或析构时释放；
+// 不能直接指向时把数据拷贝到自己的缓冲区
+class PinnableSlice : public Slice {
+ public:
+  using CleanupFunction = void (*)(void* arg1, void* arg2);
+
+  PinnableSlice() : buf_(&self_space_) {}
+
+  // 需要拷贝时拷贝到 *buf 而不是内部的缓冲区
+  explicit PinnableSlice(std::string* buf) : buf_(buf) {}
+
+  PinnableSlice(const PinnableSlice&) = delete;
+  PinnableSlice& operator=(const PinnableSlice&) = delete;
+
+  ~PinnableSlice() { Reset(); }
+
+  // 指向 s，Reset() 或析构时调用 (*function)(arg1, arg2) 释放 s 的内存
+  void PinSlice(const Slice& s, CleanupFunction function, void* arg1,
+                void* arg2) {
+    assert(function != nullptr);
+    Reset();
+    pinned_ = true;
+    function_ = function;
+    arg1_ = arg1;
+    arg2_ = arg2;
+    SetSlice(s);
+  }
+
+  // 把 s 拷贝到缓冲区并指向它
+  void PinSelf(const Slice& s) {
+    Reset();
+    buf_->assign(s.data(), s.size());
+    SetSlice(*buf_);
+  }
+
+  // 释放 pin 住的内存，变为空
+  void Reset() {
+    if (pinned_) {
+      pinned_ = false;
+      (*function_)(arg1_, arg2_);
+    }
+    SetSlice(Slice());
+  }
+
+  // 是否指向数据库内部的内存
+  bool IsPinned() const { return pinned_; }
+
+ private:
+  void SetSlice(const Slice& s) { *static_cast<Slice*>(this) = s; }
+
+  std::string self_space_;
+  std::string* const buf_;
+  bool pinned_ = false;
+  CleanupFunction function_ = nullptr;
+  void* arg1_ = nullptr;
+  void* arg2_ = nullptr;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_PINNABLE_SLICE_H_
@@ -0,0 +1,50 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+
+#include <cstdint>
+
+namespace leveldb {
+
+// 限制后台写文件的速度，避免 flush 和 compaction 占满磁盘带宽拖慢前台读
+// 后台线程每次写文件之前申请配额，配额不足时等待
+// 可以被多个数据库共享，实现必须是线程安全的
+class RateLimiter {
+ public:
+  enum IOPriority {
+    IO_LOW = 0,   // compaction
+    IO_HIGH = 1,  // flush，memtable 堆积会让写操作停顿，优先满足
+    IO_TOTAL = 2
+  };
+
+  virtual ~RateLimiter();
+
+  // 修改每秒允许写的字节数，bytes_per_second 必须大于 0
+  virtual void SetBytesPerSecond(int64_t bytes_per_second) = 0;
+  virtual int64_t GetBytesPerSecond() const = 0;
+
+  // 申请写 bytes 字节，配额不足时等待
+  // 要求: bytes <= GetSingleBurstBytes()
+  virtual void Request(int64_t bytes, IOPriority pri) = 0;
+
+  // 一次 Request 最多可以申请的字节数
+  virtual int64_t GetSingleBurstBytes() const = 0;
+
+  // 通过这个限速器的总字节数，pri 为 IO_TOTAL 时不区分优先级
+  virtual int64_t GetTotalBytesThrough(IOPriority pri = IO_TOTAL) const = 0;
+};
+
+// 令牌桶实现，每 refill_period_us 微秒补充一次配额
+// rate_bytes_per_sec: 每秒最多写的字节数，auto_tuned 时为上限
+// fairness: 每 fairness 次补充中有一次先满足低优先级的请求，避免它一直等待
+// auto_tuned: 为 true 时根据后台写入的积压程度在
+//   [rate_bytes_per_sec / 20, rate_bytes_per_sec] 之间自动调整速度:
+//   配额经常被用完说明后台写入有积压，提高速度；很少用完时降低速度，
+//   把带宽留给前台读
+RateLimiter* NewGenericRateLimiter(int64_t rate_bytes_per_sec,
+                                   int64_t refill_period_us = 100 * 1000,
+                                   int32_t fairness = 10,
+                                   bool auto_tuned = false);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
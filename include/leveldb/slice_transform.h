@@ -0,0 +1,33 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+#define STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+// 从 key 中提取前缀，用于前缀 bloom 过滤和前缀遍历
+// 要求: 对任意在 domain 中的 a <= b，Transform(a) <= Transform(b)
+// 实现必须是线程安全的
+class SliceTransform {
+ public:
+  virtual ~SliceTransform();
+
+  // 名字会被记录下来，修改提取规则时必须换一个名字
+  virtual const char* Name() const = 0;
+
+  // 返回 key 的前缀，要求: InDomain(key)
+  virtual Slice Transform(const Slice& key) const = 0;
+
+  // key 能否提取前缀，不在 domain 中的 key 不参与前缀过滤
+  virtual bool InDomain(const Slice& key) const = 0;
+};
+
+// 取前 prefix_len 个字节，长度不足的 key 不在 domain 中
+const SliceTransform* NewFixedPrefixTransform(size_t prefix_len);
+
+// 取前 cap_len 个字节，长度不足时取整个 key
+const SliceTransform* NewCappedPrefixTransform(size_t cap_len);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
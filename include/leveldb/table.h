@@ -0,0 +1,89 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_TABLE_H_
+#define STORAGE_LEVELDB_INCLUDE_TABLE_H_
+
+#include <cstdint>
+
+#include "leveldb/iterator.h"
+
+namespace leveldb {
+
+class Block;
+class BlockHandle;
+class BlockReadahead;
+class Footer;
+struct Options;
+class RandomAccessFile;
+struct ReadOptions;
+
+// sstable 是从 key 到 value 的有序映射，构造后不可修改
+// 多个线程可以同时访问，不需要外部同步
+class Table {
+ public:
+  // 打开 file 中长度为 file_size 的 sstable，成功时把 Table 存入 *table
+  // 返回的 Table 由调用者删除
+  // 调用者要保证 file 在 Table 存活期间有效，Table 不会删除 file
+  static Status Open(const Options& options, RandomAccessFile* file,
+                     uint64_t file_size, Table** table);
+
+  Table(const Table&) = delete;
+  Table& operator=(const Table&) = delete;
+
+  ~Table();
+
+  // 返回遍历 sstable 内容的迭代器，初始状态为 !Valid()
+  Iterator* NewIterator(const ReadOptions&) const;
+
+  // 返回遍历区间删除的迭代器，key() 为 start 的 internal key，value() 为 end
+  // 没有区间删除时返回 nullptr
+  Iterator* NewRangeTombstoneIterator() const;
+
+  // 第一个 >= key 的 entry 所在 data block 的 filter 表明 key 一定不存在时
+  // 返回 false，不读取 data block；没有 filter 时返回 true
+  bool BlockMayMatch(const Slice& key) const;
+
+ private:
+  friend class Version;
+  struct Rep;
+
+  struct IteratorState;
+
+  // 把 index block 中的 value（data block 的句柄）转换成遍历 data block 的
+  // 迭代器，readahead 不为 nullptr 时通过它读取
+  Iterator* BlockReader(const ReadOptions&, const Slice& index_value,
+                        BlockReadahead* readahead) const;
+  // NewIterator 的 block 函数，arg 为 IteratorState
+  static Iterator* IteratorBlockReader(void* arg, const ReadOptions&,
+                                       const Slice& index_value);
+
+  explicit Table(Rep* rep) : rep_(rep) {}
+
+  // 找到第一个 >= key 的 entry 时调用 (*handle_result)(arg, k, v, &block_iter)
+  // filter 表明 key 一定不存在时不调用
+  // handle_result 可以接管 block_iter（并把它置为 nullptr），k 和 v 在它被删除
+  // 之前一直有效；block_iter 为 nullptr 时不能接管
+  using ResultHandler = void (*)(void* arg, const Slice& k, const Slice& v,
+                                 Iterator** block_iter);
+  Status InternalGet(const ReadOptions&, const Slice& key, void* arg,
+                     ResultHandler handle_result);
+
+  // 对每个 keys[i] 做 InternalGet(options, keys[i], args[i], handle_result)，
+  // 但需要读的 data block 通过一次 RandomAccessFile::MultiRead 同时读取
+  // keys 按顺序排列时落在同一个 block 的 key 只读一次
+  // 不能接管 block_iter
+  Status InternalMultiGet(const ReadOptions&, const Slice* keys,
+                          void* const* args, size_t n,
+                          ResultHandler handle_result);
+
+  // 读取 meta block，区间删除或压缩字典读不出来时返回错误
+  // filter 只影响性能，读不出来时忽略
+  Status ReadMeta(const Footer& footer);
+  void ReadFilter(const Slice& filter_handle_value);
+  Status ReadRangeDel(const Slice& range_del_handle_value);
+  Status ReadCompressionDict(const Slice& dict_handle_value);
+
+  Rep* const rep_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_TABLE_H_
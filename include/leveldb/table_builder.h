@@ -0,0 +1,74 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_TABLE_BUILDER_H_
+#define STORAGE_LEVELDB_INCLUDE_TABLE_BUILDER_H_
+
+#include <cstdint>
+
+#include "leveldb/options.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class BlockBuilder;
+class BlockHandle;
+class CompressionDict;
+class WritableFile;
+
+// 生成 sstable，sstable 是从 key 到 value 的有序、不可修改的持久化映射
+//
+// 多个线程可以同时调用 const 方法；调用非 const 方法时需要外部同步
+class TableBuilder {
+ public:
+  // 把 sstable 写入 file，调用者负责在 Finish() 之后关闭 file
+  TableBuilder(const Options& options, WritableFile* file);
+
+  TableBuilder(const TableBuilder&) = delete;
+  TableBuilder& operator=(const TableBuilder&) = delete;
+
+  // 要求: 已经调用过 Finish() 或 Abandon()
+  ~TableBuilder();
+
+  // 添加一条 key,value
+  // 要求: 按 comparator 的顺序 key 大于之前添加的所有 key
+  // 要求: 没有调用过 Finish() 和 Abandon()
+  void Add(const Slice& key, const Slice& value);
+
+  // 添加一条区间删除，key 为 start 的 internal key，value 为 end
+  // 区间删除单独存放在 "rangedel" meta block 中，与 Add 的 key 互不影响
+  // 要求: key 大于之前添加的所有区间删除的 key
+  // 要求: 没有调用过 Finish() 和 Abandon()
+  void AddRangeTombstone(const Slice& key, const Slice& value);
+
+  // 把缓冲的 entry 写成一个 data block，通常不需要直接调用
+  void Flush();
+
+  // 出错时返回非 OK
+  Status status() const;
+
+  // 写完 sstable，之后不能再使用 file
+  Status Finish();
+
+  // 放弃已经写入的内容，之后不能再使用 file
+  void Abandon();
+
+  // 已经添加的 entry 个数
+  uint64_t NumEntries() const;
+
+  // 已经生成的文件大小，Finish() 之后为最终的文件大小
+  uint64_t FileSize() const;
+
+ private:
+  bool ok() const { return status().ok(); }
+  void WriteBlock(BlockBuilder* block, BlockHandle* handle);
+  void WriteDataBlock(const Slice& raw);
+  void CompressAndWriteBlock(const Slice& raw, const CompressionDict* dict,
+                             BlockHandle* handle);
+  void EnterUnbuffered();
+  void WriteRawBlock(const Slice& data, CompressionType, BlockHandle* handle);
+
+  struct Rep;
+  Rep* rep_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_TABLE_BUILDER_H_
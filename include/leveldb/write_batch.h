@@ -0,0 +1,70 @@
+#ifndef STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_H_
+#define STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_H_
+
+#include <string>
+
+#include "leveldb/slice.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+// 一组按顺序执行的写操作，由 DB::Write 原子地写入:
+// 所有操作使用连续的 sequence，读者要么全部看到，要么全部看不到
+//
+// 所有操作依次序列化到同一块连续的内存中，Put 时就拷贝好 key 和 value，
+// 写入时按顺序遍历一次，直接拷贝进 memtable
+//
+// 多个线程可以同时调用 const 方法；调用非 const 方法需要外部同步
+class WriteBatch {
+ public:
+  // 遍历 batch 中的操作
+  class Handler {
+   public:
+    virtual ~Handler();
+    virtual void Put(const Slice& key, const Slice& value) = 0;
+    virtual void Delete(const Slice& key) = 0;
+    virtual void DeleteRange(const Slice& begin_key, const Slice& end_key) = 0;
+  };
+
+  WriteBatch();
+
+  // 支持拷贝
+  WriteBatch(const WriteBatch&) = default;
+  WriteBatch& operator=(const WriteBatch&) = default;
+
+  ~WriteBatch();
+
+  // 设置 key 的值为 value
+  void Put(const Slice& key, const Slice& value);
+
+  // 删除 key
+  void Delete(const Slice& key);
+
+  // 删除 [begin_key, end_key) 中的所有 key
+  // begin_key 在 end_key 之后时 DB::Write 返回 InvalidArgument
+  void DeleteRange(const Slice& begin_key, const Slice& end_key);
+
+  // 清空所有操作
+  void Clear();
+
+  // 序列化后的大小，可以用来控制 batch 的大小
+  size_t ApproximateSize() const;
+
+  // 操作的个数
+  int Count() const;
+
+  // 把 source 中的操作追加到这个 batch 的末尾
+  void Append(const WriteBatch& source);
+
+  // 按顺序对每个操作调用 handler，格式错误时返回 Corruption
+  Status Iterate(Handler* handler) const;
+
+ private:
+  friend class WriteBatchInternal;
+
+  std::string rep_;  // 格式见 write_batch.cc 中的注释
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_H_
@@ -0,0 +1,300 @@
+#include "table/block.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "leveldb/comparator.h"
+#include "table/format.h"
+#include "util/coding.h"
+#include "util/ordered_coding.h"
+
+namespace leveldb {
+
+inline uint32_t Block::NumRestarts() const {
+  assert(size_ >= sizeof(uint32_t));
+  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+}
+
+Block::Block(const BlockContents& contents)
+    : data_(contents.data.data()),
+      size_(contents.data.size()),
+      owned_(contents.heap_allocated) {
+  if (size_ < sizeof(uint32_t)) {
+    size_ = 0;  // 出错
+  } else {
+    size_t max_restarts_allowed = (size_ - sizeof(uint32_t)) / sizeof(uint32_t);
+    if (NumRestarts() > max_restarts_allowed) {
+      // 剩下的空间放不下这么多重启点
+      size_ = 0;
+    } else {
+      restart_offset_ = size_ - (1 + NumRestarts()) * sizeof(uint32_t);
+    }
+  }
+}
+
+Block::~Block() {
+  if (owned_) {
+    delete[] data_;
+  }
+}
+
+// 解析从 p 开始的 entry，把共享前缀长度、不共享的长度和 value 长度
+// 分别存入 *shared、*non_shared、*value_length，不会读到 limit 之后
+//
+// 出错时返回 nullptr，否则返回 key_delta 的位置
+static inline const char* DecodeEntry(const char* p, const char* limit,
+                                      uint32_t* shared, uint32_t* non_shared,
+                                      uint32_t* value_length) {
+  if (limit - p < 3) return nullptr;
+  *shared = reinterpret_cast<const uint8_t*>(p)[0];
+  *non_shared = reinterpret_cast<const uint8_t*>(p)[1];
+  *value_length = reinterpret_cast<const uint8_t*>(p)[2];
+  if ((*shared | *non_shared | *value_length) < 128) {
+    // 三个值都只占一个字节
+    p += 3;
+  } else {
+    if ((p = GetVarint32Ptr(p, limit, shared)) == nullptr) return nullptr;
+    if ((p = GetVarint32Ptr(p, limit, non_shared)) == nullptr) return nullptr;
+    if ((p = GetVarint32Ptr(p, limit, value_length)) == nullptr) return nullptr;
+  }
+
+  if (static_cast<uint32_t>(limit - p) < (*non_shared + *value_length)) {
+    return nullptr;
+  }
+  return p;
+}
+
+class Block::Iter : public Iterator {
+ private:
+  const Comparator* const comparator_;
+  // 为 true 时先用去掉末尾 trailer_ 个字节后的 8 字节前缀比较，见
+  // Comparator::HasNormalizedKeyPrefix
+  bool use_prefix_;
+  size_t trailer_;
+  const char* const data_;       // block 的内容
+  uint32_t const restarts_;      // 重启点数组的偏移
+  uint32_t const num_restarts_;  // 重启点的个数
+
+  // current_ 是当前 entry 在 data_ 中的偏移，>= restarts_ 表示 !Valid
+  uint32_t current_;
+  uint32_t restart_index_;  // current_ 所在的重启区间
+  std::string key_;
+  Slice value_;
+  Status status_;
+
+  inline int Compare(const Slice& a, const Slice& b) const {
+    return comparator_->Compare(a, b);
+  }
+
+  inline uint64_t Prefix(const Slice& key) const {
+    const size_t n = key.size() > trailer_ ? key.size() - trailer_ : 0;
+    return NormalizedKeyPrefix(key.data(), n);
+  }
+
+  // 与 Compare(key, target) 的符号相同，target_prefix 为 Prefix(target)
+  inline int CompareToTarget(const Slice& key, const Slice& target,
+                             uint64_t target_prefix) const {
+    if (use_prefix_) {
+      const uint64_t prefix = Prefix(key);
+      if (prefix != target_prefix) {
+        return prefix < target_prefix ? -1 : +1;
+      }
+    }
+    return Compare(key, target);
+  }
+
+  // 返回下一个 entry 的偏移
+  inline uint32_t NextEntryOffset() const {
+    return (value_.data() + value_.size()) - data_;
+  }
+
+  uint32_t GetRestartPoint(uint32_t index) {
+    assert(index < num_restarts_);
+    return DecodeFixed32(data_ + restarts_ + index * sizeof(uint32_t));
+  }
+
+  void SeekToRestartPoint(uint32_t index) {
+    key_.clear();
+    restart_index_ = index;
+    // current_ 由 ParseNextKey() 修正
+
+    // ParseNextKey() 从 value_ 的末尾开始解析，这里设置好 value_
+    uint32_t offset = GetRestartPoint(index);
+    value_ = Slice(data_ + offset, 0);
+  }
+
+ public:
+  Iter(const Comparator* comparator, const char* data, uint32_t restarts,
+       uint32_t num_restarts)
+      : comparator_(comparator),
+        trailer_(0),
+        data_(data),
+        restarts_(restarts),
+        num_restarts_(num_restarts),
+        current_(restarts_),
+        restart_index_(num_restarts_) {
+    assert(num_restarts_ > 0);
+    use_prefix_ = comparator_->HasNormalizedKeyPrefix(&trailer_);
+  }
+
+  bool Valid() const override { return current_ < restarts_; }
+  Status status() const override { return status_; }
+  Slice key() const override {
+    assert(Valid());
+    return key_;
+  }
+  Slice value() const override {
+    assert(Valid());
+    return value_;
+  }
+
+  void Next() override {
+    assert(Valid());
+    ParseNextKey();
+  }
+
+  void Prev() override {
+    assert(Valid());
+
+    // 向前找到位于 current_ 之前的重启点
+    const uint32_t original = current_;
+    while (GetRestartPoint(restart_index_) >= original) {
+      if (restart_index_ == 0) {
+        // 已经没有更前面的 entry
+        current_ = restarts_;
+        restart_index_ = num_restarts_;
+        return;
+      }
+      restart_index_--;
+    }
+
+    SeekToRestartPoint(restart_index_);
+    do {
+      // 一直前进到 original 之前的那个 entry
+    } while (ParseNextKey() && NextEntryOffset() < original);
+  }
+
+  void Seek(const Slice& target) override {
+    // 在重启点数组中二分，找到最后一个 key < target 的重启点
+    uint32_t left = 0;
+    uint32_t right = num_restarts_ - 1;
+    int current_key_compare = 0;
+    const uint64_t target_prefix = use_prefix_ ? Prefix(target) : 0;
+
+    if (Valid()) {
+      // 已经定位过，用当前 key 缩小查找范围
+      current_key_compare = CompareToTarget(key_, target, target_prefix);
+      if (current_key_compare < 0) {
+        // key_ 比 target 小，从当前位置开始找
+        left = restart_index_;
+      } else if (current_key_compare > 0) {
+        right = restart_index_;
+      } else {
+        // 已经在 target 上
+        return;
+      }
+    }
+
+    while (left < right) {
+      uint32_t mid = (left + right + 1) / 2;
+      uint32_t region_offset = GetRestartPoint(mid);
+      uint32_t shared, non_shared, value_length;
+      const char* key_ptr =
+          DecodeEntry(data_ + region_offset, data_ + restarts_, &shared,
+                      &non_shared, &value_length);
+      if (key_ptr == nullptr || (shared != 0)) {
+        CorruptionError();
+        return;
+      }
+      Slice mid_key(key_ptr, non_shared);
+      if (CompareToTarget(mid_key, target, target_prefix) < 0) {
+        // mid 处的 key 小于 target，mid 之前的区间都不用再看
+        left = mid;
+      } else {
+        // mid 处的 key 大于等于 target，mid 及之后的区间都不用再看
+        right = mid - 1;
+      }
+    }
+
+    // 没有用上当前位置时，需要从 left 重启点开始解析
+    assert(current_key_compare == 0 || Valid());
+    bool skip_seek = left == restart_index_ && current_key_compare < 0;
+    if (!skip_seek) {
+      SeekToRestartPoint(left);
+    }
+    // 线性查找第一个 key >= target 的 entry
+    while (true) {
+      if (!ParseNextKey()) {
+        return;
+      }
+      if (CompareToTarget(key_, target, target_prefix) >= 0) {
+        return;
+      }
+    }
+  }
+
+  void SeekToFirst() override {
+    SeekToRestartPoint(0);
+    ParseNextKey();
+  }
+
+  void SeekToLast() override {
+    SeekToRestartPoint(num_restarts_ - 1);
+    while (ParseNextKey() && NextEntryOffset() < restarts_) {
+      // 一直前进到最后一个 entry
+    }
+  }
+
+ private:
+  void CorruptionError() {
+    current_ = restarts_;
+    restart_index_ = num_restarts_;
+    status_ = Status::Corruption("bad entry in block");
+    key_.clear();
+    value_.clear();
+  }
+
+  bool ParseNextKey() {
+    current_ = NextEntryOffset();
+    const char* p = data_ + current_;
+    const char* limit = data_ + restarts_;  // 重启点数组是 entry 的终点
+    if (p >= limit) {
+      // 没有更多 entry 了，标记为 !Valid
+      current_ = restarts_;
+      restart_index_ = num_restarts_;
+      return false;
+    }
+
+    // 解析下一个 entry
+    uint32_t shared, non_shared, value_length;
+    p = DecodeEntry(p, limit, &shared, &non_shared, &value_length);
+    if (p == nullptr || key_.size() < shared) {
+      CorruptionError();
+      return false;
+    } else {
+      key_.resize(shared);
+      key_.append(p, non_shared);
+      value_ = Slice(p + non_shared, value_length);
+      while (restart_index_ + 1 < num_restarts_ &&
+             GetRestartPoint(restart_index_ + 1) < current_) {
+        ++restart_index_;
+      }
+      return true;
+    }
+  }
+};
+
+Iterator* Block::NewIterator(const Comparator* comparator) {
+  if (size_ < sizeof(uint32_t)) {
+    return NewErrorIterator(Status::Corruption("bad block contents"));
+  }
+  const uint32_t num_restarts = NumRestarts();
+  if (num_restarts == 0) {
+    return NewEmptyIterator();
+  } else {
+    return new Iter(comparator, data_, restart_offset_, num_restarts);
+  }
+}
+
+}  // namespace leveldb
@@ -0,0 +1,49 @@
+#ifndef STORAGE_LEVELDB_TABLE_BLOCK_BUILDER_H_
+#define STORAGE_LEVELDB_TABLE_BLOCK_BUILDER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+struct Options;
+
+// 生成 block 的内容: key 按前缀压缩，每隔 block_restart_interval 个 key
+// 记录一个重启点（完整存放 key），查找时在重启点上二分
+class BlockBuilder {
+ public:
+  explicit BlockBuilder(const Options* options);
+
+  BlockBuilder(const BlockBuilder&) = delete;
+  BlockBuilder& operator=(const BlockBuilder&) = delete;
+
+  // 清空内容，就像刚构造出来一样
+  void Reset();
+
+  // 要求: 上次 Reset() 之后没有调用过 Finish()
+  // 要求: key 大于之前添加的所有 key
+  void Add(const Slice& key, const Slice& value);
+
+  // 结束构造，返回 block 的内容，在 builder 存活且没有 Reset() 之前有效
+  Slice Finish();
+
+  // 返回当前 block 大小（未压缩）的估计值
+  size_t CurrentSizeEstimate() const;
+
+  bool empty() const { return buffer_.empty(); }
+
+ private:
+  const Options* options_;
+  std::string buffer_;              // 目标缓冲区
+  std::vector<uint32_t> restarts_;  // 重启点
+  int counter_;                     // 上一个重启点之后的 entry 个数
+  bool finished_;                   // 是否已经调用过 Finish()
+  std::string last_key_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_TABLE_BLOCK_BUILDER_H_
@@ -0,0 +1,57 @@
+#ifndef STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
+#define STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+class FilterPolicy;
+
+// 生成 sstable 的 filter block
+// 每 2KB 的 data block 偏移范围对应一个 filter，内容按顺序存放在 filter block 中
+//
+// 调用顺序必须符合正则表达式 (StartBlock AddKey*)* Finish
+class FilterBlockBuilder {
+ public:
+  explicit FilterBlockBuilder(const FilterPolicy*);
+
+  FilterBlockBuilder(const FilterBlockBuilder&) = delete;
+  FilterBlockBuilder& operator=(const FilterBlockBuilder&) = delete;
+
+  void StartBlock(uint64_t block_offset);
+  void AddKey(const Slice& key);
+  Slice Finish();
+
+ private:
+  void GenerateFilter();
+
+  const FilterPolicy* policy_;
+  std::string keys_;             // 拼接在一起的 key
+  std::vector<size_t> start_;    // 每个 key 在 keys_ 中的起始位置
+  std::string result_;           // 已经生成的 filter
+  std::vector<Slice> tmp_keys_;  // CreateFilter() 的参数
+  std::vector<uint32_t> filter_offsets_;
+};
+
+class FilterBlockReader {
+ public:
+  // 要求: contents 和 policy 在 reader 存活期间必须有效
+  FilterBlockReader(const FilterPolicy* policy, const Slice& contents);
+  bool KeyMayMatch(uint64_t block_offset, const Slice& key);
+
+ private:
+  const FilterPolicy* policy_;
+  const char* data_;    // filter 数据的开头
+  const char* offset_;  // offset 数组的开头
+  size_t num_;          // offset 数组的元素个数
+  size_t base_lg_;      // 编码参数（见 .cc 中的 kFilterBaseLg）
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
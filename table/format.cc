@@ -0,0 +1,236 @@
+#include "table/format.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "leveldb/env.h"
+#include "leveldb/options.h"
+#include "util/coding.h"
+#include "util/compression.h"
+#include "util/crc32c.h"
+
+namespace leveldb {
+
+void BlockHandle::EncodeTo(std::string* dst) const {
+  // 确认所有字段都已经设置
+  assert(offset_ != ~static_cast<uint64_t>(0));
+  assert(size_ != ~static_cast<uint64_t>(0));
+  PutVarint64(dst, offset_);
+  PutVarint64(dst, size_);
+}
+
+Status BlockHandle::DecodeFrom(Slice* input) {
+  if (GetVarint64(input, &offset_) && GetVarint64(input, &size_)) {
+    return Status::OK();
+  } else {
+    return Status::Corruption("bad block handle");
+  }
+}
+
+void Footer::EncodeTo(std::string* dst) const {
+  const size_t original_size = dst->size();
+  metaindex_handle_.EncodeTo(dst);
+  index_handle_.EncodeTo(dst);
+  dst->resize(2 * BlockHandle::kMaxEncodedLength);  // 填充到固定长度
+  PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber & 0xffffffffu));
+  PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber >> 32));
+  assert(dst->size() == original_size + kEncodedLength);
+  (void)original_size;  // release 模式下不使用
+}
+
+Status Footer::DecodeFrom(Slice* input) {
+  if (input->size() < kEncodedLength) {
+    return Status::Corruption("not an sstable (footer too short)");
+  }
+
+  const char* magic_ptr = input->data() + kEncodedLength - 8;
+  const uint32_t magic_lo = DecodeFixed32(magic_ptr);
+  const uint32_t magic_hi = DecodeFixed32(magic_ptr + 4);
+  const uint64_t magic = ((static_cast<uint64_t>(magic_hi) << 32) |
+                          (static_cast<uint64_t>(magic_lo)));
+  if (magic != kTableMagicNumber) {
+    return Status::Corruption("not an sstable (bad magic number)");
+  }
+
+  Status result = metaindex_handle_.DecodeFrom(input);
+  if (result.ok()) {
+    result = index_handle_.DecodeFrom(input);
+  }
+  if (result.ok()) {
+    // 跳过填充和 magic number
+    const char* end = magic_ptr + 8;
+    *input = Slice(end, input->data() + input->size() - end);
+  }
+  return result;
+}
+
+Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
+                 const BlockHandle& handle, BlockContents* result,
+                 const CompressionDict* dict) {
+  result->data = Slice();
+  result->cachable = false;
+  result->heap_allocated = false;
+
+  // 读取 block 的内容和 trailer
+  size_t n = static_cast<size_t>(handle.size());
+  char* buf = new char[n + kBlockTrailerSize];
+  Slice contents;
+  Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
+  if (!s.ok()) {
+    delete[] buf;
+    return s;
+  }
+  return ParseBlockContents(options, handle, contents, buf, result, dict);
+}
+
+BlockReadahead::BlockReadahead(size_t readahead_size)
+    : readahead_size_(readahead_size),
+      auto_size_(kInitialAutoSize),
+      prev_end_(~static_cast<uint64_t>(0)),
+      sequential_(0),
+      capacity_(0),
+      buffer_offset_(0),
+      buffer_len_(0) {}
+
+Status BlockReadahead::ReadBlock(RandomAccessFile* file,
+                                 const ReadOptions& options,
+                                 const BlockHandle& handle,
+                                 BlockContents* result,
+                                 const CompressionDict* dict) {
+  const uint64_t offset = handle.offset();
+  const size_t n = static_cast<size_t>(handle.size()) + kBlockTrailerSize;
+  if (!Buffered(offset, n)) {
+    if (offset == prev_end_) {
+      sequential_++;
+    } else {
+      sequential_ = 0;
+      auto_size_ = kInitialAutoSize;
+    }
+    size_t size = readahead_size_;
+    if (size == 0 && sequential_ >= 2) {
+      size = auto_size_;
+      auto_size_ = std::min(auto_size_ * 2, kMaxAutoSize);
+    }
+    if (size > n) {
+      Prefetch(file, offset, size);
+    }
+  }
+  prev_end_ = offset + n;
+
+  if (!Buffered(offset, n)) {
+    return leveldb::ReadBlock(file, options, handle, result, dict);
+  }
+  // Block 会接管 buf，缓冲区在下一次预读时就会被覆盖，所以要复制一份
+  char* buf = new char[n];
+  std::memcpy(buf, buffer_.get() + (offset - buffer_offset_), n);
+  return ParseBlockContents(options, handle, Slice(buf, n), buf, result, dict);
+}
+
+void BlockReadahead::Prefetch(RandomAccessFile* file, uint64_t offset,
+                              size_t n) {
+  buffer_len_ = 0;
+  if (capacity_ < n) {
+    buffer_.reset(new char[n]);
+    capacity_ = n;
+  }
+  buffer_offset_ = offset;
+
+  std::vector<ReadRequest> reqs((n + kChunkSize - 1) / kChunkSize);
+  for (size_t i = 0; i < reqs.size(); i++) {
+    reqs[i].offset = offset + i * kChunkSize;
+    reqs[i].len = std::min(kChunkSize, n - i * kChunkSize);
+    reqs[i].scratch = buffer_.get() + i * kChunkSize;
+  }
+  if (!file->MultiRead(reqs.data(), reqs.size()).ok()) {
+    return;
+  }
+  // 只保留从头开始连续读到的部分
+  for (const ReadRequest& req : reqs) {
+    if (!req.status.ok()) {
+      break;
+    }
+    if (req.result.data() != req.scratch) {
+      std::memmove(req.scratch, req.result.data(), req.result.size());
+    }
+    buffer_len_ += req.result.size();
+    if (req.result.size() < req.len) {
+      break;
+    }
+  }
+}
+
+Status ParseBlockContents(const ReadOptions& options, const BlockHandle& handle,
+                          const Slice& contents, char* buf,
+                          BlockContents* result, const CompressionDict* dict) {
+  result->data = Slice();
+  result->cachable = false;
+  result->heap_allocated = false;
+
+  const size_t n = static_cast<size_t>(handle.size());
+  if (contents.size() != n + kBlockTrailerSize) {
+    delete[] buf;
+    return Status::Corruption("truncated block read");
+  }
+
+  // 检查 type 和 block 内容的 crc
+  const char* data = contents.data();
+  if (options.verify_checksums) {
+    const uint32_t crc = crc32c::Unmask(DecodeFixed32(data + n + 1));
+    const uint32_t actual = crc32c::Value(data, n + 1);
+    if (actual != crc) {
+      delete[] buf;
+      return Status::Corruption("block checksum mismatch");
+    }
+  }
+
+  switch (data[n]) {
+    case kNoCompression:
+      if (data != buf) {
+        // 文件实现返回的是它自己的内存（比如 mmap），直接使用
+        delete[] buf;
+        result->data = Slice(data, n);
+        result->heap_allocated = false;
+        result->cachable = false;
+      } else {
+        result->data = Slice(buf, n);
+        result->heap_allocated = true;
+        result->cachable = true;
+      }
+      break;
+    default: {
+      if (!IsValidCompressionType(data[n])) {
+        delete[] buf;
+        return Status::Corruption("bad block type");
+      }
+      const CompressionCodec* codec =
+          GetCompressionCodec(static_cast<CompressionType>(data[n]));
+      if (codec == nullptr) {
+        delete[] buf;
+        return Status::NotSupported("block compression type not supported");
+      }
+      // 直接解压到 Block 持有的内存中
+      const Slice input(data, n);
+      size_t ulength = 0;
+      if (!codec->GetUncompressedLength(input, &ulength)) {
+        delete[] buf;
+        return Status::Corruption("corrupted compressed block contents");
+      }
+      char* ubuf = new char[ulength];
+      if (!codec->Uncompress(input, dict, ubuf, ulength)) {
+        delete[] buf;
+        delete[] ubuf;
+        return Status::Corruption("corrupted compressed block contents");
+      }
+      delete[] buf;
+      result->data = Slice(ubuf, ulength);
+      result->heap_allocated = true;
+      result->cachable = true;
+      break;
+    }
+  }
+
+  return Status::OK();
+}
+
+}  // namespace leveldb
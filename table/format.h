@@ -0,0 +1,145 @@
+#ifndef STORAGE_LEVELDB_TABLE_FORMAT_H_
+#define STORAGE_LEVELDB_TABLE_FORMAT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "leveldb/slice.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class CompressionDict;
+class RandomAccessFile;
+struct ReadOptions;
+
+// 指向文件中一段区间（data block 或 meta block）的句柄
+class BlockHandle {
+ public:
+  // 编码后的最大长度
+  enum { kMaxEncodedLength = 10 + 10 };
+
+  BlockHandle();
+
+  // block 在文件中的偏移
+  uint64_t offset() const { return offset_; }
+  void set_offset(uint64_t offset) { offset_ = offset; }
+
+  // block 的大小，不含 trailer
+  uint64_t size() const { return size_; }
+  void set_size(uint64_t size) { size_ = size; }
+
+  void EncodeTo(std::string* dst) const;
+  Status DecodeFrom(Slice* input);
+
+ private:
+  uint64_t offset_;
+  uint64_t size_;
+};
+
+// footer 位于每个 sstable 的末尾，长度固定
+class Footer {
+ public:
+  // footer 的编码长度，两个 BlockHandle 再加 8 字节的 magic number
+  enum { kEncodedLength = 2 * BlockHandle::kMaxEncodedLength + 8 };
+
+  Footer() = default;
+
+  // metaindex block 的句柄
+  const BlockHandle& metaindex_handle() const { return metaindex_handle_; }
+  void set_metaindex_handle(const BlockHandle& h) { metaindex_handle_ = h; }
+
+  // index block 的句柄
+  const BlockHandle& index_handle() const { return index_handle_; }
+  void set_index_handle(const BlockHandle& h) { index_handle_ = h; }
+
+  void EncodeTo(std::string* dst) const;
+  Status DecodeFrom(Slice* input);
+
+ private:
+  BlockHandle metaindex_handle_;
+  BlockHandle index_handle_;
+};
+
+// kTableMagicNumber 取自
+// echo http://code.google.com/p/leveldb/ | sha1sum
+// 的前 64 位
+static const uint64_t kTableMagicNumber = 0xdb4775248b80fb57ull;
+
+// 每个 block 后面跟着 1 字节的 type（压缩方式）和 4 字节的 crc32c，
+// crc 覆盖 block 的内容和 type，经过 crc32c::Mask() 变换后存储
+static const size_t kBlockTrailerSize = 5;
+
+struct BlockContents {
+  Slice data;           // block 的内容
+  bool cachable;        // 为 true 时 data 可以被缓存
+  bool heap_allocated;  // 为 true 时调用者需要 delete[] data.data()
+};
+
+// 从 file 中读取 handle 指向的 block，成功时填充 *result
+// dict 不为 nullptr 时用它解压（只有用字典压缩的 data block 才需要）
+Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
+                 const BlockHandle& handle, BlockContents* result,
+                 const CompressionDict* dict = nullptr);
+
+// 把读到的 handle 指向的 block（包括 trailer）转换成 BlockContents
+// buf 是读取时使用的 scratch（new[] 分配，大小为 handle.size() + kBlockTrailerSize），
+// 由这个函数接管；contents 可以指向 buf，也可以指向文件实现自己的内存
+// options.verify_checksums 为 true 时检查 trailer 中的 crc
+Status ParseBlockContents(const ReadOptions& options, const BlockHandle& handle,
+                          const Slice& contents, char* buf,
+                          BlockContents* result,
+                          const CompressionDict* dict = nullptr);
+
+// 迭代器顺序读取 data block 时的预读，每个迭代器一个，不是线程安全的
+// 读到相邻的 block 时把后面一段范围切成多个请求，通过一次
+// RandomAccessFile::MultiRead 同时读进缓冲区，之后落在这个范围内的 block
+// 直接从缓冲区中取
+class BlockReadahead {
+ public:
+  // readahead_size 为 0 时自动预读: 连续读到两个相邻的 block 后开始，
+  // 大小从 kInitialAutoSize 开始每次翻倍，不超过 kMaxAutoSize，
+  // 读到不相邻的 block 时重新开始；不为 0 时每次缺失都预读这么多字节
+  explicit BlockReadahead(size_t readahead_size);
+
+  BlockReadahead(const BlockReadahead&) = delete;
+  BlockReadahead& operator=(const BlockReadahead&) = delete;
+
+  // 与 leveldb::ReadBlock 相同，block 在缓冲区中时不读文件
+  Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
+                   const BlockHandle& handle, BlockContents* result,
+                   const CompressionDict* dict = nullptr);
+
+  static constexpr size_t kInitialAutoSize = 8 * 1024;
+  static constexpr size_t kMaxAutoSize = 256 * 1024;
+  // 每个读请求的最大长度
+  static constexpr size_t kChunkSize = 32 * 1024;
+
+ private:
+  bool Buffered(uint64_t offset, size_t n) const {
+    return offset >= buffer_offset_ && n <= buffer_len_ &&
+           offset - buffer_offset_ <= buffer_len_ - n;
+  }
+
+  // 把 [offset, offset + n) 读进缓冲区，读不到的部分（文件结尾或出错）
+  // 不放进缓冲区，之后按普通的方式读取
+  void Prefetch(RandomAccessFile* file, uint64_t offset, size_t n);
+
+  const size_t readahead_size_;
+  size_t auto_size_;
+  uint64_t prev_end_;  // 上一次读的 block（含 trailer）的结尾
+  int sequential_;     // 连续读到相邻 block 的次数
+
+  std::unique_ptr<char[]> buffer_;
+  size_t capacity_;
+  uint64_t buffer_offset_;
+  size_t buffer_len_;
+};
+
+inline BlockHandle::BlockHandle()
+    : offset_(~static_cast<uint64_t>(0)), size_(~static_cast<uint64_t>(0)) {}
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_TABLE_FORMAT_H_
@@ -0,0 +1,17 @@
+#ifndef STORAGE_LEVELDB_TABLE_MERGER_H_
+#define STORAGE_LEVELDB_TABLE_MERGER_H_
+
+namespace leveldb {
+
+class Comparator;
+class Iterator;
+
+// 返回合并 children[0,n-1] 的迭代器，拥有所有子迭代器的所有权
+// 结果不去重: 某个 key 在 k 个子迭代器中出现时会返回 k 次
+// 要求: n >= 0
+Iterator* NewMergingIterator(const Comparator* comparator, Iterator** children,
+                             int n);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_TABLE_MERGER_H_
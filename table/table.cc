@@ -0,0 +1,405 @@
+#include "leveldb/table.h"
+
+#include <vector>
+
+#include "leveldb/comparator.h"
+#include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/options.h"
+#include "table/block.h"
+#include "table/filter_block.h"
+#include "table/format.h"
+#include "table/two_level_iterator.h"
+#include "util/coding.h"
+#include "util/compression.h"
+
+namespace leveldb {
+
+struct Table::Rep {
+  ~Rep() {
+    delete filter;
+    delete[] filter_data;
+    delete index_block;
+    delete range_del_block;
+    delete compression_dict;
+  }
+
+  Options options;
+  Status status;
+  RandomAccessFile* file;
+  FilterBlockReader* filter;
+  const char* filter_data;
+
+  BlockHandle metaindex_handle;  // 由 footer 得到
+  Block* index_block;
+  Block* range_del_block;  // 没有区间删除时为 nullptr
+  CompressionDict* compression_dict;  // data block 没有用字典压缩时为 nullptr
+};
+
+Status Table::Open(const Options& options, RandomAccessFile* file,
+                   uint64_t size, Table** table) {
+  *table = nullptr;
+  if (size < Footer::kEncodedLength) {
+    return Status::Corruption("file is too short to be an sstable");
+  }
+
+  char footer_space[Footer::kEncodedLength];
+  Slice footer_input;
+  Status s = file->Read(size - Footer::kEncodedLength, Footer::kEncodedLength,
+                        &footer_input, footer_space);
+  if (!s.ok()) return s;
+
+  Footer footer;
+  s = footer.DecodeFrom(&footer_input);
+  if (!s.ok()) return s;
+
+  // 读取 index block，只在打开时读一次，总是检查 crc
+  BlockContents index_block_contents;
+  ReadOptions opt;
+  opt.verify_checksums = true;
+  s = ReadBlock(file, opt, footer.index_handle(), &index_block_contents);
+
+  if (s.ok()) {
+    // 已经成功读取 footer 和 index block，可以开始提供读服务
+    Block* index_block = new Block(index_block_contents);
+    Rep* rep = new Table::Rep;
+    rep->options = options;
+    rep->file = file;
+    rep->metaindex_handle = footer.metaindex_handle();
+    rep->index_block = index_block;
+    rep->filter_data = nullptr;
+    rep->filter = nullptr;
+    rep->range_del_block = nullptr;
+    rep->compression_dict = nullptr;
+    *table = new Table(rep);
+    s = (*table)->ReadMeta(footer);
+    if (!s.ok()) {
+      // 少了区间删除，已经删除的 key 会重新出现，不能打开
+      delete *table;
+      *table = nullptr;
+    }
+  }
+
+  return s;
+}
+
+Status Table::ReadMeta(const Footer& footer) {
+  // meta block 都只在打开时读一次，总是检查 crc
+  ReadOptions opt;
+  opt.verify_checksums = true;
+  BlockContents contents;
+  Status s = ReadBlock(rep_->file, opt, footer.metaindex_handle(), &contents);
+  if (!s.ok()) {
+    return s;
+  }
+  Block* meta = new Block(contents);
+
+  Iterator* iter = meta->NewIterator(BytewiseComparator());
+  iter->Seek("compression.dict");
+  if (iter->Valid() && iter->key() == Slice("compression.dict")) {
+    s = ReadCompressionDict(iter->value());
+  }
+  if (s.ok() && rep_->options.filter_policy != nullptr) {
+    std::string key = "filter.";
+    key.append(rep_->options.filter_policy->Name());
+    iter->Seek(key);
+    if (iter->Valid() && iter->key() == Slice(key)) {
+      ReadFilter(iter->value());
+    }
+  }
+  if (s.ok()) {
+    iter->Seek("rangedel");
+    if (iter->Valid() && iter->key() == Slice("rangedel")) {
+      s = ReadRangeDel(iter->value());
+    }
+  }
+  if (s.ok()) {
+    s = iter->status();
+  }
+  delete iter;
+  delete meta;
+  return s;
+}
+
+void Table::ReadFilter(const Slice& filter_handle_value) {
+  Slice v = filter_handle_value;
+  BlockHandle filter_handle;
+  if (!filter_handle.DecodeFrom(&v).ok()) {
+    return;
+  }
+
+  // filter 只影响性能，读不出来（包括 crc 不对）时不使用 filter
+  ReadOptions opt;
+  opt.verify_checksums = true;
+  BlockContents block;
+  if (!ReadBlock(rep_->file, opt, filter_handle, &block).ok()) {
+    return;
+  }
+  if (block.heap_allocated) {
+    rep_->filter_data = block.data.data();  // 由 Rep 释放
+  }
+  rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
+}
+
+Status Table::ReadRangeDel(const Slice& range_del_handle_value) {
+  Slice v = range_del_handle_value;
+  BlockHandle handle;
+  Status s = handle.DecodeFrom(&v);
+  if (!s.ok()) {
+    return s;
+  }
+
+  ReadOptions opt;
+  opt.verify_checksums = true;
+  BlockContents block;
+  s = ReadBlock(rep_->file, opt, handle, &block);
+  if (s.ok()) {
+    // 区间删除只有打开时读这一次，完整地遍历一遍确认每一条都能解析
+    rep_->range_del_block = new Block(block);
+    Iterator* iter =
+        rep_->range_del_block->NewIterator(rep_->options.comparator);
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    }
+    s = iter->status();
+    delete iter;
+  }
+  return s;
+}
+
+Status Table::ReadCompressionDict(const Slice& dict_handle_value) {
+  Slice v = dict_handle_value;
+  BlockHandle handle;
+  Status s = handle.DecodeFrom(&v);
+  if (!s.ok()) {
+    return s;
+  }
+
+  // 目前只有 zstd 支持字典
+  const CompressionCodec* codec = GetCompressionCodec(kZstdCompression);
+  if (codec == nullptr) {
+    return Status::NotSupported("zstd compression dictionary");
+  }
+  ReadOptions opt;
+  opt.verify_checksums = true;
+  BlockContents block;
+  s = ReadBlock(rep_->file, opt, handle, &block);
+  if (s.ok()) {
+    rep_->compression_dict = codec->NewUncompressionDict(block.data);
+    if (block.heap_allocated) {
+      delete[] block.data.data();
+    }
+  }
+  return s;
+}
+
+Table::~Table() { delete rep_; }
+
+static void DeleteBlock(void* arg, void* ignored) {
+  delete reinterpret_cast<Block*>(arg);
+}
+
+// 每个迭代器各自的预读状态，随迭代器一起删除
+struct Table::IteratorState {
+  IteratorState(const Table* t, size_t readahead_size)
+      : table(t), readahead(readahead_size) {}
+
+  const Table* const table;
+  BlockReadahead readahead;
+};
+
+Iterator* Table::BlockReader(const ReadOptions& options,
+                             const Slice& index_value,
+                             BlockReadahead* readahead) const {
+  Block* block = nullptr;
+
+  BlockHandle handle;
+  Slice input = index_value;
+  Status s = handle.DecodeFrom(&input);
+  // input 中 handle 之后的内容留给以后扩展
+
+  if (s.ok()) {
+    BlockContents contents;
+    if (readahead != nullptr) {
+      s = readahead->ReadBlock(rep_->file, options, handle, &contents,
+                               rep_->compression_dict);
+    } else {
+      s = ReadBlock(rep_->file, options, handle, &contents,
+                    rep_->compression_dict);
+    }
+    if (s.ok()) {
+      block = new Block(contents);
+    }
+  }
+
+  Iterator* iter;
+  if (block != nullptr) {
+    iter = block->NewIterator(rep_->options.comparator);
+    iter->RegisterCleanup(&DeleteBlock, block, nullptr);
+  } else {
+    iter = NewErrorIterator(s);
+  }
+  return iter;
+}
+
+Iterator* Table::IteratorBlockReader(void* arg, const ReadOptions& options,
+                                     const Slice& index_value) {
+  IteratorState* state = reinterpret_cast<IteratorState*>(arg);
+  return state->table->BlockReader(options, index_value, &state->readahead);
+}
+
+Iterator* Table::NewIterator(const ReadOptions& options) const {
+  IteratorState* state = new IteratorState(this, options.readahead_size);
+  Iterator* iter = NewTwoLevelIterator(
+      rep_->index_block->NewIterator(rep_->options.comparator),
+      &Table::IteratorBlockReader, state, options);
+  iter->RegisterCleanup(
+      [](void* arg1, void* arg2) {
+        delete reinterpret_cast<IteratorState*>(arg1);
+      },
+      state, nullptr);
+  return iter;
+}
+
+Iterator* Table::NewRangeTombstoneIterator() const {
+  if (rep_->range_del_block == nullptr) {
+    return nullptr;
+  }
+  return rep_->range_del_block->NewIterator(rep_->options.comparator);
+}
+
+Status Table::InternalGet(const ReadOptions& options, const Slice& k, void* arg,
+                          ResultHandler handle_result) {
+  Status s;
+  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  iiter->Seek(k);
+  if (iiter->Valid()) {
+    Slice handle_value = iiter->value();
+    FilterBlockReader* filter = rep_->filter;
+    BlockHandle handle;
+    if (filter != nullptr && handle.DecodeFrom(&handle_value).ok() &&
+        !filter->KeyMayMatch(handle.offset(), k)) {
+      // filter 表明不存在
+    } else {
+      Iterator* block_iter = BlockReader(options, iiter->value(), nullptr);
+      block_iter->Seek(k);
+      s = block_iter->status();
+      if (block_iter->Valid()) {
+        (*handle_result)(arg, block_iter->key(), block_iter->value(),
+                         &block_iter);
+      }
+      delete block_iter;
+    }
+  }
+  if (s.ok()) {
+    s = iiter->status();
+  }
+  delete iiter;
+  return s;
+}
+
+bool Table::BlockMayMatch(const Slice& key) const {
+  if (rep_->filter == nullptr) {
+    return true;
+  }
+  bool may_match = true;
+  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  iiter->Seek(key);
+  if (iiter->Valid()) {
+    Slice handle_value = iiter->value();
+    BlockHandle handle;
+    may_match = !handle.DecodeFrom(&handle_value).ok() ||
+                rep_->filter->KeyMayMatch(handle.offset(), key);
+  }
+  delete iiter;
+  return may_match;
+}
+
+Status Table::InternalMultiGet(const ReadOptions& options, const Slice* keys,
+                               void* const* args, size_t n,
+                               ResultHandler handle_result) {
+  // 先用 index block 和 filter 找出每个 key 需要读的 data block
+  static const size_t kNoBlock = ~static_cast<size_t>(0);
+  std::vector<BlockHandle> handles;
+  std::vector<size_t> key_block(n, kNoBlock);
+  Status s;
+  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  for (size_t i = 0; i < n && s.ok(); i++) {
+    iiter->Seek(keys[i]);
+    if (!iiter->Valid()) {
+      continue;
+    }
+    Slice handle_value = iiter->value();
+    BlockHandle handle;
+    s = handle.DecodeFrom(&handle_value);
+    if (!s.ok()) {
+      break;
+    }
+    if (rep_->filter != nullptr &&
+        !rep_->filter->KeyMayMatch(handle.offset(), keys[i])) {
+      continue;  // filter 表明不存在
+    }
+    if (handles.empty() || handles.back().offset() != handle.offset()) {
+      handles.push_back(handle);
+    }
+    key_block[i] = handles.size() - 1;
+  }
+  if (s.ok()) {
+    s = iiter->status();
+  }
+  delete iiter;
+  if (!s.ok() || handles.empty()) {
+    return s;
+  }
+
+  // 所有 data block 一起读
+  std::vector<ReadRequest> reqs(handles.size());
+  for (size_t j = 0; j < handles.size(); j++) {
+    reqs[j].offset = handles[j].offset();
+    reqs[j].len = static_cast<size_t>(handles[j].size()) + kBlockTrailerSize;
+    reqs[j].scratch = new char[reqs[j].len];
+  }
+  s = rep_->file->MultiRead(reqs.data(), reqs.size());
+
+  std::vector<Block*> blocks(handles.size(), nullptr);
+  for (size_t j = 0; j < handles.size(); j++) {
+    Status bs = s.ok() ? reqs[j].status : s;
+    if (!bs.ok()) {
+      delete[] reqs[j].scratch;
+    } else {
+      BlockContents contents;
+      bs = ParseBlockContents(options, handles[j], reqs[j].result,
+                              reqs[j].scratch, &contents,
+                              rep_->compression_dict);
+      if (bs.ok()) {
+        blocks[j] = new Block(contents);
+      }
+    }
+    if (!bs.ok() && s.ok()) {
+      s = bs;
+    }
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    if (key_block[i] == kNoBlock || blocks[key_block[i]] == nullptr) {
+      continue;
+    }
+    Iterator* block_iter =
+        blocks[key_block[i]]->NewIterator(rep_->options.comparator);
+    block_iter->Seek(keys[i]);
+    if (block_iter->Valid()) {
+      Iterator* unpinnable = nullptr;
+      (*handle_result)(args[i], block_iter->key(), block_iter->value(),
+                       &unpinnable);
+    }
+    if (s.ok()) {
+      s = block_iter->status();
+    }
+    delete block_iter;
+  }
+  for (Block* block : blocks) {
+    delete block;
+  }
+  return s;
+}
+
+}  // namespace leveldb
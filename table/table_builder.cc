@@ -0,0 +1,359 @@
+#include "leveldb/table_builder.h"
+
+#include <cassert>
+#include <vector>
+
+#include "leveldb/comparator.h"
+#include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/options.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "table/filter_block.h"
+#include "table/format.h"
+#include "util/coding.h"
+#include "util/compression.h"
+#include "util/crc32c.h"
+
+namespace leveldb {
+
+struct TableBuilder::Rep {
+  Rep(const Options& opt, WritableFile* f)
+      : options(opt),
+        index_block_options(opt),
+        range_del_block_options(opt),
+        file(f),
+        offset(0),
+        data_block(&options),
+        index_block(&index_block_options),
+        range_del_block(&range_del_block_options),
+        num_entries(0),
+        closed(false),
+        filter_block(opt.filter_policy == nullptr
+                         ? nullptr
+                         : new FilterBlockBuilder(opt.filter_policy)),
+        pending_index_entry(false),
+        buffering(false),
+        buffered_bytes(0),
+        compression_dict(nullptr) {
+    index_block_options.block_restart_interval = 1;
+    range_del_block_options.block_restart_interval = 1;
+    const CompressionCodec* codec = GetCompressionCodec(opt.compression);
+    buffering = codec != nullptr && opt.compression == kZstdCompression &&
+                opt.zstd_max_dict_bytes > 0;
+  }
+
+  Options options;
+  Options index_block_options;
+  Options range_del_block_options;
+  WritableFile* file;
+  uint64_t offset;
+  Status status;
+  BlockBuilder data_block;
+  BlockBuilder index_block;
+  BlockBuilder range_del_block;
+  std::string last_key;
+  int64_t num_entries;
+  bool closed;  // 是否已经调用过 Finish() 或 Abandon()
+  FilterBlockBuilder* filter_block;
+
+  // 写完一个 data block 之后才添加它的 index entry，
+  // 这样可以用下一个 block 的第一个 key 生成更短的分隔 key
+  // 比如第一个 block 的最后一个 key 是 "the quick brown fox"，
+  // 第二个 block 的第一个 key 是 "the who"，分隔 key 可以用 "the r"
+  //
+  // 不变式: data_block 为空时 pending_index_entry 才为 true
+  bool pending_index_entry;
+  BlockHandle pending_handle;  // 添加到 index block 的句柄
+
+  std::string compressed_output;
+
+  // 使用 zstd 字典时，先缓存 data block 直到足够训练字典，
+  // 这期间还不知道 block 的位置，index entry 和 filter 等写入时再补上
+  bool buffering;
+  std::vector<std::string> buffered_blocks;
+  size_t buffered_bytes;
+  std::string compression_dict_contents;  // 为空表示没有字典
+  CompressionDict* compression_dict;
+};
+
+TableBuilder::TableBuilder(const Options& options, WritableFile* file)
+    : rep_(new Rep(options, file)) {
+  if (rep_->filter_block != nullptr) {
+    rep_->filter_block->StartBlock(0);
+  }
+}
+
+TableBuilder::~TableBuilder() {
+  assert(rep_->closed);  // 调用者忘了调用 Finish()
+  delete rep_->filter_block;
+  delete rep_->compression_dict;
+  delete rep_;
+}
+
+void TableBuilder::Add(const Slice& key, const Slice& value) {
+  Rep* r = rep_;
+  assert(!r->closed);
+  if (!ok()) return;
+  if (r->num_entries > 0) {
+    assert(r->options.comparator->Compare(key, Slice(r->last_key)) > 0);
+  }
+
+  if (r->pending_index_entry) {
+    assert(r->data_block.empty());
+    r->options.comparator->FindShortestSeparator(&r->last_key, key);
+    std::string handle_encoding;
+    r->pending_handle.EncodeTo(&handle_encoding);
+    r->index_block.Add(r->last_key, Slice(handle_encoding));
+    r->pending_index_entry = false;
+  }
+
+  if (r->filter_block != nullptr && !r->buffering) {
+    r->filter_block->AddKey(key);
+  }
+
+  r->last_key.assign(key.data(), key.size());
+  r->num_entries++;
+  r->data_block.Add(key, value);
+
+  const size_t estimated_block_size = r->data_block.CurrentSizeEstimate();
+  if (estimated_block_size >= r->options.block_size) {
+    Flush();
+  }
+}
+
+void TableBuilder::AddRangeTombstone(const Slice& key, const Slice& value) {
+  Rep* r = rep_;
+  assert(!r->closed);
+  if (!ok()) return;
+  r->range_del_block.Add(key, value);
+}
+
+void TableBuilder::Flush() {
+  Rep* r = rep_;
+  assert(!r->closed);
+  if (!ok()) return;
+  if (r->data_block.empty()) return;
+  if (r->buffering) {
+    r->buffered_blocks.push_back(r->data_block.Finish().ToString());
+    r->buffered_bytes += r->buffered_blocks.back().size();
+    r->data_block.Reset();
+    if (r->buffered_bytes >= r->options.zstd_max_train_bytes) {
+      EnterUnbuffered();
+    }
+    return;
+  }
+  WriteDataBlock(r->data_block.Finish());
+  r->data_block.Reset();
+}
+
+void TableBuilder::WriteDataBlock(const Slice& raw) {
+  Rep* r = rep_;
+  assert(!r->pending_index_entry);
+  CompressAndWriteBlock(raw, r->compression_dict, &r->pending_handle);
+  if (ok()) {
+    r->pending_index_entry = true;
+    r->status = r->file->Flush();
+  }
+  if (r->filter_block != nullptr) {
+    r->filter_block->StartBlock(r->offset);
+  }
+}
+
+void TableBuilder::EnterUnbuffered() {
+  Rep* r = rep_;
+  assert(r->buffering);
+  r->buffering = false;
+
+  // 用缓存的 block 训练字典，样本不足时不使用字典
+  const CompressionCodec* codec = GetCompressionCodec(r->options.compression);
+  std::vector<Slice> samples(r->buffered_blocks.begin(),
+                             r->buffered_blocks.end());
+  if (codec->TrainDict(samples, r->options.zstd_max_dict_bytes,
+                       &r->compression_dict_contents)) {
+    r->compression_dict =
+        codec->NewCompressionDict(r->compression_dict_contents);
+    if (r->compression_dict == nullptr) {
+      r->compression_dict_contents.clear();
+    }
+  }
+
+  // 按顺序写入缓存的 block，重新遍历其中的 key 补上 index entry 和 filter
+  for (const std::string& raw : r->buffered_blocks) {
+    if (!ok()) break;
+    BlockContents contents;
+    contents.data = raw;
+    contents.cachable = false;
+    contents.heap_allocated = false;
+    Block block(contents);
+    Iterator* iter = block.NewIterator(r->options.comparator);
+    iter->SeekToFirst();
+    if (r->pending_index_entry) {
+      // r->last_key 是上一个 block 的最后一个 key
+      r->options.comparator->FindShortestSeparator(&r->last_key, iter->key());
+      std::string handle_encoding;
+      r->pending_handle.EncodeTo(&handle_encoding);
+      r->index_block.Add(r->last_key, Slice(handle_encoding));
+      r->pending_index_entry = false;
+    }
+    for (; iter->Valid(); iter->Next()) {
+      if (r->filter_block != nullptr) {
+        r->filter_block->AddKey(iter->key());
+      }
+      r->last_key.assign(iter->key().data(), iter->key().size());
+    }
+    delete iter;
+    WriteDataBlock(raw);
+  }
+  r->buffered_blocks.clear();
+  r->buffered_bytes = 0;
+}
+
+void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
+  assert(ok());
+  CompressAndWriteBlock(block->Finish(), nullptr, handle);
+  block->Reset();
+}
+
+void TableBuilder::CompressAndWriteBlock(const Slice& raw,
+                                         const CompressionDict* dict,
+                                         BlockHandle* handle) {
+  // 文件中的 block 格式:
+  //    block_data: uint8[n]
+  //    type: uint8
+  //    crc: uint32
+  Rep* r = rep_;
+  Slice block_contents;
+  CompressionType type = r->options.compression;
+  const CompressionCodec* codec = GetCompressionCodec(type);
+  if (codec != nullptr && codec->Compress(raw, dict, &r->compressed_output) &&
+      r->compressed_output.size() < raw.size() - (raw.size() / 8u)) {
+    block_contents = r->compressed_output;
+  } else {
+    // 不支持这种压缩方式，或者压缩率不到 12.5%，保存原始数据
+    block_contents = raw;
+    type = kNoCompression;
+  }
+  WriteRawBlock(block_contents, type, handle);
+  r->compressed_output.clear();
+}
+
+void TableBuilder::WriteRawBlock(const Slice& block_contents,
+                                 CompressionType type, BlockHandle* handle) {
+  Rep* r = rep_;
+  handle->set_offset(r->offset);
+  handle->set_size(block_contents.size());
+  r->status = r->file->Append(block_contents);
+  if (r->status.ok()) {
+    char trailer[kBlockTrailerSize];
+    trailer[0] = type;
+    uint32_t crc = crc32c::Value(block_contents.data(), block_contents.size());
+    crc = crc32c::Extend(crc, trailer, 1);  // crc 同时覆盖 type
+    EncodeFixed32(trailer + 1, crc32c::Mask(crc));
+    r->status = r->file->Append(Slice(trailer, kBlockTrailerSize));
+    if (r->status.ok()) {
+      r->offset += block_contents.size() + kBlockTrailerSize;
+    }
+  }
+}
+
+Status TableBuilder::status() const { return rep_->status; }
+
+Status TableBuilder::Finish() {
+  Rep* r = rep_;
+  Flush();
+  if (r->buffering) {
+    EnterUnbuffered();
+  }
+  assert(!r->closed);
+  r->closed = true;
+
+  BlockHandle dict_block_handle, filter_block_handle, range_del_block_handle,
+      metaindex_block_handle, index_block_handle;
+
+  // 写入压缩字典
+  const bool has_dict = !r->compression_dict_contents.empty();
+  if (ok() && has_dict) {
+    WriteRawBlock(r->compression_dict_contents, kNoCompression,
+                  &dict_block_handle);
+  }
+
+  // 写入 filter block
+  if (ok() && r->filter_block != nullptr) {
+    WriteRawBlock(r->filter_block->Finish(), kNoCompression,
+                  &filter_block_handle);
+  }
+
+  // 写入区间删除
+  const bool has_range_dels = !r->range_del_block.empty();
+  if (ok() && has_range_dels) {
+    WriteBlock(&r->range_del_block, &range_del_block_handle);
+  }
+
+  // 写入 metaindex block
+  if (ok()) {
+    // metaindex block 的 key 是普通字符串，按字节序排列
+    Options meta_index_options(r->options);
+    meta_index_options.comparator = BytewiseComparator();
+    BlockBuilder meta_index_block(&meta_index_options);
+    if (has_dict) {
+      // "compression.dict" 排在 "filter." 之前
+      std::string handle_encoding;
+      dict_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add("compression.dict", handle_encoding);
+    }
+    if (r->filter_block != nullptr) {
+      // key 为 "filter.<Name>"，value 为 filter block 的句柄
+      std::string key = "filter.";
+      key.append(r->options.filter_policy->Name());
+      std::string handle_encoding;
+      filter_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add(key, handle_encoding);
+    }
+    if (has_range_dels) {
+      // "rangedel" 排在 "filter." 之后
+      std::string handle_encoding;
+      range_del_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add("rangedel", handle_encoding);
+    }
+    WriteBlock(&meta_index_block, &metaindex_block_handle);
+  }
+
+  // 写入 index block
+  if (ok()) {
+    if (r->pending_index_entry) {
+      r->options.comparator->FindShortSuccessor(&r->last_key);
+      std::string handle_encoding;
+      r->pending_handle.EncodeTo(&handle_encoding);
+      r->index_block.Add(r->last_key, Slice(handle_encoding));
+      r->pending_index_entry = false;
+    }
+    WriteBlock(&r->index_block, &index_block_handle);
+  }
+
+  // 写入 footer
+  if (ok()) {
+    Footer footer;
+    footer.set_metaindex_handle(metaindex_block_handle);
+    footer.set_index_handle(index_block_handle);
+    std::string footer_encoding;
+    footer.EncodeTo(&footer_encoding);
+    r->status = r->file->Append(footer_encoding);
+    if (r->status.ok()) {
+      r->offset += footer_encoding.size();
+    }
+  }
+  return r->status;
+}
+
+void TableBuilder::Abandon() {
+  Rep* r = rep_;
+  assert(!r->closed);
+  r->closed = true;
+}
+
+uint64_t TableBuilder::NumEntries() const { return rep_->num_entries; }
+
+uint64_t TableBuilder::FileSize() const { return rep_->offset; }
+
+}  // namespace leveldb
@@ -0,0 +1,630 @@
+#include "leveldb/table.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/comparator.h"
+#include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "leveldb/table_builder.h"
+#include "table/block.h"
+#include "table/format.h"
+#include "util/compression.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+namespace {
+
+std::string Key(int i) {
+  char buf[16];
+  std::snprintf(buf, sizeof(buf), "key%06d", i);
+  return buf;
+}
+
+std::string ReadFile(Env* env, const std::string& fname) {
+  uint64_t size;
+  EXPECT_TRUE(env->GetFileSize(fname, &size).ok());
+  RandomAccessFile* file;
+  EXPECT_TRUE(env->NewRandomAccessFile(fname, &file).ok());
+  std::string scratch(size, '\0');
+  Slice result;
+  EXPECT_TRUE(file->Read(0, size, &result, &scratch[0]).ok());
+  std::string contents = result.ToString();
+  delete file;
+  return contents;
+}
+
+void WriteFile(Env* env, const std::string& fname, const Slice& contents) {
+  WritableFile* file;
+  ASSERT_TRUE(env->NewWritableFile(fname, &file).ok());
+  ASSERT_TRUE(file->Append(contents).ok());
+  ASSERT_TRUE(file->Close().ok());
+  delete file;
+}
+
+// 记录 Read 和 MultiRead 的调用次数
+class CountingFile : public RandomAccessFile {
+ public:
+  explicit CountingFile(RandomAccessFile* base)
+      : base_(base), reads_(0), multi_reads_(0) {}
+
+  Status Read(uint64_t offset, size_t n, Slice* result,
+              char* scratch) const override {
+    reads_++;
+    return base_->Read(offset, n, result, scratch);
+  }
+
+  Status MultiRead(ReadRequest* reqs, size_t n) const override {
+    multi_reads_++;
+    return base_->MultiRead(reqs, n);
+  }
+
+  int reads() const { return reads_; }
+  int multi_reads() const { return multi_reads_; }
+  void Reset() { reads_ = multi_reads_ = 0; }
+
+ private:
+  RandomAccessFile* const base_;
+  mutable int reads_;
+  mutable int multi_reads_;
+};
+
+// 按字节序比较并记录 Compare 的调用次数
+class CountingComparator : public Comparator {
+ public:
+  explicit CountingComparator(bool use_prefix)
+      : use_prefix_(use_prefix), compares_(0) {}
+
+  const char* Name() const override { return "leveldb.BytewiseComparator"; }
+  int Compare(const Slice& a, const Slice& b) const override {
+    compares_++;
+    return BytewiseComparator()->Compare(a, b);
+  }
+  void FindShortestSeparator(std::string* start,
+                             const Slice& limit) const override {
+    BytewiseComparator()->FindShortestSeparator(start, limit);
+  }
+  void FindShortSuccessor(std::string* key) const override {
+    BytewiseComparator()->FindShortSuccessor(key);
+  }
+  bool HasNormalizedKeyPrefix(size_t* trailer) const override {
+    *trailer = 0;
+    return use_prefix_;
+  }
+
+  int compares() const { return compares_; }
+  void Reset() { compares_ = 0; }
+
+ private:
+  const bool use_prefix_;
+  mutable int compares_;
+};
+
+}  // namespace
+
+class TableTest : public testing::Test {
+ public:
+  TableTest()
+      : env_(Env::Default()),
+        fname_(test::TmpDir("table_test") + "/000001.ldb"),
+        policy_(NewBloomFilterPolicy(10)),
+        file_(nullptr),
+        table_(nullptr) {
+    options_.filter_policy = policy_.get();
+    options_.compression = kNoCompression;
+  }
+
+  ~TableTest() override { Close(); }
+
+  // 写入 n 个 key，with_range_dels 为 true 时再写入两条区间删除
+  void Build(int n, bool with_range_dels) {
+    WritableFile* file;
+    ASSERT_TRUE(env_->NewWritableFile(fname_, &file).ok());
+    TableBuilder builder(options_, file);
+    for (int i = 0; i < n; i++) {
+      builder.Add(Key(i), "value" + std::to_string(i));
+    }
+    if (with_range_dels) {
+      builder.AddRangeTombstone(Key(10), Key(20));
+      builder.AddRangeTombstone(Key(30), Key(40));
+    }
+    ASSERT_TRUE(builder.Finish().ok());
+    ASSERT_TRUE(file->Close().ok());
+    delete file;
+  }
+
+  Status Open() {
+    Close();
+    uint64_t size;
+    Status s = env_->GetFileSize(fname_, &size);
+    if (s.ok()) {
+      s = env_->NewRandomAccessFile(fname_, &file_);
+    }
+    if (s.ok()) {
+      s = Table::Open(options_, file_, size, &table_);
+    }
+    return s;
+  }
+
+  void Close() {
+    delete table_;
+    table_ = nullptr;
+    delete file_;
+    file_ = nullptr;
+  }
+
+  // 从 footer 和 metaindex block 中找到名为 name 的 meta block
+  BlockHandle FindMetaBlock(const std::string& name) {
+    const std::string contents = ReadFile(env_, fname_);
+    Slice footer_input(contents.data() + contents.size() -
+                           Footer::kEncodedLength,
+                       Footer::kEncodedLength);
+    Footer footer;
+    EXPECT_TRUE(footer.DecodeFrom(&footer_input).ok());
+    if (name == "metaindex") {
+      return footer.metaindex_handle();
+    }
+    RandomAccessFile* file;
+    EXPECT_TRUE(env_->NewRandomAccessFile(fname_, &file).ok());
+    BlockContents block_contents;
+    EXPECT_TRUE(ReadBlock(file, ReadOptions(), footer.metaindex_handle(),
+                          &block_contents)
+                    .ok());
+    delete file;
+    Block meta(block_contents);
+    std::unique_ptr<Iterator> iter(meta.NewIterator(BytewiseComparator()));
+    iter->Seek(name);
+    EXPECT_TRUE(iter->Valid() && iter->key().starts_with(name)) << name;
+    BlockHandle handle;
+    Slice v = iter->value();
+    EXPECT_TRUE(handle.DecodeFrom(&v).ok());
+    return handle;
+  }
+
+  // 把 handle 指向的 block 中间的一个字节取反
+  void CorruptBlock(const BlockHandle& handle) {
+    std::string contents = ReadFile(env_, fname_);
+    contents[handle.offset() + handle.size() / 2] ^= 0x80;
+    WriteFile(env_, fname_, contents);
+  }
+
+  // 遍历 sstable 的所有 entry，检查与 Build 写入的相同
+  void CheckContents(int n) {
+    std::unique_ptr<Iterator> iter(table_->NewIterator(ReadOptions()));
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      ASSERT_EQ(Key(i), iter->key().ToString());
+      ASSERT_EQ("value" + std::to_string(i), iter->value().ToString());
+    }
+    ASSERT_TRUE(iter->status().ok()) << iter->status().ToString();
+    ASSERT_EQ(n, i);
+  }
+
+  // 按顺序返回每个 data block 的 handle
+  std::vector<BlockHandle> DataBlockHandles() {
+    const std::string contents = ReadFile(env_, fname_);
+    Slice footer_input(contents.data() + contents.size() -
+                           Footer::kEncodedLength,
+                       Footer::kEncodedLength);
+    Footer footer;
+    EXPECT_TRUE(footer.DecodeFrom(&footer_input).ok());
+    // index block 也可能被压缩
+    RandomAccessFile* file;
+    EXPECT_TRUE(env_->NewRandomAccessFile(fname_, &file).ok());
+    BlockContents index_contents;
+    EXPECT_TRUE(ReadBlock(file, ReadOptions(), footer.index_handle(),
+                          &index_contents)
+                    .ok());
+    delete file;
+    Block index(index_contents);
+    std::unique_ptr<Iterator> iter(index.NewIterator(BytewiseComparator()));
+    std::vector<BlockHandle> handles;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      BlockHandle handle;
+      Slice v = iter->value();
+      EXPECT_TRUE(handle.DecodeFrom(&v).ok());
+      handles.push_back(handle);
+    }
+    return handles;
+  }
+
+  // 按顺序返回每个 data block 的 trailer 中记录的压缩类型
+  std::vector<int> DataBlockTypes() {
+    const std::string contents = ReadFile(env_, fname_);
+    std::vector<int> types;
+    for (const BlockHandle& handle : DataBlockHandles()) {
+      types.push_back(contents[handle.offset() + handle.size()]);
+    }
+    return types;
+  }
+
+  Env* const env_;
+  const std::string fname_;
+  std::unique_ptr<const FilterPolicy> policy_;
+  Options options_;
+  RandomAccessFile* file_;
+  Table* table_;
+};
+
+TEST_F(TableTest, RangeDeletions) {
+  Build(100, true);
+  ASSERT_TRUE(Open().ok());
+  CheckContents(100);
+  std::unique_ptr<Iterator> iter(table_->NewRangeTombstoneIterator());
+  ASSERT_NE(nullptr, iter);
+  iter->SeekToFirst();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(Key(10), iter->key().ToString());
+  ASSERT_EQ(Key(20), iter->value().ToString());
+  iter->Next();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(Key(30), iter->key().ToString());
+  iter->Next();
+  ASSERT_FALSE(iter->Valid());
+}
+
+// 区间删除读不出来时不能打开，否则被删除的 key 会重新出现
+TEST_F(TableTest, CorruptRangeDeletionBlock) {
+  Build(100, true);
+  CorruptBlock(FindMetaBlock("rangedel"));
+  Status s = Open();
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  ASSERT_EQ(nullptr, table_);
+}
+
+TEST_F(TableTest, CorruptMetaIndexBlock) {
+  Build(100, true);
+  CorruptBlock(FindMetaBlock("metaindex"));
+  Status s = Open();
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+}
+
+// filter 只影响性能，读不出来时照常打开，只是不使用 filter
+TEST_F(TableTest, CorruptFilterBlock) {
+  Build(1000, false);
+  CorruptBlock(FindMetaBlock("filter."));
+  ASSERT_TRUE(Open().ok());
+  CheckContents(1000);
+  // 没有 filter 时不能排除任何 key
+  ASSERT_TRUE(table_->BlockMayMatch(Key(5) + "x"));
+}
+
+// data block 的内容或者 trailer 中的 crc 被改动时，
+// verify_checksums 为 true 的读取返回 Corruption
+TEST_F(TableTest, CorruptDataBlockChecksum) {
+  ReadOptions verify;
+  verify.verify_checksums = true;
+  for (bool corrupt_crc : {false, true}) {
+    Build(1000, false);
+    const std::vector<BlockHandle> handles = DataBlockHandles();
+    ASSERT_GT(handles.size(), 2u);
+    if (corrupt_crc) {
+      // trailer 为 1 字节的类型加上 4 字节的 crc
+      std::string contents = ReadFile(env_, fname_);
+      contents[handles[1].offset() + handles[1].size() + 2] ^= 0x01;
+      WriteFile(env_, fname_, contents);
+    } else {
+      CorruptBlock(handles[1]);
+    }
+    ASSERT_TRUE(Open().ok());
+
+    std::unique_ptr<Iterator> iter(table_->NewIterator(verify));
+    int n = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      n++;
+    }
+    Status s = iter->status();
+    ASSERT_TRUE(s.IsCorruption()) << corrupt_crc << " " << s.ToString();
+    ASSERT_GT(n, 0);  // 第一个 block 没有被改动
+
+    if (corrupt_crc) {
+      // 内容没有变，不检查 crc 时照常读出
+      CheckContents(1000);
+    }
+  }
+}
+
+// 用 8 字节前缀比较的 Seek 与只用 Compare 的结果相同，且大部分比较
+// 不需要调用 Compare；key 有长有短，很多 key 的前 8 个字节相同
+TEST_F(TableTest, SeekWithNormalizedKeyPrefix) {
+  std::vector<std::string> keys;
+  for (int i = 0; i < 3000; i++) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%x", i * 7919);
+    keys.push_back(buf);
+    if (i % 3 == 0) {
+      keys.push_back(std::string(buf) + "-long-suffix-" + std::to_string(i));
+    }
+    if (i % 5 == 0) {
+      keys.push_back(std::string(buf) + '\0');
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  uint64_t counts[2];
+  for (bool use_prefix : {false, true}) {
+    CountingComparator cmp(use_prefix);
+    options_.comparator = &cmp;
+    options_.filter_policy = nullptr;
+    options_.block_restart_interval = 4;
+    WritableFile* file;
+    ASSERT_TRUE(env_->NewWritableFile(fname_, &file).ok());
+    TableBuilder builder(options_, file);
+    for (const std::string& key : keys) {
+      builder.Add(key, "v" + key);
+    }
+    ASSERT_TRUE(builder.Finish().ok());
+    ASSERT_TRUE(file->Close().ok());
+    delete file;
+    ASSERT_TRUE(Open().ok());
+
+    cmp.Reset();
+    std::unique_ptr<Iterator> iter(table_->NewIterator(ReadOptions()));
+    Random rnd(301);
+    for (int j = 0; j < 2000; j++) {
+      std::string target = keys[rnd.Uniform(keys.size())];
+      switch (rnd.Uniform(3)) {
+        case 0:
+          break;
+        case 1:
+          target.push_back('\0');
+          break;
+        default:
+          target.resize(rnd.Uniform(target.size() + 1));
+          break;
+      }
+      iter->Seek(target);
+      auto pos = std::lower_bound(keys.begin(), keys.end(), target);
+      if (pos == keys.end()) {
+        ASSERT_FALSE(iter->Valid()) << target;
+      } else {
+        ASSERT_TRUE(iter->Valid()) << target;
+        ASSERT_EQ(*pos, iter->key().ToString()) << target;
+        ASSERT_EQ("v" + *pos, iter->value().ToString());
+      }
+    }
+    ASSERT_TRUE(iter->status().ok());
+    counts[use_prefix] = cmp.compares();
+    iter.reset();
+    Close();
+  }
+  ASSERT_LT(counts[1] * 2, counts[0]);
+}
+
+// 顺序遍历时预读相邻的 block，读文件的次数远少于 block 的个数
+TEST_F(TableTest, IteratorReadahead) {
+  const int kNum = 20000;
+  Build(kNum, false);
+  const size_t num_blocks = DataBlockHandles().size();
+  ASSERT_GT(num_blocks, 50u);
+  ASSERT_TRUE(Open().ok());
+  uint64_t file_size;
+  ASSERT_TRUE(env_->GetFileSize(fname_, &file_size).ok());
+
+  CountingFile file(file_);
+  Table* table;
+  ASSERT_TRUE(Table::Open(options_, &file, file_size, &table).ok());
+  std::unique_ptr<Table> table_guard(table);
+
+  // 0 为自动预读，1MB 大于整个文件
+  for (size_t readahead_size : {size_t{0}, size_t{1} << 20}) {
+    ASSERT_LT(file_size, size_t{1} << 20);
+    ReadOptions options;
+    options.readahead_size = readahead_size;
+    options.verify_checksums = true;
+
+    file.Reset();
+    std::unique_ptr<Iterator> iter(table->NewIterator(options));
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      ASSERT_EQ(Key(i), iter->key().ToString());
+      ASSERT_EQ("value" + std::to_string(i), iter->value().ToString());
+    }
+    ASSERT_TRUE(iter->status().ok()) << iter->status().ToString();
+    ASSERT_EQ(kNum, i);
+    if (readahead_size == 0) {
+      ASSERT_GT(file.multi_reads(), 0);
+      ASSERT_LT(file.reads() + file.multi_reads(), num_blocks / 4);
+    } else {
+      // 第一次读就把整个文件读了进来
+      ASSERT_EQ(0, file.reads());
+      ASSERT_EQ(1, file.multi_reads());
+    }
+
+    // 反向遍历和随机 Seek 的结果不受预读影响
+    i = kNum - 1;
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev(), i--) {
+      ASSERT_EQ(Key(i), iter->key().ToString());
+    }
+    ASSERT_EQ(-1, i);
+    Random rnd(301);
+    for (int j = 0; j < 200; j++) {
+      const int k = rnd.Uniform(kNum);
+      iter->Seek(Key(k));
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(Key(k), iter->key().ToString());
+      for (int step = 1; step < 50 && k + step < kNum; step++) {
+        iter->Next();
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(Key(k + step), iter->key().ToString());
+      }
+    }
+    ASSERT_TRUE(iter->status().ok()) << iter->status().ToString();
+  }
+}
+
+TEST_F(TableTest, BlockMayMatch) {
+  Build(1000, false);
+  ASSERT_TRUE(Open().ok());
+  int false_positives = 0;
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_TRUE(table_->BlockMayMatch(Key(i)));
+    // 不存在的 key 落在与 Key(i) 相同的 block
+    if (table_->BlockMayMatch(Key(i) + "x")) {
+      false_positives++;
+    }
+  }
+  ASSERT_LT(false_positives, 50);
+  // 比所有 block 的 index key 都大，没有对应的 block
+  ASSERT_TRUE(table_->BlockMayMatch("zzz"));
+}
+
+// 每种编译进来的压缩方式都能读回原来的内容
+TEST_F(TableTest, Compression) {
+  for (CompressionType type :
+       {kSnappyCompression, kZstdCompression, kLZ4Compression}) {
+    if (GetCompressionCodec(type) == nullptr) {
+      continue;
+    }
+    options_.compression = type;
+    options_.zstd_max_dict_bytes = 0;
+    Build(2000, false);
+    ASSERT_TRUE(Open().ok());
+    CheckContents(2000);
+    const std::vector<int> types = DataBlockTypes();
+    ASSERT_GT(types.size(), 1u);
+    for (int t : types) {
+      ASSERT_EQ(type, t);
+    }
+  }
+}
+
+// 压缩率不到 12.5% 的 block 保存原始数据
+TEST_F(TableTest, IncompressibleBlocksStoredRaw) {
+  options_.compression = kLZ4Compression;
+  if (GetCompressionCodec(options_.compression) == nullptr) {
+    GTEST_SKIP() << "lz4 not compiled in";
+  }
+  Random rnd(301);
+  std::vector<std::string> values;
+  WritableFile* file;
+  ASSERT_TRUE(env_->NewWritableFile(fname_, &file).ok());
+  TableBuilder builder(options_, file);
+  for (int i = 0; i < 200; i++) {
+    std::string value(100, '\0');
+    for (char& c : value) {
+      c = static_cast<char>(rnd.Uniform(256));
+    }
+    builder.Add(Key(i), value);
+    values.push_back(value);
+  }
+  ASSERT_TRUE(builder.Finish().ok());
+  ASSERT_TRUE(file->Close().ok());
+  delete file;
+
+  const std::vector<int> types = DataBlockTypes();
+  ASSERT_FALSE(types.empty());
+  for (int t : types) {
+    ASSERT_EQ(kNoCompression, t);
+  }
+  ASSERT_TRUE(Open().ok());
+  std::unique_ptr<Iterator> iter(table_->NewIterator(ReadOptions()));
+  int i = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+    ASSERT_EQ(values[i], iter->value().ToString());
+  }
+  ASSERT_EQ(200, i);
+}
+
+// JSON 形式的小记录，字段名和取值来自一个共同的词表:
+// 单个 block 内重复不多，跨 block 重复很多，正是字典适用的情况
+static std::string JsonValue(int i) {
+  static const std::vector<std::string>* vocabulary = [] {
+    auto* words = new std::vector<std::string>;
+    Random rnd(301);
+    for (int w = 0; w < 400; w++) {
+      std::string word;
+      for (int c = 0; c < 10; c++) {
+        word.push_back(static_cast<char>('a' + rnd.Uniform(26)));
+      }
+      words->push_back(word);
+    }
+    return words;
+  }();
+  Random rnd(i + 1);
+  std::string value = "{";
+  for (int f = 0; f < 6; f++) {
+    value += "\"" + (*vocabulary)[rnd.Uniform(400)] + "\":\"" +
+             (*vocabulary)[rnd.Uniform(400)] + "\",";
+  }
+  value += "\"id\":" + std::to_string(i) + "}";
+  return value;
+}
+
+// 写入 n 条 JsonValue，返回文件大小
+static uint64_t BuildJson(Env* env, const Options& options,
+                          const std::string& fname, int n) {
+  WritableFile* file;
+  EXPECT_TRUE(env->NewWritableFile(fname, &file).ok());
+  TableBuilder builder(options, file);
+  for (int i = 0; i < n; i++) {
+    builder.Add(Key(i), JsonValue(i));
+  }
+  EXPECT_TRUE(builder.Finish().ok());
+  EXPECT_TRUE(file->Close().ok());
+  delete file;
+  uint64_t size = 0;
+  EXPECT_TRUE(env->GetFileSize(fname, &size).ok());
+  return size;
+}
+
+// 用训练的字典压缩小 block，比不用字典小得多，读取时使用文件中保存的字典
+TEST_F(TableTest, ZstdDictionary) {
+  options_.compression = kZstdCompression;
+  if (GetCompressionCodec(options_.compression) == nullptr) {
+    GTEST_SKIP() << "zstd not compiled in";
+  }
+  const int kNum = 20000;
+  options_.zstd_max_dict_bytes = 0;
+  const uint64_t plain_size = BuildJson(env_, options_, fname_, kNum);
+  options_.zstd_max_dict_bytes = 16 * 1024;
+  const uint64_t dict_size = BuildJson(env_, options_, fname_, kNum);
+  ASSERT_LT(dict_size, plain_size / 2)
+      << "with dict " << dict_size << ", without " << plain_size;
+
+  FindMetaBlock("compression.dict");
+  ASSERT_TRUE(Open().ok());
+  std::unique_ptr<Iterator> iter(table_->NewIterator(ReadOptions()));
+  int i = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+    ASSERT_EQ(Key(i), iter->key().ToString());
+    ASSERT_EQ(JsonValue(i), iter->value().ToString());
+  }
+  ASSERT_TRUE(iter->status().ok()) << iter->status().ToString();
+  ASSERT_EQ(kNum, i);
+}
+
+// 没有字典就无法解压 data block，字典读不出来时不能打开
+TEST_F(TableTest, CorruptZstdDictionary) {
+  options_.compression = kZstdCompression;
+  if (GetCompressionCodec(options_.compression) == nullptr) {
+    GTEST_SKIP() << "zstd not compiled in";
+  }
+  BuildJson(env_, options_, fname_, 20000);
+  CorruptBlock(FindMetaBlock("compression.dict"));
+  Status s = Open();
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  ASSERT_EQ(nullptr, table_);
+}
+
+// 数据太少时不训练字典，照常压缩
+TEST_F(TableTest, ZstdDictionaryTooFewSamples) {
+  options_.compression = kZstdCompression;
+  if (GetCompressionCodec(options_.compression) == nullptr) {
+    GTEST_SKIP() << "zstd not compiled in";
+  }
+  Build(10, false);
+  ASSERT_TRUE(Open().ok());
+  CheckContents(10);
+}
+
+}  // namespace leveldb
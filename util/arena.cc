@@ -33,13 +33,36 @@ char* Arena::AllocateAligned(size_t bytes) {
   return result;
 }
 
+char* Arena::AllocateAligned(size_t bytes, size_t alignment) {
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  size_t current_mod =
+      reinterpret_cast<uintptr_t>(alloc_ptr_) & (alignment - 1);
+  size_t slop = (current_mod == 0 ? 0 : alignment - current_mod);
+  size_t needed = bytes + slop;
+  char* result;
+  if(needed <= alloc_bytes_remaining_) {
+    result = alloc_ptr_ + slop;
+    alloc_ptr_ += needed;
+    alloc_bytes_remaining_ -= needed;
+  } else {
+    // 单独分配一个块，多出的 alignment - 1 字节用于对齐
+    char* block = AllocateNewBlock(bytes + alignment - 1);
+    uintptr_t p = reinterpret_cast<uintptr_t>(block);
+    result = reinterpret_cast<char*>((p + alignment - 1) &
+                                     ~static_cast<uintptr_t>(alignment - 1));
+  }
+  assert((reinterpret_cast<uintptr_t>(result) & (alignment - 1)) == 0);
+  return result;
+}
+
 char* Arena::AllocateFallback(size_t bytes) {
   if(bytes > kBlockSize / 4) {
-    char* result = AllocateNewBlock(kBlockSize);
+    // 大对象单独分配一个块，避免浪费当前块剩余的空间
+    char* result = AllocateNewBlock(bytes);
     return result;
   }
 
-  alloc_ptr_ = AllocateNewBlock(bytes);
+  alloc_ptr_ = AllocateNewBlock(kBlockSize);
   alloc_bytes_remaining_ = kBlockSize;
 
   char* result = alloc_ptr_;
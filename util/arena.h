@@ -22,6 +22,9 @@ class Arena {
 
   char* AllocateAligned(size_t bytes);
 
+  // 按 alignment（2 的幂）对齐，比如 direct I/O 使用的 4KB 对齐缓冲区
+  char* AllocateAligned(size_t bytes, size_t alignment);
+
   size_t  MemoryUsage() const {
     return memory_usage_.load(std::memory_order_relaxed);
   }
@@ -0,0 +1,117 @@
+#include "util/arena.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+TEST(ArenaTest, Empty) { Arena arena; }
+
+// 分配的内存互不重叠，内容在 arena 析构之前保持不变
+TEST(ArenaTest, Simple) {
+  std::vector<std::pair<size_t, char*>> allocated;
+  Arena arena;
+  const int N = 100000;
+  size_t bytes = 0;
+  Random rnd(301);
+  for (int i = 0; i < N; i++) {
+    size_t s;
+    if (i % (N / 10) == 0) {
+      s = i;
+    } else {
+      s = rnd.OneIn(4000)
+              ? rnd.Uniform(6000)
+              : (rnd.OneIn(10) ? rnd.Uniform(100) : rnd.Uniform(20));
+    }
+    if (s == 0) {
+      // 不分配 0 字节
+      s = 1;
+    }
+    char* r;
+    if (rnd.OneIn(10)) {
+      r = arena.AllocateAligned(s);
+    } else {
+      r = arena.Allocate(s);
+    }
+
+    for (size_t b = 0; b < s; b++) {
+      // 用 i 的低 8 位填充，之后检查
+      r[b] = i % 256;
+    }
+    bytes += s;
+    allocated.push_back(std::make_pair(s, r));
+    ASSERT_GE(arena.MemoryUsage(), bytes);
+    if (i > N / 10) {
+      ASSERT_LE(arena.MemoryUsage(), bytes * 1.10);
+    }
+  }
+  for (size_t i = 0; i < allocated.size(); i++) {
+    size_t num_bytes = allocated[i].first;
+    const char* p = allocated[i].second;
+    for (size_t b = 0; b < num_bytes; b++) {
+      // 检查填充的内容没有被覆盖
+      ASSERT_EQ(int(p[b]) & 0xff, i % 256);
+    }
+  }
+}
+
+// 按指定的对齐方式分配: 小请求在当前块中跳过不对齐的部分，
+// 大请求单独分配一个块；两种情况都对齐，且与其他分配互不重叠
+TEST(ArenaTest, AllocateAlignedWithAlignment) {
+  Arena arena;
+  Random rnd(301);
+  std::vector<std::pair<size_t, char*>> allocated;
+  for (int i = 0; i < 2000; i++) {
+    const size_t alignment = size_t{1} << rnd.Uniform(13);  // 1 ~ 4096
+    size_t bytes;
+    switch (rnd.Uniform(3)) {
+      case 0:
+        bytes = 1 + rnd.Uniform(16);
+        break;
+      case 1:
+        bytes = 1 + rnd.Uniform(1024);
+        break;
+      default:
+        bytes = 4096 + rnd.Uniform(3 * 4096);
+        break;
+    }
+    const size_t usage = arena.MemoryUsage();
+    char* p = arena.AllocateAligned(bytes, alignment);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(p) & (alignment - 1))
+        << "bytes " << bytes << " alignment " << alignment;
+    // 大请求多分配的部分不超过 alignment - 1 字节（加上块的记录）
+    if (arena.MemoryUsage() - usage > 4096 + sizeof(char*)) {
+      ASSERT_LE(arena.MemoryUsage() - usage,
+                bytes + alignment - 1 + sizeof(char*));
+    }
+    std::memset(p, i % 256, bytes);
+    allocated.emplace_back(bytes, p);
+    // 混入普通的分配，让当前块的位置不对齐
+    std::memset(arena.Allocate(1 + rnd.Uniform(7)), 0xff, 1);
+  }
+  for (size_t i = 0; i < allocated.size(); i++) {
+    const char* p = allocated[i].second;
+    for (size_t b = 0; b < allocated[i].first; b++) {
+      ASSERT_EQ(static_cast<int>(i % 256), p[b] & 0xff) << i;
+    }
+  }
+}
+
+// direct I/O 使用的缓冲区: 4KB 对齐的大块
+TEST(ArenaTest, AllocateAlignedDirectIOBuffer) {
+  for (size_t bytes : {4096, 1 << 20}) {
+    Arena arena;
+    arena.Allocate(3);
+    char* p = arena.AllocateAligned(bytes, 4096);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(p) % 4096);
+    std::memset(p, 'x', bytes);
+    ASSERT_GE(arena.MemoryUsage(), bytes);
+    ASSERT_LE(arena.MemoryUsage(), bytes + 4096 + 4096 + 2 * sizeof(char*));
+  }
+}
+
+}  // namespace leveldb
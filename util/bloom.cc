@@ -0,0 +1,92 @@
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+FilterPolicy::~FilterPolicy() = default;
+
+namespace {
+
+// 低 32 位是第一个探测位置，高 32 位是 double hashing 的步长，两者互相独立
+// 步长取奇数: 位数是 8 的倍数，偶数步长在小 filter 中会反复落在同几个位上
+static uint64_t BloomHash(const Slice& key) {
+  return Hash64(key.data(), key.size(), 0xbc9f1d34) | (uint64_t{1} << 32);
+}
+
+class BloomFilterPolicy : public FilterPolicy {
+ public:
+  explicit BloomFilterPolicy(int bits_per_key) : bits_per_key_(bits_per_key) {
+    // k = bits_per_key * ln(2) 时误判率最低，向下取整减少探测次数
+    k_ = static_cast<size_t>(bits_per_key * 0.69);  // 0.69 =~ ln(2)
+    if (k_ < 1) k_ = 1;
+    if (k_ > 30) k_ = 30;
+  }
+
+  // filter 中保存的是 Hash() 的结果，换哈希函数或探测方式时要改名，
+  // 旧文件中名字不同的 filter 会被忽略而不是误判
+  const char* Name() const override { return "leveldb.BuiltinBloomFilter4"; }
+
+  void CreateFilter(const Slice* keys, int n, std::string* dst) const override {
+    size_t bits = n * bits_per_key_;
+
+    // key 很少时误判率会很高，设置一个下限
+    if (bits < 64) bits = 64;
+
+    size_t bytes = (bits + 7) / 8;
+    bits = bytes * 8;
+
+    const size_t init_size = dst->size();
+    dst->resize(init_size + bytes, 0);
+    dst->push_back(static_cast<char>(k_));  // 把探测次数记在 filter 末尾
+    char* array = &(*dst)[init_size];
+    for (int i = 0; i < n; i++) {
+      // 用 double hashing 生成 k 个哈希值
+      const uint64_t hash = BloomHash(keys[i]);
+      uint32_t h = static_cast<uint32_t>(hash);
+      const uint32_t delta = static_cast<uint32_t>(hash >> 32);
+      for (size_t j = 0; j < k_; j++) {
+        const uint32_t bitpos = h % bits;
+        array[bitpos / 8] |= (1 << (bitpos % 8));
+        h += delta;
+      }
+    }
+  }
+
+  bool KeyMayMatch(const Slice& key, const Slice& bloom_filter) const override {
+    const size_t len = bloom_filter.size();
+    if (len < 2) return false;
+
+    const char* array = bloom_filter.data();
+    const size_t bits = (len - 1) * 8;
+
+    // 使用生成 filter 时的 k，不同参数生成的 filter 都能读
+    const size_t k = array[len - 1];
+    if (k > 30) {
+      // 留给以后新的编码方式，当作匹配
+      return true;
+    }
+
+    const uint64_t hash = BloomHash(key);
+    uint32_t h = static_cast<uint32_t>(hash);
+    const uint32_t delta = static_cast<uint32_t>(hash >> 32);
+    for (size_t j = 0; j < k; j++) {
+      const uint32_t bitpos = h % bits;
+      if ((array[bitpos / 8] & (1 << (bitpos % 8))) == 0) return false;
+      h += delta;
+    }
+    return true;
+  }
+
+ private:
+  size_t bits_per_key_;
+  size_t k_;
+};
+
+}  // namespace
+
+const FilterPolicy* NewBloomFilterPolicy(int bits_per_key) {
+  return new BloomFilterPolicy(bits_per_key);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,197 @@
+#include "util/bytewise_compare.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LEVELDB_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace leveldb {
+
+namespace {
+
+inline uint64_t LoadBigEndian64(const uint8_t* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+inline uint32_t LoadBigEndian32(const uint8_t* p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  return v;
+}
+
+// 比较长度小于 16 的尾部
+// 转成大端之后整数的大小关系就是字节序；首尾两次加载可以重叠，避免逐字节的循环
+inline int CompareShort(const uint8_t* a, const uint8_t* b, size_t n) {
+  if (n >= 8) {
+    uint64_t x = LoadBigEndian64(a);
+    uint64_t y = LoadBigEndian64(b);
+    if (x == y) {
+      x = LoadBigEndian64(a + n - 8);
+      y = LoadBigEndian64(b + n - 8);
+    }
+    return (x == y) ? 0 : (x < y ? -1 : +1);
+  }
+  if (n >= 4) {
+    uint32_t x = LoadBigEndian32(a);
+    uint32_t y = LoadBigEndian32(b);
+    if (x == y) {
+      x = LoadBigEndian32(a + n - 4);
+      y = LoadBigEndian32(b + n - 4);
+    }
+    return (x == y) ? 0 : (x < y ? -1 : +1);
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (a[i] != b[i]) {
+      return static_cast<int>(a[i]) - static_cast<int>(b[i]);
+    }
+  }
+  return 0;
+}
+
+// 按 8 字节的机器字比较，没有 SIMD 的平台使用；x86 上只在测试中用来对照
+int CompareScalar(const char* ca, const char* cb, size_t n) {
+  const uint8_t* a = reinterpret_cast<const uint8_t*>(ca);
+  const uint8_t* b = reinterpret_cast<const uint8_t*>(cb);
+  while (n >= 16) {
+    const uint64_t x = LoadBigEndian64(a);
+    const uint64_t y = LoadBigEndian64(b);
+    if (x != y) {
+      return x < y ? -1 : +1;
+    }
+    a += 8;
+    b += 8;
+    n -= 8;
+  }
+  return CompareShort(a, b, n);
+}
+
+#if defined(LEVELDB_X86_DISPATCH)
+
+// 比较 a[i,i+16) 和 b[i,i+16)，相等时返回 false
+// 相等的字节在 movemask 中对应位为 1，取反后最低的 1 就是第一个不同的字节
+inline bool Diff16(const uint8_t* a, const uint8_t* b, size_t i, int* r) {
+  const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+  const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+  const uint32_t diff =
+      ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) &
+      0xffff;
+  if (diff == 0) {
+    return false;
+  }
+  const size_t j = i + __builtin_ctz(diff);
+  *r = static_cast<int>(a[j]) - static_cast<int>(b[j]);
+  return true;
+}
+
+// SSE2 是 x86-64 的基础指令集，不需要检测
+int CompareSSE2(const char* ca, const char* cb, size_t n) {
+  const uint8_t* a = reinterpret_cast<const uint8_t*>(ca);
+  const uint8_t* b = reinterpret_cast<const uint8_t*>(cb);
+  if (n < 16) {
+    return CompareShort(a, b, n);
+  }
+  int r;
+  for (size_t i = 0; i + 16 < n; i += 16) {
+    if (Diff16(a, b, i, &r)) return r;
+  }
+  // 最后 16 个字节，可能和前一块重叠
+  return Diff16(a, b, n - 16, &r) ? r : 0;
+}
+
+__attribute__((target("avx2"))) inline bool Diff32(const uint8_t* a,
+                                                   const uint8_t* b, size_t i,
+                                                   int* r) {
+  const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+  const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+  const uint32_t diff =
+      ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+  if (diff == 0) {
+    return false;
+  }
+  const size_t j = i + __builtin_ctz(diff);
+  *r = static_cast<int>(a[j]) - static_cast<int>(b[j]);
+  return true;
+}
+
+__attribute__((target("avx2"))) int CompareAVX2(const char* ca,
+                                                const char* cb, size_t n) {
+  const uint8_t* a = reinterpret_cast<const uint8_t*>(ca);
+  const uint8_t* b = reinterpret_cast<const uint8_t*>(cb);
+  int r;
+  if (n < 32) {
+    if (n < 16) {
+      return CompareShort(a, b, n);
+    }
+    if (Diff16(a, b, 0, &r)) return r;
+    return Diff16(a, b, n - 16, &r) ? r : 0;
+  }
+  for (size_t i = 0; i + 32 < n; i += 32) {
+    if (Diff32(a, b, i, &r)) return r;
+  }
+  // 最后 32 个字节，可能和前一块重叠
+  return Diff32(a, b, n - 32, &r) ? r : 0;
+}
+
+#endif  // defined(LEVELDB_X86_DISPATCH)
+
+using compare_internal::CompareImpl;
+
+CompareImpl ChooseImpl() {
+#if defined(LEVELDB_X86_DISPATCH)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return {CompareAVX2, "avx2"};
+  }
+  return {CompareSSE2, "sse2"};
+#else
+  return {CompareScalar, "scalar"};
+#endif
+}
+
+const CompareImpl& Impl() {
+  static const CompareImpl impl = ChooseImpl();
+  return impl;
+}
+
+// 第一次调用时选择实现，之后直接跳转到选中的实现
+int CompareResolve(const char* a, const char* b, size_t n) {
+  compare_internal::CompareFn fn = Impl().fn;
+  compare_internal::compare_fn.store(fn, std::memory_order_relaxed);
+  return fn(a, b, n);
+}
+
+}  // namespace
+
+namespace compare_internal {
+
+std::atomic<CompareFn> compare_fn{CompareResolve};
+
+std::vector<CompareImpl> SupportedImpls() {
+  std::vector<CompareImpl> impls = {{CompareScalar, "scalar"}};
+#if defined(LEVELDB_X86_DISPATCH)
+  impls.push_back({CompareSSE2, "sse2"});
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    impls.push_back({CompareAVX2, "avx2"});
+  }
+#endif
+  return impls;
+}
+
+}  // namespace compare_internal
+
+const char* CompareBytesImplName() { return Impl().name; }
+
+}  // namespace leveldb
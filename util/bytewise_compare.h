@@ -0,0 +1,54 @@
+#ifndef STORAGE_LEVELDB_UTIL_BYTEWISE_COMPARE_H_
+#define STORAGE_LEVELDB_UTIL_BYTEWISE_COMPARE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+namespace compare_internal {
+
+typedef int (*CompareFn)(const char* a, const char* b, size_t n);
+
+// 当前使用的实现，第一次调用时根据 CPU 选定
+extern std::atomic<CompareFn> compare_fn;
+
+struct CompareImpl {
+  CompareFn fn;
+  const char* name;
+};
+
+// 当前 CPU 能运行的所有实现（包括没有选中的），供测试逐一检查
+std::vector<CompareImpl> SupportedImpls();
+
+}  // namespace compare_internal
+
+// 按无符号字节序比较 a[0,n) 和 b[0,n)，返回值的符号与 memcmp 相同
+// 运行时根据 CPU 选择实现: AVX2 每次比较 32 字节，SSE2 每次 16 字节，
+// 其他平台按 8 字节的机器字比较；都用 movemask/ctz 直接定位第一个不同的字节
+inline int CompareBytes(const char* a, const char* b, size_t n) {
+  return compare_internal::compare_fn.load(std::memory_order_relaxed)(a, b, n);
+}
+
+// 与 Slice::compare 结果相同
+inline int BytewiseCompare(const Slice& a, const Slice& b) {
+  const size_t min_len = (a.size() < b.size()) ? a.size() : b.size();
+  int r = CompareBytes(a.data(), b.data(), min_len);
+  if (r == 0) {
+    if (a.size() < b.size())
+      r = -1;
+    else if (a.size() > b.size())
+      r = +1;
+  }
+  return r;
+}
+
+// 返回当前使用的实现的名字，用于日志和调试
+const char* CompareBytesImplName();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_BYTEWISE_COMPARE_H_
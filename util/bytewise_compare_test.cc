@@ -0,0 +1,63 @@
+#include "util/bytewise_compare.h"
+
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+static int Sign(int r) { return (r > 0) - (r < 0); }
+
+// 对每个实现，在各种长度、各种位置出现第一个不同字节的情况下与 memcmp 比较
+TEST(BytewiseCompareTest, MatchesMemcmp) {
+  Random rnd(301);
+  // 额外的偏移让输入不对齐
+  std::string a(300, '\0'), b(300, '\0');
+  for (const compare_internal::CompareImpl& impl :
+       compare_internal::SupportedImpls()) {
+    for (size_t n = 0; n <= 260; n++) {
+      for (int trial = 0; trial < 20; trial++) {
+        const size_t offset = rnd.Uniform(8);
+        for (size_t i = 0; i < n; i++) {
+          a[offset + i] = b[offset + i] = static_cast<char>(rnd.Next());
+        }
+        if (n > 0 && trial > 0) {
+          // 改掉一个字节，包括 0x80 以上的字节，检查按无符号比较
+          const size_t pos = rnd.Uniform(n);
+          b[offset + pos] = static_cast<char>(rnd.Next());
+          if (rnd.OneIn(3) && pos + 1 < n) {
+            a[offset + pos + 1] = static_cast<char>(rnd.Next());
+          }
+        }
+        const char* pa = a.data() + offset;
+        const char* pb = b.data() + offset;
+        ASSERT_EQ(Sign(std::memcmp(pa, pb, n)), Sign(impl.fn(pa, pb, n)))
+            << impl.name << " n=" << n;
+        ASSERT_EQ(Sign(std::memcmp(pb, pa, n)), Sign(impl.fn(pb, pa, n)))
+            << impl.name << " n=" << n;
+      }
+    }
+  }
+}
+
+TEST(BytewiseCompareTest, Dispatch) {
+  // 选中的实现必须是当前 CPU 支持的实现之一
+  const std::string name = CompareBytesImplName();
+  bool found = false;
+  for (const compare_internal::CompareImpl& impl :
+       compare_internal::SupportedImpls()) {
+    found = found || name == impl.name;
+  }
+  ASSERT_TRUE(found) << name;
+
+  ASSERT_EQ(0, BytewiseCompare("", ""));
+  ASSERT_LT(BytewiseCompare("abc", "abd"), 0);
+  ASSERT_LT(BytewiseCompare("abc", "abcd"), 0);
+  ASSERT_GT(BytewiseCompare("abcd", "abc"), 0);
+  ASSERT_GT(BytewiseCompare("\xff", "\x01"), 0);
+  ASSERT_EQ(0, BytewiseCompare(std::string(100, 'x'), std::string(100, 'x')));
+}
+
+}  // namespace leveldb
@@ -0,0 +1,254 @@
+#include "util/coding.h"
+
+#include <algorithm>
+
+// SSE2 是 x86-64 的基础指令集，不需要运行时检测
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define LEVELDB_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace leveldb {
+
+void PutFixed32(std::string* dst, uint32_t value) {
+  char buf[sizeof(value)];
+  EncodeFixed32(buf, value);
+  dst->append(buf, sizeof(buf));
+}
+
+void PutFixed64(std::string* dst, uint64_t value) {
+  char buf[sizeof(value)];
+  EncodeFixed64(buf, value);
+  dst->append(buf, sizeof(buf));
+}
+
+char* EncodeVarint32(char* dst, uint32_t v) {
+  uint8_t* ptr = reinterpret_cast<uint8_t*>(dst);
+  static const int B = 128;
+  if (v < (1 << 7)) {
+    *(ptr++) = v;
+  } else if (v < (1 << 14)) {
+    *(ptr++) = v | B;
+    *(ptr++) = v >> 7;
+  } else if (v < (1 << 21)) {
+    *(ptr++) = v | B;
+    *(ptr++) = (v >> 7) | B;
+    *(ptr++) = v >> 14;
+  } else if (v < (1 << 28)) {
+    *(ptr++) = v | B;
+    *(ptr++) = (v >> 7) | B;
+    *(ptr++) = (v >> 14) | B;
+    *(ptr++) = v >> 21;
+  } else {
+    *(ptr++) = v | B;
+    *(ptr++) = (v >> 7) | B;
+    *(ptr++) = (v >> 14) | B;
+    *(ptr++) = (v >> 21) | B;
+    *(ptr++) = v >> 28;
+  }
+  return reinterpret_cast<char*>(ptr);
+}
+
+void PutVarint32(std::string* dst, uint32_t v) {
+  char buf[5];
+  char* ptr = EncodeVarint32(buf, v);
+  dst->append(buf, ptr - buf);
+}
+
+char* EncodeVarint64(char* dst, uint64_t v) {
+  static const int B = 128;
+  uint8_t* ptr = reinterpret_cast<uint8_t*>(dst);
+  while (v >= B) {
+    *(ptr++) = v | B;
+    v >>= 7;
+  }
+  *(ptr++) = static_cast<uint8_t>(v);
+  return reinterpret_cast<char*>(ptr);
+}
+
+void PutVarint64(std::string* dst, uint64_t v) {
+  char buf[10];
+  char* ptr = EncodeVarint64(buf, v);
+  dst->append(buf, ptr - buf);
+}
+
+void PutLengthPrefixedSlice(std::string* dst, const Slice& value) {
+  PutVarint32(dst, value.size());
+  dst->append(value.data(), value.size());
+}
+
+int VarintLength(uint64_t v) {
+  int len = 1;
+  while (v >= 128) {
+    v >>= 7;
+    len++;
+  }
+  return len;
+}
+
+const char* GetVarint32PtrFallback(const char* p, const char* limit,
+                                   uint32_t* value) {
+  uint32_t result = 0;
+  for (uint32_t shift = 0; shift <= 28 && p < limit; shift += 7) {
+    uint32_t byte = *(reinterpret_cast<const uint8_t*>(p));
+    p++;
+    if (byte & 128) {
+      // 后面还有字节
+      result |= ((byte & 127) << shift);
+    } else {
+      result |= (byte << shift);
+      *value = result;
+      return reinterpret_cast<const char*>(p);
+    }
+  }
+  return nullptr;
+}
+
+bool GetVarint32(Slice* input, uint32_t* value) {
+  const char* p = input->data();
+  const char* limit = p + input->size();
+  const char* q = GetVarint32Ptr(p, limit, value);
+  if (q == nullptr) {
+    return false;
+  } else {
+    *input = Slice(q, limit - q);
+    return true;
+  }
+}
+
+const char* GetVarint64Ptr(const char* p, const char* limit, uint64_t* value) {
+  uint64_t result = 0;
+  for (uint32_t shift = 0; shift <= 63 && p < limit; shift += 7) {
+    uint64_t byte = *(reinterpret_cast<const uint8_t*>(p));
+    p++;
+    if (byte & 128) {
+      // 后面还有字节
+      result |= ((byte & 127) << shift);
+    } else {
+      result |= (byte << shift);
+      *value = result;
+      return reinterpret_cast<const char*>(p);
+    }
+  }
+  return nullptr;
+}
+
+bool GetVarint64(Slice* input, uint64_t* value) {
+  const char* p = input->data();
+  const char* limit = p + input->size();
+  const char* q = GetVarint64Ptr(p, limit, value);
+  if (q == nullptr) {
+    return false;
+  } else {
+    *input = Slice(q, limit - q);
+    return true;
+  }
+}
+
+bool GetLengthPrefixedSlice(Slice* input, Slice* result) {
+  uint32_t len;
+  if (GetVarint32(input, &len) && input->size() >= len) {
+    *result = Slice(input->data(), len);
+    input->remove_prefix(len);
+    return true;
+  } else {
+    return false;
+  }
+}
+
+namespace {
+
+// 逐个解析，用于剩余数据不足 16 个字节或者 varint 超过 8 个字节的情况
+inline const char* GetVarintPtr(const char* p, const char* limit,
+                                uint32_t* value) {
+  return GetVarint32Ptr(p, limit, value);
+}
+
+inline const char* GetVarintPtr(const char* p, const char* limit,
+                                uint64_t* value) {
+  return GetVarint64Ptr(p, limit, value);
+}
+
+#if defined(LEVELDB_SSE2)
+
+// 把 w 中每个字节的低 7 位依次拼接起来
+inline uint64_t CompactVarintBits(uint64_t w) {
+  w &= 0x7f7f7f7f7f7f7f7full;
+  w = (w & 0x007f007f007f007full) | ((w & 0x7f007f007f007f00ull) >> 1);
+  w = (w & 0x00003fff00003fffull) | ((w & 0x3fff00003fff0000ull) >> 2);
+  w = (w & 0x000000000fffffffull) | ((w & 0x0fffffff00000000ull) >> 4);
+  return w;
+}
+
+#endif  // defined(LEVELDB_SSE2)
+
+// 每次取 16 个字节，movemask 得到所有字节的最高位（续位），
+// 最高位为 0 的字节就是一个 varint 的结束位置；
+// 不超过 8 个字节的 varint 用一次 8 字节加载加上位压缩解出
+template <typename T>
+inline const char* GetVarintBatch(const char* p, const char* limit, T* values,
+                                  size_t n) {
+  size_t i = 0;
+#if defined(LEVELDB_SSE2)
+  constexpr int kMaxBytes = (sizeof(T) * 8 + 6) / 7;
+  // 多要求 8 个字节，从 16 个字节中的任意位置加载 8 个字节都不会越界
+  while (i < n && limit - p >= 24) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const uint32_t cont = static_cast<uint32_t>(_mm_movemask_epi8(chunk));
+
+    const size_t k = std::min<size_t>(n - i, 16);
+    if ((cont & ((1u << k) - 1)) == 0) {
+      // 接下来的 k 个 varint 都只占一个字节
+      for (size_t j = 0; j < k; j++) {
+        values[i + j] = static_cast<uint8_t>(p[j]);
+      }
+      i += k;
+      p += k;
+      continue;
+    }
+
+    uint32_t ends = ~cont & 0xffff;
+    int pos = 0;
+    while (i < n && ends != 0) {
+      const int end = __builtin_ctz(ends);
+      const int len = end - pos + 1;
+      if (len > kMaxBytes) {
+        return nullptr;
+      }
+      if (len > 8) {
+        break;
+      }
+      uint64_t w;
+      std::memcpy(&w, p + pos, sizeof(w));
+      w &= ~uint64_t{0} >> (64 - 8 * len);  // 只保留这个 varint 的字节
+      values[i++] = static_cast<T>(CompactVarintBits(w));
+      pos = end + 1;
+      ends &= ends - 1;
+    }
+    if (pos == 0) {
+      break;  // 第一个 varint 超过 8 个字节，或者 16 个字节中没有结束位置
+    }
+    p += pos;
+  }
+#endif  // defined(LEVELDB_SSE2)
+  for (; i < n; i++) {
+    if ((p = GetVarintPtr(p, limit, &values[i])) == nullptr) {
+      return nullptr;
+    }
+  }
+  return p;
+}
+
+}  // namespace
+
+const char* GetVarint32Batch(const char* p, const char* limit, uint32_t* values,
+                             size_t n) {
+  return GetVarintBatch(p, limit, values, n);
+}
+
+const char* GetVarint64Batch(const char* p, const char* limit, uint64_t* values,
+                             size_t n) {
+  return GetVarintBatch(p, limit, values, n);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,105 @@
+#ifndef STORAGE_LEVELDB_UTIL_CODING_H_
+#define STORAGE_LEVELDB_UTIL_CODING_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+// 定长整数按小端编码，变长整数（varint）每个字节用低 7 位存数据，最高位表示后面还有字节
+
+void PutFixed32(std::string* dst, uint32_t value);
+void PutFixed64(std::string* dst, uint64_t value);
+void PutVarint32(std::string* dst, uint32_t value);
+void PutVarint64(std::string* dst, uint64_t value);
+void PutLengthPrefixedSlice(std::string* dst, const Slice& value);
+
+// 从 *input 的开头解析一个值，成功时跳过已解析的部分并返回 true
+bool GetVarint32(Slice* input, uint32_t* value);
+bool GetVarint64(Slice* input, uint64_t* value);
+bool GetLengthPrefixedSlice(Slice* input, Slice* result);
+
+// 返回 v 编码成 varint 后的字节数
+int VarintLength(uint64_t v);
+
+// 把 value 编码到 dst，返回写入后的下一个位置
+// 要求: dst 至少有 5 个字节的空间
+char* EncodeVarint32(char* dst, uint32_t value);
+
+// 要求: dst 至少有 10 个字节的空间
+char* EncodeVarint64(char* dst, uint64_t value);
+
+// 从 [p, limit) 解析一个 varint64，成功返回解析后的下一个位置，失败返回 nullptr
+const char* GetVarint64Ptr(const char* p, const char* limit, uint64_t* value);
+
+// 从 [p, limit) 解析一个 varint32，成功返回解析后的下一个位置，失败返回 nullptr
+const char* GetVarint32PtrFallback(const char* p, const char* limit,
+                                   uint32_t* value);
+inline const char* GetVarint32Ptr(const char* p, const char* limit,
+                                  uint32_t* value) {
+  if (p < limit) {
+    uint32_t result = *(reinterpret_cast<const uint8_t*>(p));
+    if ((result & 128) == 0) {
+      *value = result;
+      return p + 1;
+    }
+  }
+  return GetVarint32PtrFallback(p, limit, value);
+}
+
+// 从 [p, limit) 连续解析 n 个 varint 存入 values[0, n)，
+// 成功返回解析后的下一个位置，失败返回 nullptr
+// 支持 SSE2 并且后面至少还有 24 个字节时，一次找出 16 个字节中每个 varint 的
+// 结束位置，适合解析较长的、多字节的 varint 序列；只有两三个 varint 时
+// 不如直接调用 GetVarint32Ptr 快
+const char* GetVarint32Batch(const char* p, const char* limit, uint32_t* values,
+                             size_t n);
+const char* GetVarint64Batch(const char* p, const char* limit, uint64_t* values,
+                             size_t n);
+
+inline void EncodeFixed32(char* dst, uint32_t value) {
+  uint8_t* const buffer = reinterpret_cast<uint8_t*>(dst);
+  buffer[0] = static_cast<uint8_t>(value);
+  buffer[1] = static_cast<uint8_t>(value >> 8);
+  buffer[2] = static_cast<uint8_t>(value >> 16);
+  buffer[3] = static_cast<uint8_t>(value >> 24);
+}
+
+inline void EncodeFixed64(char* dst, uint64_t value) {
+  uint8_t* const buffer = reinterpret_cast<uint8_t*>(dst);
+  buffer[0] = static_cast<uint8_t>(value);
+  buffer[1] = static_cast<uint8_t>(value >> 8);
+  buffer[2] = static_cast<uint8_t>(value >> 16);
+  buffer[3] = static_cast<uint8_t>(value >> 24);
+  buffer[4] = static_cast<uint8_t>(value >> 32);
+  buffer[5] = static_cast<uint8_t>(value >> 40);
+  buffer[6] = static_cast<uint8_t>(value >> 48);
+  buffer[7] = static_cast<uint8_t>(value >> 56);
+}
+
+inline uint32_t DecodeFixed32(const char* ptr) {
+  const uint8_t* const buffer = reinterpret_cast<const uint8_t*>(ptr);
+  return (static_cast<uint32_t>(buffer[0])) |
+         (static_cast<uint32_t>(buffer[1]) << 8) |
+         (static_cast<uint32_t>(buffer[2]) << 16) |
+         (static_cast<uint32_t>(buffer[3]) << 24);
+}
+
+inline uint64_t DecodeFixed64(const char* ptr) {
+  const uint8_t* const buffer = reinterpret_cast<const uint8_t*>(ptr);
+  return (static_cast<uint64_t>(buffer[0])) |
+         (static_cast<uint64_t>(buffer[1]) << 8) |
+         (static_cast<uint64_t>(buffer[2]) << 16) |
+         (static_cast<uint64_t>(buffer[3]) << 24) |
+         (static_cast<uint64_t>(buffer[4]) << 32) |
+         (static_cast<uint64_t>(buffer[5]) << 40) |
+         (static_cast<uint64_t>(buffer[6]) << 48) |
+         (static_cast<uint64_t>(buffer[7]) << 56);
+}
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_CODING_H_
@@ -0,0 +1,224 @@
+#include "util/coding.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+namespace {
+
+// 返回编码后恰好占 len 个字节的随机值，bits 为类型的位数
+uint64_t RandomValueOfLength(Random* rnd, int len, int bits) {
+  uint64_t v = (static_cast<uint64_t>(rnd->Next()) << 33) ^
+               (static_cast<uint64_t>(rnd->Next()) << 2) ^ rnd->Next();
+  const int value_bits = std::min(7 * len, bits);
+  if (value_bits < 64) {
+    v &= (uint64_t{1} << value_bits) - 1;
+  }
+  if (len > 1) {
+    v |= uint64_t{1} << (7 * (len - 1));  // 最高的字节不为 0
+  }
+  return v;
+}
+
+void PutVarint(std::string* dst, uint32_t v) { PutVarint32(dst, v); }
+void PutVarint(std::string* dst, uint64_t v) { PutVarint64(dst, v); }
+
+const char* GetVarintPtr(const char* p, const char* limit, uint32_t* v) {
+  return GetVarint32Ptr(p, limit, v);
+}
+const char* GetVarintPtr(const char* p, const char* limit, uint64_t* v) {
+  return GetVarint64Ptr(p, limit, v);
+}
+
+const char* GetVarintBatch(const char* p, const char* limit, uint32_t* v,
+                           size_t n) {
+  return GetVarint32Batch(p, limit, v, n);
+}
+const char* GetVarintBatch(const char* p, const char* limit, uint64_t* v,
+                           size_t n) {
+  return GetVarint64Batch(p, limit, v, n);
+}
+
+// 从 buf 开头批量解析 n 个 varint，结果与逐个调用 GetVarint{32,64}Ptr 相同
+// 返回批量解析是否成功
+template <typename T>
+bool CheckBatch(const std::string& buf, size_t n) {
+  const char* const start = buf.data();
+  const char* const limit = start + buf.size();
+  std::vector<T> expected(n);
+  const char* q = start;
+  for (size_t i = 0; i < n && q != nullptr; i++) {
+    q = GetVarintPtr(q, limit, &expected[i]);
+  }
+  std::vector<T> actual(n);
+  const char* r = GetVarintBatch(start, limit, actual.data(), n);
+  EXPECT_EQ(q == nullptr ? -1 : q - start, r == nullptr ? -1 : r - start)
+      << "n=" << n;
+  if (q != nullptr) {
+    EXPECT_EQ(expected, actual) << "n=" << n;
+  }
+  return r != nullptr;
+}
+
+// 编码 lengths 中每个长度的随机值，返回编码结果
+template <typename T>
+std::string EncodeLengths(Random* rnd, const std::vector<int>& lengths) {
+  std::string buf;
+  for (int len : lengths) {
+    const T v =
+        static_cast<T>(RandomValueOfLength(rnd, len, sizeof(T) * 8));
+    const size_t before = buf.size();
+    PutVarint(&buf, v);
+    EXPECT_EQ(static_cast<size_t>(len), buf.size() - before);
+  }
+  return buf;
+}
+
+template <typename T>
+void CheckRandomMixes() {
+  const int max_len = (sizeof(T) * 8 + 6) / 7;
+  Random rnd(301);
+  for (int trial = 0; trial < 2000; trial++) {
+    const size_t n = rnd.Uniform(80);
+    std::vector<int> lengths(n);
+    for (int& len : lengths) {
+      // 一部分只有单字节的，走全是单字节的快速路径
+      len = (trial % 4 == 0) ? 1 : 1 + rnd.Uniform(max_len);
+    }
+    const std::string buf = EncodeLengths<T>(&rnd, lengths);
+    ASSERT_TRUE(CheckBatch<T>(buf, n));
+    // 后面还有别的数据时只解析前 n 个
+    ASSERT_TRUE(CheckBatch<T>(buf + std::string(30, '\x01'), n));
+  }
+}
+
+// 剩余的字节数在 24 字节的门限上下，以及 varint 跨过 16 字节的窗口
+template <typename T>
+void CheckWindows() {
+  const int max_len = (sizeof(T) * 8 + 6) / 7;
+  Random rnd(302);
+  for (int len = 1; len <= max_len; len++) {
+    for (int prefix = 0; prefix < 20; prefix++) {
+      std::vector<int> lengths(prefix, 1);
+      lengths.push_back(len);
+      lengths.push_back(1 + rnd.Uniform(max_len));
+      const std::string buf = EncodeLengths<T>(&rnd, lengths);
+      for (size_t extra : {0, 1, 7, 8, 9, 24}) {
+        // 让 buf.size() 经过 23/24/25 等各个值
+        ASSERT_TRUE(
+            CheckBatch<T>(buf + std::string(extra, '\0'), lengths.size()));
+      }
+    }
+  }
+  for (size_t total = 20; total <= 28; total++) {
+    const std::string buf(total, '\x05');
+    ASSERT_TRUE(CheckBatch<T>(buf, total));
+  }
+}
+
+}  // namespace
+
+TEST(Coding, Fixed) {
+  std::string s;
+  for (uint32_t v = 0; v < 100000; v++) {
+    PutFixed32(&s, v);
+  }
+  const char* p = s.data();
+  for (uint32_t v = 0; v < 100000; v++) {
+    ASSERT_EQ(v, DecodeFixed32(p));
+    p += sizeof(uint32_t);
+  }
+
+  s.clear();
+  for (int power = 0; power <= 63; power++) {
+    const uint64_t v = uint64_t{1} << power;
+    PutFixed64(&s, v - 1);
+    PutFixed64(&s, v);
+    PutFixed64(&s, v + 1);
+  }
+  p = s.data();
+  for (int power = 0; power <= 63; power++) {
+    const uint64_t v = uint64_t{1} << power;
+    ASSERT_EQ(v - 1, DecodeFixed64(p));
+    ASSERT_EQ(v, DecodeFixed64(p + 8));
+    ASSERT_EQ(v + 1, DecodeFixed64(p + 16));
+    p += 24;
+  }
+}
+
+TEST(Coding, Varint32RoundTrip) {
+  std::string s;
+  for (uint32_t i = 0; i < (32 * 32); i++) {
+    PutVarint32(&s, (i / 32) << (i % 32));
+  }
+  Slice input(s);
+  for (uint32_t i = 0; i < (32 * 32); i++) {
+    uint32_t actual;
+    ASSERT_TRUE(GetVarint32(&input, &actual));
+    ASSERT_EQ((i / 32) << (i % 32), actual);
+    ASSERT_EQ(VarintLength(actual),
+              VarintLength((i / 32) << (i % 32)));
+  }
+  ASSERT_TRUE(input.empty());
+}
+
+TEST(Coding, Varint32BatchRandom) { CheckRandomMixes<uint32_t>(); }
+
+TEST(Coding, Varint64BatchRandom) { CheckRandomMixes<uint64_t>(); }
+
+TEST(Coding, Varint32BatchWindows) { CheckWindows<uint32_t>(); }
+
+TEST(Coding, Varint64BatchWindows) { CheckWindows<uint64_t>(); }
+
+// 最后一个 varint 被截断时返回 nullptr，截断处在不在 SIMD 处理的范围内都一样
+TEST(Coding, VarintBatchTruncated) {
+  Random rnd(303);
+  for (int trial = 0; trial < 500; trial++) {
+    const size_t n = 1 + rnd.Uniform(60);
+    std::vector<int> lengths32(n), lengths64(n);
+    for (size_t i = 0; i < n; i++) {
+      lengths32[i] = 1 + rnd.Uniform(5);
+      lengths64[i] = 1 + rnd.Uniform(10);
+    }
+    lengths32.back() = 2 + rnd.Uniform(4);
+    lengths64.back() = 2 + rnd.Uniform(9);
+    std::string buf = EncodeLengths<uint32_t>(&rnd, lengths32);
+    buf.resize(buf.size() - 1 - rnd.Uniform(lengths32.back() - 1));
+    ASSERT_FALSE(CheckBatch<uint32_t>(buf, n));
+
+    buf = EncodeLengths<uint64_t>(&rnd, lengths64);
+    buf.resize(buf.size() - 1 - rnd.Uniform(lengths64.back() - 1));
+    ASSERT_FALSE(CheckBatch<uint64_t>(buf, n));
+  }
+  // 要求的个数多于数据中的 varint 个数
+  ASSERT_FALSE(CheckBatch<uint32_t>(std::string(30, '\x01'), 31));
+  ASSERT_FALSE(CheckBatch<uint64_t>(std::string(30, '\x01'), 31));
+}
+
+// varint32 最多 5 个字节，第 5 个字节的高位超出 32 位时与逐个解析的结果相同，
+// 超过 5 个字节时失败；varint64 最多 10 个字节
+TEST(Coding, VarintBatchOverlong) {
+  for (size_t prefix : {0, 3, 12, 15, 30}) {
+    for (size_t suffix : {0, 1, 30}) {
+      std::string head(prefix, '\x01');
+      std::string tail(suffix, '\x01');
+      // 5 个字节，最后一个字节的高 4 位被截掉
+      std::string buf = head + std::string("\xff\xff\xff\xff\x7f", 5) + tail;
+      ASSERT_TRUE(CheckBatch<uint32_t>(buf, prefix + 1 + suffix));
+      // 6 个字节
+      buf = head + std::string("\x81\x80\x80\x80\x80\x01", 6) + tail;
+      ASSERT_FALSE(CheckBatch<uint32_t>(buf, prefix + 1 + suffix));
+      ASSERT_TRUE(CheckBatch<uint64_t>(buf, prefix + 1 + suffix));
+      // 11 个字节
+      buf = head + std::string(10, '\x80') + "\x01" + tail;
+      ASSERT_FALSE(CheckBatch<uint64_t>(buf, prefix + 1 + suffix));
+    }
+  }
+}
+
+}  // namespace leveldb
@@ -0,0 +1,275 @@
+#include "util/compression.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+#include "util/coding.h"
+
+#if HAVE_SNAPPY
+#include <snappy.h>
+#endif  // HAVE_SNAPPY
+#if HAVE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif  // HAVE_ZSTD
+#if HAVE_LZ4
+#include <lz4.h>
+#endif  // HAVE_LZ4
+
+namespace leveldb {
+
+namespace {
+
+#if HAVE_SNAPPY
+class SnappyCodec : public CompressionCodec {
+ public:
+  CompressionType type() const override { return kSnappyCompression; }
+  const char* Name() const override { return "Snappy"; }
+
+  bool Compress(const Slice& input, const CompressionDict* dict,
+                std::string* output) const override {
+    const size_t offset = output->size();
+    output->resize(offset + snappy::MaxCompressedLength(input.size()));
+    size_t outlen;
+    snappy::RawCompress(input.data(), input.size(), &(*output)[offset],
+                        &outlen);
+    output->resize(offset + outlen);
+    return true;
+  }
+
+  bool GetUncompressedLength(const Slice& input,
+                             size_t* length) const override {
+    return snappy::GetUncompressedLength(input.data(), input.size(), length);
+  }
+
+  bool Uncompress(const Slice& input, const CompressionDict* dict,
+                  char* output, size_t length) const override {
+    return snappy::RawUncompress(input.data(), input.size(), output);
+  }
+};
+#endif  // HAVE_SNAPPY
+
+#if HAVE_ZSTD
+// 每个线程复用一个压缩/解压上下文，不用为每个 block 重新分配
+ZSTD_CCtx* ThreadLocalCCtx() {
+  static thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> ctx(
+      ZSTD_createCCtx(), ZSTD_freeCCtx);
+  return ctx.get();
+}
+
+ZSTD_DCtx* ThreadLocalDCtx() {
+  static thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> ctx(
+      ZSTD_createDCtx(), ZSTD_freeDCtx);
+  return ctx.get();
+}
+
+struct ZstdCompressionDict : public CompressionDict {
+  explicit ZstdCompressionDict(ZSTD_CDict* d) : cdict(d) {}
+  ~ZstdCompressionDict() override { ZSTD_freeCDict(cdict); }
+
+  ZSTD_CDict* const cdict;
+};
+
+struct ZstdUncompressionDict : public CompressionDict {
+  explicit ZstdUncompressionDict(ZSTD_DDict* d) : ddict(d) {}
+  ~ZstdUncompressionDict() override { ZSTD_freeDDict(ddict); }
+
+  ZSTD_DDict* const ddict;
+};
+
+// zstd 的 frame 头中记录了原始长度
+class ZstdCodec : public CompressionCodec {
+ public:
+  // 默认压缩级别，与 zstd 命令行工具相同
+  static constexpr int kCompressionLevel = 3;
+
+  CompressionType type() const override { return kZstdCompression; }
+  const char* Name() const override { return "ZSTD"; }
+
+  bool Compress(const Slice& input, const CompressionDict* dict,
+                std::string* output) const override {
+    ZSTD_CCtx* ctx = ThreadLocalCCtx();
+    if (ctx == nullptr) {
+      return false;
+    }
+    const size_t offset = output->size();
+    output->resize(offset + ZSTD_compressBound(input.size()));
+    char* dst = &(*output)[offset];
+    const size_t capacity = output->size() - offset;
+    size_t outlen;
+    if (dict == nullptr) {
+      outlen = ZSTD_compressCCtx(ctx, dst, capacity, input.data(),
+                                 input.size(), kCompressionLevel);
+    } else {
+      outlen = ZSTD_compress_usingCDict(
+          ctx, dst, capacity, input.data(), input.size(),
+          static_cast<const ZstdCompressionDict*>(dict)->cdict);
+    }
+    if (ZSTD_isError(outlen)) {
+      output->resize(offset);
+      return false;
+    }
+    output->resize(offset + outlen);
+    return true;
+  }
+
+  bool GetUncompressedLength(const Slice& input,
+                             size_t* length) const override {
+    const unsigned long long n =
+        ZSTD_getFrameContentSize(input.data(), input.size());
+    if (n == ZSTD_CONTENTSIZE_UNKNOWN || n == ZSTD_CONTENTSIZE_ERROR) {
+      return false;
+    }
+    *length = static_cast<size_t>(n);
+    return true;
+  }
+
+  bool Uncompress(const Slice& input, const CompressionDict* dict,
+                  char* output, size_t length) const override {
+    ZSTD_DCtx* ctx = ThreadLocalDCtx();
+    if (ctx == nullptr) {
+      return false;
+    }
+    size_t n;
+    if (dict == nullptr) {
+      n = ZSTD_decompressDCtx(ctx, output, length, input.data(), input.size());
+    } else {
+      n = ZSTD_decompress_usingDDict(
+          ctx, output, length, input.data(), input.size(),
+          static_cast<const ZstdUncompressionDict*>(dict)->ddict);
+    }
+    return !ZSTD_isError(n) && n == length;
+  }
+
+  bool TrainDict(const std::vector<Slice>& samples, size_t max_bytes,
+                 std::string* dict) const override {
+    // ZDICT 要求样本连续存放
+    std::string buffer;
+    std::vector<size_t> sizes;
+    sizes.reserve(samples.size());
+    for (const Slice& sample : samples) {
+      buffer.append(sample.data(), sample.size());
+      sizes.push_back(sample.size());
+    }
+    dict->resize(max_bytes);
+    const size_t n = ZDICT_trainFromBuffer(
+        &(*dict)[0], max_bytes, buffer.data(), sizes.data(),
+        static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(n)) {
+      dict->clear();
+      return false;
+    }
+    dict->resize(n);
+    return true;
+  }
+
+  CompressionDict* NewCompressionDict(const Slice& dict) const override {
+    ZSTD_CDict* cdict =
+        ZSTD_createCDict(dict.data(), dict.size(), kCompressionLevel);
+    return cdict == nullptr ? nullptr : new ZstdCompressionDict(cdict);
+  }
+
+  CompressionDict* NewUncompressionDict(const Slice& dict) const override {
+    ZSTD_DDict* ddict = ZSTD_createDDict(dict.data(), dict.size());
+    return ddict == nullptr ? nullptr : new ZstdUncompressionDict(ddict);
+  }
+};
+#endif  // HAVE_ZSTD
+
+#if HAVE_LZ4
+// LZ4 的 block 格式不记录原始长度，在压缩数据前面加一个 varint32
+class LZ4Codec : public CompressionCodec {
+ public:
+  CompressionType type() const override { return kLZ4Compression; }
+  const char* Name() const override { return "LZ4"; }
+
+  bool Compress(const Slice& input, const CompressionDict* dict,
+                std::string* output) const override {
+    if (input.size() > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+      return false;
+    }
+    const size_t offset = output->size();
+    PutVarint32(output, static_cast<uint32_t>(input.size()));
+    const size_t header = output->size();
+    const int bound = LZ4_compressBound(static_cast<int>(input.size()));
+    output->resize(header + bound);
+    const int outlen =
+        LZ4_compress_default(input.data(), &(*output)[header],
+                             static_cast<int>(input.size()), bound);
+    if (outlen <= 0) {
+      output->resize(offset);
+      return false;
+    }
+    output->resize(header + outlen);
+    return true;
+  }
+
+  bool GetUncompressedLength(const Slice& input,
+                             size_t* length) const override {
+    Slice in = input;
+    uint32_t n;
+    if (!GetVarint32(&in, &n)) {
+      return false;
+    }
+    *length = n;
+    return true;
+  }
+
+  bool Uncompress(const Slice& input, const CompressionDict* dict,
+                  char* output, size_t length) const override {
+    Slice in = input;
+    uint32_t n;
+    if (!GetVarint32(&in, &n) || n != length) {
+      return false;
+    }
+    const int outlen =
+        LZ4_decompress_safe(in.data(), output, static_cast<int>(in.size()),
+                            static_cast<int>(length));
+    return outlen >= 0 && static_cast<size_t>(outlen) == length;
+  }
+};
+#endif  // HAVE_LZ4
+
+}  // namespace
+
+const CompressionCodec* GetCompressionCodec(CompressionType type) {
+  switch (type) {
+#if HAVE_SNAPPY
+    case kSnappyCompression: {
+      static const SnappyCodec snappy;
+      return &snappy;
+    }
+#endif  // HAVE_SNAPPY
+#if HAVE_ZSTD
+    case kZstdCompression: {
+      static const ZstdCodec zstd;
+      return &zstd;
+    }
+#endif  // HAVE_ZSTD
+#if HAVE_LZ4
+    case kLZ4Compression: {
+      static const LZ4Codec lz4;
+      return &lz4;
+    }
+#endif  // HAVE_LZ4
+    default:
+      return nullptr;
+  }
+}
+
+bool IsValidCompressionType(int type) {
+  return type >= kNoCompression && type <= kLZ4Compression;
+}
+
+CompressionType CompressionTypeForLevel(const Options& options, int level) {
+  const std::vector<CompressionType>& per_level = options.compression_per_level;
+  if (per_level.empty()) {
+    return options.compression;
+  }
+  // 超出的层使用最后一项
+  const size_t i = std::min<size_t>(level, per_level.size() - 1);
+  return per_level[i];
+}
+
+}  // namespace leveldb
@@ -0,0 +1,73 @@
+#ifndef STORAGE_LEVELDB_UTIL_COMPRESSION_H_
+#define STORAGE_LEVELDB_UTIL_COMPRESSION_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "leveldb/options.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+// 预先处理好的压缩字典，由 CompressionCodec 创建，只能传回给创建它的 codec
+// 创建之后只读，可以被多个线程同时使用
+class CompressionDict {
+ public:
+  virtual ~CompressionDict() = default;
+};
+
+// block 压缩算法的统一接口
+// 编译时定义 HAVE_SNAPPY / HAVE_ZSTD / HAVE_LZ4 并链接对应的库才会启用对应的实现
+class CompressionCodec {
+ public:
+  virtual ~CompressionCodec() = default;
+
+  // 写入 block trailer 的类型
+  virtual CompressionType type() const = 0;
+
+  virtual const char* Name() const = 0;
+
+  // 把 input 压缩后追加到 *output，失败时返回 false
+  // dict 不为 nullptr 时用它压缩，解压时必须使用同一个字典
+  virtual bool Compress(const Slice& input, const CompressionDict* dict,
+                        std::string* output) const = 0;
+
+  // 从压缩后的数据中取出解压后的长度
+  virtual bool GetUncompressedLength(const Slice& input,
+                                     size_t* length) const = 0;
+
+  // 把 input 解压到 output，output 的大小为 GetUncompressedLength 的结果
+  virtual bool Uncompress(const Slice& input, const CompressionDict* dict,
+                          char* output, size_t length) const = 0;
+
+  // 从 samples 中训练一个不超过 max_bytes 的字典，存入 *dict
+  // 不支持字典或者样本不足时返回 false
+  virtual bool TrainDict(const std::vector<Slice>& samples, size_t max_bytes,
+                         std::string* dict) const {
+    return false;
+  }
+
+  // 用 TrainDict 得到的字典内容创建压缩/解压使用的字典，不支持时返回 nullptr
+  // 结果不引用 dict 的内存，由调用者 delete
+  virtual CompressionDict* NewCompressionDict(const Slice& dict) const {
+    return nullptr;
+  }
+  virtual CompressionDict* NewUncompressionDict(const Slice& dict) const {
+    return nullptr;
+  }
+};
+
+// 返回 type 对应的实现，当前编译的版本不支持时返回 nullptr
+// 返回的对象是全局的，不需要释放
+const CompressionCodec* GetCompressionCodec(CompressionType type);
+
+// type 是否为合法的压缩类型（不管当前编译的版本是否支持）
+bool IsValidCompressionType(int type);
+
+// 第 level 层的 sstable 使用的压缩方式
+CompressionType CompressionTypeForLevel(const Options& options, int level);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_COMPRESSION_H_
@@ -0,0 +1,145 @@
+#include "util/compression.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+namespace {
+
+const CompressionType kCodecTypes[] = {kSnappyCompression, kZstdCompression,
+                                       kLZ4Compression};
+
+std::string RandomString(Random* rnd, size_t len) {
+  std::string s(len, '\0');
+  for (size_t i = 0; i < len; i++) {
+    s[i] = static_cast<char>(rnd->Uniform(256));
+  }
+  return s;
+}
+
+// 由少量单词组成，容易压缩
+std::string RepetitiveString(Random* rnd, size_t len) {
+  static const char* kWords[] = {"{\"id\":", "\"name\":\"", "leveldb", "\",",
+                                 "\"value\":", "}", "memtable", " "};
+  std::string s;
+  while (s.size() < len) {
+    s += kWords[rnd->Uniform(8)];
+  }
+  s.resize(len);
+  return s;
+}
+
+void CheckRoundTrip(const CompressionCodec* codec, const std::string& input) {
+  std::string compressed;
+  ASSERT_TRUE(codec->Compress(input, nullptr, &compressed)) << codec->Name();
+  size_t length;
+  ASSERT_TRUE(codec->GetUncompressedLength(compressed, &length));
+  ASSERT_EQ(input.size(), length);
+  std::string output(length, '\0');
+  ASSERT_TRUE(codec->Uncompress(compressed, nullptr, &output[0], length));
+  ASSERT_EQ(input, output);
+}
+
+}  // namespace
+
+TEST(CompressionTest, RoundTrip) {
+  Random rnd(301);
+  int supported = 0;
+  for (CompressionType type : kCodecTypes) {
+    const CompressionCodec* codec = GetCompressionCodec(type);
+    if (codec == nullptr) {
+      continue;  // 没有编译进来
+    }
+    supported++;
+    ASSERT_EQ(type, codec->type());
+    for (size_t len : {0, 1, 100, 4096, 65536, 1 << 20}) {
+      CheckRoundTrip(codec, RandomString(&rnd, len));
+      CheckRoundTrip(codec, RepetitiveString(&rnd, len));
+    }
+  }
+  ASSERT_EQ(nullptr, GetCompressionCodec(kNoCompression));
+  if (supported == 0) {
+    GTEST_SKIP() << "no compression library compiled in";
+  }
+}
+
+TEST(CompressionTest, CompressesRepetitiveData) {
+  Random rnd(301);
+  const std::string input = RepetitiveString(&rnd, 4096);
+  for (CompressionType type : kCodecTypes) {
+    const CompressionCodec* codec = GetCompressionCodec(type);
+    if (codec == nullptr) {
+      continue;
+    }
+    std::string compressed;
+    ASSERT_TRUE(codec->Compress(input, nullptr, &compressed));
+    ASSERT_LT(compressed.size(), input.size() / 2) << codec->Name();
+  }
+}
+
+// 损坏的输入只能返回 false，不能越界读写
+TEST(CompressionTest, CorruptInput) {
+  Random rnd(301);
+  const std::string input = RepetitiveString(&rnd, 8192);
+  for (CompressionType type : kCodecTypes) {
+    const CompressionCodec* codec = GetCompressionCodec(type);
+    if (codec == nullptr) {
+      continue;
+    }
+    std::string compressed;
+    ASSERT_TRUE(codec->Compress(input, nullptr, &compressed));
+    for (int i = 0; i < 200; i++) {
+      std::string corrupted = compressed;
+      if (rnd.OneIn(4)) {
+        corrupted.resize(rnd.Uniform(static_cast<int>(corrupted.size())));
+      } else {
+        corrupted[rnd.Uniform(static_cast<int>(corrupted.size()))] ^=
+            static_cast<char>(1 + rnd.Uniform(255));
+      }
+      size_t length;
+      if (!codec->GetUncompressedLength(corrupted, &length) ||
+          length > (1 << 20)) {
+        continue;
+      }
+      std::string output(length, '\0');
+      if (codec->Uncompress(corrupted, nullptr, &output[0], length)) {
+        ASSERT_EQ(length, output.size());
+      }
+    }
+    // 输出缓冲区比实际数据小
+    std::string output(input.size() / 2, '\0');
+    ASSERT_FALSE(
+        codec->Uncompress(compressed, nullptr, &output[0], output.size()))
+        << codec->Name();
+  }
+}
+
+TEST(CompressionTest, ValidTypes) {
+  ASSERT_TRUE(IsValidCompressionType(kNoCompression));
+  ASSERT_TRUE(IsValidCompressionType(kSnappyCompression));
+  ASSERT_TRUE(IsValidCompressionType(kZstdCompression));
+  ASSERT_TRUE(IsValidCompressionType(kLZ4Compression));
+  ASSERT_FALSE(IsValidCompressionType(-1));
+  ASSERT_FALSE(IsValidCompressionType(kLZ4Compression + 1));
+}
+
+TEST(CompressionTest, TypeForLevel) {
+  Options options;
+  options.compression = kSnappyCompression;
+  ASSERT_EQ(kSnappyCompression, CompressionTypeForLevel(options, 0));
+  ASSERT_EQ(kSnappyCompression, CompressionTypeForLevel(options, 6));
+
+  // 设置了 compression_per_level 之后 compression 不再生效，超出的层用最后一项
+  options.compression_per_level = {kNoCompression, kLZ4Compression,
+                                   kZstdCompression};
+  ASSERT_EQ(kNoCompression, CompressionTypeForLevel(options, 0));
+  ASSERT_EQ(kLZ4Compression, CompressionTypeForLevel(options, 1));
+  ASSERT_EQ(kZstdCompression, CompressionTypeForLevel(options, 2));
+  ASSERT_EQ(kZstdCompression, CompressionTypeForLevel(options, 6));
+}
+
+}  // namespace leveldb
@@ -0,0 +1,192 @@
+#include "util/crc32c.h"
+
+#include <cstring>
+
+#include "util/coding.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LEVELDB_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace leveldb {
+namespace crc32c {
+
+namespace {
+
+// crc32c（Castagnoli）多项式的反射表示
+constexpr uint32_t kPoly = 0x82f63b78u;
+
+// slicing-by-8 的表: t[j][i] 是字节 i 后面跟 j 个 0 字节的 crc（不含取反）
+struct SliceTables {
+  uint32_t t[8][256];
+};
+
+constexpr SliceTables MakeSliceTables() {
+  SliceTables tables{};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ ((crc & 1) ? kPoly : 0);
+    }
+    tables.t[0][i] = crc;
+  }
+  for (int j = 1; j < 8; j++) {
+    for (uint32_t i = 0; i < 256; i++) {
+      const uint32_t prev = tables.t[j - 1][i];
+      tables.t[j][i] = (prev >> 8) ^ tables.t[0][prev & 0xff];
+    }
+  }
+  return tables;
+}
+
+constexpr SliceTables kTables = MakeSliceTables();
+
+// 每次查 8 张表处理 8 个字节
+uint32_t ExtendPortable(uint32_t crc, const char* data, size_t n) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+  const uint8_t* const e = p + n;
+  const auto& t = kTables.t;
+  uint32_t l = crc ^ 0xffffffffu;
+  while (e - p >= 8) {
+    const uint32_t lo = DecodeFixed32(reinterpret_cast<const char*>(p)) ^ l;
+    const uint32_t hi = DecodeFixed32(reinterpret_cast<const char*>(p + 4));
+    l = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^
+        t[4][lo >> 24] ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+        t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    p += 8;
+  }
+  while (p < e) {
+    l = t[0][(l ^ *p++) & 0xff] ^ (l >> 8);
+  }
+  return l ^ 0xffffffffu;
+}
+
+#if defined(LEVELDB_X86_DISPATCH)
+
+// 反射表示下的 x^n mod P，x^0 对应最高位
+constexpr uint32_t XPowMod(uint32_t n) {
+  uint32_t v = 0x80000000u;
+  for (uint32_t i = 0; i < n; i++) {
+    v = (v >> 1) ^ ((v & 1) ? kPoly : 0);
+  }
+  return v;
+}
+
+// 三路并行时每一路的长度
+// crc32 指令的延迟是 3 个周期、吞吐是每周期一条，三条互不依赖的链正好
+// 填满流水线；长的一档用于大 block，短的一档处理剩下的部分
+constexpr size_t kLongBlock = 4096;
+constexpr size_t kShortBlock = 256;
+
+// 把一路的 crc 移过 block 长度所需的常数，见 Shift()
+constexpr uint32_t kLongShift = XPowMod(8 * kLongBlock - 33);
+constexpr uint32_t kShortShift = XPowMod(8 * kShortBlock - 33);
+
+inline uint64_t Load64(const uint8_t* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// 返回 crc 后面补 len 个 0 字节之后的 crc（不含取反），k = x^(8*len-33)
+// 在反射表示下 clmul 的 64 位结果多乘了一个 x，crc32 指令再乘上 x^32 并取模，
+// 合起来正好是 crc * x^(8*len) mod P
+__attribute__((target("sse4.2,pclmul"))) inline uint64_t Shift(uint64_t crc,
+                                                               uint32_t k) {
+  const __m128i a = _mm_cvtsi64_si128(static_cast<int64_t>(crc));
+  const __m128i b = _mm_cvtsi32_si128(static_cast<int>(k));
+  const uint64_t product =
+      static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_clmulepi64_si128(a, b, 0)));
+  return _mm_crc32_u64(0, product);
+}
+
+// 把 [p, e) 中能凑成三段 block 的部分分三路计算，再用 Shift() 合并
+// 第二、三路从 0 开始，crc 是线性的: crc(A|B) = crc(A) * x^(8|B|) ^ crc(B)
+template <size_t kBlock>
+__attribute__((target("sse4.2,pclmul"))) inline const uint8_t* Extend3Way(
+    uint64_t* crc, const uint8_t* p, const uint8_t* e, uint32_t shift) {
+  while (static_cast<size_t>(e - p) >= 3 * kBlock) {
+    uint64_t c0 = *crc, c1 = 0, c2 = 0;
+    for (size_t i = 0; i < kBlock; i += 8) {
+      c0 = _mm_crc32_u64(c0, Load64(p + i));
+      c1 = _mm_crc32_u64(c1, Load64(p + kBlock + i));
+      c2 = _mm_crc32_u64(c2, Load64(p + 2 * kBlock + i));
+    }
+    c0 = Shift(c0, shift) ^ c1;
+    *crc = Shift(c0, shift) ^ c2;
+    p += 3 * kBlock;
+  }
+  return p;
+}
+
+__attribute__((target("sse4.2,pclmul"))) uint32_t ExtendSSE42(
+    uint32_t crc, const char* data, size_t n) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+  const uint8_t* const e = p + n;
+  uint64_t l = crc ^ 0xffffffffu;
+  // 先处理到 8 字节对齐
+  while (p < e && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    l = _mm_crc32_u8(static_cast<uint32_t>(l), *p++);
+  }
+  p = Extend3Way<kLongBlock>(&l, p, e, kLongShift);
+  p = Extend3Way<kShortBlock>(&l, p, e, kShortShift);
+  while (e - p >= 8) {
+    l = _mm_crc32_u64(l, Load64(p));
+    p += 8;
+  }
+  while (p < e) {
+    l = _mm_crc32_u8(static_cast<uint32_t>(l), *p++);
+  }
+  return static_cast<uint32_t>(l) ^ 0xffffffffu;
+}
+
+#endif  // defined(LEVELDB_X86_DISPATCH)
+
+using internal::ExtendImpl;
+
+ExtendImpl ChooseImpl() {
+#if defined(LEVELDB_X86_DISPATCH)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul")) {
+    return {ExtendSSE42, "sse4.2"};
+  }
+#endif
+  return {ExtendPortable, "slicing-by-8"};
+}
+
+const ExtendImpl& Impl() {
+  static const ExtendImpl impl = ChooseImpl();
+  return impl;
+}
+
+// 第一次调用时选择实现，之后直接跳转到选中的实现
+uint32_t ExtendResolve(uint32_t crc, const char* data, size_t n) {
+  internal::ExtendFn fn = Impl().fn;
+  internal::extend_fn.store(fn, std::memory_order_relaxed);
+  return fn(crc, data, n);
+}
+
+}  // namespace
+
+namespace internal {
+
+std::atomic<ExtendFn> extend_fn{ExtendResolve};
+
+std::vector<ExtendImpl> SupportedImpls() {
+  std::vector<ExtendImpl> impls = {{ExtendPortable, "slicing-by-8"}};
+#if defined(LEVELDB_X86_DISPATCH)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul")) {
+    impls.push_back({ExtendSSE42, "sse4.2"});
+  }
+#endif
+  return impls;
+}
+
+}  // namespace internal
+
+const char* ImplName() { return Impl().name; }
+
+}  // namespace crc32c
+}  // namespace leveldb
@@ -0,0 +1,60 @@
+#ifndef STORAGE_LEVELDB_UTIL_CRC32C_H_
+#define STORAGE_LEVELDB_UTIL_CRC32C_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace leveldb {
+namespace crc32c {
+
+namespace internal {
+
+typedef uint32_t (*ExtendFn)(uint32_t crc, const char* data, size_t n);
+
+// 当前使用的实现，第一次调用时根据 CPU 选定
+extern std::atomic<ExtendFn> extend_fn;
+
+struct ExtendImpl {
+  ExtendFn fn;
+  const char* name;
+};
+
+// 当前 CPU 能运行的所有实现（包括没有选中的），供测试逐一检查
+std::vector<ExtendImpl> SupportedImpls();
+
+}  // namespace internal
+
+// 返回 concat(A, data[0,n-1]) 的 crc32c，init_crc 是某个字符串 A 的 crc32c
+// 运行时根据 CPU 选择实现: 支持 SSE4.2 和 PCLMUL 时用 crc32 指令分三路
+// 并行计算再合并，否则用 slicing-by-8 查表
+inline uint32_t Extend(uint32_t init_crc, const char* data, size_t n) {
+  return internal::extend_fn.load(std::memory_order_relaxed)(init_crc, data, n);
+}
+
+// 返回 data[0,n-1] 的 crc32c
+inline uint32_t Value(const char* data, size_t n) { return Extend(0, data, n); }
+
+static const uint32_t kMaskDelta = 0xa282ead8ul;
+
+// 对 crc 做变换后再存储
+// 计算包含 crc 的字符串的 crc 容易出问题，所以存储的 crc 要先变换
+inline uint32_t Mask(uint32_t crc) {
+  // 循环右移 15 位再加上一个常数
+  return ((crc >> 15) | (crc << 17)) + kMaskDelta;
+}
+
+// Mask() 的逆变换
+inline uint32_t Unmask(uint32_t masked_crc) {
+  uint32_t rot = masked_crc - kMaskDelta;
+  return ((rot >> 17) | (rot << 15));
+}
+
+// 返回当前使用的实现的名字，用于日志和调试
+const char* ImplName();
+
+}  // namespace crc32c
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_CRC32C_H_
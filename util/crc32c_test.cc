@@ -0,0 +1,142 @@
+#include "util/crc32c.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/random.h"
+
+namespace leveldb {
+namespace crc32c {
+
+// 逐位计算的参考实现
+static uint32_t BitwiseExtend(uint32_t crc, const char* data, size_t n) {
+  uint32_t l = crc ^ 0xffffffffu;
+  for (size_t i = 0; i < n; i++) {
+    l ^= static_cast<uint8_t>(data[i]);
+    for (int k = 0; k < 8; k++) {
+      l = (l >> 1) ^ ((l & 1) ? 0x82f63b78u : 0);
+    }
+  }
+  return l ^ 0xffffffffu;
+}
+
+static std::string RandomBytes(Random* rnd, size_t n) {
+  std::string s(n, '\0');
+  for (size_t i = 0; i < n; i++) {
+    s[i] = static_cast<char>(rnd->Uniform(256));
+  }
+  return s;
+}
+
+// 标准测试向量，每个实现都要得到相同的结果
+TEST(CRC, StandardResults) {
+  for (const internal::ExtendImpl& impl : internal::SupportedImpls()) {
+    auto value = [&impl](const char* data, size_t n) {
+      return impl.fn(0, data, n);
+    };
+    ASSERT_EQ(0xe3069283u, value("123456789", 9)) << impl.name;
+
+    char buf[32];
+    std::memset(buf, 0, sizeof(buf));
+    ASSERT_EQ(0x8a9136aau, value(buf, sizeof(buf))) << impl.name;
+
+    std::memset(buf, 0xff, sizeof(buf));
+    ASSERT_EQ(0x62a8ab43u, value(buf, sizeof(buf))) << impl.name;
+
+    for (int i = 0; i < 32; i++) {
+      buf[i] = static_cast<char>(i);
+    }
+    ASSERT_EQ(0x46dd794eu, value(buf, sizeof(buf))) << impl.name;
+
+    for (int i = 0; i < 32; i++) {
+      buf[i] = static_cast<char>(31 - i);
+    }
+    ASSERT_EQ(0x113fdb5cu, value(buf, sizeof(buf))) << impl.name;
+
+    const uint8_t data[48] = {
+        0x01, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+        0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x18, 0x28, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    ASSERT_EQ(0xd9963a56u,
+              value(reinterpret_cast<const char*>(data), sizeof(data)))
+        << impl.name;
+  }
+}
+
+TEST(CRC, Values) {
+  ASSERT_NE(Value("a", 1), Value("foo", 3));
+  ASSERT_EQ(Value("123456789", 9), BitwiseExtend(0, "123456789", 9));
+}
+
+// 覆盖三路并行的两档 block 长度附近的长度和不对齐的起始位置
+TEST(CRC, MatchesBitwise) {
+  Random rnd(301);
+  const std::string data = RandomBytes(&rnd, 3 * 4096 * 2 + 64);
+  std::vector<size_t> lengths;
+  for (size_t n = 0; n <= 64; n++) {
+    lengths.push_back(n);
+  }
+  for (size_t base : {size_t{3 * 256}, size_t{3 * 4096}, size_t{2 * 3 * 4096}}) {
+    for (size_t n = base - 9; n <= base + 9; n++) {
+      lengths.push_back(n);
+    }
+  }
+  for (int i = 0; i < 50; i++) {
+    lengths.push_back(rnd.Uniform(3 * 4096 * 2));
+  }
+  for (const internal::ExtendImpl& impl : internal::SupportedImpls()) {
+    for (size_t n : lengths) {
+      for (size_t offset = 0; offset < 8; offset++) {
+        const char* p = data.data() + offset;
+        ASSERT_EQ(BitwiseExtend(0, p, n), impl.fn(0, p, n))
+            << impl.name << " n=" << n << " offset=" << offset;
+      }
+    }
+  }
+}
+
+// 任意切分成两段分别计算，结果与一次计算相同
+TEST(CRC, Extend) {
+  ASSERT_EQ(Value("hello world", 11), Extend(Value("hello ", 6), "world", 5));
+
+  Random rnd(302);
+  const std::string data = RandomBytes(&rnd, 3 * 4096 + 100);
+  for (const internal::ExtendImpl& impl : internal::SupportedImpls()) {
+    const uint32_t expected = BitwiseExtend(0, data.data(), data.size());
+    for (int i = 0; i < 200; i++) {
+      const size_t split = rnd.Uniform(static_cast<int>(data.size() + 1));
+      const uint32_t first = impl.fn(0, data.data(), split);
+      ASSERT_EQ(expected, impl.fn(first, data.data() + split,
+                                  data.size() - split))
+          << impl.name << " split=" << split;
+    }
+  }
+}
+
+TEST(CRC, Mask) {
+  const uint32_t crc = Value("foo", 3);
+  ASSERT_NE(crc, Mask(crc));
+  ASSERT_NE(crc, Mask(Mask(crc)));
+  ASSERT_EQ(crc, Unmask(Mask(crc)));
+  ASSERT_EQ(crc, Unmask(Unmask(Mask(Mask(crc)))));
+  for (uint32_t v : {0u, 1u, 0x80000000u, 0xffffffffu, kMaskDelta}) {
+    ASSERT_EQ(v, Unmask(Mask(v)));
+  }
+}
+
+TEST(CRC, Dispatch) {
+  // 选中的实现必须是当前 CPU 支持的实现之一
+  const std::string name = ImplName();
+  bool found = false;
+  for (const internal::ExtendImpl& impl : internal::SupportedImpls()) {
+    found = found || name == impl.name;
+  }
+  ASSERT_TRUE(found) << name;
+}
+
+}  // namespace crc32c
+}  // namespace leveldb
@@ -0,0 +1,94 @@
+#ifndef STORAGE_LEVELDB_UTIL_DYNAMIC_BLOOM_H_
+#define STORAGE_LEVELDB_UTIL_DYNAMIC_BLOOM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "leveldb/slice.h"
+#include "util/arena.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+// 可以边写边查的 bloom filter，给 memtable 使用
+// 内存从 arena 分配，每个 key 的 num_probes 个位都落在同一个 64 字节的
+// cache line 里，一次查询最多一次 cache miss
+//
+// Add 可以和 MayContain 并发执行；多个 Add 之间需要外部同步
+// （memtable 的写本来就是串行的）
+class DynamicBloom {
+ public:
+  // total_bits 会向上取整到 512 的倍数
+  DynamicBloom(Arena* arena, uint32_t total_bits, int num_probes = 6);
+
+  DynamicBloom(const DynamicBloom&) = delete;
+  DynamicBloom& operator=(const DynamicBloom&) = delete;
+
+  void Add(const Slice& key) { AddHash(BloomHash(key)); }
+
+  bool MayContain(const Slice& key) const {
+    return MayContainHash(BloomHash(key));
+  }
+
+ private:
+  static constexpr uint32_t kWordsPerLine = 8;  // 64 字节
+
+  static uint32_t BloomHash(const Slice& key) {
+    return Hash(key.data(), key.size(), 0xbc9f1d34);
+  }
+
+  void AddHash(uint32_t h);
+  bool MayContainHash(uint32_t h) const;
+
+  uint32_t num_lines_;
+  const int num_probes_;
+  std::atomic<uint64_t>* data_;
+};
+
+inline DynamicBloom::DynamicBloom(Arena* arena, uint32_t total_bits,
+                                  int num_probes)
+    : num_probes_(num_probes) {
+  num_lines_ = (total_bits + 511) / 512;
+  if (num_lines_ == 0) num_lines_ = 1;
+  const size_t words = static_cast<size_t>(num_lines_) * kWordsPerLine;
+  char* raw = arena->AllocateAligned(words * sizeof(std::atomic<uint64_t>));
+  data_ = reinterpret_cast<std::atomic<uint64_t>*>(raw);
+  for (size_t i = 0; i < words; i++) {
+    new (&data_[i]) std::atomic<uint64_t>(0);
+  }
+}
+
+inline void DynamicBloom::AddHash(uint32_t h) {
+  // 高位选 cache line，低位在 cache line 内做 double hashing
+  std::atomic<uint64_t>* line =
+      data_ + (static_cast<uint64_t>(h) * num_lines_ >> 32) * kWordsPerLine;
+  const uint32_t delta = (h >> 17) | (h << 15);
+  for (int i = 0; i < num_probes_; i++) {
+    const uint32_t bitpos = h & 511;
+    // 只有一个写者，relaxed 就够了: memtable 先 Add 再插入跳表，
+    // 读者能看到 entry 时也一定能看到这些位
+    line[bitpos >> 6].fetch_or(uint64_t{1} << (bitpos & 63),
+                               std::memory_order_relaxed);
+    h += delta;
+  }
+}
+
+inline bool DynamicBloom::MayContainHash(uint32_t h) const {
+  const std::atomic<uint64_t>* line =
+      data_ + (static_cast<uint64_t>(h) * num_lines_ >> 32) * kWordsPerLine;
+  const uint32_t delta = (h >> 17) | (h << 15);
+  for (int i = 0; i < num_probes_; i++) {
+    const uint32_t bitpos = h & 511;
+    if ((line[bitpos >> 6].load(std::memory_order_relaxed) &
+         (uint64_t{1} << (bitpos & 63))) == 0) {
+      return false;
+    }
+    h += delta;
+  }
+  return true;
+}
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_DYNAMIC_BLOOM_H_
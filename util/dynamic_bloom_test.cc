@@ -0,0 +1,76 @@
+#include "util/dynamic_bloom.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "util/arena.h"
+#include "util/coding.h"
+
+namespace leveldb {
+
+static Slice Key(uint32_t i, char* buffer) {
+  EncodeFixed32(buffer, i);
+  return Slice(buffer, sizeof(uint32_t));
+}
+
+TEST(DynamicBloomTest, EmptyFilter) {
+  Arena arena;
+  DynamicBloom bloom(&arena, 1024);
+  ASSERT_FALSE(bloom.MayContain("hello"));
+  ASSERT_FALSE(bloom.MayContain("world"));
+}
+
+TEST(DynamicBloomTest, VaryingLengths) {
+  char buffer[sizeof(uint32_t)];
+  for (uint32_t length = 1; length <= 10000; length = length * 3 + 1) {
+    Arena arena;
+    DynamicBloom bloom(&arena, length * 10);
+    for (uint32_t i = 0; i < length; i++) {
+      bloom.Add(Key(i, buffer));
+    }
+    // 没有 false negative
+    for (uint32_t i = 0; i < length; i++) {
+      ASSERT_TRUE(bloom.MayContain(Key(i, buffer))) << length << " " << i;
+    }
+    // 每个 key 10 位、6 个 probe，false positive 应该在 1% 左右
+    int false_positives = 0;
+    for (uint32_t i = 0; i < 10000; i++) {
+      if (bloom.MayContain(Key(i + 1000000000, buffer))) {
+        false_positives++;
+      }
+    }
+    if (length >= 1000) {
+      ASSERT_LE(false_positives, 300) << length;
+    }
+  }
+}
+
+// 一个线程 Add 的同时其他线程查询，已经 Add 完成的 key 一定能查到
+TEST(DynamicBloomTest, ConcurrentAddAndQuery) {
+  const uint32_t kNumKeys = 200000;
+  Arena arena;
+  DynamicBloom bloom(&arena, kNumKeys * 10);
+  std::atomic<uint32_t> added(0);
+  std::thread writer([&] {
+    char buffer[sizeof(uint32_t)];
+    for (uint32_t i = 0; i < kNumKeys; i++) {
+      bloom.Add(Key(i, buffer));
+      added.store(i + 1, std::memory_order_release);
+    }
+  });
+  std::thread reader([&] {
+    char buffer[sizeof(uint32_t)];
+    uint32_t n;
+    while ((n = added.load(std::memory_order_acquire)) < kNumKeys) {
+      for (uint32_t i = (n > 100 ? n - 100 : 0); i < n; i++) {
+        ASSERT_TRUE(bloom.MayContain(Key(i, buffer)));
+      }
+    }
+  });
+  writer.join();
+  reader.join();
+}
+
+}  // namespace leveldb
@@ -0,0 +1,26 @@
+#include "leveldb/env.h"
+
+namespace leveldb {
+
+Env::Env() = default;
+
+Env::~Env() = default;
+
+Status Env::NewWritableFile(const std::string& fname, const EnvOptions& options,
+                            WritableFile** result) {
+  return NewWritableFile(fname, result);
+}
+
+RandomAccessFile::~RandomAccessFile() = default;
+
+Status RandomAccessFile::MultiRead(ReadRequest* reqs, size_t n) const {
+  for (size_t i = 0; i < n; i++) {
+    reqs[i].status =
+        Read(reqs[i].offset, reqs[i].len, &reqs[i].result, reqs[i].scratch);
+  }
+  return Status::OK();
+}
+
+WritableFile::~WritableFile() = default;
+
+}  // namespace leveldb
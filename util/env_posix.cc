@@ -0,0 +1,800 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif  // HAVE_IO_URING
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "leveldb/env.h"
+#include "leveldb/slice.h"
+#include "util/arena.h"
+#include "util/env_posix_test_helper.h"
+
+namespace leveldb {
+
+namespace {
+
+Status PosixError(const std::string& context, int error_number) {
+  if (error_number == ENOENT) {
+    return Status::NotFound(context, std::strerror(error_number));
+  } else {
+    return Status::IOError(context, std::strerror(error_number));
+  }
+}
+
+// MultiRead 一次最多同时发出多少个读请求
+constexpr unsigned kMultiReadQueueDepth = 64;
+
+// 没有 io_uring 时 MultiRead 使用的线程数
+constexpr int kReadThreads = 4;
+
+#if HAVE_IO_URING
+// io_uring_enter 连续多少次没有进展（被信号打断或者暂时缺少资源）之后
+// 不再提交剩下的请求
+constexpr int kMaxEnterRetries = 100;
+
+// 直接通过系统调用使用 io_uring（不依赖 liburing）
+// 每个线程一个 ring，只用来提交一批读请求并等待它们全部完成
+class IoUring {
+ public:
+  // 内核不支持或者不允许使用 io_uring 时返回 nullptr
+  static IoUring* Create(unsigned entries) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    const int fd =
+        static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) {
+      return nullptr;
+    }
+    IoUring* ring = new IoUring(fd);
+    if (!ring->Map(params)) {
+      delete ring;
+      return nullptr;
+    }
+    return ring;
+  }
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  ~IoUring() {
+    if (sqes_ != MAP_FAILED) ::munmap(sqes_, sqes_size_);
+    if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) {
+      ::munmap(cq_ptr_, cq_size_);
+    }
+    if (sq_ptr_ != MAP_FAILED) ::munmap(sq_ptr_, sq_size_);
+    ::close(fd_);
+  }
+
+  unsigned entries() const { return sq_entries_; }
+
+  // 从 fd 读取 reqs[0..n-1]，n 不超过 entries()
+  // 返回提交并完成了的请求个数，它们是 reqs 开头的一段；
+  // 小于 n 时 ring 中还留有没有提交的请求，不能再使用，剩下的请求由调用者另外读
+  size_t Read(int fd, ReadRequest* reqs, size_t n,
+              const std::string& filename) {
+    assert(n <= sq_entries_);
+    std::unique_ptr<struct iovec[]> iovecs(new struct iovec[n]);
+    // 上一批请求已经全部完成，提交队列一定是空的
+    unsigned tail = *sq_tail_;
+    for (size_t i = 0; i < n; i++) {
+      iovecs[i].iov_base = reqs[i].scratch;
+      iovecs[i].iov_len = reqs[i].len;
+      const unsigned index = tail & *sq_mask_;
+      struct io_uring_sqe* sqe = &sqes_[index];
+      std::memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_READV;
+      sqe->fd = fd;
+      sqe->addr = reinterpret_cast<uint64_t>(&iovecs[i]);
+      sqe->len = 1;
+      sqe->off = reqs[i].offset;
+      sqe->user_data = i;
+      sq_array_[index] = index;
+      tail++;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+    size_t submitted = 0;
+    size_t completed = 0;
+    bool submitting = true;
+    int failures = 0;  // 连续没有任何进展的 io_uring_enter 次数
+    while (completed < submitted || (submitting && submitted < n)) {
+      const unsigned to_submit =
+          submitting ? static_cast<unsigned>(n - submitted) : 0;
+      const int ret = static_cast<int>(
+          ::syscall(__NR_io_uring_enter, fd_, to_submit, 1,
+                    IORING_ENTER_GETEVENTS, nullptr, 0));
+      bool progress = false;
+      if (ret > 0) {
+        submitted += ret;
+        progress = true;
+      } else if (ret < 0 && errno != EINTR && errno != EAGAIN &&
+                 errno != EBUSY) {
+        // 剩下的请求提交不了；已经提交的仍然会完成，scratch 被内核引用，
+        // 只能继续等待它们
+        submitting = false;
+      }
+
+      // 出错时也收取已经完成的请求，EBUSY 时这样才能腾出完成队列的空间
+      unsigned head = *cq_head_;
+      const unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      for (; head != cq_tail; head++) {
+        const struct io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+        ReadRequest* req = &reqs[cqe.user_data];
+        if (cqe.res >= 0) {
+          req->result = Slice(req->scratch, cqe.res);
+          req->status = Status::OK();
+        } else {
+          req->result = Slice(req->scratch, 0);
+          req->status = PosixError(filename, -cqe.res);
+        }
+        completed++;
+        progress = true;
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+      if (progress) {
+        failures = 0;
+      } else if (++failures >= kMaxEnterRetries) {
+        // 一直提交不了就放弃剩下的请求；只剩等待时不会出错，
+        // 万一出错也只能继续等待已经提交的请求完成
+        submitting = false;
+        if (completed < submitted) {
+          std::this_thread::yield();
+        }
+      }
+    }
+    return submitted;
+  }
+
+ private:
+  explicit IoUring(int fd)
+      : fd_(fd),
+        sq_ptr_(MAP_FAILED),
+        cq_ptr_(MAP_FAILED),
+        sqes_(static_cast<struct io_uring_sqe*>(MAP_FAILED)) {}
+
+  bool Map(const struct io_uring_params& p) {
+    sq_entries_ = p.sq_entries;
+    sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    }
+    sq_ptr_ = ::mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) return false;
+    if (single_mmap) {
+      cq_ptr_ = sq_ptr_;
+    } else {
+      cq_ptr_ = ::mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+      if (cq_ptr_ == MAP_FAILED) return false;
+    }
+    sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = static_cast<struct io_uring_sqe*>(
+        ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) return false;
+
+    char* sq = static_cast<char*>(sq_ptr_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    char* cq = static_cast<char*>(cq_ptr_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+    return true;
+  }
+
+  const int fd_;
+  unsigned sq_entries_ = 0;
+  void* sq_ptr_;
+  void* cq_ptr_;
+  size_t sq_size_ = 0;
+  size_t cq_size_ = 0;
+  struct io_uring_sqe* sqes_;
+  size_t sqes_size_ = 0;
+
+  // 指向与内核共享的内存
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  struct io_uring_cqe* cqes_ = nullptr;
+};
+
+// 有一个线程创建 ring 失败之后，其他线程也不再尝试
+std::atomic<bool> io_uring_disabled{false};
+
+// 当前线程的 ring，第一次调用时创建，不可用时为 nullptr
+std::unique_ptr<IoUring>& ThreadLocalIoUring() {
+  static thread_local std::unique_ptr<IoUring> ring;
+  static thread_local bool initialized = false;
+  if (!initialized) {
+    initialized = true;
+    if (!io_uring_disabled.load(std::memory_order_relaxed)) {
+      ring.reset(IoUring::Create(kMultiReadQueueDepth));
+      if (ring == nullptr) {
+        io_uring_disabled.store(true, std::memory_order_relaxed);
+      }
+    }
+  }
+  return ring;
+}
+#endif  // HAVE_IO_URING
+
+// 没有 io_uring 时，MultiRead 把请求交给这几个线程并发 pread，
+// 少量线程就能让设备的队列保持足够的深度
+class ReadThreadPool {
+ public:
+  static ReadThreadPool* Default() {
+    // 不析构，理由同 Env::Default()
+    static ReadThreadPool* pool = new ReadThreadPool(kReadThreads);
+    return pool;
+  }
+
+  // 并发执行 reqs[0..n-1]，全部完成后返回；reqs[0] 由调用者自己读
+  void MultiRead(const RandomAccessFile* file, ReadRequest* reqs, size_t n) {
+    Batch batch(file, n - 1);
+    {
+      std::lock_guard<std::mutex> l(mutex_);
+      for (size_t i = 1; i < n; i++) {
+        queue_.push(Task{&batch, &reqs[i]});
+      }
+    }
+    cv_.notify_all();
+
+    ReadOne(file, &reqs[0]);
+
+    std::unique_lock<std::mutex> l(batch.mutex);
+    while (batch.remaining > 0) {
+      batch.cv.wait(l);
+    }
+  }
+
+ private:
+  struct Batch {
+    Batch(const RandomAccessFile* f, size_t n) : file(f), remaining(n) {}
+
+    const RandomAccessFile* const file;
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t remaining;  // 由 mutex 保护
+  };
+
+  struct Task {
+    Batch* batch;
+    ReadRequest* req;
+  };
+
+  explicit ReadThreadPool(int threads) {
+    for (int i = 0; i < threads; i++) {
+      std::thread t(&ReadThreadPool::ThreadMain, this);
+      t.detach();
+    }
+  }
+
+  static void ReadOne(const RandomAccessFile* file, ReadRequest* req) {
+    req->status = file->Read(req->offset, req->len, &req->result, req->scratch);
+  }
+
+  void ThreadMain() {
+    while (true) {
+      Task task;
+      {
+        std::unique_lock<std::mutex> l(mutex_);
+        while (queue_.empty()) {
+          cv_.wait(l);
+        }
+        task = queue_.front();
+        queue_.pop();
+      }
+      ReadOne(task.batch->file, task.req);
+      // 调用者看到 remaining 为 0 之后就会销毁 batch，之后不能再访问它
+      std::lock_guard<std::mutex> l(task.batch->mutex);
+      if (--task.batch->remaining == 0) {
+        task.batch->cv.notify_one();
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::queue<Task> queue_;  // 由 mutex_ 保护
+};
+
+// 用 pread 实现，不修改文件偏移，多个线程可以同时读
+class PosixRandomAccessFile final : public RandomAccessFile {
+ public:
+  PosixRandomAccessFile(std::string filename, int fd)
+      : fd_(fd), filename_(std::move(filename)) {}
+
+  ~PosixRandomAccessFile() override { ::close(fd_); }
+
+  Status Read(uint64_t offset, size_t n, Slice* result,
+              char* scratch) const override {
+    Status status;
+    ssize_t read_size = ::pread(fd_, scratch, n, static_cast<off_t>(offset));
+    *result = Slice(scratch, (read_size < 0) ? 0 : read_size);
+    if (read_size < 0) {
+      status = PosixError(filename_, errno);
+    }
+    return status;
+  }
+
+  // 优先使用 io_uring 一次提交所有请求，不可用时交给 ReadThreadPool
+  Status MultiRead(ReadRequest* reqs, size_t n) const override {
+    if (n <= 1) {
+      return RandomAccessFile::MultiRead(reqs, n);
+    }
+#if HAVE_IO_URING
+    std::unique_ptr<IoUring>& ring = ThreadLocalIoUring();
+    while (ring != nullptr && n > 0 &&
+           !io_uring_disabled.load(std::memory_order_relaxed)) {
+      const size_t batch = std::min<size_t>(n, ring->entries());
+      const size_t done = ring->Read(fd_, reqs, batch, filename_);
+      reqs += done;
+      n -= done;
+      if (done < batch) {
+        // 剩下的请求交给线程池
+        ring.reset();
+        io_uring_disabled.store(true, std::memory_order_relaxed);
+        break;
+      }
+    }
+    if (n == 0) {
+      return Status::OK();
+    }
+#endif  // HAVE_IO_URING
+    ReadThreadPool::Default()->MultiRead(this, reqs, n);
+    return Status::OK();
+  }
+
+ private:
+  const int fd_;
+  const std::string filename_;
+};
+
+class PosixWritableFile final : public WritableFile {
+ public:
+  PosixWritableFile(std::string filename, int fd)
+      : pos_(0), fd_(fd), filename_(std::move(filename)) {}
+
+  ~PosixWritableFile() override {
+    if (fd_ >= 0) {
+      Close();
+    }
+  }
+
+  Status Append(const Slice& data) override {
+    size_t write_size = data.size();
+    const char* write_data = data.data();
+
+    // 尽量放进缓冲区
+    size_t copy_size = std::min(write_size, kWritableFileBufferSize - pos_);
+    std::memcpy(buf_ + pos_, write_data, copy_size);
+    write_data += copy_size;
+    write_size -= copy_size;
+    pos_ += copy_size;
+    if (write_size == 0) {
+      return Status::OK();
+    }
+
+    // 缓冲区满了，先写出去
+    Status status = FlushBuffer();
+    if (!status.ok()) {
+      return status;
+    }
+
+    // 小块数据继续缓冲，大块数据直接写
+    if (write_size < kWritableFileBufferSize) {
+      std::memcpy(buf_, write_data, write_size);
+      pos_ = write_size;
+      return Status::OK();
+    }
+    return WriteUnbuffered(write_data, write_size);
+  }
+
+  Status Close() override {
+    Status status = FlushBuffer();
+    const int close_result = ::close(fd_);
+    if (close_result < 0 && status.ok()) {
+      status = PosixError(filename_, errno);
+    }
+    fd_ = -1;
+    return status;
+  }
+
+  Status Flush() override { return FlushBuffer(); }
+
+  Status Sync() override {
+    Status status = FlushBuffer();
+    if (!status.ok()) {
+      return status;
+    }
+    if (::fdatasync(fd_) != 0) {
+      return PosixError(filename_, errno);
+    }
+    return Status::OK();
+  }
+
+ private:
+  static constexpr size_t kWritableFileBufferSize = 65536;
+
+  Status FlushBuffer() {
+    Status status = WriteUnbuffered(buf_, pos_);
+    pos_ = 0;
+    return status;
+  }
+
+  Status WriteUnbuffered(const char* data, size_t size) {
+    while (size > 0) {
+      ssize_t write_result = ::write(fd_, data, size);
+      if (write_result < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return PosixError(filename_, errno);
+      }
+      data += write_result;
+      size -= write_result;
+    }
+    return Status::OK();
+  }
+
+  // buf_[0, pos_ - 1] 是还没写到 fd_ 的数据
+  char buf_[kWritableFileBufferSize];
+  size_t pos_;
+  int fd_;
+  const std::string filename_;
+};
+
+// direct I/O 的对齐单位，不小于常见设备的逻辑块大小
+constexpr size_t kDirectIOAlignment = 4096;
+
+size_t RoundUpToAlignment(size_t n) {
+  return (n + kDirectIOAlignment - 1) & ~(kDirectIOAlignment - 1);
+}
+
+// 用 O_DIRECT 写文件，数据不进入 page cache，不会挤掉读操作依赖的热数据
+// 每次写的位置、长度和内存地址都必须按 kDirectIOAlignment 对齐:
+// 数据先攒在对齐的缓冲区中，满了才写；Sync 和 Close 时把最后不满一块的部分
+// 补零写出，Close 时再把文件截断到实际长度
+class PosixDirectWritableFile final : public WritableFile {
+ public:
+  PosixDirectWritableFile(std::string filename, int fd, size_t buffer_size)
+      : capacity_(
+            RoundUpToAlignment(std::max(buffer_size, kDirectIOAlignment))),
+        buf_(arena_.AllocateAligned(capacity_, kDirectIOAlignment)),
+        pos_(0),
+        file_offset_(0),
+        fd_(fd),
+        filename_(std::move(filename)) {}
+
+  ~PosixDirectWritableFile() override {
+    if (fd_ >= 0) {
+      Close();
+    }
+  }
+
+  Status Append(const Slice& data) override {
+    const char* p = data.data();
+    size_t n = data.size();
+    while (n > 0) {
+      const size_t copy_size = std::min(n, capacity_ - pos_);
+      std::memcpy(buf_ + pos_, p, copy_size);
+      pos_ += copy_size;
+      p += copy_size;
+      n -= copy_size;
+      if (pos_ == capacity_) {
+        Status status = WriteAligned(capacity_);
+        if (!status.ok()) {
+          return status;
+        }
+        file_offset_ += capacity_;
+        pos_ = 0;
+      }
+    }
+    return Status::OK();
+  }
+
+  Status Close() override {
+    Status status = WriteTail();
+    if (status.ok() && ::ftruncate(fd_, file_offset_ + pos_) != 0) {
+      status = PosixError(filename_, errno);
+    }
+    if (::close(fd_) < 0 && status.ok()) {
+      status = PosixError(filename_, errno);
+    }
+    fd_ = -1;
+    return status;
+  }
+
+  // 不满一块的数据只能等到 Sync 或 Close 时补齐再写
+  Status Flush() override { return Status::OK(); }
+
+  Status Sync() override {
+    Status status = WriteTail();
+    if (!status.ok()) {
+      return status;
+    }
+    if (::fdatasync(fd_) != 0) {
+      return PosixError(filename_, errno);
+    }
+    return Status::OK();
+  }
+
+ private:
+  // 写出缓冲区中的全部数据，最后不满一块的部分补零
+  // 这部分留在缓冲区开头，之后和新的数据一起重写
+  Status WriteTail() {
+    const size_t padded = RoundUpToAlignment(pos_);
+    if (padded == 0) {
+      return Status::OK();
+    }
+    std::memset(buf_ + pos_, 0, padded - pos_);
+    Status status = WriteAligned(padded);
+    if (!status.ok()) {
+      return status;
+    }
+    const size_t full = pos_ & ~(kDirectIOAlignment - 1);
+    if (full > 0) {
+      std::memmove(buf_, buf_ + full, pos_ - full);
+      file_offset_ += full;
+      pos_ -= full;
+    }
+    return Status::OK();
+  }
+
+  // 把 buf_[0, n - 1] 写到 file_offset_，n 按 kDirectIOAlignment 对齐
+  Status WriteAligned(size_t n) {
+    const char* data = buf_;
+    uint64_t offset = file_offset_;
+    while (n > 0) {
+      ssize_t write_result =
+          ::pwrite(fd_, data, n, static_cast<off_t>(offset));
+      if (write_result < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return PosixError(filename_, errno);
+      }
+      data += write_result;
+      offset += write_result;
+      n -= write_result;
+    }
+    return Status::OK();
+  }
+
+  Arena arena_;
+  const size_t capacity_;
+  char* const buf_;       // 按 kDirectIOAlignment 对齐
+  size_t pos_;            // buf_[0, pos_ - 1] 是还没有完整写出的数据
+  uint64_t file_offset_;  // buf_[0] 在文件中的位置，按 kDirectIOAlignment 对齐
+  int fd_;
+  const std::string filename_;
+};
+
+class PosixEnv : public Env {
+ public:
+  PosixEnv() : started_background_thread_(false) {}
+
+  ~PosixEnv() override {
+    // Env::Default() 不会被删除
+    std::abort();
+  }
+
+  Status NewRandomAccessFile(const std::string& filename,
+                             RandomAccessFile** result) override {
+    *result = nullptr;
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return PosixError(filename, errno);
+    }
+    *result = new PosixRandomAccessFile(filename, fd);
+    return Status::OK();
+  }
+
+  Status NewWritableFile(const std::string& filename,
+                         WritableFile** result) override {
+    int fd = ::open(filename.c_str(), O_TRUNC | O_WRONLY | O_CREAT | O_CLOEXEC,
+                    0644);
+    if (fd < 0) {
+      *result = nullptr;
+      return PosixError(filename, errno);
+    }
+    *result = new PosixWritableFile(filename, fd);
+    return Status::OK();
+  }
+
+  Status NewWritableFile(const std::string& filename, const EnvOptions& options,
+                         WritableFile** result) override {
+    if (!options.use_direct_writes) {
+      return NewWritableFile(filename, result);
+    }
+    int fd = ::open(filename.c_str(),
+                    O_TRUNC | O_WRONLY | O_CREAT | O_CLOEXEC | O_DIRECT, 0644);
+    if (fd < 0 && errno == EINVAL) {
+      // 文件系统不支持 O_DIRECT
+      return NewWritableFile(filename, result);
+    }
+    if (fd < 0) {
+      *result = nullptr;
+      return PosixError(filename, errno);
+    }
+    *result = new PosixDirectWritableFile(
+        filename, fd, options.writable_file_max_buffer_size);
+    return Status::OK();
+  }
+
+  bool FileExists(const std::string& filename) override {
+    return ::access(filename.c_str(), F_OK) == 0;
+  }
+
+  Status GetChildren(const std::string& directory_path,
+                     std::vector<std::string>* result) override {
+    result->clear();
+    ::DIR* dir = ::opendir(directory_path.c_str());
+    if (dir == nullptr) {
+      return PosixError(directory_path, errno);
+    }
+    struct ::dirent* entry;
+    while ((entry = ::readdir(dir)) != nullptr) {
+      result->emplace_back(entry->d_name);
+    }
+    ::closedir(dir);
+    return Status::OK();
+  }
+
+  Status RemoveFile(const std::string& filename) override {
+    if (::unlink(filename.c_str()) != 0) {
+      return PosixError(filename, errno);
+    }
+    return Status::OK();
+  }
+
+  Status LinkFile(const std::string& src, const std::string& target) override {
+    if (::link(src.c_str(), target.c_str()) != 0) {
+      return PosixError(target, errno);
+    }
+    return Status::OK();
+  }
+
+  Status CreateDir(const std::string& dirname) override {
+    if (::mkdir(dirname.c_str(), 0755) != 0 && errno != EEXIST) {
+      return PosixError(dirname, errno);
+    }
+    return Status::OK();
+  }
+
+  Status GetFileSize(const std::string& filename, uint64_t* size) override {
+    struct ::stat file_stat;
+    if (::stat(filename.c_str(), &file_stat) != 0) {
+      *size = 0;
+      return PosixError(filename, errno);
+    }
+    *size = file_stat.st_size;
+    return Status::OK();
+  }
+
+  void Schedule(void (*background_work_function)(void* background_work_arg),
+                void* background_work_arg) override;
+
+  void StartThread(void (*thread_main)(void* thread_main_arg),
+                   void* thread_main_arg) override {
+    std::thread new_thread(thread_main, thread_main_arg);
+    new_thread.detach();
+  }
+
+ private:
+  void BackgroundThreadMain();
+
+  static void BackgroundThreadEntryPoint(PosixEnv* env) {
+    env->BackgroundThreadMain();
+  }
+
+  struct BackgroundWorkItem {
+    explicit BackgroundWorkItem(void (*function)(void* arg), void* arg)
+        : function(function), arg(arg) {}
+
+    void (*const function)(void*);
+    void* const arg;
+  };
+
+  std::mutex background_work_mutex_;
+  std::condition_variable background_work_cv_;
+  bool started_background_thread_;  // 由 background_work_mutex_ 保护
+
+  std::queue<BackgroundWorkItem> background_work_queue_;
+};
+
+void PosixEnv::Schedule(
+    void (*background_work_function)(void* background_work_arg),
+    void* background_work_arg) {
+  std::lock_guard<std::mutex> l(background_work_mutex_);
+
+  // 第一次调用时启动后台线程
+  if (!started_background_thread_) {
+    started_background_thread_ = true;
+    std::thread background_thread(PosixEnv::BackgroundThreadEntryPoint, this);
+    background_thread.detach();
+  }
+
+  // 队列为空时后台线程可能在等待
+  if (background_work_queue_.empty()) {
+    background_work_cv_.notify_one();
+  }
+
+  background_work_queue_.emplace(background_work_function,
+                                 background_work_arg);
+}
+
+void PosixEnv::BackgroundThreadMain() {
+  while (true) {
+    std::unique_lock<std::mutex> l(background_work_mutex_);
+
+    while (background_work_queue_.empty()) {
+      background_work_cv_.wait(l);
+    }
+
+    assert(!background_work_queue_.empty());
+    auto background_work_function = background_work_queue_.front().function;
+    void* background_work_arg = background_work_queue_.front().arg;
+    background_work_queue_.pop();
+
+    l.unlock();
+    background_work_function(background_work_arg);
+  }
+}
+
+}  // namespace
+
+bool EnvPosixTestHelper::IoUringEnabled() {
+#if HAVE_IO_URING
+  return ThreadLocalIoUring() != nullptr &&
+         !io_uring_disabled.load(std::memory_order_relaxed);
+#else
+  return false;
+#endif  // HAVE_IO_URING
+}
+
+void EnvPosixTestHelper::DisableIoUring() {
+#if HAVE_IO_URING
+  io_uring_disabled.store(true, std::memory_order_relaxed);
+#endif  // HAVE_IO_URING
+}
+
+bool EnvPosixTestHelper::IsDirectWritableFile(const WritableFile* file) {
+  return dynamic_cast<const PosixDirectWritableFile*>(file) != nullptr;
+}
+
+Env* Env::Default() {
+  // 不析构，避免进程退出时后台线程还在使用它
+  static PosixEnv* env = new PosixEnv;
+  return env;
+}
+
+}  // namespace leveldb
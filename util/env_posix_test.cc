@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/env.h"
+#include "util/env_posix_test_helper.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+class EnvPosixTest : public testing::Test {
+ public:
+  EnvPosixTest()
+      : env_(Env::Default()), dir_(test::TmpDir("env_posix_test")) {}
+
+  static bool IoUringEnabled() { return EnvPosixTestHelper::IoUringEnabled(); }
+  static void DisableIoUring() { EnvPosixTestHelper::DisableIoUring(); }
+  static bool IsDirectWritableFile(const WritableFile* file) {
+    return EnvPosixTestHelper::IsDirectWritableFile(file);
+  }
+
+  // 读出整个文件
+  std::string ReadFile(const std::string& fname) {
+    uint64_t size;
+    EXPECT_TRUE(env_->GetFileSize(fname, &size).ok());
+    RandomAccessFile* file;
+    EXPECT_TRUE(env_->NewRandomAccessFile(fname, &file).ok());
+    std::string scratch(size, '\0');
+    Slice result;
+    EXPECT_TRUE(file->Read(0, size, &result, &scratch[0]).ok());
+    delete file;
+    return result.ToString();
+  }
+
+  // 写入 n 个随机字节，返回文件名
+  std::string WriteRandomFile(const std::string& name, size_t n) {
+    const std::string fname = dir_ + "/" + name;
+    Random rnd(301);
+    contents_.resize(n);
+    for (size_t i = 0; i < n; i++) {
+      contents_[i] = static_cast<char>(rnd.Uniform(256));
+    }
+    WritableFile* file;
+    EXPECT_TRUE(env_->NewWritableFile(fname, &file).ok());
+    EXPECT_TRUE(file->Append(contents_).ok());
+    EXPECT_TRUE(file->Close().ok());
+    delete file;
+    return fname;
+  }
+
+  // 一次 MultiRead 发出 n 个随机的请求，包括跨过和超出文件末尾的请求，
+  // 结果与 contents_ 比较
+  void CheckMultiRead(RandomAccessFile* file, size_t n, Random* rnd) {
+    const size_t size = contents_.size();
+    std::vector<ReadRequest> reqs(n);
+    std::vector<std::string> scratch(n);
+    for (size_t i = 0; i < n; i++) {
+      reqs[i].offset = rnd->Uniform(static_cast<int>(size + 100));
+      reqs[i].len = rnd->Uniform(8192);
+      scratch[i].resize(reqs[i].len);
+      reqs[i].scratch = &scratch[i][0];
+    }
+    ASSERT_TRUE(file->MultiRead(reqs.data(), n).ok());
+    for (size_t i = 0; i < n; i++) {
+      ASSERT_TRUE(reqs[i].status.ok()) << reqs[i].status.ToString();
+      const size_t offset = std::min<size_t>(reqs[i].offset, size);
+      const size_t len = std::min(reqs[i].len, size - offset);
+      ASSERT_EQ(contents_.substr(offset, len), reqs[i].result.ToString())
+          << "offset " << reqs[i].offset << " len " << reqs[i].len;
+    }
+  }
+
+  Env* const env_;
+  const std::string dir_;
+  std::string contents_;
+};
+
+// 请求的个数超过 io_uring 的队列深度时分批提交
+TEST_F(EnvPosixTest, MultiRead) {
+  const std::string fname = WriteRandomFile("multi_read", 1 << 20);
+  RandomAccessFile* file;
+  ASSERT_TRUE(env_->NewRandomAccessFile(fname, &file).ok());
+  Random rnd(301);
+  for (size_t n : {0, 1, 2, 10, 64, 65, 200}) {
+    CheckMultiRead(file, n, &rnd);
+  }
+  std::fprintf(stderr, "MultiRead %s io_uring\n",
+               IoUringEnabled() ? "used" : "did not use");
+  delete file;
+}
+
+TEST_F(EnvPosixTest, MultiReadConcurrent) {
+  const std::string fname = WriteRandomFile("multi_read", 1 << 20);
+  RandomAccessFile* file;
+  ASSERT_TRUE(env_->NewRandomAccessFile(fname, &file).ok());
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([this, file, t] {
+      Random rnd(301 + t);
+      for (int i = 0; i < 20; i++) {
+        CheckMultiRead(file, 1 + rnd.Uniform(100), &rnd);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  delete file;
+}
+
+// direct I/O 写入长度不是 4KB 整数倍的数据，中间穿插 Sync:
+// Sync 时补零写出的尾部之后会被新数据覆盖，Close 之后文件长度正好是写入的长度
+TEST_F(EnvPosixTest, DirectWrites) {
+  Random rnd(301);
+  for (size_t buffer_size : {1, 4096, 10000, 65536}) {
+    EnvOptions options;
+    options.use_direct_writes = true;
+    options.writable_file_max_buffer_size = buffer_size;
+    const std::string fname = dir_ + "/direct_" + std::to_string(buffer_size);
+    WritableFile* file;
+    ASSERT_TRUE(env_->NewWritableFile(fname, options, &file).ok());
+    if (!IsDirectWritableFile(file)) {
+      delete file;
+      GTEST_SKIP() << "O_DIRECT is not supported on " << dir_;
+    }
+    std::string expected;
+    for (int i = 0; i < 200; i++) {
+      std::string data(rnd.OneIn(10) ? rnd.Uniform(20000) : rnd.Uniform(300),
+                       '\0');
+      for (char& c : data) {
+        c = static_cast<char>(rnd.Uniform(256));
+      }
+      ASSERT_TRUE(file->Append(data).ok());
+      expected += data;
+      if (rnd.OneIn(5)) {
+        ASSERT_TRUE(file->Sync().ok());
+        // Sync 之后已经写入的数据可以读到，尾部补了零
+        const std::string synced = ReadFile(fname);
+        ASSERT_GE(synced.size(), expected.size());
+        ASSERT_EQ(expected, synced.substr(0, expected.size()));
+      }
+    }
+    ASSERT_TRUE(file->Close().ok());
+    delete file;
+    ASSERT_EQ(expected, ReadFile(fname)) << buffer_size;
+  }
+}
+
+// 长度刚好是对齐单位整数倍、空文件和只有 Sync 的情况
+TEST_F(EnvPosixTest, DirectWritesAlignedAndEmpty) {
+  EnvOptions options;
+  options.use_direct_writes = true;
+  options.writable_file_max_buffer_size = 8192;
+  for (size_t n : {0, 1, 4095, 4096, 4097, 8192, 12288}) {
+    const std::string fname = dir_ + "/direct_aligned";
+    WritableFile* file;
+    ASSERT_TRUE(env_->NewWritableFile(fname, options, &file).ok());
+    if (!IsDirectWritableFile(file)) {
+      delete file;
+      GTEST_SKIP() << "O_DIRECT is not supported on " << dir_;
+    }
+    const std::string data(n, 'x');
+    ASSERT_TRUE(file->Sync().ok());
+    ASSERT_TRUE(file->Append(data).ok());
+    ASSERT_TRUE(file->Sync().ok());
+    ASSERT_TRUE(file->Sync().ok());
+    ASSERT_TRUE(file->Close().ok());
+    delete file;
+    ASSERT_EQ(data, ReadFile(fname)) << n;
+  }
+}
+
+// 没有 io_uring 时由线程池并发 pread，结果相同
+// 关闭之后不能恢复，所以放在使用 io_uring 的测试之后
+TEST_F(EnvPosixTest, MultiReadThreadPool) {
+  DisableIoUring();
+  ASSERT_FALSE(IoUringEnabled());
+  const std::string fname = WriteRandomFile("multi_read", 1 << 20);
+  RandomAccessFile* file;
+  ASSERT_TRUE(env_->NewRandomAccessFile(fname, &file).ok());
+  Random rnd(301);
+  for (size_t n : {0, 1, 2, 10, 64, 65, 200}) {
+    CheckMultiRead(file, n, &rnd);
+  }
+  delete file;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,26 @@
+#ifndef STORAGE_LEVELDB_UTIL_ENV_POSIX_TEST_HELPER_H_
+#define STORAGE_LEVELDB_UTIL_ENV_POSIX_TEST_HELPER_H_
+
+namespace leveldb {
+
+class EnvPosixTest;
+class WritableFile;
+
+// 只给 env_posix_test 使用的开关
+class EnvPosixTestHelper {
+ private:
+  friend class EnvPosixTest;
+
+  // 当前线程的 MultiRead 是否使用 io_uring
+  static bool IoUringEnabled();
+
+  // 之后所有线程的 MultiRead 都改用线程池，不能再恢复
+  static void DisableIoUring();
+
+  // file 是否用 O_DIRECT 写入，文件系统不支持时会退回普通的写
+  static bool IsDirectWritableFile(const WritableFile* file);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_ENV_POSIX_TEST_HELPER_H_
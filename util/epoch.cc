@@ -0,0 +1,63 @@
+#include "util/epoch.h"
+
+namespace leveldb {
+
+EpochManager::EpochManager() : epoch_(0), pending_(0), drain_parity_(0) {
+  for (Slot& slot : slots_) {
+    slot.counters[0].store(0, std::memory_order_relaxed);
+    slot.counters[1].store(0, std::memory_order_relaxed);
+  }
+}
+
+EpochManager::~EpochManager() {
+  assert(Drained(0) && Drained(1));
+  for (const Retired& r : draining_) {
+    r.deleter(r.arg);
+  }
+  for (const Retired& r : waiting_) {
+    r.deleter(r.arg);
+  }
+}
+
+bool EpochManager::Drained(uint64_t parity) const {
+  for (const Slot& slot : slots_) {
+    if (slot.counters[parity].load(std::memory_order_seq_cst) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void EpochManager::Retire(Deleter deleter, void* arg) {
+  std::lock_guard<std::mutex> l(mutex_);
+  waiting_.push_back(Retired{deleter, arg});
+  pending_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EpochManager::TryReclaim() {
+  std::vector<Retired> reclaimed;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (!draining_.empty() && Drained(drain_parity_)) {
+      reclaimed.swap(draining_);
+    }
+    if (draining_.empty() && !waiting_.empty()) {
+      // waiting_ 中的对象都是在翻转之前摘下的，之后进入的读者看不到它们，
+      // 只需要等翻转之前进入的读者（计在旧的奇偶性上）退出
+      draining_.swap(waiting_);
+      drain_parity_ = epoch_.fetch_add(1, std::memory_order_seq_cst) & 1;
+      if (Drained(drain_parity_)) {
+        reclaimed.insert(reclaimed.end(), draining_.begin(), draining_.end());
+        draining_.clear();
+      }
+    }
+    pending_.fetch_sub(reclaimed.size(), std::memory_order_relaxed);
+  }
+
+  // 在锁外调用，deleter 里可以再调用 Retire
+  for (const Retired& r : reclaimed) {
+    r.deleter(r.arg);
+  }
+}
+
+}  // namespace leveldb
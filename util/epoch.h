@@ -0,0 +1,120 @@
+#ifndef STORAGE_LEVELDB_UTIL_EPOCH_H_
+#define STORAGE_LEVELDB_UTIL_EPOCH_H_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace leveldb {
+
+// 基于 epoch 的内存回收
+//
+// 读者在访问共享对象前后调用 Enter/Exit（或者使用 EpochGuard），
+// 代价是对本线程所在槽位的计数器做一次原子加、一次原子减，不加锁。
+// 写者先把对象从共享指针上摘下来（原子交换），再调用 Retire 登记释放函数；
+// 之后 TryReclaim 确认摘下之前进入的读者都已经退出，才真正调用释放函数。
+//
+// 实现上全局 epoch 只有奇偶两种状态有意义: 读者按进入时 epoch 的奇偶性计数，
+// 翻转 epoch 之后等旧的奇偶性的计数归零，此前 Retire 的对象就不再有人访问
+//
+// 线程安全: 所有方法都可以并发调用
+class EpochManager {
+ public:
+  typedef void (*Deleter)(void* arg);
+
+  EpochManager();
+
+  EpochManager(const EpochManager&) = delete;
+  EpochManager& operator=(const EpochManager&) = delete;
+
+  // 释放所有还没回收的对象，要求: 已经没有读者
+  ~EpochManager();
+
+  // 进入读临界区，返回值传给 Exit
+  size_t Enter() {
+    const size_t slot = ThreadSlot();
+    std::atomic<uint64_t>* counters = slots_[slot].counters;
+    while (true) {
+      const uint64_t e = epoch_.load(std::memory_order_seq_cst);
+      counters[e & 1].fetch_add(1, std::memory_order_seq_cst);
+      // 加计数之前 epoch 可能已经翻转，这时写者不会等这个计数，需要重来
+      if (epoch_.load(std::memory_order_seq_cst) == e) {
+        return slot * 2 + (e & 1);
+      }
+      counters[e & 1].fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  // 离开读临界区，token 为 Enter 的返回值
+  void Exit(size_t token) {
+    slots_[token / 2].counters[token & 1].fetch_sub(1,
+                                                    std::memory_order_release);
+  }
+
+  // 登记一个已经对新读者不可见的对象，之后在安全的时候调用 deleter(arg)
+  void Retire(Deleter deleter, void* arg);
+
+  // 有对象在等待回收时返回 true，调用者据此决定是否调用 TryReclaim
+  bool HasPending() const {
+    return pending_.load(std::memory_order_relaxed) != 0;
+  }
+
+  // 回收已经没有读者的对象，不会阻塞等待读者
+  void TryReclaim();
+
+ private:
+  enum { kNumSlots = 64 };
+
+  // 每个槽位独占一个 cache line，避免不同线程的计数器互相干扰
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> counters[2];
+  };
+
+  struct Retired {
+    Deleter deleter;
+    void* arg;
+  };
+
+  // 当前线程使用的槽位，线程按第一次进入的顺序轮流分配
+  static size_t ThreadSlot() {
+    static std::atomic<size_t> next_slot(0);
+    thread_local size_t slot =
+        next_slot.fetch_add(1, std::memory_order_relaxed) % kNumSlots;
+    return slot;
+  }
+
+  // parity 对应的读者计数都为 0 时返回 true
+  bool Drained(uint64_t parity) const;
+
+  Slot slots_[kNumSlots];
+  std::atomic<uint64_t> epoch_;
+  std::atomic<size_t> pending_;  // waiting_ 和 draining_ 中对象的个数
+
+  std::mutex mutex_;
+  std::vector<Retired> waiting_;   // 还没翻转 epoch 的对象，由 mutex_ 保护
+  std::vector<Retired> draining_;  // 等待 drain_parity_ 归零的对象，由 mutex_ 保护
+  uint64_t drain_parity_;          // 由 mutex_ 保护
+};
+
+// 在作用域内处于读临界区
+class EpochGuard {
+ public:
+  explicit EpochGuard(EpochManager* epochs)
+      : epochs_(epochs), token_(epochs->Enter()) {}
+
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+
+  ~EpochGuard() { epochs_->Exit(token_); }
+
+ private:
+  EpochManager* const epochs_;
+  const size_t token_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_EPOCH_H_
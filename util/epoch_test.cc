@@ -0,0 +1,125 @@
+#include "util/epoch.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace leveldb {
+
+namespace {
+
+struct Object {
+  explicit Object(uint64_t v) : value(v), alive(true) {}
+  ~Object() { alive.store(false, std::memory_order_relaxed); }
+
+  const uint64_t value;
+  std::atomic<bool> alive;
+};
+
+std::atomic<int> deleted_count(0);
+
+void DeleteObject(void* arg) {
+  Object* obj = reinterpret_cast<Object*>(arg);
+  // 先标记再释放，释放之后还有读者访问时 ASan 能发现
+  obj->alive.store(false, std::memory_order_relaxed);
+  delete obj;
+  deleted_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+TEST(EpochTest, ReclaimWithoutReaders) {
+  deleted_count = 0;
+  EpochManager epochs;
+  ASSERT_FALSE(epochs.HasPending());
+  epochs.Retire(DeleteObject, new Object(1));
+  epochs.Retire(DeleteObject, new Object(2));
+  ASSERT_TRUE(epochs.HasPending());
+  epochs.TryReclaim();
+  ASSERT_FALSE(epochs.HasPending());
+  ASSERT_EQ(2, deleted_count.load());
+}
+
+// 读者在 Retire 之前进入，退出之前对象不能被回收
+TEST(EpochTest, ReaderBlocksReclaim) {
+  deleted_count = 0;
+  EpochManager epochs;
+  {
+    EpochGuard guard(&epochs);
+    epochs.Retire(DeleteObject, new Object(1));
+    epochs.TryReclaim();
+    epochs.TryReclaim();
+    ASSERT_EQ(0, deleted_count.load());
+    ASSERT_TRUE(epochs.HasPending());
+  }
+  epochs.TryReclaim();
+  ASSERT_EQ(1, deleted_count.load());
+
+  // Retire 之后才进入的读者不影响回收
+  epochs.Retire(DeleteObject, new Object(2));
+  {
+    EpochGuard guard(&epochs);
+    epochs.TryReclaim();
+    epochs.TryReclaim();
+  }
+  epochs.TryReclaim();
+  ASSERT_EQ(2, deleted_count.load());
+}
+
+// 析构时释放还没有回收的对象
+TEST(EpochTest, DestructorFreesPending) {
+  deleted_count = 0;
+  {
+    EpochManager epochs;
+    epochs.Retire(DeleteObject, new Object(1));
+  }
+  ASSERT_EQ(1, deleted_count.load());
+}
+
+// 一个写者不断替换共享指针，多个读者在 epoch 中读取
+// 读者看到的对象在它退出之前一直有效
+TEST(EpochTest, ConcurrentSwap) {
+  deleted_count = 0;
+  EpochManager epochs;
+  std::atomic<Object*> current(new Object(0));
+  std::atomic<bool> done(false);
+  const uint64_t kSwaps = 100000;
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&] {
+      uint64_t last = 0;
+      while (!done.load(std::memory_order_acquire)) {
+        EpochGuard guard(&epochs);
+        Object* obj = current.load(std::memory_order_acquire);
+        for (int i = 0; i < 10; i++) {
+          ASSERT_TRUE(obj->alive.load(std::memory_order_relaxed));
+        }
+        // 同一个读者看到的版本不会倒退
+        ASSERT_GE(obj->value, last);
+        last = obj->value;
+      }
+    });
+  }
+
+  for (uint64_t i = 1; i <= kSwaps; i++) {
+    Object* old = current.exchange(new Object(i), std::memory_order_acq_rel);
+    epochs.Retire(DeleteObject, old);
+    if (epochs.HasPending()) {
+      epochs.TryReclaim();
+    }
+  }
+  done.store(true, std::memory_order_release);
+  for (std::thread& t : readers) {
+    t.join();
+  }
+  epochs.TryReclaim();
+  epochs.TryReclaim();
+  ASSERT_FALSE(epochs.HasPending());
+  ASSERT_EQ(static_cast<int>(kSwaps), deleted_count.load());
+  delete current.load();
+}
+
+}  // namespace leveldb
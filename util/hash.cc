@@ -0,0 +1,174 @@
+#include "util/hash.h"
+
+// SSE2 是 x86-64 的基础指令集，不需要运行时检测
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define LEVELDB_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace leveldb {
+namespace hash_internal {
+
+namespace {
+
+// 与 xxh3 的长输入部分类似: 8 个 64 位累加器，每次处理 64 字节（一个 stripe），
+// 每个 lane 累加 (d ^ secret) 高低 32 位之积，相邻的 lane 再交叉累加原始数据
+// 每个 stripe 使用的 secret 依次错开 8 个字节，防止交换 stripe 得到相同的结果；
+// 每 kStripesPerBlock 个 stripe 打乱一次累加器
+constexpr size_t kStripeLen = 64;
+constexpr size_t kLanes = 8;
+constexpr size_t kStripesPerBlock = 16;
+constexpr size_t kSecretWords = kLanes + kStripesPerBlock;
+constexpr uint64_t kPrime32 = 0x9e3779b1u;
+
+struct Secret {
+  uint64_t w[kSecretWords];
+};
+
+// 用 splitmix64 生成固定的 secret，编译期计算
+constexpr Secret MakeSecret() {
+  Secret s{};
+  uint64_t x = 0x6a09e667f3bcc908ull;
+  for (size_t i = 0; i < kSecretWords; i++) {
+    x += 0x9e3779b97f4a7c15ull;
+    uint64_t z = x;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    s.w[i] = z ^ (z >> 31);
+  }
+  return s;
+}
+
+alignas(16) constexpr Secret kSecret = MakeSecret();
+
+#if defined(LEVELDB_SSE2)
+
+inline void Accumulate(__m128i* acc, const char* p, const uint64_t* secret) {
+  for (size_t v = 0; v < kLanes / 2; v++) {
+    const __m128i d =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * v));
+    const __m128i s =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret + 2 * v));
+    const __m128i k = _mm_xor_si128(d, s);
+    // 每个 64 位 lane 的低 32 位乘高 32 位
+    const __m128i product =
+        _mm_mul_epu32(k, _mm_shuffle_epi32(k, _MM_SHUFFLE(0, 3, 0, 1)));
+    const __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+    acc[v] = _mm_add_epi64(acc[v], _mm_add_epi64(product, swapped));
+  }
+}
+
+inline void Scramble(__m128i* acc, const uint64_t* secret) {
+  const __m128i prime = _mm_set1_epi32(static_cast<int>(kPrime32));
+  for (size_t v = 0; v < kLanes / 2; v++) {
+    __m128i a = acc[v];
+    a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+    a = _mm_xor_si128(
+        a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret + 2 * v)));
+    // 64 位乘 32 位常数: 低半部分的积加上高半部分的积左移 32 位
+    const __m128i lo = _mm_mul_epu32(a, prime);
+    const __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+    acc[v] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+  }
+}
+
+struct Sse2Accumulators {
+  explicit Sse2Accumulators(const uint64_t* init) {
+    for (size_t v = 0; v < kLanes / 2; v++) {
+      acc[v] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(init + 2 * v));
+    }
+  }
+  void Accumulate(const char* p, const uint64_t* secret) {
+    hash_internal::Accumulate(acc, p, secret);
+  }
+  void Scramble(const uint64_t* secret) {
+    hash_internal::Scramble(acc, secret);
+  }
+  void Store(uint64_t* out) const {
+    for (size_t v = 0; v < kLanes / 2; v++) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * v), acc[v]);
+    }
+  }
+
+  __m128i acc[kLanes / 2];
+};
+
+#endif  // defined(LEVELDB_SSE2)
+
+// 不使用向量指令的实现，结果与 Sse2Accumulators 相同
+struct PortableAccumulators {
+  explicit PortableAccumulators(const uint64_t* init) {
+    for (size_t i = 0; i < kLanes; i++) {
+      acc[i] = init[i];
+    }
+  }
+  void Accumulate(const char* p, const uint64_t* secret) {
+    for (size_t i = 0; i < kLanes; i++) {
+      const uint64_t d = DecodeFixed64(p + 8 * i);
+      const uint64_t k = d ^ secret[i];
+      acc[i ^ 1] += d;
+      acc[i] += (k & 0xffffffffu) * (k >> 32);
+    }
+  }
+  void Scramble(const uint64_t* secret) {
+    for (size_t i = 0; i < kLanes; i++) {
+      const uint64_t a = acc[i] ^ (acc[i] >> 47) ^ secret[i];
+      acc[i] = a * kPrime32;
+    }
+  }
+  void Store(uint64_t* out) const {
+    for (size_t i = 0; i < kLanes; i++) {
+      out[i] = acc[i];
+    }
+  }
+
+  uint64_t acc[kLanes];
+};
+
+template <typename Accumulators>
+uint64_t HashLongImpl(const char* data, size_t n, uint64_t seed) {
+  uint64_t init[kLanes];
+  for (size_t i = 0; i < kLanes; i++) {
+    init[i] = kSecret.w[i] ^ seed;
+  }
+  Accumulators acc(init);
+
+  // 最后一个 stripe 单独处理，这里只处理它之前的完整 stripe
+  const char* p = data;
+  const size_t stripes = (n - 1) / kStripeLen;
+  for (size_t s = 0; s < stripes; s++) {
+    const size_t in_block = s % kStripesPerBlock;
+    acc.Accumulate(p, kSecret.w + in_block);
+    p += kStripeLen;
+    if (in_block == kStripesPerBlock - 1) {
+      acc.Scramble(kSecret.w + kStripesPerBlock);
+    }
+  }
+  // 最后 64 个字节，可能与前面重叠
+  acc.Accumulate(data + n - kStripeLen, kSecret.w + 7);
+
+  uint64_t out[kLanes];
+  acc.Store(out);
+  uint64_t h = n * kP0 ^ seed;
+  for (size_t i = 0; i < kLanes; i += 2) {
+    h = Mix(out[i] ^ kP1 ^ h, out[i + 1] ^ kSecret.w[i]);
+  }
+  return Mix(h ^ kP2, n ^ kP3);
+}
+
+}  // namespace
+
+uint64_t HashLong(const char* data, size_t n, uint64_t seed) {
+#if defined(LEVELDB_SSE2)
+  return HashLongImpl<Sse2Accumulators>(data, n, seed);
+#else
+  return HashLongImpl<PortableAccumulators>(data, n, seed);
+#endif
+}
+
+uint64_t HashLongPortable(const char* data, size_t n, uint64_t seed) {
+  return HashLongImpl<PortableAccumulators>(data, n, seed);
+}
+
+}  // namespace hash_internal
+}  // namespace leveldb
@@ -0,0 +1,122 @@
+#ifndef STORAGE_LEVELDB_UTIL_HASH_H_
+#define STORAGE_LEVELDB_UTIL_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "util/coding.h"
+
+namespace leveldb {
+
+// wyhash 风格的哈希，用于 bloom filter 和哈希分桶
+// 按小端读取输入，结果与平台无关，可以持久化（filter block 中保存的就是它）
+// 不超过 256 字节的输入全部内联计算；更长的输入交给 HashLong，
+// 用 8 路累加器按 64 字节一组处理，支持 SSE2 时用向量指令，结果相同
+
+namespace hash_internal {
+
+constexpr uint64_t kP0 = 0xa0761d6478bd642full;
+constexpr uint64_t kP1 = 0xe7037ed1a0b428dbull;
+constexpr uint64_t kP2 = 0x8ebc6af09c88c6e3ull;
+constexpr uint64_t kP3 = 0x589965cc75374cc3ull;
+
+// 超过这个长度的输入使用 HashLong
+constexpr size_t kLongThreshold = 256;
+
+// 64x64 -> 128 位乘法，*a 为低 64 位，*b 为高 64 位
+inline void Mum(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = *a;
+  r *= *b;
+  *a = static_cast<uint64_t>(r);
+  *b = static_cast<uint64_t>(r >> 64);
+#else
+  const uint64_t ha = *a >> 32, hb = *b >> 32;
+  const uint64_t la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+  const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  const uint64_t t = rl + (rm0 << 32);
+  const uint64_t lo = t + (rm1 << 32);
+  const uint64_t c = (t < rl) + (lo < t);
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+inline uint64_t Mix(uint64_t a, uint64_t b) {
+  Mum(&a, &b);
+  return a ^ b;
+}
+
+// 读取 1 到 3 个字节
+inline uint64_t Read3(const char* p, size_t n) {
+  return (static_cast<uint64_t>(static_cast<uint8_t>(p[0])) << 16) |
+         (static_cast<uint64_t>(static_cast<uint8_t>(p[n >> 1])) << 8) |
+         static_cast<uint64_t>(static_cast<uint8_t>(p[n - 1]));
+}
+
+uint64_t HashLong(const char* data, size_t n, uint64_t seed);
+
+// 不使用向量指令的 HashLong，结果相同，供测试对比两种实现
+uint64_t HashLongPortable(const char* data, size_t n, uint64_t seed);
+
+}  // namespace hash_internal
+
+inline uint64_t Hash64(const char* data, size_t n, uint64_t seed) {
+  using namespace hash_internal;
+  if (n > kLongThreshold) {
+    return HashLong(data, n, seed);
+  }
+  const char* p = data;
+  seed ^= Mix(seed ^ kP0, kP1);
+  uint64_t a, b;
+  if (n <= 16) {
+    if (n >= 4) {
+      // 首尾各取 4 个字节，再各取一段与它们可能重叠的 4 个字节
+      const size_t d = (n >> 3) << 2;
+      a = (static_cast<uint64_t>(DecodeFixed32(p)) << 32) |
+          DecodeFixed32(p + d);
+      b = (static_cast<uint64_t>(DecodeFixed32(p + n - 4)) << 32) |
+          DecodeFixed32(p + n - 4 - d);
+    } else if (n > 0) {
+      a = Read3(p, n);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = n;
+    if (i > 48) {
+      // 三条互不依赖的链，乘法可以并行
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = Mix(DecodeFixed64(p) ^ kP1, DecodeFixed64(p + 8) ^ seed);
+        see1 = Mix(DecodeFixed64(p + 16) ^ kP2, DecodeFixed64(p + 24) ^ see1);
+        see2 = Mix(DecodeFixed64(p + 32) ^ kP3, DecodeFixed64(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = Mix(DecodeFixed64(p) ^ kP1, DecodeFixed64(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    // 最后 16 个字节，可能与前面重叠
+    a = DecodeFixed64(p + i - 16);
+    b = DecodeFixed64(p + i - 8);
+  }
+  a ^= kP1;
+  b ^= seed;
+  Mum(&a, &b);
+  return Mix(a ^ kP0 ^ n, b ^ kP1);
+}
+
+inline uint32_t Hash(const char* data, size_t n, uint32_t seed) {
+  const uint64_t h = Hash64(data, n, seed);
+  return static_cast<uint32_t>(h ^ (h >> 32));
+}
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_HASH_H_
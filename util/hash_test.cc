@@ -0,0 +1,118 @@
+#include "util/hash.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+static std::string PatternBytes(size_t n) {
+  std::string s(n, '\0');
+  for (size_t i = 0; i < n; i++) {
+    s[i] = static_cast<char>(i * 131 + 7);
+  }
+  return s;
+}
+
+// Hash64 的结果保存在 filter block 中，不能随实现改变
+// 长度覆盖各个分支的边界: 0、1~3、4~16、17~48、多于 48、HashLong
+TEST(HashTest, Golden) {
+  struct Case {
+    size_t n;
+    uint64_t hash;
+  };
+  struct SeedCases {
+    uint64_t seed;
+    Case cases[10];
+  };
+  static const SeedCases kGolden[] = {
+      {0,
+       {{0, 0x0409638ee2bde459ull},
+        {3, 0x8e4fbcba74db6389ull},
+        {4, 0xe51e02146ebec632ull},
+        {16, 0x47340008ff15ca56ull},
+        {17, 0x8700d4e8fbdc902bull},
+        {48, 0xb61c237f7239a6efull},
+        {49, 0x601195ce2f825428ull},
+        {256, 0x324212f8c03583baull},
+        {257, 0xfa3bb7e20ce416b9ull},
+        {4096, 0x9b77ed9506a666b5ull}}},
+      {1,
+       {{0, 0xb8dc5edd260f4037ull},
+        {3, 0x4b809185e1f5fa2aull},
+        {4, 0xf21fbf3f27c0f211ull},
+        {16, 0x4d8313c6b8700cf1ull},
+        {17, 0x04e84acb8532e19eull},
+        {48, 0x329d6a26dd59037cull},
+        {49, 0xe4f628f85629aff4ull},
+        {256, 0x612d42713ec57f8full},
+        {257, 0x46414d72555f24b9ull},
+        {4096, 0x1f4f9a4d1fa2ae0eull}}},
+      {0xbc9f1d34,  // BloomHash 使用的 seed
+       {{0, 0x25ae910defbba1c8ull},
+        {3, 0x44274f41b97eff5bull},
+        {4, 0x6295caac2926d190ull},
+        {16, 0x56ca8403ea93bb32ull},
+        {17, 0x0ed04287b722cfb3ull},
+        {48, 0xe2025c91ea39491aull},
+        {49, 0x1ed44d8d87a4bb76ull},
+        {256, 0xf7b2a6debb0050bbull},
+        {257, 0x95fa49c6ea0a09ecull},
+        {4096, 0x91778fafa3b4e142ull}}},
+      {0xdeadbeefcafef00dull,
+       {{0, 0x649635a4df61c740ull},
+        {3, 0x56412c460b801a02ull},
+        {4, 0xd40c5003f0672f16ull},
+        {16, 0xd7333fb5c15322d2ull},
+        {17, 0x9a8d6b9f2902b423ull},
+        {48, 0x7429878e3878c4e2ull},
+        {49, 0x618e43a62cb56442ull},
+        {256, 0x1b52937e9934a308ull},
+        {257, 0xc913455b685ca973ull},
+        {4096, 0xfeb16f9edce4dec7ull}}},
+  };
+  const std::string data = PatternBytes(4096);
+  for (const SeedCases& s : kGolden) {
+    for (const Case& c : s.cases) {
+      ASSERT_EQ(c.hash, Hash64(data.data(), c.n, s.seed))
+          << "seed=" << s.seed << " n=" << c.n;
+    }
+  }
+}
+
+// SSE2 和标量的 HashLong 结果相同，包括不对齐的起始位置、
+// 不满一个 stripe 的尾部和跨过多个 block 的输入
+TEST(HashTest, LongImplsAgree) {
+  Random rnd(301);
+  std::string buf(20000, '\0');
+  for (char& c : buf) {
+    c = static_cast<char>(rnd.Uniform(256));
+  }
+  for (size_t n = hash_internal::kLongThreshold + 1; n < buf.size() - 8;
+       n += 1 + rnd.Uniform(200)) {
+    for (size_t offset = 0; offset < 8; offset += 3) {
+      const uint64_t seed = (static_cast<uint64_t>(rnd.Next()) << 32) | n;
+      const char* p = buf.data() + offset;
+      ASSERT_EQ(hash_internal::HashLongPortable(p, n, seed),
+                hash_internal::HashLong(p, n, seed))
+          << "n=" << n << " offset=" << offset;
+      ASSERT_EQ(hash_internal::HashLong(p, n, seed), Hash64(p, n, seed));
+    }
+  }
+}
+
+// 任意一个字节改变都会改变结果
+TEST(HashTest, EveryByteMatters) {
+  for (size_t n : {1, 3, 4, 16, 17, 48, 49, 256, 257, 1000}) {
+    std::string data = PatternBytes(n);
+    const uint64_t h = Hash64(data.data(), n, 0);
+    for (size_t i = 0; i < n; i++) {
+      data[i] ^= 1;
+      ASSERT_NE(h, Hash64(data.data(), n, 0)) << "n=" << n << " i=" << i;
+      data[i] ^= 1;
+    }
+  }
+}
+
+}  // namespace leveldb
@@ -0,0 +1,158 @@
+#include "util/ordered_coding.h"
+
+#include <cstring>
+
+namespace leveldb {
+
+namespace {
+
+void PutBigEndian(std::string* dst, uint64_t v, int bytes, bool descending) {
+  char buf[8];
+  for (int i = 0; i < bytes; i++) {
+    buf[i] = static_cast<char>(v >> (8 * (bytes - 1 - i)));
+    if (descending) buf[i] = ~buf[i];
+  }
+  dst->append(buf, bytes);
+}
+
+bool GetBigEndian(Slice* input, uint64_t* v, int bytes, bool descending) {
+  if (input->size() < static_cast<size_t>(bytes)) {
+    return false;
+  }
+  uint64_t result = 0;
+  for (int i = 0; i < bytes; i++) {
+    uint8_t c = static_cast<uint8_t>((*input)[i]);
+    if (descending) c = ~c;
+    result = (result << 8) | c;
+  }
+  input->remove_prefix(bytes);
+  *v = result;
+  return true;
+}
+
+const uint64_t kSignBit64 = uint64_t{1} << 63;
+const uint32_t kSignBit32 = uint32_t{1} << 31;
+
+// 字符串中的 0x00 转义为 0x00 0xff，结尾为 0x00 0x01
+const char kEscape = '\x00';
+const char kEscapedZero = '\xff';
+const char kTerminator = '\x01';
+
+}  // namespace
+
+void PutOrderedUint32(std::string* dst, uint32_t v, bool descending) {
+  PutBigEndian(dst, v, 4, descending);
+}
+
+void PutOrderedUint64(std::string* dst, uint64_t v, bool descending) {
+  PutBigEndian(dst, v, 8, descending);
+}
+
+void PutOrderedInt32(std::string* dst, int32_t v, bool descending) {
+  // 翻转符号位后，负数排在正数前面
+  PutBigEndian(dst, static_cast<uint32_t>(v) ^ kSignBit32, 4, descending);
+}
+
+void PutOrderedInt64(std::string* dst, int64_t v, bool descending) {
+  PutBigEndian(dst, static_cast<uint64_t>(v) ^ kSignBit64, 8, descending);
+}
+
+void PutOrderedDouble(std::string* dst, double v, bool descending) {
+  if (v == 0) v = 0;  // -0.0 和 0.0 相等
+  uint64_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  // 正数: 翻转符号位，排在负数后面
+  // 负数: 全部取反，绝对值越大排得越靠前
+  bits = (bits & kSignBit64) ? ~bits : (bits ^ kSignBit64);
+  PutBigEndian(dst, bits, 8, descending);
+}
+
+void PutOrderedString(std::string* dst, const Slice& v, bool descending) {
+  const size_t start = dst->size();
+  dst->reserve(start + v.size() + 2);
+  const char* p = v.data();
+  const char* limit = p + v.size();
+  while (p < limit) {
+    const char* zero =
+        static_cast<const char*>(std::memchr(p, kEscape, limit - p));
+    if (zero == nullptr) {
+      dst->append(p, limit - p);
+      break;
+    }
+    dst->append(p, zero - p);
+    dst->push_back(kEscape);
+    dst->push_back(kEscapedZero);
+    p = zero + 1;
+  }
+  dst->push_back(kEscape);
+  dst->push_back(kTerminator);
+  if (descending) {
+    for (size_t i = start; i < dst->size(); i++) {
+      (*dst)[i] = ~(*dst)[i];
+    }
+  }
+}
+
+bool GetOrderedUint32(Slice* input, uint32_t* v, bool descending) {
+  uint64_t r;
+  if (!GetBigEndian(input, &r, 4, descending)) return false;
+  *v = static_cast<uint32_t>(r);
+  return true;
+}
+
+bool GetOrderedUint64(Slice* input, uint64_t* v, bool descending) {
+  return GetBigEndian(input, v, 8, descending);
+}
+
+bool GetOrderedInt32(Slice* input, int32_t* v, bool descending) {
+  uint64_t r;
+  if (!GetBigEndian(input, &r, 4, descending)) return false;
+  *v = static_cast<int32_t>(static_cast<uint32_t>(r) ^ kSignBit32);
+  return true;
+}
+
+bool GetOrderedInt64(Slice* input, int64_t* v, bool descending) {
+  uint64_t r;
+  if (!GetBigEndian(input, &r, 8, descending)) return false;
+  *v = static_cast<int64_t>(r ^ kSignBit64);
+  return true;
+}
+
+bool GetOrderedDouble(Slice* input, double* v, bool descending) {
+  uint64_t bits;
+  if (!GetBigEndian(input, &bits, 8, descending)) return false;
+  bits = (bits & kSignBit64) ? (bits ^ kSignBit64) : ~bits;
+  std::memcpy(v, &bits, sizeof(bits));
+  return true;
+}
+
+bool GetOrderedString(Slice* input, std::string* v, bool descending) {
+  const char mask = descending ? '\xff' : '\x00';
+  v->clear();
+  const char* p = input->data();
+  const char* limit = p + input->size();
+  while (p < limit) {
+    const char c = *p ^ mask;
+    if (c != kEscape) {
+      v->push_back(c);
+      p++;
+      continue;
+    }
+    if (p + 1 >= limit) {
+      return false;
+    }
+    const char next = p[1] ^ mask;
+    if (next == kTerminator) {
+      input->remove_prefix(p + 2 - input->data());
+      return true;
+    } else if (next == kEscapedZero) {
+      v->push_back(kEscape);
+      p += 2;
+    } else {
+      return false;
+    }
+  }
+  return false;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,54 @@
+#ifndef STORAGE_LEVELDB_UTIL_ORDERED_CODING_H_
+#define STORAGE_LEVELDB_UTIL_ORDERED_CODING_H_
+
+#include <cstdint>
+#include <string>
+
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+// 保序编码（normalized key）: 把由整数、浮点数、字符串组成的复合 key
+// 编码成一个字节串，字节串按 memcmp 的顺序就是字段逐个比较的逻辑顺序
+// 这样复合 key 可以直接使用 BytewiseComparator()，不需要自定义比较器
+//
+// 每个字段都是自定界的（任何一个字段的编码都不是另一个的前缀），
+// 所以字段可以直接拼接；descending 为 true 时把该字段的编码按位取反，得到降序
+//
+//   整数      : 大端定长，有符号数翻转符号位
+//   浮点数    : 正数翻转符号位，负数全部取反，-0.0 与 0.0 编码相同
+//   字符串    : 0x00 转义为 0x00 0xff，以 0x00 0x01 结尾
+
+void PutOrderedUint32(std::string* dst, uint32_t v, bool descending = false);
+void PutOrderedUint64(std::string* dst, uint64_t v, bool descending = false);
+void PutOrderedInt32(std::string* dst, int32_t v, bool descending = false);
+void PutOrderedInt64(std::string* dst, int64_t v, bool descending = false);
+void PutOrderedDouble(std::string* dst, double v, bool descending = false);
+void PutOrderedString(std::string* dst, const Slice& v,
+                      bool descending = false);
+
+// 从 *input 的开头解析一个字段并前移 *input，格式不对时返回 false
+// descending 必须与编码时相同
+bool GetOrderedUint32(Slice* input, uint32_t* v, bool descending = false);
+bool GetOrderedUint64(Slice* input, uint64_t* v, bool descending = false);
+bool GetOrderedInt32(Slice* input, int32_t* v, bool descending = false);
+bool GetOrderedInt64(Slice* input, int64_t* v, bool descending = false);
+bool GetOrderedDouble(Slice* input, double* v, bool descending = false);
+bool GetOrderedString(Slice* input, std::string* v, bool descending = false);
+
+// 返回 key 前 8 个字节按大端解释的整数，不足 8 字节时补 0
+// 对按字节序比较的 key，a 的前缀 < b 的前缀 可以推出 a < b，
+// 前缀相等时才需要比较完整的 key
+inline uint64_t NormalizedKeyPrefix(const char* data, size_t n) {
+  uint64_t prefix = 0;
+  const size_t m = n < 8 ? n : 8;
+  for (size_t i = 0; i < m; i++) {
+    prefix |= static_cast<uint64_t>(static_cast<uint8_t>(data[i]))
+              << (56 - 8 * i);
+  }
+  return prefix;
+}
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_ORDERED_CODING_H_
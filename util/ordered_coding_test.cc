@@ -0,0 +1,235 @@
+#include "util/ordered_coding.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+namespace {
+
+int Sign(int r) { return (r > 0) - (r < 0); }
+
+template <typename T>
+int Compare(T a, T b) {
+  return (a > b) - (a < b);
+}
+
+uint64_t Random64(Random* rnd) {
+  uint64_t v = (static_cast<uint64_t>(rnd->Next()) << 33) ^
+               (static_cast<uint64_t>(rnd->Next()) << 11) ^ rnd->Next();
+  // 经常取较小的值和边界附近的值
+  switch (rnd->Uniform(4)) {
+    case 0:
+      return v & 0xff;
+    case 1:
+      return ~(v & 0xff);
+    default:
+      return v;
+  }
+}
+
+}  // namespace
+
+// 编码按 memcmp 的顺序与数值顺序相同，并且可以原样解码
+TEST(OrderedCodingTest, Integers) {
+  Random rnd(301);
+  for (int i = 0; i < 100000; i++) {
+    const uint64_t a = Random64(&rnd), b = Random64(&rnd);
+    const bool desc = rnd.OneIn(2);
+    const int flip = desc ? -1 : 1;
+
+    std::string ea, eb;
+    PutOrderedUint64(&ea, a, desc);
+    PutOrderedUint64(&eb, b, desc);
+    ASSERT_EQ(flip * Compare(a, b), Sign(Slice(ea).compare(eb)));
+    Slice in(ea);
+    uint64_t u64;
+    ASSERT_TRUE(GetOrderedUint64(&in, &u64, desc));
+    ASSERT_EQ(a, u64);
+    ASSERT_TRUE(in.empty());
+
+    ea.clear();
+    eb.clear();
+    PutOrderedInt64(&ea, static_cast<int64_t>(a), desc);
+    PutOrderedInt64(&eb, static_cast<int64_t>(b), desc);
+    ASSERT_EQ(flip * Compare(static_cast<int64_t>(a), static_cast<int64_t>(b)),
+              Sign(Slice(ea).compare(eb)));
+    in = ea;
+    int64_t i64;
+    ASSERT_TRUE(GetOrderedInt64(&in, &i64, desc));
+    ASSERT_EQ(static_cast<int64_t>(a), i64);
+
+    ea.clear();
+    eb.clear();
+    PutOrderedUint32(&ea, static_cast<uint32_t>(a), desc);
+    PutOrderedUint32(&eb, static_cast<uint32_t>(b), desc);
+    ASSERT_EQ(
+        flip * Compare(static_cast<uint32_t>(a), static_cast<uint32_t>(b)),
+        Sign(Slice(ea).compare(eb)));
+    in = ea;
+    uint32_t u32;
+    ASSERT_TRUE(GetOrderedUint32(&in, &u32, desc));
+    ASSERT_EQ(static_cast<uint32_t>(a), u32);
+
+    ea.clear();
+    eb.clear();
+    PutOrderedInt32(&ea, static_cast<int32_t>(a), desc);
+    PutOrderedInt32(&eb, static_cast<int32_t>(b), desc);
+    ASSERT_EQ(flip * Compare(static_cast<int32_t>(a), static_cast<int32_t>(b)),
+              Sign(Slice(ea).compare(eb)));
+    in = ea;
+    int32_t i32;
+    ASSERT_TRUE(GetOrderedInt32(&in, &i32, desc));
+    ASSERT_EQ(static_cast<int32_t>(a), i32);
+  }
+}
+
+TEST(OrderedCodingTest, Doubles) {
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<double> values = {-inf,
+                                -std::numeric_limits<double>::max(),
+                                -1e10,
+                                -1.5,
+                                -std::numeric_limits<double>::denorm_min(),
+                                -0.0,
+                                0.0,
+                                std::numeric_limits<double>::denorm_min(),
+                                std::numeric_limits<double>::min(),
+                                1.0,
+                                1.0000000000000002,
+                                1e300,
+                                inf};
+  Random rnd(17);
+  for (int i = 0; i < 2000; i++) {
+    uint64_t bits = Random64(&rnd);
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    if (!std::isnan(d)) {
+      values.push_back(d);
+    }
+  }
+  for (bool desc : {false, true}) {
+    std::vector<std::string> encoded;
+    for (double v : values) {
+      std::string e;
+      PutOrderedDouble(&e, v, desc);
+      Slice in(e);
+      double decoded;
+      ASSERT_TRUE(GetOrderedDouble(&in, &decoded, desc));
+      ASSERT_TRUE(in.empty());
+      ASSERT_EQ(v, decoded);  // -0.0 与 0.0 相等
+      encoded.push_back(e);
+    }
+    for (size_t i = 0; i < values.size(); i++) {
+      for (size_t j = 0; j < values.size(); j += 7) {
+        ASSERT_EQ((desc ? -1 : 1) * Compare(values[i], values[j]),
+                  Sign(Slice(encoded[i]).compare(encoded[j])))
+            << values[i] << " " << values[j];
+      }
+    }
+  }
+}
+
+TEST(OrderedCodingTest, Strings) {
+  Random rnd(99);
+  std::vector<std::string> values = {"", std::string(1, '\0'),
+                                     std::string(2, '\0'), "a",
+                                     std::string("a\0", 2), "a\xff", "ab",
+                                     "\xff\xff"};
+  for (int i = 0; i < 300; i++) {
+    std::string s;
+    const int len = rnd.Uniform(6);
+    for (int j = 0; j < len; j++) {
+      // 只用几个字符，制造大量公共前缀和 0x00、0xff
+      static const char kAlphabet[] = {'\0', '\x01', 'a', '\xfe', '\xff'};
+      s.push_back(kAlphabet[rnd.Uniform(5)]);
+    }
+    values.push_back(s);
+  }
+  for (bool desc : {false, true}) {
+    std::vector<std::string> encoded;
+    for (const std::string& v : values) {
+      std::string e;
+      PutOrderedString(&e, v, desc);
+      // 后面接着另一个字段，检查编码是自定界的
+      PutOrderedUint32(&e, 7);
+      Slice in(e);
+      std::string decoded;
+      ASSERT_TRUE(GetOrderedString(&in, &decoded, desc));
+      ASSERT_EQ(v, decoded);
+      uint32_t next;
+      ASSERT_TRUE(GetOrderedUint32(&in, &next));
+      ASSERT_EQ(7u, next);
+      encoded.push_back(e);
+    }
+    for (size_t i = 0; i < values.size(); i++) {
+      for (size_t j = 0; j < values.size(); j++) {
+        ASSERT_EQ((desc ? -1 : 1) * Sign(Slice(values[i]).compare(values[j])),
+                  Sign(Slice(encoded[i]).compare(encoded[j])));
+      }
+    }
+  }
+}
+
+// 复合 key 的编码顺序与逐字段比较的顺序相同
+TEST(OrderedCodingTest, CompositeKeys) {
+  Random rnd(5);
+  struct Row {
+    int32_t a;
+    std::string b;
+    uint64_t c;
+  };
+  std::vector<Row> rows;
+  std::vector<std::string> keys;
+  for (int i = 0; i < 500; i++) {
+    Row r{static_cast<int32_t>(rnd.Uniform(5)) - 2,
+          std::string(rnd.Uniform(3), 'a' + rnd.Uniform(2)), rnd.Uniform(4)};
+    std::string k;
+    PutOrderedInt32(&k, r.a);
+    PutOrderedString(&k, r.b);
+    PutOrderedUint64(&k, r.c, true);
+    rows.push_back(r);
+    keys.push_back(k);
+  }
+  for (size_t i = 0; i < rows.size(); i++) {
+    for (size_t j = 0; j < rows.size(); j++) {
+      int expected = Compare(rows[i].a, rows[j].a);
+      if (expected == 0) expected = Sign(rows[i].b.compare(rows[j].b));
+      if (expected == 0) expected = -Compare(rows[i].c, rows[j].c);
+      ASSERT_EQ(expected, Sign(Slice(keys[i]).compare(keys[j])));
+    }
+  }
+}
+
+TEST(OrderedCodingTest, Malformed) {
+  Slice in("\x01\x02", 2);
+  uint32_t u32;
+  ASSERT_FALSE(GetOrderedUint32(&in, &u32));
+  std::string s;
+  in = Slice("ab", 2);  // 没有结束标记
+  ASSERT_FALSE(GetOrderedString(&in, &s));
+}
+
+TEST(OrderedCodingTest, NormalizedKeyPrefix) {
+  Random rnd(3);
+  for (int i = 0; i < 10000; i++) {
+    std::string a(rnd.Uniform(12), '\0'), b(rnd.Uniform(12), '\0');
+    for (char& c : a) c = static_cast<char>(rnd.Uniform(3) + 0xfe);
+    for (char& c : b) c = static_cast<char>(rnd.Uniform(3) + 0xfe);
+    const uint64_t pa = NormalizedKeyPrefix(a.data(), a.size());
+    const uint64_t pb = NormalizedKeyPrefix(b.data(), b.size());
+    if (pa < pb) {
+      ASSERT_LT(Slice(a).compare(b), 0);
+    } else if (pa > pb) {
+      ASSERT_GT(Slice(a).compare(b), 0);
+    }
+  }
+}
+
+}  // namespace leveldb
@@ -5,9 +5,44 @@
 
 namespace leveldb {
 
+// 简单的伪随机数生成器（Park-Miller），跳表用它来决定节点高度
 class Random {
  private:
- 
+  uint32_t seed_;
+
+ public:
+  explicit Random(uint32_t s) : seed_(s & 0x7fffffffu) {
+    // 避免错误的种子
+    if (seed_ == 0 || seed_ == 2147483647L) {
+      seed_ = 1;
+    }
+  }
+
+  uint32_t Next() {
+    static const uint32_t M = 2147483647L;  // 2^31-1
+    static const uint64_t A = 16807;        // bits 14, 8, 7, 5, 2, 1, 0
+    // 计算 seed_ = (seed_ * A) % M，其中 M = 2^31-1
+    // 利用 ((x << 31) % M) == x 避免取模运算
+    uint64_t product = seed_ * A;
+    seed_ = static_cast<uint32_t>((product >> 31) + (product & M));
+    // 第一次约简可能溢出 1 位，再减一次
+    if (seed_ > M) {
+      seed_ -= M;
+    }
+    return seed_;
+  }
+
+  // 返回 [0..n-1] 之间均匀分布的值
+  // 要求: n > 0
+  uint32_t Uniform(int n) { return Next() % n; }
+
+  // 大约每 n 次返回一次 true
+  // 要求: n > 0
+  bool OneIn(int n) { return (Next() % n) == 0; }
+
+  // 先均匀地从 [0, max_log] 中选出 base，再返回 [0, 2^base - 1] 中的值
+  // 偏向于返回较小的数
+  uint32_t Skewed(int max_log) { return Uniform(1 << Uniform(max_log + 1)); }
 };
 
 
@@ -0,0 +1,272 @@
+#include "util/rate_limiter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+
+#include "leveldb/env.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+RateLimiter::~RateLimiter() = default;
+
+namespace {
+
+class GenericRateLimiter : public RateLimiter {
+ public:
+  GenericRateLimiter(int64_t rate_bytes_per_sec, int64_t refill_period_us,
+                     int32_t fairness, bool auto_tuned)
+      : refill_period_(refill_period_us),
+        fairness_(fairness > 0 ? fairness : 1),
+        auto_tuned_(auto_tuned),
+        max_bytes_per_sec_(rate_bytes_per_sec),
+        rate_bytes_per_sec_(0),
+        refill_bytes_per_period_(0),
+        available_bytes_(0),
+        next_refill_(Clock::now()),
+        refills_(0),
+        tune_start_(next_refill_),
+        num_drains_(0) {
+    assert(rate_bytes_per_sec > 0 && refill_period_us > 0);
+    total_bytes_[IO_LOW] = 0;
+    total_bytes_[IO_HIGH] = 0;
+    // 自动调整时从上限的一半开始
+    SetBytesPerSecondLocked(auto_tuned ? std::max<int64_t>(
+                                             rate_bytes_per_sec / 2, 1)
+                                       : rate_bytes_per_sec);
+  }
+
+  void SetBytesPerSecond(int64_t bytes_per_second) override {
+    assert(bytes_per_second > 0);
+    std::lock_guard<std::mutex> l(mutex_);
+    if (auto_tuned_) {
+      // 自动调整时修改的是上限
+      max_bytes_per_sec_ = bytes_per_second;
+      bytes_per_second =
+          std::min(rate_bytes_per_sec_.load(std::memory_order_relaxed),
+                   bytes_per_second);
+    }
+    SetBytesPerSecondLocked(bytes_per_second);
+  }
+
+  int64_t GetBytesPerSecond() const override {
+    return rate_bytes_per_sec_.load(std::memory_order_relaxed);
+  }
+
+  int64_t GetSingleBurstBytes() const override {
+    return refill_bytes_per_period_.load(std::memory_order_relaxed);
+  }
+
+  int64_t GetTotalBytesThrough(IOPriority pri) const override {
+    if (pri == IO_TOTAL) {
+      return total_bytes_[IO_LOW].load(std::memory_order_relaxed) +
+             total_bytes_[IO_HIGH].load(std::memory_order_relaxed);
+    }
+    return total_bytes_[pri].load(std::memory_order_relaxed);
+  }
+
+  void Request(int64_t bytes, IOPriority pri) override {
+    assert(pri == IO_LOW || pri == IO_HIGH);
+    std::unique_lock<std::mutex> l(mutex_);
+    // 速度可能刚被调低，超出的部分不再计较
+    bytes = std::min(bytes, refill_bytes_per_period_.load(
+                                std::memory_order_relaxed));
+    total_bytes_[pri].fetch_add(bytes, std::memory_order_relaxed);
+
+    const Clock::time_point now = Clock::now();
+    if (now >= next_refill_) {
+      Refill(now);
+    }
+    if (queue_[IO_LOW].empty() && queue_[IO_HIGH].empty() &&
+        available_bytes_ >= bytes) {
+      available_bytes_ -= bytes;
+      return;
+    }
+
+    // 配额不足，排队等下一次补充；到时间时由正在等待的线程或者新的请求负责补充
+    Req r(bytes);
+    queue_[pri].push_back(&r);
+    while (!r.granted) {
+      const Clock::time_point now = Clock::now();
+      if (now >= next_refill_) {
+        Refill(now);
+      } else {
+        cv_.wait_until(l, next_refill_);
+      }
+    }
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // 每隔多少个补充周期自动调整一次速度
+  static constexpr int kRefillsPerTune = 100;
+  // 配额用完的周期超过这个比例时提高速度，低于 kLowWatermarkPct 时降低
+  static constexpr int kHighWatermarkPct = 90;
+  static constexpr int kLowWatermarkPct = 50;
+  // 每次调整的幅度
+  static constexpr int kAdjustFactorPct = 5;
+  // 自动调整的下限为上限的 1/kAllowedRangeFactor
+  static constexpr int kAllowedRangeFactor = 20;
+
+  struct Req {
+    explicit Req(int64_t b) : bytes(b), granted(false) {}
+
+    int64_t bytes;  // 还差多少字节
+    bool granted;
+  };
+
+  void SetBytesPerSecondLocked(int64_t bytes_per_second) {
+    rate_bytes_per_sec_.store(bytes_per_second, std::memory_order_relaxed);
+    const int64_t period_us = refill_period_.count();
+    int64_t refill_bytes;
+    if (bytes_per_second > std::numeric_limits<int64_t>::max() / period_us) {
+      refill_bytes = std::numeric_limits<int64_t>::max() / 1000000;
+    } else {
+      refill_bytes = bytes_per_second * period_us / 1000000;
+    }
+    refill_bytes_per_period_.store(std::max<int64_t>(refill_bytes, 1),
+                                   std::memory_order_relaxed);
+  }
+
+  // 补充一个周期的配额并按优先级分给等待的请求，要求持有 mutex_
+  void Refill(Clock::time_point now) {
+    // 按固定的节拍补充，等待的线程醒得晚一点也不会让周期变长，
+    // 否则配额一直被用完时统计出的比例也达不到 kHighWatermarkPct；
+    // 空闲了一个周期以上时从现在重新开始
+    next_refill_ += refill_period_;
+    if (next_refill_ <= now) {
+      next_refill_ = now + refill_period_;
+    }
+    if (!queue_[IO_LOW].empty() || !queue_[IO_HIGH].empty()) {
+      num_drains_++;
+    }
+    if (auto_tuned_ && now - tune_start_ >= kRefillsPerTune * refill_period_) {
+      Tune(now);
+    }
+
+    // 配额不跨周期累积，空闲很久之后也不会突发大量写入
+    available_bytes_ = refill_bytes_per_period_.load(std::memory_order_relaxed);
+    const bool low_first = (++refills_ % fairness_) == 0;
+    const IOPriority order[2] = {low_first ? IO_LOW : IO_HIGH,
+                                 low_first ? IO_HIGH : IO_LOW};
+    for (IOPriority pri : order) {
+      std::deque<Req*>* queue = &queue_[pri];
+      while (!queue->empty() && available_bytes_ > 0) {
+        Req* r = queue->front();
+        if (available_bytes_ < r->bytes) {
+          // 先给一部分，剩下的等下一次补充
+          r->bytes -= available_bytes_;
+          available_bytes_ = 0;
+          break;
+        }
+        available_bytes_ -= r->bytes;
+        r->granted = true;
+        queue->pop_front();
+      }
+    }
+    cv_.notify_all();
+  }
+
+  // 根据最近一段时间内配额被用完的比例调整速度
+  void Tune(Clock::time_point now) {
+    const int64_t elapsed_periods = (now - tune_start_) / refill_period_;
+    const int64_t drained_pct =
+        num_drains_ * 100 / std::max<int64_t>(elapsed_periods, 1);
+    const int64_t rate = rate_bytes_per_sec_.load(std::memory_order_relaxed);
+    int64_t new_rate = rate;
+    if (drained_pct > kHighWatermarkPct) {
+      new_rate = rate + std::max<int64_t>(rate * kAdjustFactorPct / 100, 1);
+    } else if (drained_pct < kLowWatermarkPct) {
+      new_rate = rate - rate * kAdjustFactorPct / 100;
+    }
+    const int64_t min_rate =
+        std::max<int64_t>(max_bytes_per_sec_ / kAllowedRangeFactor, 1);
+    new_rate = std::min(std::max(new_rate, min_rate), max_bytes_per_sec_);
+    if (new_rate != rate) {
+      SetBytesPerSecondLocked(new_rate);
+    }
+    tune_start_ = now;
+    num_drains_ = 0;
+  }
+
+  const std::chrono::microseconds refill_period_;
+  const int32_t fairness_;
+  const bool auto_tuned_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+
+  // 以下由 mutex_ 保护，原子变量只是为了可以不加锁读取
+  int64_t max_bytes_per_sec_;
+  std::atomic<int64_t> rate_bytes_per_sec_;
+  std::atomic<int64_t> refill_bytes_per_period_;
+  int64_t available_bytes_;
+  Clock::time_point next_refill_;
+  int64_t refills_;
+  std::deque<Req*> queue_[2];
+
+  // 自动调整使用
+  Clock::time_point tune_start_;
+  int64_t num_drains_;  // tune_start_ 之后有请求在等待的补充周期数
+
+  std::atomic<int64_t> total_bytes_[2];
+};
+
+class RateLimitedWritableFile : public WritableFile {
+ public:
+  RateLimitedWritableFile(WritableFile* base, RateLimiter* limiter,
+                          RateLimiter::IOPriority pri)
+      : base_(base), limiter_(limiter), pri_(pri) {}
+
+  ~RateLimitedWritableFile() override { delete base_; }
+
+  Status Append(const Slice& data) override {
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+      const size_t n = std::min<size_t>(
+          left, static_cast<size_t>(limiter_->GetSingleBurstBytes()));
+      limiter_->Request(static_cast<int64_t>(n), pri_);
+      Status s = base_->Append(Slice(p, n));
+      if (!s.ok()) {
+        return s;
+      }
+      p += n;
+      left -= n;
+    }
+    return Status::OK();
+  }
+
+  Status Close() override { return base_->Close(); }
+  Status Flush() override { return base_->Flush(); }
+  Status Sync() override { return base_->Sync(); }
+
+ private:
+  WritableFile* const base_;
+  RateLimiter* const limiter_;
+  const RateLimiter::IOPriority pri_;
+};
+
+}  // namespace
+
+RateLimiter* NewGenericRateLimiter(int64_t rate_bytes_per_sec,
+                                   int64_t refill_period_us, int32_t fairness,
+                                   bool auto_tuned) {
+  return new GenericRateLimiter(rate_bytes_per_sec, refill_period_us, fairness,
+                                auto_tuned);
+}
+
+WritableFile* NewRateLimitedWritableFile(WritableFile* base,
+                                         RateLimiter* limiter,
+                                         RateLimiter::IOPriority pri) {
+  return new RateLimitedWritableFile(base, limiter, pri);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,18 @@
+#ifndef STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
+
+#include "leveldb/rate_limiter.h"
+
+namespace leveldb {
+
+class WritableFile;
+
+// 返回一个写入前先向 limiter 申请配额的 WritableFile，
+// 其余操作直接转发给 base；返回的对象拥有 base
+WritableFile* NewRateLimitedWritableFile(WritableFile* base,
+                                         RateLimiter* limiter,
+                                         RateLimiter::IOPriority pri);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
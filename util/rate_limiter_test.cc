@@ -0,0 +1,249 @@
+#include "util/rate_limiter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/env.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// 记录每次 Append 的大小和内容
+class RecordingFile : public WritableFile {
+ public:
+  explicit RecordingFile(bool* deleted) : deleted_(deleted) {}
+  ~RecordingFile() override { *deleted_ = true; }
+
+  Status Append(const Slice& data) override {
+    appends.push_back(data.size());
+    contents.append(data.data(), data.size());
+    return Status::OK();
+  }
+  Status Close() override {
+    closes++;
+    return Status::OK();
+  }
+  Status Flush() override {
+    flushes++;
+    return Status::OK();
+  }
+  Status Sync() override {
+    syncs++;
+    return Status::OK();
+  }
+
+  std::vector<size_t> appends;
+  std::string contents;
+  int closes = 0;
+  int flushes = 0;
+  int syncs = 0;
+
+ private:
+  bool* const deleted_;
+};
+
+}  // namespace
+
+TEST(RateLimiterTest, SetBytesPerSecond) {
+  // 每 100ms 补充一次，每次 100KB
+  std::unique_ptr<RateLimiter> limiter(
+      NewGenericRateLimiter(1000 * 1000, 100 * 1000, 10));
+  ASSERT_EQ(1000 * 1000, limiter->GetBytesPerSecond());
+  ASSERT_EQ(100 * 1000, limiter->GetSingleBurstBytes());
+
+  limiter->SetBytesPerSecond(2000 * 1000);
+  ASSERT_EQ(2000 * 1000, limiter->GetBytesPerSecond());
+  ASSERT_EQ(200 * 1000, limiter->GetSingleBurstBytes());
+
+  // 速度很低时每个周期至少 1 个字节
+  limiter->SetBytesPerSecond(1);
+  ASSERT_EQ(1, limiter->GetSingleBurstBytes());
+
+  // 乘以周期会溢出时不溢出
+  limiter->SetBytesPerSecond(std::numeric_limits<int64_t>::max());
+  ASSERT_GT(limiter->GetSingleBurstBytes(), 0);
+}
+
+// 多个线程一起写时，实际的速度与设定的速度相符
+TEST(RateLimiterTest, Throughput) {
+  const int64_t kRate = 2 * 1000 * 1000;
+  const int64_t kPeriodUs = 10 * 1000;
+  for (int threads : {1, 4}) {
+    std::unique_ptr<RateLimiter> limiter(
+        NewGenericRateLimiter(kRate, kPeriodUs, 10));
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point deadline = start + std::chrono::milliseconds(500);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+        const RateLimiter::IOPriority pri =
+            (t % 2 == 0) ? RateLimiter::IO_HIGH : RateLimiter::IO_LOW;
+        while (Clock::now() < deadline) {
+          limiter->Request(1000 + 1000 * t, pri);
+        }
+      });
+    }
+    for (std::thread& w : workers) {
+      w.join();
+    }
+    const double elapsed = SecondsSince(start);
+    // 第一个周期的配额立即可用，最后一个请求可能在截止时间之后才完成
+    const double expected = kRate * elapsed + kRate * kPeriodUs / 1e6;
+    const double actual =
+        static_cast<double>(limiter->GetTotalBytesThrough());
+    ASSERT_GT(actual, expected * 0.8) << threads;
+    ASSERT_LT(actual, expected * 1.2) << threads;
+  }
+}
+
+// 高优先级的请求一直占满配额时，低优先级的请求不会一直等待
+TEST(RateLimiterTest, LowPriorityNotStarved) {
+  const int32_t kFairness = 5;
+  std::unique_ptr<RateLimiter> limiter(
+      NewGenericRateLimiter(1000 * 1000, 5 * 1000, kFairness));
+  const int64_t burst = limiter->GetSingleBurstBytes();
+  std::atomic<bool> done(false);
+  std::vector<std::thread> high;
+  for (int t = 0; t < 3; t++) {
+    high.emplace_back([&] {
+      while (!done.load(std::memory_order_relaxed)) {
+        limiter->Request(burst, RateLimiter::IO_HIGH);
+      }
+    });
+  }
+  // 低优先级的请求在高优先级的请求排满之后才开始
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  const Clock::time_point start = Clock::now();
+  int low_requests = 0;
+  while (low_requests < 10 &&
+         Clock::now() < start + std::chrono::seconds(5)) {
+    limiter->Request(burst, RateLimiter::IO_LOW);
+    low_requests++;
+  }
+  const double elapsed = SecondsSince(start);
+  done.store(true, std::memory_order_relaxed);
+  for (std::thread& t : high) {
+    t.join();
+  }
+  ASSERT_EQ(10, low_requests);
+  // 每 kFairness 个周期至少有一次先满足低优先级的请求
+  ASSERT_LT(elapsed, 10 * kFairness * 5e-3 * 2);
+  ASSERT_EQ(10 * burst,
+            limiter->GetTotalBytesThrough(RateLimiter::IO_LOW));
+  ASSERT_GT(limiter->GetTotalBytesThrough(RateLimiter::IO_HIGH),
+            limiter->GetTotalBytesThrough(RateLimiter::IO_LOW));
+}
+
+// 自动调整时速度始终在 [上限 / 20, 上限] 之间:
+// 负载很低时降到下限为止，配额总是被用完时升到上限为止
+TEST(RateLimiterTest, AutoTuneStaysInRange) {
+  const int64_t kMax = 1000 * 1000;
+  // 每 500us 补充一次，每 100 次补充调整一次
+  std::unique_ptr<RateLimiter> limiter(
+      NewGenericRateLimiter(kMax, 500, 10, /*auto_tuned=*/true));
+  ASSERT_EQ(kMax / 2, limiter->GetBytesPerSecond());
+
+  // 负载很低: 偶尔写一点，配额从来不会用完
+  Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+  while (limiter->GetBytesPerSecond() > kMax / 20 && Clock::now() < deadline) {
+    limiter->Request(1, RateLimiter::IO_LOW);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_GE(limiter->GetBytesPerSecond(), kMax / 20);
+    ASSERT_LE(limiter->GetBytesPerSecond(), kMax);
+  }
+  ASSERT_EQ(kMax / 20, limiter->GetBytesPerSecond());
+  for (int i = 0; i < 200; i++) {
+    limiter->Request(1, RateLimiter::IO_LOW);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(kMax / 20, limiter->GetBytesPerSecond());
+
+  // 修改上限: 当前速度不超过新的上限，配额一直被用完时升到上限为止
+  const int64_t kNewMax = kMax / 20 + kMax / 100;
+  limiter->SetBytesPerSecond(kNewMax);
+  ASSERT_EQ(kMax / 20, limiter->GetBytesPerSecond());
+  std::atomic<bool> done(false);
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 4; t++) {
+    writers.emplace_back([&] {
+      while (!done.load(std::memory_order_relaxed)) {
+        limiter->Request(limiter->GetSingleBurstBytes(),
+                         RateLimiter::IO_HIGH);
+      }
+    });
+  }
+  int64_t lowest = kNewMax, highest = 0;
+  deadline = Clock::now() + std::chrono::seconds(10);
+  do {
+    const int64_t rate = limiter->GetBytesPerSecond();
+    lowest = std::min(lowest, rate);
+    highest = std::max(highest, rate);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  } while (limiter->GetBytesPerSecond() < kNewMax && Clock::now() < deadline);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  highest = std::max(highest, limiter->GetBytesPerSecond());
+  done.store(true, std::memory_order_relaxed);
+  for (std::thread& t : writers) {
+    t.join();
+  }
+  ASSERT_GE(lowest, kNewMax / 20);
+  ASSERT_LE(highest, kNewMax);
+  ASSERT_EQ(kNewMax, limiter->GetBytesPerSecond());
+}
+
+// 超过一次能申请的字节数的 Append 分成多次写入，内容不变
+TEST(RateLimiterTest, RateLimitedWritableFile) {
+  // 每 1ms 补充 10000 字节
+  std::unique_ptr<RateLimiter> limiter(
+      NewGenericRateLimiter(10 * 1000 * 1000, 1000, 10));
+  ASSERT_EQ(10000, limiter->GetSingleBurstBytes());
+  bool deleted = false;
+  RecordingFile* base = new RecordingFile(&deleted);
+  std::unique_ptr<WritableFile> file(
+      NewRateLimitedWritableFile(base, limiter.get(), RateLimiter::IO_HIGH));
+
+  std::string data(25000, '\0');
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(i % 251);
+  }
+  ASSERT_TRUE(file->Append(data).ok());
+  ASSERT_TRUE(file->Append(Slice("abc")).ok());
+  ASSERT_TRUE(file->Append(Slice()).ok());
+  ASSERT_EQ((std::vector<size_t>{10000, 10000, 5000, 3}), base->appends);
+  ASSERT_EQ(data + "abc", base->contents);
+  ASSERT_EQ(25003, limiter->GetTotalBytesThrough(RateLimiter::IO_HIGH));
+  ASSERT_EQ(0, limiter->GetTotalBytesThrough(RateLimiter::IO_LOW));
+
+  // 按调整之后的大小切分
+  limiter->SetBytesPerSecond(4 * 1000 * 1000);
+  base->appends.clear();
+  ASSERT_TRUE(file->Append(Slice(data.data(), 9000)).ok());
+  ASSERT_EQ((std::vector<size_t>{4000, 4000, 1000}), base->appends);
+
+  ASSERT_TRUE(file->Flush().ok());
+  ASSERT_TRUE(file->Sync().ok());
+  ASSERT_TRUE(file->Close().ok());
+  ASSERT_EQ(1, base->flushes);
+  ASSERT_EQ(1, base->syncs);
+  ASSERT_EQ(1, base->closes);
+  ASSERT_FALSE(deleted);
+  file.reset();
+  ASSERT_TRUE(deleted);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,32 @@
+#ifndef STORAGE_LEVELDB_UTIL_TESTUTIL_H_
+#define STORAGE_LEVELDB_UTIL_TESTUTIL_H_
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/env.h"
+
+namespace leveldb {
+namespace test {
+
+// 返回测试专用的空目录，name 在所有测试中唯一
+// 目录中已有的文件（上次运行留下的）会被删除
+inline std::string TmpDir(const std::string& name) {
+  Env* env = Env::Default();
+  const std::string dir = testing::TempDir() + "leveldb_test_" + name;
+  env->CreateDir(dir);
+  std::vector<std::string> children;
+  env->GetChildren(dir, &children);
+  for (const std::string& child : children) {
+    if (child != "." && child != "..") {
+      env->RemoveFile(dir + "/" + child);
+    }
+  }
+  return dir;
+}
+
+}  // namespace test
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_TESTUTIL_H_